@@ -0,0 +1,30 @@
+#!/usr/bin/env sh
+#
+#   Travis CI build of libzmq. BUILD_TYPE selects the configuration:
+#
+#   default         builds and runs 'make check'.
+#   curve-aesgcm    also insists that the CURVE-AESGCM test really runs
+#                   AES-GCM, rather than being skipped for want of libsodium
+#                   or falling back to plain CURVE for want of CPU support.
+
+set -e
+
+./autogen.sh
+./configure
+make
+make check
+
+if [ "$BUILD_TYPE" = "curve-aesgcm" ]; then
+    #   libsodium implements AES-256-GCM with AES-NI and PCLMULQDQ only.
+    grep -qw aes /proc/cpuinfo || {
+        echo "CPU lacks AES-NI, cannot test CURVE-AESGCM"; exit 1; }
+    grep -qw pclmulqdq /proc/cpuinfo || {
+        echo "CPU lacks PCLMULQDQ, cannot test CURVE-AESGCM"; exit 1; }
+
+    output=`./tests/test_security_curve_aesgcm`
+    echo "$output"
+    if echo "$output" | grep -q skipping; then
+        echo "test_security_curve_aesgcm was skipped"
+        exit 1
+    fi
+fi
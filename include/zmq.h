@@ -178,10 +178,15 @@ ZMQ_EXPORT void zmq_version (int *major, int *minor, int *patch);
 /*  Context options                                                           */
 #define ZMQ_IO_THREADS  1
 #define ZMQ_MAX_SOCKETS 2
+#define ZMQ_FLIGHT_RECORDER 3
+#define ZMQ_LOOPBACK_SHORTCUT 4
+#define ZMQ_IO_THREAD_PINNING 5
+#define ZMQ_IO_THREAD_STATS 6
 
 /*  Default for new contexts                                                  */
 #define ZMQ_IO_THREADS_DFLT  1
 #define ZMQ_MAX_SOCKETS_DFLT 1023
+#define ZMQ_FLIGHT_RECORDER_DFLT 256
 
 ZMQ_EXPORT void *zmq_ctx_new (void);
 ZMQ_EXPORT int zmq_ctx_term (void *context);
@@ -189,6 +194,31 @@ ZMQ_EXPORT int zmq_ctx_shutdown (void *ctx_);
 ZMQ_EXPORT int zmq_ctx_set (void *context, int option, int optval);
 ZMQ_EXPORT int zmq_ctx_get (void *context, int option);
 
+/*  Event loop statistics of an I/O thread, see zmq_ctx_io_thread_stats      */
+typedef struct {
+    uint64_t busy_us;  // time spent processing, in microseconds
+    uint64_t wait_us;  // time spent waiting for events, in microseconds
+    uint64_t wakeups;  // number of returns from the wait for events
+    uint64_t events;   // file descriptor events processed
+    uint64_t timers;   // timers fired
+    uint64_t commands; // commands processed from the thread's mailbox
+    int32_t  load;     // number of file descriptors handled by the thread
+} zmq_io_thread_stats_t;
+
+ZMQ_EXPORT int zmq_ctx_io_thread_stats (void *context, int thread,
+    zmq_io_thread_stats_t *stats);
+ZMQ_EXPORT int zmq_ctx_flight_recorder_dump (void *context, const char *path);
+
+/*  Lock statistics of a mutex site, see zmq_mutex_stats                      */
+typedef struct {
+    const char *name;      // name of the site
+    uint64_t acquisitions; // number of times the mutexes were acquired
+    uint64_t contentions;  // acquisitions that found the mutex held
+    uint64_t wait_ns;      // time spent waiting for the mutexes
+} zmq_mutex_stats_t;
+
+ZMQ_EXPORT int zmq_mutex_stats (zmq_mutex_stats_t *stats, int count);
+
 /*  Old (legacy) API                                                          */
 ZMQ_EXPORT void *zmq_init (int io_threads);
 ZMQ_EXPORT int zmq_term (void *context);
@@ -294,6 +324,33 @@ ZMQ_EXPORT int zmq_msg_set (zmq_msg_t *msg, int option, int optval);
 #define ZMQ_IPC_FILTER_UID 59
 #define ZMQ_IPC_FILTER_GID 60
 #define ZMQ_CONNECT_RID 61 
+#define ZMQ_TCP_INCOMING_CPU 62
+#define ZMQ_TCP_FASTOPEN 63
+#define ZMQ_TCP_CONNECT_STAGGER 64
+#define ZMQ_STREAM_FRAMING 65
+#define ZMQ_STREAM_FRAME_SIZE 66
+#define ZMQ_STREAM_DELIMITER 67
+#define ZMQ_MONITOR_RING_FD 68
+#define ZMQ_MONITOR_RING_DROPPED 69
+#define ZMQ_HWM_TARGET_DELAY 70
+#define ZMQ_HWM_MIN 71
+#define ZMQ_INBOUND_POLL_RATE 72
+#define ZMQ_COMMAND_DELAY 73
+#define ZMQ_COMMAND_ADAPTIVE 74
+#define ZMQ_XPUB_PACING 75
+#define ZMQ_XPUB_EVICT_DROP_RATIO 76
+#define ZMQ_XPUB_EVICT_QUEUE_AGE 77
+#define ZMQ_XPUB_PEER_STATS 78
+#define ZMQ_TOPIC_PATTERNS 79
+#define ZMQ_BATCH_SIZE 80
+#define ZMQ_DEFERRED_RELEASE 81
+#define ZMQ_WARMUP 82
+#define ZMQ_CURVE_AESGCM 83
+#define ZMQ_XPUB_BROADCAST_RING 84
+#define ZMQ_XPUB_BROADCAST_BLOCK 85
+#define ZMQ_PING_IVL 86
+#define ZMQ_PEER_RTT_STATS 87
+#define ZMQ_TCP_MUX 88
 
 /*  Message options                                                           */
 #define ZMQ_MORE 1
@@ -308,6 +365,13 @@ ZMQ_EXPORT int zmq_msg_set (zmq_msg_t *msg, int option, int optval);
 #define ZMQ_PLAIN 1
 #define ZMQ_CURVE 2
 
+/*  ZMQ_STREAM framing decoders                                               */
+#define ZMQ_FRAMING_RAW 0
+#define ZMQ_FRAMING_FIXED 1
+#define ZMQ_FRAMING_LENGTH16 2
+#define ZMQ_FRAMING_LENGTH32 3
+#define ZMQ_FRAMING_DELIMITER 4
+
 /*  Deprecated options and aliases                                            */
 #define ZMQ_IPV4ONLY                31
 #define ZMQ_DELAY_ATTACH_ON_CONNECT ZMQ_IMMEDIATE
@@ -348,6 +412,30 @@ typedef struct {
     int32_t  value ; // value is either error code, fd or reconnect interval
 } zmq_event_t;
 
+/*  Socket event record, as delivered by the monitor ring  */
+typedef struct {
+    uint32_t event;    // id of the event as bitfield
+    int32_t  value;    // value is either error code, fd or reconnect interval
+    uint32_t endpoint; // interned endpoint id, see zmq_monitor_ring_endpoint
+} zmq_monitor_record_t;
+
+/*  Per-subscriber statistics of a PUB or XPUB socket, see ZMQ_XPUB_PEER_STATS */
+typedef struct {
+    uint64_t sent;     // messages queued for the subscriber
+    uint64_t dropped;  // messages dropped as the subscriber's queue was full
+    uint64_t paced;    // messages dropped by ZMQ_XPUB_PACING
+    uint32_t peer;     // id of the subscriber, unique within the socket
+} zmq_xpub_peer_stats_t;
+
+/*  Round-trip time statistics of a connection, see ZMQ_PEER_RTT_STATS       */
+typedef struct {
+    uint64_t samples;  // round trips measured
+    uint32_t srtt;     // smoothed round-trip time, in microseconds
+    uint32_t rttvar;   // round-trip time variation, in microseconds
+    uint32_t min_rtt;  // lowest round-trip time measured, in microseconds
+    uint32_t peer;     // id of the connection, unique within the socket
+} zmq_peer_rtt_stats_t;
+
 ZMQ_EXPORT void *zmq_socket (void *, int type);
 ZMQ_EXPORT int zmq_close (void *s);
 ZMQ_EXPORT int zmq_setsockopt (void *s, int option, const void *optval,
@@ -362,6 +450,11 @@ ZMQ_EXPORT int zmq_send (void *s, const void *buf, size_t len, int flags);
 ZMQ_EXPORT int zmq_send_const (void *s, const void *buf, size_t len, int flags);
 ZMQ_EXPORT int zmq_recv (void *s, void *buf, size_t len, int flags);
 ZMQ_EXPORT int zmq_socket_monitor (void *s, const char *addr, int events);
+ZMQ_EXPORT int zmq_socket_monitor_ring (void *s, int events, int capacity);
+ZMQ_EXPORT int zmq_monitor_ring_recv (void *s, zmq_monitor_record_t *records,
+    int count);
+ZMQ_EXPORT int zmq_monitor_ring_endpoint (void *s, uint32_t id, char *buf,
+    size_t size);
 
 ZMQ_EXPORT int zmq_sendmsg (void *s, zmq_msg_t *msg, int flags);
 ZMQ_EXPORT int zmq_recvmsg (void *s, zmq_msg_t *msg, int flags);
@@ -0,0 +1,509 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#endif
+
+//  Benchmarks the classic broker topology: REQ clients talking to REP
+//  workers through a chain of ROUTER/DEALER proxies. The whole topology
+//  can run in a single process, or the broker, the clients and the
+//  workers can each be started as a separate process.
+//
+//  Every request carries a timestamp for each point it passes: the client
+//  stamps it when sending, each proxy (from a hook) when forwarding it in
+//  either direction and the worker when receiving it. The clients then
+//  report the round-trip throughput and the latency percentiles of every
+//  hop. The timestamps are taken from a system-wide monotonic clock, so
+//  per-hop figures are meaningful only when all processes share a host.
+
+static const char *role;
+static const char *transport;
+static int hops;
+static bool chained;
+static int client_count;
+static int worker_count;
+static size_t message_size;
+static int roundtrip_count;
+
+//  Stamps are placed at the start of the message body in the order the
+//  request passes: client, proxies, worker, proxies in reverse order.
+static int stamp_count;
+
+static void fail (const char *function_)
+{
+    printf ("error in %s: %s\n", function_, zmq_strerror (errno));
+    exit (1);
+}
+
+static uint64_t now_ns ()
+{
+#if defined ZMQ_HAVE_WINDOWS
+    LARGE_INTEGER ticks, frequency;
+    QueryPerformanceCounter (&ticks);
+    QueryPerformanceFrequency (&frequency);
+    return (uint64_t) ((double) ticks.QuadPart * 1000000000.0 /
+        (double) frequency.QuadPart);
+#elif defined CLOCK_MONOTONIC
+    struct timespec ts;
+    int rc = clock_gettime (CLOCK_MONOTONIC, &ts);
+    if (rc == 0)
+        return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    return (uint64_t) tv.tv_sec * 1000000000 + tv.tv_usec * 1000;
+#else
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    return (uint64_t) tv.tv_sec * 1000000000 + tv.tv_usec * 1000;
+#endif
+}
+
+static void stamp (zmq_msg_t *msg_, int slot_)
+{
+    if (zmq_msg_size (msg_) < (size_t) stamp_count * sizeof (uint64_t))
+        return;
+    const uint64_t now = now_ns ();
+    memcpy ((char *) zmq_msg_data (msg_) + slot_ * sizeof (uint64_t),
+        &now, sizeof now);
+}
+
+//  Endpoint i connects hop i to the next one: endpoint 0 is where the
+//  clients connect, endpoint 'hops' is where the workers connect.
+static void endpoint (int index_, char *buf_, size_t size_)
+{
+    if (strcmp (transport, "tcp") == 0)
+        snprintf (buf_, size_, "tcp://127.0.0.1:%d", 5600 + index_);
+    else
+        snprintf (buf_, size_, "%s://broker_bench-%d", transport, index_);
+}
+
+struct proxy_t
+{
+    zmq_proxy_hook_t hook;
+    int request_slot;
+    int reply_slot;
+    void *frontend;
+    void *backend;
+};
+
+//  Proxy hooks see every frame; the body is the last one.
+static int stamp_request (void *, void *, void *, zmq_msg_t *msg_,
+    size_t n_, void *data_)
+{
+    if (n_ == 0)
+        stamp (msg_, ((proxy_t *) data_)->request_slot);
+    return 0;
+}
+
+static int stamp_reply (void *, void *, void *, zmq_msg_t *msg_,
+    size_t n_, void *data_)
+{
+    if (n_ == 0)
+        stamp (msg_, ((proxy_t *) data_)->reply_slot);
+    return 0;
+}
+
+static proxy_t *proxies;
+
+static void create_proxies (void *ctx_)
+{
+    char addr [256];
+
+    proxies = (proxy_t *) calloc (hops, sizeof (proxy_t));
+    if (!proxies) {
+        printf ("error in calloc\n");
+        exit (1);
+    }
+
+    //  Frontends are bound first, so that the backends of the preceding
+    //  proxies have something to connect to, whatever the transport.
+    for (int i = 0; i != hops; i++) {
+        proxy_t *proxy = &proxies [i];
+        proxy->hook.data = proxy;
+        proxy->hook.front2back_hook = stamp_request;
+        proxy->hook.back2front_hook = stamp_reply;
+        proxy->request_slot = 1 + i;
+        proxy->reply_slot = 2 * hops + 1 - i;
+
+        proxy->frontend = zmq_socket (ctx_, ZMQ_ROUTER);
+        if (!proxy->frontend)
+            fail ("zmq_socket");
+        endpoint (i, addr, sizeof addr);
+        if (zmq_bind (proxy->frontend, addr) != 0)
+            fail ("zmq_bind");
+    }
+    for (int i = 0; i != hops; i++) {
+        proxy_t *proxy = &proxies [i];
+        proxy->backend = zmq_socket (ctx_, ZMQ_DEALER);
+        if (!proxy->backend)
+            fail ("zmq_socket");
+        endpoint (i + 1, addr, sizeof addr);
+        const int rc = i + 1 == hops ?
+            zmq_bind (proxy->backend, addr) :
+            zmq_connect (proxy->backend, addr);
+        if (rc != 0)
+            fail (i + 1 == hops ? "zmq_bind" : "zmq_connect");
+    }
+}
+
+static void close_proxy (proxy_t *proxy_)
+{
+    int linger = 0;
+    zmq_setsockopt (proxy_->frontend, ZMQ_LINGER, &linger, sizeof linger);
+    zmq_setsockopt (proxy_->backend, ZMQ_LINGER, &linger, sizeof linger);
+    zmq_close (proxy_->frontend);
+    zmq_close (proxy_->backend);
+}
+
+//  Runs a single proxy until the context is terminated.
+static void run_proxy (void *proxy_)
+{
+    proxy_t *proxy = (proxy_t *) proxy_;
+    zmq_proxy_hook (proxy->frontend, proxy->backend, NULL, &proxy->hook, NULL);
+    close_proxy (proxy);
+}
+
+//  Runs all the proxies in the calling thread until the context is
+//  terminated.
+static void run_proxy_chain (void *)
+{
+    void *frontends [ZMQ_PROXY_CHAIN_MAX_LENGTH + 1];
+    void *backends [ZMQ_PROXY_CHAIN_MAX_LENGTH + 1];
+    void *hooks [ZMQ_PROXY_CHAIN_MAX_LENGTH];
+
+    for (int i = 0; i != hops; i++) {
+        frontends [i] = proxies [i].frontend;
+        backends [i] = proxies [i].backend;
+        hooks [i] = &proxies [i].hook;
+    }
+    frontends [hops] = NULL;
+    backends [hops] = NULL;
+    zmq_proxy_chain (frontends, backends, NULL, hooks, NULL);
+    for (int i = 0; i != hops; i++)
+        close_proxy (&proxies [i]);
+}
+
+//  Starts the proxies in background threads.
+static void start_broker (void *ctx_, void **threads_)
+{
+    create_proxies (ctx_);
+    if (chained)
+        threads_ [0] = zmq_threadstart (run_proxy_chain, NULL);
+    else
+        for (int i = 0; i != hops; i++)
+            threads_ [i] = zmq_threadstart (run_proxy, &proxies [i]);
+}
+
+static void stop_broker (void **threads_)
+{
+    for (int i = 0; i != (chained ? 1 : hops); i++)
+        zmq_threadclose (threads_ [i]);
+    free (proxies);
+}
+
+//  Echoes requests until the context is terminated.
+static void worker (void *ctx_)
+{
+    char addr [256];
+    zmq_msg_t msg;
+
+    void *s = zmq_socket (ctx_, ZMQ_REP);
+    if (!s)
+        fail ("zmq_socket");
+    endpoint (hops, addr, sizeof addr);
+    if (zmq_connect (s, addr) != 0)
+        fail ("zmq_connect");
+    if (zmq_msg_init (&msg) != 0)
+        fail ("zmq_msg_init");
+
+    while (true) {
+        if (zmq_recvmsg (s, &msg, 0) < 0)
+            break;
+        stamp (&msg, hops + 1);
+        if (zmq_sendmsg (s, &msg, 0) < 0)
+            break;
+    }
+    if (errno != ETERM)
+        fail ("zmq_recvmsg");
+
+    zmq_msg_close (&msg);
+    int linger = 0;
+    zmq_setsockopt (s, ZMQ_LINGER, &linger, sizeof linger);
+    zmq_close (s);
+}
+
+struct client_t
+{
+    void *ctx;
+    //  Duration of each hop, the last column being the whole round trip,
+    //  in nanoseconds. One row per round trip.
+    uint64_t *samples;
+    uint64_t start;
+    uint64_t end;
+};
+
+static void client (void *client_)
+{
+    client_t *c = (client_t *) client_;
+    char addr [256];
+    zmq_msg_t msg;
+    uint64_t stamps [2 * ZMQ_PROXY_CHAIN_MAX_LENGTH + 2];
+
+    void *s = zmq_socket (c->ctx, ZMQ_REQ);
+    if (!s)
+        fail ("zmq_socket");
+    endpoint (0, addr, sizeof addr);
+    if (zmq_connect (s, addr) != 0)
+        fail ("zmq_connect");
+
+    c->start = now_ns ();
+    for (int i = 0; i != roundtrip_count; i++) {
+        if (zmq_msg_init_size (&msg, message_size) != 0)
+            fail ("zmq_msg_init_size");
+        memset (zmq_msg_data (&msg), 0, message_size);
+        stamp (&msg, 0);
+        if (zmq_sendmsg (s, &msg, 0) < 0)
+            fail ("zmq_sendmsg");
+        if (zmq_recvmsg (s, &msg, 0) < 0)
+            fail ("zmq_recvmsg");
+        const uint64_t now = now_ns ();
+        if (zmq_msg_size (&msg) != message_size) {
+            printf ("message of incorrect size received\n");
+            exit (1);
+        }
+        memcpy (stamps, zmq_msg_data (&msg), stamp_count * sizeof (uint64_t));
+        if (zmq_msg_close (&msg) != 0)
+            fail ("zmq_msg_close");
+
+        uint64_t *row = c->samples + i * (stamp_count + 1);
+        for (int j = 0; j != stamp_count - 1; j++)
+            row [j] = stamps [j + 1] - stamps [j];
+        row [stamp_count - 1] = now - stamps [stamp_count - 1];
+        row [stamp_count] = now - stamps [0];
+    }
+    c->end = now_ns ();
+
+    if (zmq_close (s) != 0)
+        fail ("zmq_close");
+}
+
+//  Point 0 is the client, points 1..hops are the proxies on the way in,
+//  point hops + 1 is the worker, the following ones the proxies on the way
+//  out and point 2 * hops + 2 is the client again.
+static void point_name (int point_, char *buf_)
+{
+    if (point_ == 0 || point_ == stamp_count)
+        strcpy (buf_, "client");
+    else
+    if (point_ <= hops)
+        sprintf (buf_, "proxy %d", point_);
+    else
+    if (point_ == hops + 1)
+        strcpy (buf_, "worker");
+    else
+        sprintf (buf_, "proxy %d", 2 * hops + 2 - point_);
+}
+
+static double percentile (uint64_t *sorted_, size_t count_, double p_)
+{
+    size_t index = (size_t) (p_ * (count_ - 1) / 100.0 + 0.5);
+    return (double) sorted_ [index] / 1000.0;
+}
+
+static void run_clients (void *ctx_)
+{
+    client_t *clients = (client_t *) calloc (client_count, sizeof (client_t));
+    void **threads = (void **) calloc (client_count, sizeof (void *));
+    if (!clients || !threads) {
+        printf ("error in calloc\n");
+        exit (1);
+    }
+    const int columns = stamp_count + 1;
+    for (int i = 0; i != client_count; i++) {
+        clients [i].ctx = ctx_;
+        clients [i].samples = (uint64_t *) malloc (
+            (size_t) roundtrip_count * columns * sizeof (uint64_t));
+        if (!clients [i].samples) {
+            printf ("error in malloc\n");
+            exit (1);
+        }
+    }
+    for (int i = 0; i != client_count; i++)
+        threads [i] = zmq_threadstart (client, &clients [i]);
+    for (int i = 0; i != client_count; i++)
+        zmq_threadclose (threads [i]);
+
+    uint64_t start = clients [0].start;
+    uint64_t end = clients [0].end;
+    for (int i = 1; i != client_count; i++) {
+        start = std::min (start, clients [i].start);
+        end = std::max (end, clients [i].end);
+    }
+    const size_t total = (size_t) client_count * roundtrip_count;
+    const double elapsed = (double) (end - start) / 1000000000.0;
+    printf ("mean throughput: %d [roundtrips/s]\n",
+        (int) (total / (elapsed > 0 ? elapsed : 1e-9)));
+    printf ("\n%-24s %10s %10s %10s %10s %10s %10s [us]\n",
+        "hop", "mean", "p50", "p90", "p99", "p99.9", "max");
+
+    uint64_t *column = (uint64_t *) malloc (total * sizeof (uint64_t));
+    if (!column) {
+        printf ("error in malloc\n");
+        exit (1);
+    }
+    for (int j = 0; j != columns; j++) {
+        size_t n = 0;
+        double sum = 0;
+        for (int i = 0; i != client_count; i++)
+            for (int k = 0; k != roundtrip_count; k++) {
+                column [n] = clients [i].samples [k * columns + j];
+                sum += (double) column [n++];
+            }
+        std::sort (column, column + n);
+
+        char name [64];
+        if (j == columns - 1)
+            strcpy (name, "roundtrip");
+        else {
+            char from [32], to [32];
+            point_name (j, from);
+            point_name (j + 1, to);
+            sprintf (name, "%s -> %s", from, to);
+        }
+        printf ("%-24s %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", name,
+            sum / n / 1000.0, percentile (column, n, 50),
+            percentile (column, n, 90), percentile (column, n, 99),
+            percentile (column, n, 99.9), percentile (column, n, 100));
+    }
+
+    free (column);
+    for (int i = 0; i != client_count; i++)
+        free (clients [i].samples);
+    free (threads);
+    free (clients);
+}
+
+int main (int argc, char *argv [])
+{
+    if (argc != 9) {
+        printf ("usage: broker_bench <all|broker|clients|workers> "
+            "<inproc|ipc|tcp> <hops> <chain|threads> <client-count> "
+            "<worker-count> <message-size> <roundtrip-count>\n");
+        return 1;
+    }
+    role = argv [1];
+    transport = argv [2];
+    hops = atoi (argv [3]);
+    chained = strcmp (argv [4], "chain") == 0;
+    client_count = atoi (argv [5]);
+    worker_count = atoi (argv [6]);
+    message_size = atoi (argv [7]);
+    roundtrip_count = atoi (argv [8]);
+
+    const bool all = strcmp (role, "all") == 0;
+    if (!all && strcmp (role, "broker") != 0 && strcmp (role, "clients") != 0
+    &&  strcmp (role, "workers") != 0) {
+        printf ("unknown role: %s\n", role);
+        return 1;
+    }
+    if (strcmp (transport, "inproc") != 0 && strcmp (transport, "ipc") != 0
+    &&  strcmp (transport, "tcp") != 0) {
+        printf ("unknown transport: %s\n", transport);
+        return 1;
+    }
+    if (!all && strcmp (transport, "inproc") == 0) {
+        printf ("inproc transport requires the 'all' role\n");
+        return 1;
+    }
+    if (hops < 1 || hops > ZMQ_PROXY_CHAIN_MAX_LENGTH) {
+        printf ("hops must be between 1 and %d\n", ZMQ_PROXY_CHAIN_MAX_LENGTH);
+        return 1;
+    }
+    if (client_count < 1 || worker_count < 1 || roundtrip_count < 1) {
+        printf ("counts must be positive\n");
+        return 1;
+    }
+
+    //  Messages too small to hold the timestamps are enlarged.
+    stamp_count = 2 * hops + 2;
+    if (message_size < stamp_count * sizeof (uint64_t))
+        message_size = stamp_count * sizeof (uint64_t);
+
+    void *ctx = zmq_ctx_new ();
+    if (!ctx)
+        fail ("zmq_ctx_new");
+
+    printf ("role: %s\n", role);
+    printf ("transport: %s\n", transport);
+    printf ("hops: %d (%s)\n", hops,
+        chained ? "chained in one thread" : "one thread each");
+    printf ("clients: %d\n", client_count);
+    printf ("workers: %d\n", worker_count);
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("roundtrip count: %d per client\n", roundtrip_count);
+
+    void *broker_threads [ZMQ_PROXY_CHAIN_MAX_LENGTH];
+    if (all || strcmp (role, "broker") == 0)
+        start_broker (ctx, broker_threads);
+
+    void **worker_threads = NULL;
+    if (all || strcmp (role, "workers") == 0) {
+        worker_threads = (void **) calloc (worker_count, sizeof (void *));
+        if (!worker_threads) {
+            printf ("error in calloc\n");
+            return 1;
+        }
+        for (int i = 0; i != worker_count; i++)
+            worker_threads [i] = zmq_threadstart (worker, ctx);
+    }
+
+    if (all || strcmp (role, "clients") == 0)
+        run_clients (ctx);
+    else {
+        //  Brokers and workers serve until interrupted.
+        while (true)
+            zmq_sleep (1);
+    }
+
+    //  Terminating the context makes the proxies and workers return.
+    if (zmq_ctx_term (ctx) != 0)
+        fail ("zmq_ctx_term");
+    if (all) {
+        stop_broker (broker_threads);
+        for (int i = 0; i != worker_count; i++)
+            zmq_threadclose (worker_threads [i]);
+        free (worker_threads);
+    }
+
+    return 0;
+}
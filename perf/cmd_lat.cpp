@@ -0,0 +1,310 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//  Measures how long commands wait to be processed by a socket that is busy
+//  receiving messages. A PULL socket receives a continuous stream from one
+//  PUSH socket. Meanwhile, a fresh PUSH socket connects to it repeatedly and
+//  sends a single probe message, which can only be received after the PULL
+//  socket has processed the command attaching the new pipe. The time from
+//  sending a probe till it's received is reported as a histogram, along
+//  with the throughput of the stream. To emulate an application doing some
+//  work per message, the receiver spins <work> times after each message.
+
+static void *ctx;
+static int probe_count;
+static volatile int stop;
+
+static void streamer (void *)
+{
+    void *s;
+    int rc;
+
+    s = zmq_socket (ctx, ZMQ_PUSH);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_connect (s, "inproc://cmd_lat");
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    while (!stop) {
+        rc = zmq_send (s, "x", 1, 0);
+        if (rc != 1) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+    //  Empty message marks the end of the stream.
+    rc = zmq_send (s, NULL, 0, 0);
+    if (rc != 0) {
+        printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+}
+
+static void prober (void *)
+{
+    void *ack;
+    void *s;
+    void *watch;
+    char buf [1];
+    int rc;
+    int i;
+
+    ack = zmq_socket (ctx, ZMQ_PAIR);
+    if (!ack) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_connect (ack, "inproc://cmd_lat_ack");
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    for (i = 0; i != probe_count; i++) {
+        s = zmq_socket (ctx, ZMQ_PUSH);
+        if (!s) {
+            printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+
+        rc = zmq_connect (s, "inproc://cmd_lat");
+        if (rc != 0) {
+            printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+
+        //  The probe carries the stopwatch; the receiver stops it.
+        watch = zmq_stopwatch_start ();
+        rc = zmq_send (s, &watch, sizeof watch, 0);
+        if (rc != sizeof watch) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+
+        //  Wait till the probe is received before sending another one.
+        rc = zmq_recv (ack, buf, sizeof buf, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+
+        rc = zmq_close (s);
+        if (rc != 0) {
+            printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+    rc = zmq_close (ack);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    stop = 1;
+}
+
+static int compare (const void *a_, const void *b_)
+{
+    unsigned long a = *(const unsigned long *) a_;
+    unsigned long b = *(const unsigned long *) b_;
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+int main (int argc, char *argv [])
+{
+    void *s;
+    void *ack;
+    void *streamer_thread;
+    void *prober_thread;
+    void *watch;
+    void *probe;
+    unsigned long *latencies;
+    unsigned long elapsed;
+    unsigned long stream_count;
+    int work;
+    volatile int spin;
+    int latency_count;
+    int histogram [32];
+    int bucket;
+    int value;
+    char buf [16];
+    int rc;
+    int i;
+
+    if (argc != 3 && argc != 6) {
+        printf ("usage: cmd_lat <probe-count> <work> [<inbound-poll-rate> "
+            "<command-delay> <command-adaptive>]\n");
+        return 1;
+    }
+    probe_count = atoi (argv [1]);
+    work = atoi (argv [2]);
+    if (probe_count < 1) {
+        printf ("there must be at least one probe\n");
+        return 1;
+    }
+
+    ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    s = zmq_socket (ctx, ZMQ_PULL);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    if (argc == 6) {
+        value = atoi (argv [3]);
+        rc = zmq_setsockopt (s, ZMQ_INBOUND_POLL_RATE, &value, sizeof value);
+        if (rc == 0) {
+            value = atoi (argv [4]);
+            rc = zmq_setsockopt (s, ZMQ_COMMAND_DELAY, &value, sizeof value);
+        }
+        if (rc == 0) {
+            value = atoi (argv [5]);
+            rc = zmq_setsockopt (s, ZMQ_COMMAND_ADAPTIVE, &value,
+                sizeof value);
+        }
+        if (rc != 0) {
+            printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    rc = zmq_bind (s, "inproc://cmd_lat");
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    ack = zmq_socket (ctx, ZMQ_PAIR);
+    if (!ack) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_bind (ack, "inproc://cmd_lat_ack");
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    latencies = (unsigned long *) malloc (probe_count * sizeof (unsigned long));
+    if (!latencies) {
+        printf ("error in malloc\n");
+        return -1;
+    }
+
+    streamer_thread = zmq_threadstart (&streamer, NULL);
+    prober_thread = zmq_threadstart (&prober, NULL);
+
+    watch = zmq_stopwatch_start ();
+    stream_count = 0;
+    latency_count = 0;
+    while (true) {
+        rc = zmq_recv (s, buf, sizeof buf, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        if (rc == 0)
+            break;
+        if (rc == 1) {
+            stream_count++;
+            for (spin = 0; spin != work; spin++);
+            continue;
+        }
+
+        memcpy (&probe, buf, sizeof probe);
+        latencies [latency_count++] = zmq_stopwatch_stop (probe);
+        rc = zmq_send (ack, "", 0, 0);
+        if (rc != 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+    elapsed = zmq_stopwatch_stop (watch);
+
+    zmq_threadclose (prober_thread);
+    zmq_threadclose (streamer_thread);
+
+    rc = zmq_close (ack);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    //  Histogram buckets are powers of two microseconds.
+    memset (histogram, 0, sizeof histogram);
+    for (i = 0; i != latency_count; i++) {
+        for (bucket = 0; bucket != 31 && latencies [i] >> bucket; bucket++);
+        histogram [bucket]++;
+    }
+    qsort (latencies, latency_count, sizeof (unsigned long), compare);
+
+    printf ("probe count: %d\n", latency_count);
+    for (bucket = 0; bucket != 32; bucket++)
+        if (histogram [bucket])
+            printf ("  < %10lu [us]: %d\n", 1ul << bucket, histogram [bucket]);
+    printf ("median latency: %lu [us]\n", latencies [latency_count / 2]);
+    printf ("99th percentile latency: %lu [us]\n",
+        latencies [latency_count * 99 / 100]);
+    printf ("maximum latency: %lu [us]\n", latencies [latency_count - 1]);
+    printf ("stream throughput: %d [msg/s]\n",
+        (int) ((double) stream_count / elapsed * 1000000));
+
+    free (latencies);
+
+    return 0;
+}
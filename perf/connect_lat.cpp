@@ -0,0 +1,267 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+//  Measures the time from zmq_connect () on a fresh REQ socket till the
+//  reply to its first request arrives, i.e. the connection setup cost as
+//  seen by short-lived request clients. Each roundtrip uses a new socket and
+//  thus a new connection. To see the effect of ZMQ_TCP_FASTOPEN on Linux,
+//  both client and server Fast Open have to be enabled in the kernel
+//  (net.ipv4.tcp_fastopen = 3).
+
+static int roundtrip_count;
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall worker (void *s_)
+#else
+static void *worker (void *s_)
+#endif
+{
+    int rc;
+    int i;
+    zmq_msg_t msg;
+
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    for (i = 0; i != roundtrip_count; i++) {
+        rc = zmq_recvmsg (s_, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        rc = zmq_sendmsg (s_, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_sendmsg: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+int main (int argc, char *argv [])
+{
+#if defined ZMQ_HAVE_WINDOWS
+    HANDLE local_thread;
+#else
+    pthread_t local_thread;
+#endif
+    const char *endpoint;
+    size_t message_size;
+    int fastopen;
+    void *ctx;
+    void *server;
+    void *s;
+    int rc;
+    int i;
+    int linger;
+    size_t size;
+    zmq_msg_t msg;
+    void *watch;
+    unsigned long elapsed;
+    double latency;
+
+    if (argc != 4 && argc != 5) {
+        printf ("usage: connect_lat <endpoint> <message-size> "
+            "<roundtrip-count> [fastopen]\n");
+        return 1;
+    }
+
+    endpoint = argv [1];
+    message_size = atoi (argv [2]);
+    roundtrip_count = atoi (argv [3]);
+    fastopen = argc == 5 ? atoi (argv [4]) : 0;
+
+    ctx = zmq_init (1);
+    if (!ctx) {
+        printf ("error in zmq_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    server = zmq_socket (ctx, ZMQ_REP);
+    if (!server) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_setsockopt (server, ZMQ_TCP_FASTOPEN, &fastopen, sizeof (int));
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_bind (server, endpoint);
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    local_thread = (HANDLE) _beginthreadex (NULL, 0,
+        worker, server, 0 , NULL);
+    if (local_thread == 0) {
+        printf ("error in _beginthreadex\n");
+        return -1;
+    }
+#else
+    rc = pthread_create (&local_thread, NULL, worker, server);
+    if (rc != 0) {
+        printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("roundtrip count: %d\n", (int) roundtrip_count);
+    printf ("fast open: %d\n", fastopen);
+
+    elapsed = 0;
+    linger = 0;
+
+    for (i = 0; i != roundtrip_count; i++) {
+        s = zmq_socket (ctx, ZMQ_REQ);
+        if (!s) {
+            printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+
+        rc = zmq_setsockopt (s, ZMQ_LINGER, &linger, sizeof (int));
+        if (rc != 0) {
+            printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+
+        rc = zmq_setsockopt (s, ZMQ_TCP_FASTOPEN, &fastopen, sizeof (int));
+        if (rc != 0) {
+            printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+
+        rc = zmq_msg_init_size (&msg, message_size);
+        if (rc != 0) {
+            printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        memset (zmq_msg_data (&msg), 0, message_size);
+
+        watch = zmq_stopwatch_start ();
+
+        rc = zmq_connect (s, endpoint);
+        if (rc != 0) {
+            printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        rc = zmq_sendmsg (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_sendmsg: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        rc = zmq_recvmsg (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+
+        elapsed += zmq_stopwatch_stop (watch);
+
+        size = zmq_msg_size (&msg);
+        if (size != message_size) {
+            printf ("message of incorrect size received\n");
+            return -1;
+        }
+
+        rc = zmq_msg_close (&msg);
+        if (rc != 0) {
+            printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+
+        rc = zmq_close (s);
+        if (rc != 0) {
+            printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    latency = (double) elapsed / roundtrip_count;
+
+#if defined ZMQ_HAVE_WINDOWS
+    DWORD rc2 = WaitForSingleObject (local_thread, INFINITE);
+    if (rc2 == WAIT_FAILED) {
+        printf ("error in WaitForSingleObject\n");
+        return -1;
+    }
+    BOOL rc3 = CloseHandle (local_thread);
+    if (rc3 == 0) {
+        printf ("error in CloseHandle\n");
+        return -1;
+    }
+#else
+    rc = pthread_join (local_thread, NULL);
+    if (rc != 0) {
+        printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    printf ("average connect-to-reply latency: %.3f [us]\n", (double) latency);
+
+    rc = zmq_close (server);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    return 0;
+}
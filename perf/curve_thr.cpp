@@ -0,0 +1,235 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//  Measures the throughput of a CURVE secured TCP connection over the
+//  loopback interface, with messages protected either by crypto_box, as
+//  in plain CURVE, or by AES-256-GCM. A PUSH socket, acting as the CURVE
+//  client, streams messages from a separate thread to a PULL socket acting
+//  as the server. Both sides do their encryption in their own I/O thread,
+//  so the figure is bounded by the slower of the two.
+
+static void *ctx;
+static const char *endpoint;
+static char server_public [41];
+static char client_public [41];
+static char client_secret [41];
+static int aesgcm;
+static size_t message_size;
+static int message_count;
+
+static void sender (void *)
+{
+    void *push;
+    zmq_msg_t msg;
+    int rc;
+    int i;
+
+    push = zmq_socket (ctx, ZMQ_PUSH);
+    if (!push) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_setsockopt (push, ZMQ_CURVE_SERVERKEY, server_public, 40);
+    if (rc == 0)
+        rc = zmq_setsockopt (push, ZMQ_CURVE_PUBLICKEY, client_public, 40);
+    if (rc == 0)
+        rc = zmq_setsockopt (push, ZMQ_CURVE_SECRETKEY, client_secret, 40);
+    if (rc == 0)
+        rc = zmq_setsockopt (push, ZMQ_CURVE_AESGCM, &aesgcm, sizeof (int));
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_connect (push, endpoint);
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    for (i = 0; i != message_count; i++) {
+        rc = zmq_msg_init_size (&msg, message_size);
+        if (rc != 0) {
+            printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        rc = zmq_sendmsg (push, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_sendmsg: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        rc = zmq_msg_close (&msg);
+        if (rc != 0) {
+            printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+    rc = zmq_close (push);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+}
+
+int main (int argc, char *argv [])
+{
+    char server_secret [41];
+    char last_endpoint [256];
+    size_t size;
+    void *pull;
+    void *sender_thread;
+    zmq_msg_t msg;
+    int as_server = 1;
+    int rc;
+    int i;
+    void *watch;
+    unsigned long elapsed;
+    double throughput;
+    double megabits;
+
+    if (argc != 3 && argc != 4) {
+        printf ("usage: curve_thr <message-size> <message-count> "
+            "[curve|aesgcm]\n");
+        return 1;
+    }
+
+    message_size = atoi (argv [1]);
+    message_count = atoi (argv [2]);
+    aesgcm = argc == 4 && strcmp (argv [3], "aesgcm") == 0 ? 1 : 0;
+    if (message_count < 1) {
+        printf ("there must be at least one message\n");
+        return 1;
+    }
+
+    rc = zmq_curve_keypair (server_public, server_secret);
+    if (rc == 0)
+        rc = zmq_curve_keypair (client_public, client_secret);
+    if (rc != 0) {
+        printf ("error in zmq_curve_keypair: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    pull = zmq_socket (ctx, ZMQ_PULL);
+    if (!pull) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_setsockopt (pull, ZMQ_CURVE_SERVER, &as_server, sizeof (int));
+    if (rc == 0)
+        rc = zmq_setsockopt (pull, ZMQ_CURVE_SECRETKEY, server_secret, 40);
+    if (rc == 0)
+        rc = zmq_setsockopt (pull, ZMQ_CURVE_AESGCM, &aesgcm, sizeof (int));
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_bind (pull, "tcp://127.0.0.1:*");
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    size = sizeof (last_endpoint);
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, last_endpoint, &size);
+    if (rc != 0) {
+        printf ("error in zmq_getsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    endpoint = last_endpoint;
+
+    sender_thread = zmq_threadstart (&sender, NULL);
+
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    //  Start the clock once the connection is established.
+    rc = zmq_recvmsg (pull, &msg, 0);
+    if (rc < 0) {
+        printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    watch = zmq_stopwatch_start ();
+
+    for (i = 1; i != message_count; i++) {
+        rc = zmq_recvmsg (pull, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        if (zmq_msg_size (&msg) != message_size) {
+            printf ("message of incorrect size received\n");
+            return -1;
+        }
+    }
+
+    elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    zmq_threadclose (sender_thread);
+
+    rc = zmq_close (pull);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    throughput = (double) message_count / (double) elapsed * 1000000;
+    megabits = (double) (throughput * message_size * 8) / 1000000;
+
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d\n", message_count);
+    printf ("protection: %s\n", aesgcm ? "AES-256-GCM" : "crypto_box");
+    printf ("mean throughput: %d [msg/s]\n", (int) throughput);
+    printf ("mean throughput: %.3f [Mb/s]\n", (double) megabits);
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//  Measures how fast an XPUB socket matches messages against the
+//  subscriptions of a subscriber. The subscriber never reads, so once its
+//  queue is full the cost of sending a message is mostly that of matching.
+//  Subscriber i subscribes either to the prefix "md.<i>.us." or to the
+//  wildcard pattern "md.<i>.us.>". Half of the published topics match.
+
+int main (int argc, char *argv [])
+{
+    int subscription_count;
+    int message_count;
+    int patterns;
+    void *ctx;
+    void *pub;
+    void *sub;
+    char topic [64];
+    char buf [64];
+    int rc;
+    int i;
+    void *watch;
+    unsigned long elapsed;
+    double throughput;
+
+    if (argc != 3 && argc != 4) {
+        printf ("usage: match_thr <subscription-count> <message-count> "
+            "[prefix|pattern]\n");
+        return 1;
+    }
+
+    subscription_count = atoi (argv [1]);
+    message_count = atoi (argv [2]);
+    patterns = argc == 4 && strcmp (argv [3], "pattern") == 0 ? 1 : 0;
+    if (subscription_count < 1 || message_count < 1) {
+        printf ("there must be at least one subscription and message\n");
+        return 1;
+    }
+
+    ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    pub = zmq_socket (ctx, ZMQ_XPUB);
+    sub = zmq_socket (ctx, ZMQ_SUB);
+    if (!pub || !sub) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_setsockopt (pub, ZMQ_TOPIC_PATTERNS, &patterns, sizeof (int));
+    if (rc == 0)
+        rc = zmq_setsockopt (sub, ZMQ_TOPIC_PATTERNS, &patterns,
+            sizeof (int));
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_bind (pub, "inproc://match_thr");
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_connect (sub, "inproc://match_thr");
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    for (i = 0; i != subscription_count; i++) {
+        sprintf (topic, patterns ? "md.%d.us.>" : "md.%d.us.", i);
+        rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, topic, strlen (topic));
+        if (rc != 0) {
+            printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    //  Wait till all the subscriptions are in place.
+    for (i = 0; i != subscription_count; i++) {
+        rc = zmq_recv (pub, buf, sizeof (buf), 0);
+        if (rc < 0) {
+            printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    watch = zmq_stopwatch_start ();
+
+    for (i = 0; i != message_count; i++) {
+        sprintf (topic, "md.%d.us.ibm", i % (subscription_count * 2));
+        rc = zmq_send (pub, topic, strlen (topic), 0);
+        if (rc < 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    rc = zmq_close (sub);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_close (pub);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    throughput = (double) message_count / (double) elapsed * 1000000;
+
+    printf ("subscription count: %d\n", subscription_count);
+    printf ("message count: %d\n", message_count);
+    printf ("matching: %s\n", patterns ? "pattern" : "prefix");
+    printf ("mean throughput: %d [msg/s]\n", (int) throughput);
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//  Measures the time it takes to shut down a context holding many sockets
+//  and pipes: all sockets are closed with zero linger and the context is
+//  terminated. Each socket binds an endpoint of its own and connects to the
+//  endpoints of its next <connects-per-socket> neighbours, wrapping around
+//  if there are fewer sockets than connects. There are twice as many pipes
+//  as connects. A message is left queued on each pipe.
+
+int main (int argc, char *argv [])
+{
+    int socket_count;
+    int connects;
+    const char *transport;
+    void *ctx;
+    void **sockets;
+    char (*endpoints) [256];
+    int rc;
+    int i;
+    int j;
+    int linger;
+    size_t size;
+    void *watch;
+    unsigned long elapsed;
+
+    if (argc != 3 && argc != 4) {
+        printf ("usage: term_lat <socket-count> <connects-per-socket> "
+            "[inproc|tcp]\n");
+        return 1;
+    }
+
+    socket_count = atoi (argv [1]);
+    connects = atoi (argv [2]);
+    transport = argc == 4 ? argv [3] : "inproc";
+    if (socket_count < 2 || connects < 0) {
+        printf ("there must be at least two sockets\n");
+        return 1;
+    }
+
+    ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_ctx_set (ctx, ZMQ_MAX_SOCKETS, socket_count + 16);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_set: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    sockets = (void **) malloc (socket_count * sizeof (void *));
+    endpoints = (char (*) [256]) malloc (socket_count * 256);
+    if (!sockets || !endpoints) {
+        printf ("error in malloc\n");
+        return -1;
+    }
+
+    linger = 0;
+    for (i = 0; i != socket_count; i++) {
+        sockets [i] = zmq_socket (ctx, ZMQ_DEALER);
+        if (!sockets [i]) {
+            printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+
+        rc = zmq_setsockopt (sockets [i], ZMQ_LINGER, &linger, sizeof (int));
+        if (rc != 0) {
+            printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+
+        if (strcmp (transport, "tcp") == 0)
+            rc = zmq_bind (sockets [i], "tcp://127.0.0.1:*");
+        else {
+            sprintf (endpoints [i], "inproc://term_lat-%d", i);
+            rc = zmq_bind (sockets [i], endpoints [i]);
+        }
+        if (rc != 0) {
+            printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+
+        size = sizeof endpoints [i];
+        rc = zmq_getsockopt (sockets [i], ZMQ_LAST_ENDPOINT, endpoints [i],
+            &size);
+        if (rc != 0) {
+            printf ("error in zmq_getsockopt: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    for (i = 0; i != socket_count; i++)
+        for (j = 0; j != connects; j++) {
+            rc = zmq_connect (sockets [i],
+                endpoints [(i + 1 + j % (socket_count - 1)) % socket_count]);
+            if (rc != 0) {
+                printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+                return -1;
+            }
+        }
+
+    //  Queue a message on each pipe. The messages are dropped on shutdown.
+    for (i = 0; i != socket_count; i++)
+        for (j = 0; j != connects; j++) {
+            rc = zmq_send (sockets [i], "x", 1, ZMQ_DONTWAIT);
+            if (rc != 1 && errno != EAGAIN) {
+                printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+                return -1;
+            }
+        }
+
+    //  Let the connections settle.
+    zmq_sleep (1);
+
+    watch = zmq_stopwatch_start ();
+
+    for (i = 0; i != socket_count; i++) {
+        rc = zmq_close (sockets [i]);
+        if (rc != 0) {
+            printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    elapsed = zmq_stopwatch_stop (watch);
+
+    free (sockets);
+    free (endpoints);
+
+    printf ("socket count: %d\n", socket_count);
+    printf ("pipe count: %d\n", socket_count * connects * 2);
+    printf ("transport: %s\n", transport);
+    printf ("shutdown time: %.3f [ms]\n", (double) elapsed / 1000);
+
+    return 0;
+}
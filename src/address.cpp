@@ -30,7 +30,8 @@
 zmq::address_t::address_t (
     const std::string &protocol_, const std::string &address_)
     : protocol (protocol_),
-      address (address_)
+      address (address_),
+      endpoint_id (0)
 {
     memset (&resolved, 0, sizeof (resolved));
 }
@@ -42,6 +43,10 @@ zmq::address_t::~address_t ()
             delete resolved.tcp_addr;
             resolved.tcp_addr = 0;
         }
+        for (std::vector <tcp_address_t*>::size_type i = 0;
+              i != tcp_addrs.size (); i++)
+            delete tcp_addrs [i];
+        tcp_addrs.clear ();
     }
 #if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
     else
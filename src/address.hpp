@@ -21,6 +21,9 @@
 #define __ZMQ_ADDRESS_HPP_INCLUDED__
 
 #include <string>
+#include <vector>
+
+#include "stdint.hpp"
 
 namespace zmq
 {
@@ -50,6 +53,13 @@ namespace zmq
 #endif
         } resolved;
 
+        //  All the addresses a TCP hostname resolved to, to race connections
+        //  across. Filled in only if ZMQ_TCP_CONNECT_STAGGER is set.
+        std::vector <tcp_address_t*> tcp_addrs;
+
+        //  ID the socket's monitor ring reports this endpoint with.
+        uint32_t endpoint_id;
+
         int to_string (std::string &addr_) const;
     };
 }
@@ -166,11 +166,89 @@ namespace zmq
 #endif
         }
 
+        //  Atomic compare and swap. If the counter equals cmp_, it is set to
+        //  val_. Returns the old value.
+        inline integer_t cas (integer_t cmp_, integer_t val_)
+        {
+            integer_t old_value;
+
+#if defined ZMQ_ATOMIC_COUNTER_WINDOWS
+            old_value = InterlockedCompareExchange ((LONG*) &value,
+                val_, cmp_);
+#elif defined ZMQ_ATOMIC_COUNTER_ATOMIC_H
+            old_value = atomic_cas_32 (&value, cmp_, val_);
+#elif defined ZMQ_ATOMIC_COUNTER_TILE
+            old_value = arch_atomic_val_compare_and_exchange (&value,
+                cmp_, val_);
+#elif defined ZMQ_ATOMIC_COUNTER_X86
+            __asm__ volatile (
+                "lock; cmpxchg %2, %3"
+                : "=a" (old_value), "=m" (value)
+                : "r" (val_), "m" (value), "0" (cmp_)
+                : "cc", "memory");
+#elif defined ZMQ_ATOMIC_COUNTER_ARM
+            integer_t flag;
+            __asm__ volatile (
+                "       dmb     sy\n\t"
+                "1:     ldrex   %1, [%3]\n\t"
+                "       mov     %0, #0\n\t"
+                "       teq     %1, %4\n\t"
+                "       it      eq\n\t"
+                "       strexeq %0, %5, [%3]\n\t"
+                "       teq     %0, #0\n\t"
+                "       bne     1b\n\t"
+                "       dmb     sy\n\t"
+                : "=&r"(flag), "=&r"(old_value), "+Qo"(value)
+                : "r"(&value), "r"(cmp_), "r"(val_)
+                : "cc");
+#elif defined ZMQ_ATOMIC_COUNTER_MUTEX
+            sync.lock ();
+            old_value = value;
+            if (value == cmp_)
+                value = val_;
+            sync.unlock ();
+#else
+#error atomic_counter is not implemented for this platform
+#endif
+            return old_value;
+        }
+
         inline integer_t get ()
         {
             return value;
         }
 
+        //  Reads the counter with acquire semantics, i.e. memory accesses
+        //  following the read can't be moved before it.
+        inline integer_t get_acquire ()
+        {
+            integer_t result;
+
+#if defined ZMQ_ATOMIC_COUNTER_WINDOWS
+            result = InterlockedCompareExchange ((LONG*) &value, 0, 0);
+#elif defined ZMQ_ATOMIC_COUNTER_ATOMIC_H
+            result = value;
+            membar_consumer ();
+#elif defined ZMQ_ATOMIC_COUNTER_TILE
+            result = arch_atomic_val_compare_and_exchange (&value, 0, 0);
+#elif defined ZMQ_ATOMIC_COUNTER_X86
+            //  x86 doesn't reorder loads with later memory accesses; only
+            //  the compiler has to be kept from doing so.
+            result = value;
+            __asm__ volatile ("" : : : "memory");
+#elif defined ZMQ_ATOMIC_COUNTER_ARM
+            result = value;
+            __asm__ volatile ("dmb sy" : : : "memory");
+#elif defined ZMQ_ATOMIC_COUNTER_MUTEX
+            sync.lock ();
+            result = value;
+            sync.unlock ();
+#else
+#error atomic_counter is not implemented for this platform
+#endif
+            return result;
+        }
+
     private:
 
         volatile integer_t value;
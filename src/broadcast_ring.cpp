@@ -0,0 +1,260 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <new>
+
+#include "broadcast_ring.hpp"
+#include "err.hpp"
+
+static uint32_t round_up_pow2 (int value_)
+{
+    uint32_t result = 2;
+    while (result < (uint32_t) value_)
+        result <<= 1;
+    return result;
+}
+
+zmq::broadcast_ring_t::broadcast_ring_t (int capacity_, bool block_) :
+    mask (round_up_pow2 (capacity_) - 1),
+    head (0),
+    pos (0),
+    tail (0),
+    block (block_),
+    refs (1)
+{
+    slots = new (std::nothrow) msg_t [mask + 1];
+    alloc_assert (slots);
+    for (uint32_t i = 0; i <= mask; i++) {
+        int rc = slots [i].init ();
+        errno_assert (rc == 0);
+    }
+}
+
+zmq::broadcast_ring_t::~broadcast_ring_t ()
+{
+    for (readers_t::size_type i = 0; i != readers.size (); i++)
+        release_reader (readers [i]);
+    for (uint32_t i = 0; i <= mask; i++) {
+        int rc = slots [i].close ();
+        errno_assert (rc == 0);
+    }
+    delete [] slots;
+}
+
+void zmq::broadcast_ring_t::add_ref ()
+{
+    refs.add (1);
+}
+
+void zmq::broadcast_ring_t::release ()
+{
+    if (!refs.sub (1))
+        delete this;
+}
+
+zmq::broadcast_ring_t::reader_t *zmq::broadcast_ring_t::attach ()
+{
+    reader_t *reader = new (std::nothrow) reader_t;
+    alloc_assert (reader);
+    reader->ring = this;
+    reader->cursor.set (head.get ());
+    reader->attached.set (1);
+    reader->sleeping.set (0);
+
+    //  One reference for the writer, one for the reader. The reader
+    //  holds a reference to the ring as well.
+    reader->refs.set (2);
+    add_ref ();
+
+    readers.push_back (reader);
+    return reader;
+}
+
+void zmq::broadcast_ring_t::detach (reader_t *reader_)
+{
+    for (readers_t::iterator it = readers.begin (); it != readers.end (); ++it)
+        if (*it == reader_) {
+            readers.erase (it);
+            break;
+        }
+    release_reader (reader_);
+}
+
+bool zmq::broadcast_ring_t::has_readers ()
+{
+    return !readers.empty ();
+}
+
+bool zmq::broadcast_ring_t::check_write ()
+{
+    if (pos - tail <= mask)
+        return true;
+
+    update_tail ();
+    if (pos - tail <= mask)
+        return true;
+
+    if (!block)
+        return false;
+
+    //  Ask the readers to wake us up, then check once again in case one
+    //  of them made progress before noticing the request. If so, an
+    //  extra wake-up may still be on its way, which is harmless.
+    waiting.cas (0, 1);
+    update_tail ();
+    if (pos - tail <= mask) {
+        waiting.cas (1, 0);
+        return true;
+    }
+    return false;
+}
+
+bool zmq::broadcast_ring_t::write (msg_t *msg_)
+{
+    if (!check_write ())
+        return false;
+
+    //  The slot is free to reuse, so copying the message into it drops
+    //  the message stored previously. Copying makes the message shared,
+    //  hence the readers only ever read the slot.
+    int rc = slots [pos & mask].copy (*msg_);
+    errno_assert (rc == 0);
+    pos++;
+    return true;
+}
+
+void zmq::broadcast_ring_t::rollback ()
+{
+    const uint32_t published = head.get ();
+    while (pos != published) {
+        pos--;
+        int rc = slots [pos & mask].close ();
+        errno_assert (rc == 0);
+        rc = slots [pos & mask].init ();
+        errno_assert (rc == 0);
+    }
+}
+
+bool zmq::broadcast_ring_t::is_oversized ()
+{
+    return pos - head.get () > mask;
+}
+
+bool zmq::broadcast_ring_t::flush ()
+{
+    const uint32_t count = pos - head.get ();
+    if (count)
+        head.add (count);
+
+    //  The count may be off by one for a moment while a reader is going
+    //  to sleep, which causes a spurious scan at worst.
+    return sleepers.get () != 0;
+}
+
+bool zmq::broadcast_ring_t::wake (reader_t *reader_)
+{
+    if (!reader_->sleeping.get () || reader_->sleeping.cas (1, 0) != 1)
+        return false;
+    sleepers.sub (1);
+    return true;
+}
+
+bool zmq::broadcast_ring_t::check_read (reader_t *reader_)
+{
+    return reader_->cursor.get () != head.get ();
+}
+
+bool zmq::broadcast_ring_t::read (reader_t *reader_, msg_t *msg_)
+{
+    const uint32_t cursor = reader_->cursor.get ();
+    if (cursor == head.get ())
+        return false;
+
+    int rc = msg_->init ();
+    errno_assert (rc == 0);
+    rc = msg_->copy (slots [cursor & mask]);
+    errno_assert (rc == 0);
+
+    //  From now on the writer may reuse the slot.
+    reader_->cursor.add (1);
+    return true;
+}
+
+bool zmq::broadcast_ring_t::sleep (reader_t *reader_)
+{
+    //  The writer checks the number of sleepers after publishing, while
+    //  we check for new messages after announcing we are asleep. Thus
+    //  either the writer wakes us up or we notice the message here.
+    reader_->sleeping.cas (0, 1);
+    sleepers.add (1);
+    if (reader_->cursor.get () == head.get ())
+        return true;
+
+    //  Unless the writer is waking us up already, we are awake again.
+    if (reader_->sleeping.cas (1, 0) == 1)
+        sleepers.sub (1);
+    return false;
+}
+
+bool zmq::broadcast_ring_t::writer_waiting ()
+{
+    return waiting.get () && waiting.cas (1, 0) == 1;
+}
+
+bool zmq::broadcast_ring_t::is_blocking ()
+{
+    return block;
+}
+
+void zmq::broadcast_ring_t::reader_closed (void *reader_, void *ring_)
+{
+    reader_t *reader = (reader_t*) reader_;
+    broadcast_ring_t *ring = (broadcast_ring_t*) ring_;
+
+    //  Stop holding the writer back and keep the count of sleepers right.
+    reader->attached.set (0);
+    if (reader->sleeping.get () && reader->sleeping.cas (1, 0) == 1)
+        ring->sleepers.sub (1);
+
+    release_reader (reader);
+    ring->release ();
+}
+
+void zmq::broadcast_ring_t::release_reader (reader_t *reader_)
+{
+    if (!reader_->refs.sub (1))
+        delete reader_;
+}
+
+void zmq::broadcast_ring_t::update_tail ()
+{
+    //  Sequence numbers wrap around; the oldest cursor is the one
+    //  farthest behind the writer.
+    uint32_t oldest = pos;
+    for (readers_t::size_type i = 0; i != readers.size (); i++) {
+        reader_t *reader = readers [i];
+        if (!reader->attached.get ())
+            continue;
+        const uint32_t cursor = reader->cursor.get ();
+        if (pos - cursor > pos - oldest)
+            oldest = cursor;
+    }
+    tail = oldest;
+}
@@ -0,0 +1,186 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_BROADCAST_RING_HPP_INCLUDED__
+#define __ZMQ_BROADCAST_RING_HPP_INCLUDED__
+
+#include <vector>
+
+#include "msg.hpp"
+#include "atomic_counter.hpp"
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    //  Bounded ring of messages written by a single publisher and read by
+    //  any number of subscribers, each with a cursor of its own. A message
+    //  is stored once whatever the number of readers; readers take their
+    //  own reference to it. The slowest reader limits how far the writer
+    //  can get ahead: once the ring is full, messages are either dropped
+    //  or the writer has to wait, depending on the policy.
+    //
+    //  Slots are reused only when all the readers have moved past them,
+    //  so readers access the messages without locking. Messages stay in
+    //  the ring until their slot is reused.
+
+    class broadcast_ring_t
+    {
+    public:
+
+        //  Per-reader state. Readers are created by the writer and handed
+        //  over to the reader's thread. Both sides hold a reference.
+        struct reader_t
+        {
+            broadcast_ring_t *ring;
+
+            //  Sequence number of the next message to read. Only advanced
+            //  by the reader.
+            atomic_counter_t cursor;
+
+            //  Zero once the reader stopped reading, so that the writer
+            //  doesn't have to wait for it.
+            atomic_counter_t attached;
+
+            //  Set when the reader went to sleep waiting for messages.
+            atomic_counter_t sleeping;
+
+            atomic_counter_t refs;
+        };
+
+        //  Capacity is rounded up to the next power of two. If block_ is
+        //  true, the writer waits for the slowest reader once the ring is
+        //  full, otherwise new messages are dropped.
+        broadcast_ring_t (int capacity_, bool block_);
+
+        //  The ring is deallocated once the last reference is dropped.
+        //  The creator holds the initial reference.
+        void add_ref ();
+        void release ();
+
+        //  Writer side.
+
+        //  Creates a reader positioned at the end of the published
+        //  messages.
+        reader_t *attach ();
+
+        //  Drops the writer's reference to the reader.
+        void detach (reader_t *reader_);
+
+        //  Returns true if there are readers to write to.
+        bool has_readers ();
+
+        //  Returns true if a message can be written. If the ring is full
+        //  and the policy is to block, the next reader to make progress
+        //  is asked to wake the writer up.
+        bool check_write ();
+
+        //  Copies the message part into the ring. Parts are only visible
+        //  to the readers once flush is called at the end of the message.
+        //  Returns false if the ring is full.
+        bool write (msg_t *msg_);
+
+        //  Drops the parts written since the last flush.
+        void rollback ();
+
+        //  Returns true if the parts written since the last flush fill the
+        //  whole ring, i.e. the message can never be published.
+        bool is_oversized ();
+
+        //  Publishes the parts written. Returns true if some readers may
+        //  be asleep and have to be woken up using wake.
+        bool flush ();
+
+        //  Returns true if the reader was asleep, in which case it has to
+        //  be sent a command to resume reading.
+        bool wake (reader_t *reader_);
+
+        //  Reader side.
+
+        //  Returns true if there's a message for the reader.
+        bool check_read (reader_t *reader_);
+
+        //  Reads the next message. msg_ is treated as uninitialised.
+        //  Returns false if there's no message to read.
+        bool read (reader_t *reader_, msg_t *msg_);
+
+        //  Marks the reader as asleep. Returns false if a message arrived
+        //  in the meantime, in which case the reader should keep reading.
+        bool sleep (reader_t *reader_);
+
+        //  Returns true if the writer waits for readers to make progress
+        //  and this reader was chosen to wake it up.
+        bool writer_waiting ();
+
+        //  Detaches the reader and drops the reader's reference to it and
+        //  to the ring. Meant to be used as msg_free_fn for the message
+        //  handing the reader over (see pipe_t).
+        static void reader_closed (void *reader_, void *ring_);
+
+        //  Returns true if the writer waits once the ring is full.
+        bool is_blocking ();
+
+    private:
+
+        ~broadcast_ring_t ();
+
+        //  Drops a reference to the reader, deallocating it if it was
+        //  the last one.
+        static void release_reader (reader_t *reader_);
+
+        //  Recomputes the sequence number of the oldest message still
+        //  in use by a reader.
+        void update_tail ();
+
+        //  Messages, indexed by sequence number modulo the capacity.
+        msg_t *slots;
+        const uint32_t mask;
+
+        //  Sequence number of the next message to be published. Readers
+        //  may read up to, but not including, this message.
+        atomic_counter_t head;
+
+        //  Writer's state: sequence number of the next part to write and
+        //  of the oldest message still needed by some reader, as of the
+        //  last check.
+        uint32_t pos;
+        uint32_t tail;
+
+        //  Readers attached by the writer.
+        typedef std::vector <reader_t*> readers_t;
+        readers_t readers;
+
+        //  Number of readers that went to sleep.
+        atomic_counter_t sleepers;
+
+        //  Set while the blocked writer waits for a reader to wake it up.
+        atomic_counter_t waiting;
+
+        const bool block;
+
+        atomic_counter_t refs;
+
+        broadcast_ring_t (const broadcast_ring_t&);
+        const broadcast_ring_t &operator = (const broadcast_ring_t&);
+    };
+
+}
+
+#endif
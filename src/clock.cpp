@@ -23,6 +23,7 @@
 #include "config.hpp"
 #include "err.hpp"
 #include "mutex.hpp"
+#include "atomic_counter.hpp"
 
 #include <stddef.h>
 
@@ -174,6 +175,56 @@ uint64_t zmq::clock_t::now_ms ()
     return last_time;
 }
 
+//  Timestamp counter rate, set once by clock_t::calibrate. The flag is set
+//  after the rate, so that a reader seeing the flag sees the rate as well.
+static zmq::mutex_t calibration_sync;
+static zmq::atomic_counter_t calibrated;
+static zmq::atomic_counter_t ticks_per_us;
+
+void zmq::clock_t::calibrate ()
+{
+    if (calibrated.get_acquire ())
+        return;
+
+    zmq::scoped_lock_t lock (calibration_sync);
+    if (calibrated.get ())
+        return;
+
+    uint64_t rate = 0;
+    uint64_t start_tsc = rdtsc ();
+    if (start_tsc) {
+
+        //  Count the ticks over a millisecond.
+        uint64_t start_time = now_us ();
+        uint64_t time;
+        do
+            time = now_us ();
+        while (time - start_time < 1000);
+        uint64_t tsc = rdtsc ();
+
+        //  TSC jumped backwards due to migration between cores. Better
+        //  estimate a rate than use a bogus one.
+        if (tsc <= start_tsc)
+            rate = 1000;
+        else
+            rate = (tsc - start_tsc) / (time - start_time);
+        if (!rate)
+            rate = 1;
+    }
+
+    ticks_per_us.set ((atomic_counter_t::integer_t) rate);
+    calibrated.cas (0, 1);
+}
+
+uint64_t zmq::clock_t::rdtsc_per_us ()
+{
+    //  Contexts calibrate the clock when created, so this is only done
+    //  here if the rate is asked for outside of any context.
+    if (unlikely (!calibrated.get_acquire ()))
+        calibrate ();
+    return ticks_per_us.get ();
+}
+
 uint64_t zmq::clock_t::rdtsc ()
 {
 #if (defined _MSC_VER && (defined _M_IX86 || defined _M_X64))
@@ -35,6 +35,15 @@ namespace zmq
         //  CPU's timestamp counter. Returns 0 if it's not available.
         static uint64_t rdtsc ();
 
+        //  Measures the rate of the timestamp counter. The measurement busy
+        //  waits for a millisecond, so it's done once per process, when the
+        //  first context is created. Later calls return immediately.
+        static void calibrate ();
+
+        //  Number of timestamp counter ticks per microsecond, as measured by
+        //  calibrate. Returns 0 if the counter is not available.
+        static uint64_t rdtsc_per_us ();
+
         //  High precision timestamp.
         static uint64_t now_us ();
 
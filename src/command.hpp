@@ -106,8 +106,10 @@ namespace zmq
             } hiccup;
 
             //  Sent by pipe reader to pipe writer to ask it to terminate
-            //  its end of the pipe.
+            //  its end of the pipe. If drop is set, the writer is not to
+            //  wait for the messages it has not read yet.
             struct {
+                bool drop;
             } pipe_term;
 
             //  Pipe writer acknowledges pipe_term command.
@@ -55,9 +55,22 @@ namespace zmq
         //  unnecessary network stack traversals.
         out_batch_size = 8192,
 
+        //  Application frames of ZMQ_STREAM sockets up to this size are
+        //  copied out of the framing decoder's buffer. Larger ones are
+        //  delivered as messages referring to the buffer itself.
+        stream_frame_copy_max = 128,
+
         //  Maximal delta between high and low watermark.
         max_wm_delta = 1024,
 
+        //  Minimal period, in microseconds, over which the drain rate of
+        //  a pipe is measured before its adaptive high watermark is adjusted.
+        hwm_sample_interval = 5000,
+
+        //  Number of messages over which the ratio of messages dropped for
+        //  a subscriber is evaluated for ZMQ_XPUB_EVICT_DROP_RATIO.
+        eviction_window = 1000,
+
         //  Maximum number of events the I/O thread can process in one go.
         max_io_events = 256,
 
@@ -67,6 +80,10 @@ namespace zmq
         //  messages to process. If not so, commands are processed immediately.
         max_command_delay = 3000000,
 
+        //  Adaptive command throttling checks for commands at most this many
+        //  times as often as the configured poll rate and delay ask for.
+        command_throttle_range = 16,
+
         //  Low-precision clock precision in CPU ticks. 1ms. Value of 1000000
         //  should be OK for CPU frequencies above 1GHz. If should work
         //  reasonably well for CPU frequencies above 500MHz. For lower CPU
@@ -74,9 +91,23 @@ namespace zmq
         //  possible latencies.
         clock_precision = 1000000,
 
+        //  Maximal number of records in a socket's monitor ring.
+        monitor_ring_max_capacity = 1048576,
+
+        //  Maximal number of messages in a broadcast ring.
+        broadcast_ring_max_capacity = 1048576,
+
         //  Maximum transport data unit size for PGM (TPDU).
         pgm_max_tpdu = 1500,
 
+        //  Maximal number of batches of APDUs a PGM receiver reads from the
+        //  socket in one go before yielding to other engines in the thread.
+        pgm_max_rx_batches = 16,
+
+        //  Number of messages a channel of a multiplexed TCP connection may
+        //  have in flight when the receiving socket has no ZMQ_RCVHWM.
+        mux_default_window = 1000,
+
         //  On some OSes the signaler has to be emulated using a TCP
         //  connection. In such cases following port is used.
         signaler_port = 5905
@@ -23,8 +23,12 @@
 #else
 #include <unistd.h>
 #endif
+#if defined ZMQ_HAVE_LINUX
+#include <sched.h>
+#endif
 
 #include <new>
+#include <vector>
 #include <string.h>
 
 #include "ctx.hpp"
@@ -34,6 +38,8 @@
 #include "pipe.hpp"
 #include "err.hpp"
 #include "msg.hpp"
+#include "clock.hpp"
+#include "flight_recorder.hpp"
 
 #define ZMQ_CTX_TAG_VALUE_GOOD 0xabadcafe
 #define ZMQ_CTX_TAG_VALUE_BAD  0xdeadbeef
@@ -46,20 +52,49 @@ int clipped_maxsocket(int max_requested)
     return max_requested;
 }
 
+//  Returns the CPU cores the process may run on, or an empty list if the
+//  OS doesn't tell.
+static std::vector <int> process_cpus ()
+{
+    std::vector <int> cpus;
+#if defined ZMQ_HAVE_LINUX
+    cpu_set_t set;
+    CPU_ZERO (&set);
+    if (sched_getaffinity (0, sizeof (set), &set) == 0)
+        for (int cpu = 0; cpu != CPU_SETSIZE; cpu++)
+            if (CPU_ISSET (cpu, &set))
+                cpus.push_back (cpu);
+#endif
+    return cpus;
+}
+
 zmq::ctx_t::ctx_t () :
     tag (ZMQ_CTX_TAG_VALUE_GOOD),
     starting (true),
     terminating (false),
+    slot_sync ("ctx_t::slot_sync"),
     reaper (NULL),
     slot_count (0),
     slots (NULL),
+    endpoints_sync ("ctx_t::endpoints_sync"),
     max_sockets (clipped_maxsocket (ZMQ_MAX_SOCKETS_DFLT)),
     io_thread_count (ZMQ_IO_THREADS_DFLT),
-    ipv6 (false)
+    ipv6 (false),
+    loopback_shortcut (false),
+    io_thread_pinning (false),
+    io_thread_stats (false),
+    flight_recorder_size (ZMQ_FLIGHT_RECORDER_DFLT),
+    recorders (NULL),
+    recorder_capacity (0),
+    opt_sync ("ctx_t::opt_sync")
 {
 #ifdef HAVE_FORK
     pid = getpid();
 #endif
+
+    //  Measure the timestamp counter rate up front rather than on the
+    //  first socket option or flight recorder dump needing it.
+    clock_t::calibrate ();
 }
 
 bool zmq::ctx_t::check_tag ()
@@ -89,6 +124,13 @@ zmq::ctx_t::~ctx_t ()
     //  corresponding io_thread/socket objects.
     free (slots);
 
+    //  Deallocate the flight recorders, now that all threads are gone.
+    if (recorders) {
+        for (uint32_t i = 0; i != slot_count; i++)
+            delete recorders [i].xchg (NULL);
+        delete [] recorders;
+    }
+
     //  Remove the tag, so that the object is considered dead.
     tag = ZMQ_CTX_TAG_VALUE_BAD;
 }
@@ -182,6 +224,30 @@ int zmq::ctx_t::set (int option_, int optval_)
         ipv6 = (optval_ != 0);
         opt_sync.unlock ();
     }
+    else
+    if (option_ == ZMQ_FLIGHT_RECORDER && optval_ >= 0) {
+        opt_sync.lock ();
+        flight_recorder_size = optval_;
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_LOOPBACK_SHORTCUT && optval_ >= 0) {
+        opt_sync.lock ();
+        loopback_shortcut = (optval_ != 0);
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_IO_THREAD_PINNING && optval_ >= 0) {
+        opt_sync.lock ();
+        io_thread_pinning = (optval_ != 0);
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_IO_THREAD_STATS && optval_ >= 0) {
+        opt_sync.lock ();
+        io_thread_stats = (optval_ != 0);
+        opt_sync.unlock ();
+    }
     else {
         errno = EINVAL;
         rc = -1;
@@ -200,6 +266,18 @@ int zmq::ctx_t::get (int option_)
     else
     if (option_ == ZMQ_IPV6)
         rc = ipv6;
+    else
+    if (option_ == ZMQ_FLIGHT_RECORDER)
+        rc = flight_recorder_size;
+    else
+    if (option_ == ZMQ_LOOPBACK_SHORTCUT)
+        rc = loopback_shortcut;
+    else
+    if (option_ == ZMQ_IO_THREAD_PINNING)
+        rc = io_thread_pinning;
+    else
+    if (option_ == ZMQ_IO_THREAD_STATS)
+        rc = io_thread_stats;
     else {
         errno = EINVAL;
         rc = -1;
@@ -207,6 +285,62 @@ int zmq::ctx_t::get (int option_)
     return rc;
 }
 
+int zmq::ctx_t::get_io_thread_stats (int index_,
+    zmq_io_thread_stats_t *stats_)
+{
+    //  I/O threads are launched along with the first socket.
+    slot_sync.lock ();
+    if (index_ < 0 || (size_t) index_ >= io_threads.size ()) {
+        slot_sync.unlock ();
+        errno = EINVAL;
+        return -1;
+    }
+    io_threads [index_]->get_stats (stats_);
+    slot_sync.unlock ();
+    return 0;
+}
+
+size_t zmq::ctx_t::get_rtt_stats (int socket_id_,
+    zmq_peer_rtt_stats_t *stats_, size_t count_)
+{
+    size_t filled = 0;
+    slot_sync.lock ();
+    for (io_threads_t::size_type i = 0; i != io_threads.size (); i++)
+        filled += io_threads [i]->get_rtt_stats (socket_id_,
+            stats_ + filled, count_ - filled);
+    slot_sync.unlock ();
+    return filled;
+}
+
+zmq::flight_recorder_t *zmq::ctx_t::get_flight_recorder (uint32_t tid_)
+{
+    if (likely (!recorders))
+        return NULL;
+    flight_recorder_t *recorder = recorders [tid_].cas (NULL, NULL);
+    if (unlikely (!recorder)) {
+
+        //  Another thread may be creating an object with the same thread
+        //  slot. Whichever publishes its recorder first wins.
+        recorder = new (std::nothrow) flight_recorder_t (recorder_capacity);
+        alloc_assert (recorder);
+        flight_recorder_t *published = recorders [tid_].cas (NULL, recorder);
+        if (published) {
+            delete recorder;
+            recorder = published;
+        }
+    }
+    return recorder;
+}
+
+int zmq::ctx_t::dump_flight_recorders (const char *path_)
+{
+    if (!recorders) {
+        errno = EINVAL;
+        return -1;
+    }
+    return flight_recorder_t::dump (recorders, slot_count, path_);
+}
+
 zmq::socket_base_t *zmq::ctx_t::create_socket (int type_)
 {
     slot_sync.lock ();
@@ -218,11 +352,22 @@ zmq::socket_base_t *zmq::ctx_t::create_socket (int type_)
         opt_sync.lock ();
         int mazmq = max_sockets;
         int ios = io_thread_count;
+        int records = flight_recorder_size;
+        bool pinning = io_thread_pinning;
+        bool stats = io_thread_stats;
         opt_sync.unlock ();
         slot_count = mazmq + ios + 2;
         slots = (mailbox_t**) malloc (sizeof (mailbox_t*) * slot_count);
         alloc_assert (slots);
 
+        //  Recorders are created along with the first object of their
+        //  thread.
+        if (records > 0) {
+            recorder_capacity = (uint32_t) records;
+            recorders = new (std::nothrow) recorder_ptr_t [slot_count];
+            alloc_assert (recorders);
+        }
+
         //  Initialise the infrastructure for zmq_ctx_term thread.
         slots [term_tid] = &term_mailbox;
 
@@ -232,13 +377,28 @@ zmq::socket_base_t *zmq::ctx_t::create_socket (int type_)
         slots [reaper_tid] = reaper->get_mailbox ();
         reaper->start ();
 
-        //  Create I/O thread objects and launch them.
+        //  Create I/O thread objects and launch them. If requested, deal
+        //  the CPU cores out to the I/O threads.
+        const std::vector <int> cpus = pinning ?
+            process_cpus () : std::vector <int> ();
+        int pin_errno = 0;
         for (int i = 2; i != ios + 2; i++) {
             io_thread_t *io_thread = new (std::nothrow) io_thread_t (this, i);
             alloc_assert (io_thread);
             io_threads.push_back (io_thread);
             slots [i] = io_thread->get_mailbox ();
+            if (stats)
+                io_thread->enable_stats ();
             io_thread->start ();
+            if (!cpus.empty ()) {
+                std::vector <int> own;
+                for (size_t j = i - 2; j < cpus.size (); j += ios)
+                    own.push_back (cpus [j]);
+                if (own.empty ())
+                    own.push_back (cpus [(i - 2) % cpus.size ()]);
+                if (io_thread->pin (own) == -1 && !pin_errno)
+                    pin_errno = errno;
+            }
         }
 
         //  In the unused part of the slot array, create a list of empty slots.
@@ -247,6 +407,17 @@ zmq::socket_base_t *zmq::ctx_t::create_socket (int type_)
             empty_slots.push_back (i);
             slots [i] = NULL;
         }
+
+        //  If the cores couldn't be dealt out, e.g. because some are not
+        //  in the cpuset of the container, none of the I/O threads stays
+        //  pinned and the error is reported.
+        if (pin_errno) {
+            for (io_threads_t::size_type i = 0; i != io_threads.size (); i++)
+                io_threads [i]->unpin (cpus);
+            slot_sync.unlock ();
+            errno = pin_errno;
+            return NULL;
+        }
     }
 
     //  Once zmq_ctx_term() was called, we can't create new sockets.
@@ -334,6 +505,44 @@ zmq::io_thread_t *zmq::ctx_t::choose_io_thread (uint64_t affinity_)
     return selected_io_thread;
 }
 
+zmq::io_thread_t *zmq::ctx_t::choose_io_thread_for_cpu (int cpu_,
+    uint64_t affinity_)
+{
+    if (cpu_ < 0)
+        return NULL;
+
+    for (io_threads_t::size_type i = 0; i != io_threads.size (); i++)
+        if (!affinity_ || (affinity_ & (uint64_t (1) << i)))
+            if (io_threads [i]->is_pinned_to (cpu_))
+                return io_threads [i];
+    return NULL;
+}
+
+zmq::io_thread_t *zmq::ctx_t::choose_io_thread_for_hash (uint32_t hash_,
+    uint64_t affinity_)
+{
+    if (io_threads.empty ())
+        return NULL;
+
+    //  Count the I/O threads eligible under the affinity mask.
+    uint32_t eligible = 0;
+    for (io_threads_t::size_type i = 0; i != io_threads.size (); i++)
+        if (!affinity_ || (affinity_ & (uint64_t (1) << i)))
+            eligible++;
+    if (eligible == 0)
+        return NULL;
+
+    //  Pick the (hash % eligible)-th eligible I/O thread.
+    uint32_t index = hash_ % eligible;
+    for (io_threads_t::size_type i = 0; i != io_threads.size (); i++)
+        if (!affinity_ || (affinity_ & (uint64_t (1) << i)))
+            if (index-- == 0)
+                return io_threads [i];
+
+    zmq_assert (false);
+    return NULL;
+}
+
 int zmq::ctx_t::register_endpoint (const char *addr_, endpoint_t &endpoint_)
 {
     endpoints_sync.lock ();
@@ -350,20 +559,15 @@ int zmq::ctx_t::register_endpoint (const char *addr_, endpoint_t &endpoint_)
     return 0;
 }
 
-void zmq::ctx_t::unregister_endpoints (socket_base_t *socket_)
+void zmq::ctx_t::unregister_endpoint (const std::string &addr_,
+    socket_base_t *socket_)
 {
     endpoints_sync.lock ();
 
-    endpoints_t::iterator it = endpoints.begin ();
-    while (it != endpoints.end ()) {
-        if (it->second.socket == socket_) {
-            endpoints_t::iterator to_erase = it;
-            ++it;
-            endpoints.erase (to_erase);
-            continue;
-        }
-        ++it;
-    }
+    endpoints_t::iterator it = endpoints.find (addr_);
+    if (it != endpoints.end () && it->second.socket == socket_)
+        endpoints.erase (it);
+
     endpoints_sync.unlock ();
 }
 
@@ -426,16 +630,6 @@ void zmq::ctx_t::connect_inproc_sockets (zmq::socket_base_t *bind_socket_,
     bind_socket_->inc_seqnum();
     pending_connection_.bind_pipe->set_tid(bind_socket_->get_tid());
 
-    if (side_ == bind_side) {
-        command_t cmd;
-        cmd.type = command_t::bind;
-        cmd.args.bind.pipe = pending_connection_.bind_pipe;
-        bind_socket_->process_command(cmd);
-        bind_socket_->send_inproc_connected(pending_connection_.endpoint.socket);
-    }
-    else
-        pending_connection_.connect_pipe->send_bind(bind_socket_, pending_connection_.bind_pipe, false);
-
     int sndhwm = 0;
     if (pending_connection_.endpoint.options.sndhwm != 0 && bind_options.rcvhwm != 0)
         sndhwm = pending_connection_.endpoint.options.sndhwm + bind_options.rcvhwm;
@@ -455,6 +649,27 @@ void zmq::ctx_t::connect_inproc_sockets (zmq::socket_base_t *bind_socket_,
        pending_connection_.connect_pipe->set_hwms(hwms [1], hwms [0]);
        pending_connection_.bind_pipe->set_hwms(hwms [0], hwms [1]);
 
+    //  New watermarks become the upper bounds of the adaptive ones. As
+    //  set_hwm_target adjusts the peer pipe too, this has to be done before
+    //  the bind pipe is handed over to the bind socket.
+    if (pending_connection_.endpoint.options.hwm_target_delay > 0) {
+        const options_t &opts = pending_connection_.endpoint.options;
+        pending_connection_.connect_pipe->set_hwm_target (
+            opts.hwm_target_delay, opts.hwm_min);
+        pending_connection_.bind_pipe->set_hwm_target (
+            opts.hwm_target_delay, opts.hwm_min);
+    }
+
+    if (side_ == bind_side) {
+        command_t cmd;
+        cmd.type = command_t::bind;
+        cmd.args.bind.pipe = pending_connection_.bind_pipe;
+        bind_socket_->process_command(cmd);
+        bind_socket_->send_inproc_connected(pending_connection_.endpoint.socket);
+    }
+    else
+        pending_connection_.connect_pipe->send_bind(bind_socket_, pending_connection_.bind_pipe, false);
+
     if (bind_options.recv_identity) {
     
         msg_t id;
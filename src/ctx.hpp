@@ -25,6 +25,7 @@
 #include <string>
 #include <stdarg.h>
 
+#include "../include/zmq.h"
 #include "mailbox.hpp"
 #include "array.hpp"
 #include "config.hpp"
@@ -32,6 +33,7 @@
 #include "stdint.hpp"
 #include "options.hpp"
 #include "atomic_counter.hpp"
+#include "atomic_ptr.hpp"
 
 namespace zmq
 {
@@ -41,6 +43,7 @@ namespace zmq
     class socket_base_t;
     class reaper_t;
     class pipe_t;
+    class flight_recorder_t;
 
     //  Information associated with inproc endpoint. Note that endpoint options
     //  are registered as well so that the peer can access them without a need
@@ -90,6 +93,24 @@ namespace zmq
         int set (int option_, int optval_);
         int get (int option_);
 
+        //  Retrieves the event loop statistics of an I/O thread.
+        int get_io_thread_stats (int index_, zmq_io_thread_stats_t *stats_);
+
+        //  Returns the flight recorder of thread tid_, or NULL if flight
+        //  recording is disabled. The recorder is created on first use and
+        //  published atomically, so this may be called from any thread.
+        flight_recorder_t *get_flight_recorder (uint32_t tid_);
+
+        //  Dumps the records of all the flight recorders into a file.
+        int dump_flight_recorders (const char *path_);
+
+        //  Gathers the round-trip time statistics of the connections of the
+        //  socket from the I/O threads, which keep them as engines may
+        //  outlive their socket for a while. Fills in at most count_
+        //  records and returns the number of records filled in.
+        size_t get_rtt_stats (int socket_id_, zmq_peer_rtt_stats_t *stats_,
+            size_t count_);
+
         //  Create and destroy a socket.
         zmq::socket_base_t *create_socket (int type_);
         void destroy_socket (zmq::socket_base_t *socket_);
@@ -102,12 +123,25 @@ namespace zmq
         //  Returns NULL if no I/O thread is available.
         zmq::io_thread_t *choose_io_thread (uint64_t affinity_);
 
+        //  Returns the I/O thread eligible under affinity_ that is pinned
+        //  to the CPU core cpu_. Returns NULL if there's no such thread,
+        //  notably when the I/O threads are not pinned.
+        zmq::io_thread_t *choose_io_thread_for_cpu (int cpu_,
+            uint64_t affinity_);
+
+        //  Returns the I/O thread eligible under affinity_ that the hash
+        //  value maps to, so that equal values map to the same thread.
+        //  Returns NULL if no I/O thread is available.
+        zmq::io_thread_t *choose_io_thread_for_hash (uint32_t hash_,
+            uint64_t affinity_);
+
         //  Returns reaper thread object.
         zmq::object_t *get_reaper ();
 
         //  Management of inproc endpoints.
         int register_endpoint (const char *addr_, endpoint_t &endpoint_);
-        void unregister_endpoints (zmq::socket_base_t *socket_);
+        void unregister_endpoint (const std::string &addr_,
+            zmq::socket_base_t *socket_);
         endpoint_t find_endpoint (const char *addr_);
         void pend_connection (const char *addr_, pending_connection_t &pending_connection_);
         void connect_pending (const char *addr_, zmq::socket_base_t *bind_socket_);
@@ -185,6 +219,31 @@ namespace zmq
         //  Is IPv6 enabled on this context?
         bool ipv6;
 
+        //  If true, TCP and IPC connections between sockets of this context
+        //  are replaced by inproc pipes.
+        bool loopback_shortcut;
+
+        //  If true, the I/O threads are pinned to disjoint sets of the CPU
+        //  cores the process may run on.
+        bool io_thread_pinning;
+
+        //  If true, the I/O threads keep the statistics reported by
+        //  zmq_ctx_io_thread_stats.
+        bool io_thread_stats;
+
+        //  Number of records kept by the flight recorder of each thread,
+        //  zero if flight recording is disabled.
+        int flight_recorder_size;
+
+        //  Flight recorders indexed by thread slot, or NULL if flight
+        //  recording is disabled. Slots whose recorder isn't created yet
+        //  hold NULL.
+        typedef atomic_ptr_t <flight_recorder_t> recorder_ptr_t;
+        recorder_ptr_t *recorders;
+
+        //  Number of records per flight recorder, as of context start.
+        uint32_t recorder_capacity;
+
         //  Synchronisation of access to context options.
         mutex_t opt_sync;
 
@@ -0,0 +1,70 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_CURVE_AESGCM_CLIENT_HPP_INCLUDED__
+#define __ZMQ_CURVE_AESGCM_CLIENT_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#ifdef HAVE_LIBSODIUM
+
+#include "curve_client.hpp"
+
+namespace zmq
+{
+
+    //  CURVE client that protects messages with AES-256-GCM rather than
+    //  with crypto_box once the CURVE handshake is complete. The key is
+    //  derived from the short-term keys negotiated by the handshake.
+
+    class curve_aesgcm_client_t : public curve_client_t
+    {
+    public:
+
+        curve_aesgcm_client_t (const options_t &options_);
+        virtual ~curve_aesgcm_client_t ();
+
+        // mechanism implementation
+        virtual int encode (msg_t *msg_);
+        virtual int decode (msg_t *msg_);
+
+        //  Returns true if libsodium supports AES-256-GCM on this CPU,
+        //  which takes the AES-NI and PCLMULQDQ instructions. There is
+        //  no software implementation to fall back to.
+        static bool is_available ();
+
+    private:
+
+        //  Keys the cipher on first use, after the handshake.
+        void init_cipher ();
+
+        //  Expanded AES key used for MESSAGE commands, wiped on destruction.
+        crypto_aead_aes256gcm_state cipher;
+        bool keyed;
+
+        //  Nonce of the next message sent.
+        uint64_t message_nonce;
+    };
+
+}
+
+#endif
+
+#endif
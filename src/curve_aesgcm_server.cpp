@@ -0,0 +1,163 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "platform.hpp"
+
+#ifdef HAVE_LIBSODIUM
+
+#include <new>
+#include <sodium.h>
+
+#ifdef ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#endif
+
+#include "msg.hpp"
+#include "err.hpp"
+#include "curve_aesgcm_server.hpp"
+#include "wire.hpp"
+
+zmq::curve_aesgcm_server_t::curve_aesgcm_server_t (session_base_t *session_,
+        const std::string &peer_address_, const options_t &options_) :
+    curve_server_t (session_, peer_address_, options_),
+    keyed (false),
+    message_nonce (0)
+{
+}
+
+zmq::curve_aesgcm_server_t::~curve_aesgcm_server_t ()
+{
+    sodium_memzero (&cipher, sizeof cipher);
+}
+
+int zmq::curve_aesgcm_server_t::encode (msg_t *msg_)
+{
+    zmq_assert (is_handshake_complete ());
+
+    if (!keyed)
+        init_cipher ();
+
+    uint8_t flags = 0;
+    if (msg_->flags () & msg_t::more)
+        flags |= 0x01;
+    if (msg_->flags () & msg_t::batch)
+        flags |= 0x02;
+    if (msg_->flags () & msg_t::command)
+        flags |= 0x04;
+
+    //  The 16 byte header is authenticated along with the flags and the
+    //  message body, which are encrypted in place.
+    const size_t size = msg_->size ();
+    msg_t encoded;
+    int rc = encoded.init_size (16 + 1 + size + crypto_aead_aes256gcm_ABYTES);
+    errno_assert (rc == 0);
+
+    uint8_t *message = static_cast <uint8_t *> (encoded.data ());
+    memcpy (message, "\x07MESSAGE", 8);
+    put_uint64 (message + 8, message_nonce);
+    message [16] = flags;
+    memcpy (message + 17, msg_->data (), size);
+
+    uint8_t nonce [crypto_aead_aes256gcm_NPUBBYTES];
+    memcpy (nonce, "MSGS", 4);
+    memcpy (nonce + 4, message + 8, 8);
+
+    rc = crypto_aead_aes256gcm_encrypt_detached_afternm (message + 16,
+        message + 17 + size, NULL, message + 16, 1 + size, message, 16,
+        NULL, nonce, &cipher);
+    zmq_assert (rc == 0);
+
+    rc = msg_->move (encoded);
+    errno_assert (rc == 0);
+
+    message_nonce++;
+
+    return 0;
+}
+
+int zmq::curve_aesgcm_server_t::decode (msg_t *msg_)
+{
+    zmq_assert (is_handshake_complete ());
+
+    if (!keyed)
+        init_cipher ();
+
+    if (msg_->size () < 16 + 1 + crypto_aead_aes256gcm_ABYTES) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    uint8_t *message = static_cast <uint8_t *> (msg_->data ());
+    if (memcmp (message, "\x07MESSAGE", 8)) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    uint8_t nonce [crypto_aead_aes256gcm_NPUBBYTES];
+    memcpy (nonce, "MSGC", 4);
+    memcpy (nonce + 4, message + 8, 8);
+
+    const size_t size = msg_->size () - 16 - crypto_aead_aes256gcm_ABYTES;
+    int rc = crypto_aead_aes256gcm_decrypt_detached_afternm (message + 16,
+        NULL, message + 16, size, message + 16 + size, message, 16, nonce,
+        &cipher);
+    if (rc != 0) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    msg_t decoded;
+    rc = decoded.init_size (size - 1);
+    errno_assert (rc == 0);
+    if (message [16] & 0x01)
+        decoded.set_flags (msg_t::more);
+    if (message [16] & 0x02)
+        decoded.set_flags (msg_t::batch);
+    if (message [16] & 0x04)
+        decoded.set_flags (msg_t::command);
+    memcpy (decoded.data (), message + 17, size - 1);
+
+    rc = msg_->move (decoded);
+    errno_assert (rc == 0);
+
+    return 0;
+}
+
+void zmq::curve_aesgcm_server_t::init_cipher ()
+{
+    //  Both peers derive the same key from the precomputed shared key,
+    //  so that it is not used by two different ciphers.
+    uint8_t material [crypto_box_BEFORENMBYTES + 16];
+    memcpy (material, cn_precom, crypto_box_BEFORENMBYTES);
+    memcpy (material + crypto_box_BEFORENMBYTES, "CurveZMQAESGCM--", 16);
+
+    uint8_t key [crypto_hash_sha256_BYTES];
+    int rc = crypto_hash_sha256 (key, material, sizeof material);
+    zmq_assert (rc == 0);
+
+    rc = crypto_aead_aes256gcm_beforenm (&cipher, key);
+    zmq_assert (rc == 0);
+    keyed = true;
+
+    sodium_memzero (material, sizeof material);
+    sodium_memzero (key, sizeof key);
+}
+
+#endif
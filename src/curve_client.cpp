@@ -108,6 +108,10 @@ int zmq::curve_client_t::encode (msg_t *msg_)
     uint8_t flags = 0;
     if (msg_->flags () & msg_t::more)
         flags |= 0x01;
+    if (msg_->flags () & msg_t::batch)
+        flags |= 0x02;
+    if (msg_->flags () & msg_t::command)
+        flags |= 0x04;
 
     uint8_t message_nonce [crypto_box_NONCEBYTES];
     memcpy (message_nonce, "CurveZMQMESSAGEC", 16);
@@ -194,6 +198,10 @@ int zmq::curve_client_t::decode (msg_t *msg_)
         const uint8_t flags = message_plaintext [crypto_box_ZEROBYTES];
         if (flags & 0x01)
             msg_->set_flags (msg_t::more);
+        if (flags & 0x02)
+            msg_->set_flags (msg_t::batch);
+        if (flags & 0x04)
+            msg_->set_flags (msg_t::command);
 
         memcpy (msg_->data (),
                 message_plaintext + crypto_box_ZEROBYTES + 1,
@@ -315,8 +323,10 @@ int zmq::curve_client_t::produce_initiate (msg_t *msg_)
 
     //  Assume here that metadata is limited to 256 bytes
     uint8_t initiate_nonce [crypto_box_NONCEBYTES];
-    uint8_t initiate_plaintext [crypto_box_ZEROBYTES + 128 + 256];
-    uint8_t initiate_box [crypto_box_BOXZEROBYTES + 144 + 256];
+    uint8_t initiate_plaintext [crypto_box_ZEROBYTES + 128 + 256
+                                + extension_properties_max];
+    uint8_t initiate_box [crypto_box_BOXZEROBYTES + 144 + 256
+                          + extension_properties_max];
 
     //  Create Box [C + vouch + metadata](C'->S')
     memset (initiate_plaintext, 0, crypto_box_ZEROBYTES);
@@ -341,6 +351,9 @@ int zmq::curve_client_t::produce_initiate (msg_t *msg_)
         ptr += add_property (ptr, "Identity",
                              options.identity, options.identity_size);
 
+    //  Add the properties of the protocol extensions in use
+    ptr += add_extension_properties (ptr);
+
     const size_t mlen = ptr - initiate_plaintext;
 
     memcpy (initiate_nonce, "CurveZMQINITIATE", 16);
@@ -384,8 +397,10 @@ int zmq::curve_client_t::process_ready (msg_t *msg_)
     const size_t clen = (msg_->size () - 14) + crypto_box_BOXZEROBYTES;
 
     uint8_t ready_nonce [crypto_box_NONCEBYTES];
-    uint8_t ready_plaintext [crypto_box_ZEROBYTES + 256];
-    uint8_t ready_box [crypto_box_BOXZEROBYTES + 16 + 256];
+    uint8_t ready_plaintext [crypto_box_ZEROBYTES + 256
+                             + extension_properties_max];
+    uint8_t ready_box [crypto_box_BOXZEROBYTES + 16 + 256
+                       + extension_properties_max];
 
     memset (ready_box, 0, crypto_box_BOXZEROBYTES);
     memcpy (ready_box + crypto_box_BOXZEROBYTES,
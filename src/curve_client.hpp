@@ -56,6 +56,11 @@ namespace zmq
         virtual int decode (msg_t *msg_);
         virtual bool is_handshake_complete () const;
 
+    protected:
+
+        //  Intermediary buffer used to seepd up boxing and unboxing.
+        uint8_t cn_precom [crypto_box_BEFORENMBYTES];
+
     private:
 
         enum state_t {
@@ -90,9 +95,6 @@ namespace zmq
         //  Cookie received from server
         uint8_t cn_cookie [16 + 80];
 
-        //  Intermediary buffer used to seepd up boxing and unboxing.
-        uint8_t cn_precom [crypto_box_BEFORENMBYTES];
-
         //  Nonce
         uint64_t cn_nonce;
 
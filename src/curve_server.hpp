@@ -62,6 +62,11 @@ namespace zmq
         virtual int zap_msg_available ();
         virtual bool is_handshake_complete () const;
 
+    protected:
+
+        //  Intermediary buffer used to speed up boxing and unboxing.
+        uint8_t cn_precom [crypto_box_BEFORENMBYTES];
+
     private:
 
         enum state_t {
@@ -100,9 +105,6 @@ namespace zmq
         //  Key used to produce cookie
         uint8_t cookie_key [crypto_secretbox_KEYBYTES];
 
-        //  Intermediary buffer used to speed up boxing and unboxing.
-        uint8_t cn_precom [crypto_box_BEFORENMBYTES];
-
         int process_hello (msg_t *msg_);
         int produce_welcome (msg_t *msg_);
         int process_initiate (msg_t *msg_);
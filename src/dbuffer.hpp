@@ -53,6 +53,7 @@ namespace zmq
         inline dbuffer_t ()
             : back (&storage[0])
             , front (&storage[1])
+            , sync ("dbuffer_t::sync")
             , has_msg (false)
         {
             back->init ();
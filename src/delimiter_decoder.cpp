@@ -0,0 +1,70 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+
+#include "platform.hpp"
+#ifdef ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#endif
+
+#include "delimiter_decoder.hpp"
+#include "likely.hpp"
+#include "err.hpp"
+
+zmq::delimiter_decoder_t::delimiter_decoder_t (size_t bufsize_,
+      const std::string &delimiter_, int64_t maxmsgsize_) :
+    frame_decoder_t (bufsize_, maxmsgsize_),
+    delimiter (delimiter_)
+{
+    zmq_assert (!delimiter.empty ());
+}
+
+zmq::delimiter_decoder_t::~delimiter_decoder_t ()
+{
+}
+
+int zmq::delimiter_decoder_t::find_frame (const uint8_t *data_,
+    size_t size_, size_t scanned_, size_t &offset_, size_t &frame_size_,
+    size_t &used_, size_t &)
+{
+    const size_t dsize = delimiter.size ();
+
+    //  The delimiter may straddle the boundary between the data searched
+    //  before and the new data, so resume a little bit before the new data.
+    const uint8_t *from = data_ + scanned_ - std::min (scanned_, dsize - 1);
+    const uint8_t *end = data_ + size_;
+    const uint8_t *pos = std::search (from, end,
+        delimiter.begin (), delimiter.end ());
+
+    if (pos == end) {
+        //  Don't let an unterminated frame grow without bounds.
+        if (maxmsgsize >= 0)
+            if (unlikely (size_ >
+                  static_cast <uint64_t> (maxmsgsize) + dsize - 1)) {
+                errno = EMSGSIZE;
+                return -1;
+            }
+        return 0;
+    }
+
+    offset_ = 0;
+    frame_size_ = pos - data_;
+    used_ = frame_size_ + dsize;
+    return 1;
+}
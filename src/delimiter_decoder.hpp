@@ -0,0 +1,57 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __ZMQ_DELIMITER_DECODER_HPP_INCLUDED__
+#define __ZMQ_DELIMITER_DECODER_HPP_INCLUDED__
+
+#include <string>
+
+#include "frame_decoder.hpp"
+
+namespace zmq
+{
+
+    //  Decoder for ZMQ_STREAM sockets speaking a delimiter-framed application
+    //  protocol. Each frame up to (but not including) the delimiter is
+    //  delivered as a single message. Frames are searched for the delimiter
+    //  right in the receive buffer.
+
+    class delimiter_decoder_t : public frame_decoder_t
+    {
+    public:
+
+        delimiter_decoder_t (size_t bufsize_, const std::string &delimiter_,
+            int64_t maxmsgsize_);
+        virtual ~delimiter_decoder_t ();
+
+    private:
+
+        //  frame_decoder_t interface.
+        virtual int find_frame (const unsigned char *data_, size_t size_,
+            size_t scanned_, size_t &offset_, size_t &frame_size_,
+            size_t &used_, size_t &needed_);
+
+        const std::string delimiter;
+
+        delimiter_decoder_t (const delimiter_decoder_t&);
+        void operator = (const delimiter_decoder_t&);
+    };
+
+}
+
+#endif
@@ -128,6 +128,12 @@ void zmq::devpoll_t::start ()
     worker.start (worker_routine, this);
 }
 
+int zmq::devpoll_t::set_cpus (const std::vector <int> &cpus_,
+    std::vector <int> &cpus_out_)
+{
+    return worker.set_cpus (cpus_, cpus_out_);
+}
+
 void zmq::devpoll_t::stop ()
 {
     stopping = true;
@@ -161,7 +167,9 @@ void zmq::devpoll_t::loop ()
         poll_req.dp_nfds = max_io_events;
 #endif
         poll_req.dp_timeout = timeout ? timeout : -1;
+        wait_begin ();
         int n = ioctl (devpoll_fd, DP_POLL, &poll_req);
+        wait_end (n);
         if (n == -1 && errno == EINTR)
             continue;
         errno_assert (n != -1);
@@ -17,17 +17,25 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+
 #include "dist.hpp"
 #include "pipe.hpp"
 #include "err.hpp"
 #include "msg.hpp"
 #include "likely.hpp"
+#include "config.hpp"
 
 zmq::dist_t::dist_t () :
     matching (0),
     active (0),
     eligible (0),
-    more (false)
+    more (false),
+    next_id (0),
+    seq (1),
+    rate (0),
+    drop_ratio (0),
+    queue_age (0)
 {
 }
 
@@ -38,17 +46,19 @@ zmq::dist_t::~dist_t ()
 
 void zmq::dist_t::attach (pipe_t *pipe_)
 {
+    peer_t peer = {next_id++, 0, 0, 0, 0, 0, 0, 0, 0, 0, false};
+    pipes.push_back (pipe_);
+    peers.push_back (peer);
+
     //  If we are in the middle of sending a message, we'll add new pipe
     //  into the list of eligible pipes. Otherwise we add it to the list
     //  of active pipes.
     if (more) {
-        pipes.push_back (pipe_);
-        pipes.swap (eligible, pipes.size () - 1);
+        swap (eligible, pipes.size () - 1);
         eligible++;
     }
     else {
-        pipes.push_back (pipe_);
-        pipes.swap (active, pipes.size () - 1);
+        swap (active, pipes.size () - 1);
         active++;
         eligible++;
     }
@@ -60,18 +70,26 @@ void zmq::dist_t::match (pipe_t *pipe_)
     if (pipes.index (pipe_) < matching)
         return;
 
-    //  If the pipe isn't eligible, ignore it.
-    if (pipes.index (pipe_) >= eligible)
+    //  If the pipe isn't eligible, ignore it. The pipe is full, so the
+    //  message is dropped as far as the pipe is concerned.
+    if (pipes.index (pipe_) >= eligible) {
+        peer_t &peer = peers [pipes.index (pipe_)];
+        if (peer.dropped_seq != seq) {
+            peer.dropped_seq = seq;
+            dropped (pipes.index (pipe_));
+        }
         return;
+    }
 
     //  Mark the pipe as matching.
-    pipes.swap (pipes.index (pipe_), matching);
+    swap (pipes.index (pipe_), matching);
     matching++;    
 }
 
 void zmq::dist_t::unmatch ()
 {
     matching = 0;
+    seq++;
 }
 
 void zmq::dist_t::pipe_terminated (pipe_t *pipe_)
@@ -79,31 +97,38 @@ void zmq::dist_t::pipe_terminated (pipe_t *pipe_)
     //  Remove the pipe from the list; adjust number of matching, active and/or
     //  eligible pipes accordingly.
     if (pipes.index (pipe_) < matching) {
-        pipes.swap (pipes.index (pipe_), matching - 1);
+        swap (pipes.index (pipe_), matching - 1);
         matching--;
     }
     if (pipes.index (pipe_) < active) {
-        pipes.swap (pipes.index (pipe_), active - 1);
+        swap (pipes.index (pipe_), active - 1);
         active--;
     }
     if (pipes.index (pipe_) < eligible) {
-        pipes.swap (pipes.index (pipe_), eligible - 1);
+        swap (pipes.index (pipe_), eligible - 1);
         eligible--;
     }
 
-    pipes.erase (pipe_);
+    //  Erase the pipe and its state the same way.
+    const pipes_t::size_type index = pipes.index (pipe_);
+    peers [index] = peers.back ();
+    peers.pop_back ();
+    pipes.erase (index);
 }
 
 void zmq::dist_t::activated (pipe_t *pipe_)
 {
+    //  The pipe is not full anymore.
+    peers [pipes.index (pipe_)].full_since = 0;
+
     //  Move the pipe from passive to eligible state.
-    pipes.swap (pipes.index (pipe_), eligible);
+    swap (pipes.index (pipe_), eligible);
     eligible++;
 
     //  If there's no message being sent at the moment, move it to
     //  the active state.
     if (!more) {
-        pipes.swap (eligible - 1, active);
+        swap (eligible - 1, active);
         active++;
     }
 }
@@ -133,6 +158,25 @@ int zmq::dist_t::send_to_matching (msg_t *msg_)
 
 void zmq::dist_t::distribute (msg_t *msg_)
 {
+    //  Pipes that are over their rate don't get the message. The decision
+    //  is taken on the first part, so that the message is dropped whole.
+    if (rate > 0 && !more) {
+        const uint64_t now = clock.now_ms ();
+        for (pipes_t::size_type i = 0; i < matching;)
+            if (take_token (i, now))
+                i++;
+            else {
+                peers [i].paced++;
+                swap (i, matching - 1);
+                matching--;
+            }
+    }
+
+    //  Pipes that have been full for too long are evicted even if they
+    //  don't subscribe to the message and so never see it dropped.
+    if (queue_age > 0 && !more && eligible < pipes.size ())
+        check_queue_age ();
+
     //  If there are no matching pipes available, simply drop the message.
     if (matching == 0) {
         int rc = msg_->close ();
@@ -181,16 +225,130 @@ bool zmq::dist_t::has_out ()
 bool zmq::dist_t::write (pipe_t *pipe_, msg_t *msg_)
 {
     if (!pipe_->write (msg_)) {
-        pipes.swap (pipes.index (pipe_), matching - 1);
+        dropped (pipes.index (pipe_));
+        swap (pipes.index (pipe_), matching - 1);
         matching--;
-        pipes.swap (pipes.index (pipe_), active - 1);
+        swap (pipes.index (pipe_), active - 1);
         active--;
-        pipes.swap (active, eligible - 1);
+        swap (active, eligible - 1);
         eligible--;
         return false;
     }
-    if (!(msg_->flags () & msg_t::more))
+    if (!(msg_->flags () & msg_t::more)) {
         pipe_->flush ();
+        sent (pipes.index (pipe_));
+    }
+    return true;
+}
+
+void zmq::dist_t::set_policies (int rate_, int drop_ratio_, int queue_age_)
+{
+    rate = rate_;
+    drop_ratio = drop_ratio_;
+    queue_age = queue_age_;
+}
+
+size_t zmq::dist_t::get_stats (zmq_xpub_peer_stats_t *stats_, size_t count_)
+{
+    size_t count = pipes.size () < count_ ? pipes.size () : count_;
+    for (size_t i = 0; i != count; i++) {
+        stats_ [i].sent = peers [i].sent;
+        stats_ [i].dropped = peers [i].dropped;
+        stats_ [i].paced = peers [i].paced;
+        stats_ [i].peer = peers [i].id;
+    }
+    return count;
+}
+
+void zmq::dist_t::swap (pipes_t::size_type index1_,
+    pipes_t::size_type index2_)
+{
+    pipes.swap (index1_, index2_);
+    std::swap (peers [index1_], peers [index2_]);
+}
+
+void zmq::dist_t::sent (pipes_t::size_type index_)
+{
+    peers [index_].sent++;
+    if (drop_ratio > 0) {
+        peers [index_].window_sent++;
+        check_drop_ratio (index_);
+    }
+}
+
+void zmq::dist_t::dropped (pipes_t::size_type index_)
+{
+    peer_t &peer = peers [index_];
+    peer.dropped++;
+
+    //  Terminate the pipe if it has been full for too long.
+    if (queue_age > 0) {
+        const uint64_t now = clock.now_ms ();
+        if (!peer.full_since)
+            peer.full_since = now;
+        else
+        if (now - peer.full_since >= (uint64_t) queue_age)
+            evict (index_);
+    }
+
+    if (drop_ratio > 0) {
+        peer.window_dropped++;
+        check_drop_ratio (index_);
+    }
+}
+
+void zmq::dist_t::check_queue_age ()
+{
+    //  Only the pipes past the eligible ones can be full.
+    const uint64_t now = clock.now_ms ();
+    for (pipes_t::size_type i = eligible; i != pipes.size (); i++) {
+        peer_t &peer = peers [i];
+        if (!peer.full_since)
+            peer.full_since = now;
+        else
+        if (now - peer.full_since >= (uint64_t) queue_age)
+            evict (i);
+    }
+}
+
+void zmq::dist_t::check_drop_ratio (pipes_t::size_type index_)
+{
+    //  Evaluate the ratio once per eviction_window messages.
+    peer_t &peer = peers [index_];
+    const uint32_t total = peer.window_sent + peer.window_dropped;
+    if (total < eviction_window)
+        return;
+    if ((uint64_t) peer.window_dropped * 100 >= (uint64_t) drop_ratio * total)
+        evict (index_);
+    peer.window_sent = 0;
+    peer.window_dropped = 0;
+}
+
+void zmq::dist_t::evict (pipes_t::size_type index_)
+{
+    //  The pipe stays with us till its termination is complete.
+    if (peers [index_].evicted)
+        return;
+    peers [index_].evicted = true;
+    pipes [index_]->terminate (false, true);
+}
+
+bool zmq::dist_t::take_token (pipes_t::size_type index_, uint64_t now_)
+{
+    //  Refill the bucket, which holds up to a tenth of a second's worth of
+    //  messages but at least one.
+    peer_t &peer = peers [index_];
+    if (now_ != peer.refill_time) {
+        const int64_t depth = rate > 10 ? (int64_t) rate * 100 : 1000;
+        peer.tokens += (int64_t) (now_ - peer.refill_time) * rate;
+        if (peer.tokens > depth)
+            peer.tokens = depth;
+        peer.refill_time = now_;
+    }
+
+    if (peer.tokens < 1000)
+        return false;
+    peer.tokens -= 1000;
     return true;
 }
 
@@ -22,8 +22,12 @@
 
 #include <vector>
 
+#include "../include/zmq.h"
+
 #include "array.hpp"
 #include "pipe.hpp"
+#include "clock.hpp"
+#include "stdint.hpp"
 
 namespace zmq
 {
@@ -64,6 +68,16 @@ namespace zmq
 
         bool has_out ();
 
+        //  Sets the policies applied to each pipe: maximal number of
+        //  messages per second (zero for no limit), and the percentage of
+        //  dropped messages and the time in milliseconds the pipe may stay
+        //  full (zero for no limit) beyond which the pipe is terminated.
+        void set_policies (int rate_, int drop_ratio_, int queue_age_);
+
+        //  Fills in statistics of up to count_ pipes. Returns the number of
+        //  pipes filled in.
+        size_t get_stats (zmq_xpub_peer_stats_t *stats_, size_t count_);
+
     private:
 
         //  Write the message to the pipe. Make the pipe inactive if writing
@@ -95,6 +109,71 @@ namespace zmq
         //  True if last we are in the middle of a multipart message.
         bool more;
 
+        //  Per-pipe state kept alongside the pipes array, in the same order.
+        struct peer_t
+        {
+            uint32_t id;
+            uint64_t sent;
+            uint64_t dropped;
+            uint64_t paced;
+
+            //  Messages sent and dropped since the drop ratio was last
+            //  checked.
+            uint32_t window_sent;
+            uint32_t window_dropped;
+
+            //  Pacing tokens in thousandths of a message and the time they
+            //  were last refilled at.
+            int64_t tokens;
+            uint64_t refill_time;
+
+            //  Time the pipe was found full at, zero if it's not full.
+            uint64_t full_since;
+
+            //  Sequence number of the message the pipe has last been found
+            //  full for. A pipe may match a message several times.
+            uint64_t dropped_seq;
+
+            //  True once the pipe was asked to terminate by a policy.
+            bool evicted;
+        };
+        typedef std::vector <peer_t> peers_t;
+        peers_t peers;
+
+        //  Id to assign to the next attached pipe.
+        uint32_t next_id;
+
+        //  Sequence number of the message being matched.
+        uint64_t seq;
+
+        //  Policies, see set_policies.
+        int rate;
+        int drop_ratio;
+        int queue_age;
+
+        clock_t clock;
+
+        //  Swaps the pipes at the given positions along with their state.
+        void swap (pipes_t::size_type index1_, pipes_t::size_type index2_);
+
+        //  Account for the message sent to, or dropped for, the pipe at
+        //  the given position and terminate the pipe if it breaks the
+        //  policies.
+        void sent (pipes_t::size_type index_);
+        void dropped (pipes_t::size_type index_);
+        void check_drop_ratio (pipes_t::size_type index_);
+
+        //  Terminates the full pipes that have been full for longer than
+        //  queue_age milliseconds.
+        void check_queue_age ();
+
+        //  Terminates the pipe at the given position.
+        void evict (pipes_t::size_type index_);
+
+        //  Takes a pacing token from the pipe at the given position.
+        //  Returns false if there's none left.
+        bool take_token (pipes_t::size_type index_, uint64_t now_);
+
         dist_t (const dist_t&);
         const dist_t &operator = (const dist_t&);
     };
@@ -61,6 +61,11 @@ namespace zmq
             free (buf);
         }
 
+        inline void warmup ()
+        {
+            memset (buf, 0, bufsize);
+        }
+
         //  The function returns a batch of binary data. The data
         //  are filled to a supplied buffer. If no buffer is supplied (data_
         //  points to NULL) decoder object will provide buffer of its own.
@@ -121,6 +121,12 @@ void zmq::epoll_t::start ()
     worker.start (worker_routine, this);
 }
 
+int zmq::epoll_t::set_cpus (const std::vector <int> &cpus_,
+    std::vector <int> &cpus_out_)
+{
+    return worker.set_cpus (cpus_, cpus_out_);
+}
+
 void zmq::epoll_t::stop ()
 {
     stopping = true;
@@ -141,8 +147,10 @@ void zmq::epoll_t::loop ()
         int timeout = (int) execute_timers ();
 
         //  Wait for events.
+        wait_begin ();
         int n = epoll_wait (epoll_fd, &ev_buf [0], max_io_events,
             timeout ? timeout : -1);
+        wait_end (n);
         if (n == -1) {
             errno_assert (errno == EINTR);
             continue;
@@ -0,0 +1,162 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "flight_recorder.hpp"
+#include "wire.hpp"
+#include "err.hpp"
+
+//  The dump file starts with a header:
+//
+//      magic           8 bytes, "ZMQFR\0\0\1"
+//      ticks per us    uint64
+//      dump time       uint64, in the same unit as the record times
+//
+//  followed by one section per thread that recorded anything:
+//
+//      thread          uint32, mailbox slot of the thread
+//      record count    uint32
+//      records         24 bytes each, oldest first:
+//          time        uint64
+//          object      uint64, address of the recording object
+//          event       uint32, see flight_recorder_t::event_t
+//          value       uint32
+//
+//  All integers are in network byte order.
+
+static const unsigned char magic [8] = {'Z', 'M', 'Q', 'F', 'R', 0, 0, 1};
+
+zmq::flight_recorder_t::flight_recorder_t (uint32_t capacity_) :
+    count (0)
+{
+    uint32_t capacity = 1;
+    while (capacity < capacity_ && capacity < 0x80000000)
+        capacity <<= 1;
+    mask = capacity - 1;
+    records = (record_t *) malloc (capacity * sizeof (record_t));
+    alloc_assert (records);
+    memset (records, 0, capacity * sizeof (record_t));
+}
+
+zmq::flight_recorder_t::~flight_recorder_t ()
+{
+    free (records);
+}
+
+uint64_t zmq::flight_recorder_t::ticks_per_us ()
+{
+    const uint64_t ticks = clock_t::rdtsc_per_us ();
+    return ticks ? ticks : 1;
+}
+
+static int write_all (int fd_, const unsigned char *data_, size_t size_)
+{
+    while (size_ > 0) {
+#if defined ZMQ_HAVE_WINDOWS
+        const int rc = _write (fd_, data_, (unsigned int) size_);
+#else
+        const ssize_t rc = ::write (fd_, data_, size_);
+        if (rc == -1 && errno == EINTR)
+            continue;
+#endif
+        if (rc <= 0)
+            return -1;
+        data_ += rc;
+        size_ -= rc;
+    }
+    return 0;
+}
+
+int zmq::flight_recorder_t::dump (
+    atomic_ptr_t <flight_recorder_t> *recorders_, uint32_t count_,
+    const char *path_)
+{
+#if defined ZMQ_HAVE_WINDOWS
+    const int fd = _open (path_, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+        _S_IREAD | _S_IWRITE);
+#else
+    const int fd = open (path_, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (fd == -1)
+        return -1;
+
+    unsigned char header [24];
+    memcpy (header, magic, 8);
+    put_uint64 (header + 8, ticks_per_us ());
+    put_uint64 (header + 16, now ());
+    int rc = write_all (fd, header, sizeof header);
+
+    for (uint32_t i = 0; rc == 0 && i != count_; i++) {
+        flight_recorder_t *recorder = recorders_ [i].cas (NULL, NULL);
+        if (recorder)
+            rc = recorder->dump (fd, i);
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    _close (fd);
+#else
+    close (fd);
+#endif
+    return rc;
+}
+
+int zmq::flight_recorder_t::dump (int fd_, uint32_t tid_)
+{
+    //  Take a snapshot of the count; anything the thread records from now
+    //  on may overwrite the oldest records being dumped.
+    const uint64_t end = count;
+    const uint64_t size = end < (uint64_t) mask + 1 ? end : (uint64_t) mask + 1;
+
+    unsigned char buf [8 + 24 * 64];
+    put_uint32 (buf, tid_);
+    put_uint32 (buf + 4, (uint32_t) size);
+    size_t pos = 8;
+
+    for (uint64_t i = end - size; i != end; i++) {
+        const record_t &r = records [i & mask];
+        put_uint64 (buf + pos, r.time);
+        put_uint64 (buf + pos + 8, r.object);
+        put_uint32 (buf + pos + 16, r.event);
+        put_uint32 (buf + pos + 20, r.value);
+        pos += 24;
+        if (pos + 24 > sizeof buf) {
+            if (write_all (fd_, buf, pos) == -1)
+                return -1;
+            pos = 0;
+        }
+    }
+    return write_all (fd_, buf, pos);
+}
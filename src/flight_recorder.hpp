@@ -0,0 +1,113 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_FLIGHT_RECORDER_HPP_INCLUDED__
+#define __ZMQ_FLIGHT_RECORDER_HPP_INCLUDED__
+
+#include "stdint.hpp"
+#include "clock.hpp"
+#include "atomic_ptr.hpp"
+
+namespace zmq
+{
+
+    //  Bounded ring of the most recent internal events of one thread, as
+    //  identified by its mailbox slot. The ring is written by that thread
+    //  only, without synchronisation, and the oldest records are
+    //  overwritten. It can be dumped from any thread at any time, though
+    //  records written during the dump may come out garbled.
+
+    class flight_recorder_t
+    {
+    public:
+
+        //  Recorded events. The meaning of the value depends on the event.
+        enum event_t
+        {
+            command = 1,            //  Command type
+            activate_read = 2,      //  None
+            activate_write = 3,     //  Messages read by the peer
+            hwm_reached = 4,        //  High water mark
+            engine_read = 5,        //  Bytes read
+            engine_write = 6,       //  Bytes written
+            send_blocked = 7,       //  Send flags
+            recv_blocked = 8        //  Receive flags
+        };
+
+        //  Capacity is rounded up to the next power of two.
+        flight_recorder_t (uint32_t capacity_);
+        ~flight_recorder_t ();
+
+        inline void record (event_t event_, const void *object_,
+            uint32_t value_)
+        {
+            record_t &r = records [count & mask];
+            r.time = now ();
+            r.object = (uint64_t) (size_t) object_;
+            r.event = event_;
+            r.value = value_;
+            count++;
+        }
+
+        //  Timestamp used in the records: CPU ticks if available,
+        //  microseconds otherwise.
+        static inline uint64_t now ()
+        {
+            const uint64_t tsc = clock_t::rdtsc ();
+            return tsc ? tsc : clock_t::now_us ();
+        }
+
+        //  Number of timestamp units per microsecond.
+        static uint64_t ticks_per_us ();
+
+        //  Writes the records of all the recorders_, indexed by thread
+        //  slot, into a file at path_, in the format described in
+        //  flight_recorder.cpp. NULL entries are skipped. Neither allocates
+        //  memory nor takes locks.
+        static int dump (atomic_ptr_t <flight_recorder_t> *recorders_,
+            uint32_t count_, const char *path_);
+
+    private:
+
+        //  Writes the records of thread tid_ to file descriptor fd_, oldest
+        //  first.
+        int dump (int fd_, uint32_t tid_);
+
+        struct record_t
+        {
+            uint64_t time;
+            uint64_t object;
+            uint32_t event;
+            uint32_t value;
+        };
+
+        record_t *records;
+        uint32_t mask;
+
+        //  Number of records ever written.
+        uint64_t count;
+
+        flight_recorder_t (const flight_recorder_t&);
+        const flight_recorder_t &operator = (const flight_recorder_t&);
+    };
+
+}
+
+#endif
@@ -0,0 +1,178 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include "platform.hpp"
+#ifdef ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#endif
+
+#include "frame_decoder.hpp"
+#include "config.hpp"
+#include "likely.hpp"
+#include "err.hpp"
+
+zmq::frame_decoder_t::frame_decoder_t (size_t bufsize_,
+      int64_t maxmsgsize_) :
+    maxmsgsize (maxmsgsize_),
+    batch_size (bufsize_),
+    refcnt (NULL),
+    buffer (NULL),
+    bufsize (0),
+    pending (0)
+{
+    int rc = in_progress.init ();
+    errno_assert (rc == 0);
+
+    rc = reallocate (batch_size, NULL);
+    errno_assert (rc == 0);
+}
+
+zmq::frame_decoder_t::~frame_decoder_t ()
+{
+    int rc = in_progress.close ();
+    errno_assert (rc == 0);
+
+    release (buffer, refcnt);
+}
+
+void zmq::frame_decoder_t::get_buffer (unsigned char **data_, size_t *size_)
+{
+    //  If messages still refer to the buffer, leave it to them. Likewise,
+    //  don't hold on to a buffer grown for a large frame once it's done.
+    if (pending == 0 &&
+          (refcnt->get_acquire () > 1 || bufsize != batch_size)) {
+        const int rc = reallocate (batch_size, NULL);
+        errno_assert (rc == 0);
+    }
+
+    *data_ = buffer + pending;
+    *size_ = bufsize - pending;
+}
+
+int zmq::frame_decoder_t::decode (const uint8_t *data_, size_t size_,
+    size_t &bytes_used_)
+{
+    //  The data continue the pending part of the frame, if any.
+    zmq_assert (pending == 0 || data_ == buffer + pending);
+    const uint8_t *begin = pending ? buffer : data_;
+
+    size_t offset = 0;
+    size_t frame_size = 0;
+    size_t used = 0;
+    size_t needed = 0;
+    int rc = find_frame (begin, pending + size_, pending,
+        offset, frame_size, used, needed);
+    if (rc == -1)
+        return -1;
+
+    if (rc == 1) {
+        zmq_assert (used > pending && used <= pending + size_);
+        bytes_used_ = used - pending;
+        pending = 0;
+        return frame_ready (const_cast <uint8_t*> (begin) + offset,
+            frame_size);
+    }
+
+    //  No complete frame yet; keep the data until the rest arrives.
+    bytes_used_ = size_;
+    pending += size_;
+
+    size_t capacity = bufsize;
+    if (needed > capacity)
+        capacity = needed;
+    else
+    if (pending == capacity)
+        capacity *= 2;
+
+    //  Data still referred to by messages must not be overwritten.
+    if (capacity != bufsize || refcnt->get_acquire () > 1)
+        return reallocate (capacity, begin);
+
+    if (begin != buffer)
+        memmove (buffer, begin, pending);
+    return 0;
+}
+
+int zmq::frame_decoder_t::reallocate (size_t capacity_, const uint8_t *data_)
+{
+    void *chunk = malloc (sizeof (atomic_counter_t) + capacity_);
+    if (unlikely (!chunk)) {
+        errno = ENOMEM;
+        return -1;
+    }
+    atomic_counter_t *new_refcnt = new (chunk) atomic_counter_t (1);
+    unsigned char *new_buffer = (unsigned char *) chunk +
+        sizeof (atomic_counter_t);
+
+    if (pending)
+        memcpy (new_buffer, data_, pending);
+    if (refcnt)
+        release (buffer, refcnt);
+
+    refcnt = new_refcnt;
+    buffer = new_buffer;
+    bufsize = capacity_;
+    return 0;
+}
+
+int zmq::frame_decoder_t::frame_ready (uint8_t *data_, size_t size_)
+{
+    //  Message size must not exceed the maximum allowed size.
+    if (maxmsgsize >= 0)
+        if (unlikely (size_ > static_cast <uint64_t> (maxmsgsize))) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+
+    //  in_progress is either a 0-byte message or has been handed over to
+    //  the session, so it can be treated as uninitialised.
+    int rc;
+    if (size_ <= stream_frame_copy_max) {
+        rc = in_progress.init_size (size_);
+        if (likely (rc == 0))
+            memcpy (in_progress.data (), data_, size_);
+    }
+    else {
+        refcnt->add (1);
+        rc = in_progress.init_data (data_, size_, release, refcnt);
+        if (unlikely (rc))
+            refcnt->sub (1);
+    }
+    if (unlikely (rc)) {
+        errno_assert (errno == ENOMEM);
+        rc = in_progress.init ();
+        errno_assert (rc == 0);
+        errno = ENOMEM;
+        return -1;
+    }
+    return 1;
+}
+
+void zmq::frame_decoder_t::release (void *, void *hint_)
+{
+    atomic_counter_t *counter = (atomic_counter_t *) hint_;
+    if (!counter->sub (1)) {
+        counter->~atomic_counter_t ();
+        free (counter);
+    }
+}
@@ -0,0 +1,105 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_FRAME_DECODER_HPP_INCLUDED__
+#define __ZMQ_FRAME_DECODER_HPP_INCLUDED__
+
+#include "err.hpp"
+#include "msg.hpp"
+#include "i_decoder.hpp"
+#include "atomic_counter.hpp"
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    //  Base class for decoders of ZMQ_STREAM sockets speaking a framed
+    //  application protocol. Data are received into a reference-counted
+    //  buffer and frames longer than stream_frame_copy_max are delivered
+    //  as messages referring to the buffer rather than as copies. While
+    //  such messages are alive the buffer is not written to again; the
+    //  decoder moves on to a new one instead. The beginning of a frame
+    //  that is not complete yet is kept at the front of the buffer, which
+    //  grows if the frame doesn't fit in it.
+
+    class frame_decoder_t : public i_decoder
+    {
+    public:
+
+        frame_decoder_t (size_t bufsize_, int64_t maxmsgsize_);
+        virtual ~frame_decoder_t ();
+
+        //  i_decoder interface.
+
+        virtual void get_buffer (unsigned char **data_, size_t *size_);
+
+        virtual int decode (const unsigned char *data_, size_t size_,
+                            size_t &processed);
+
+        virtual msg_t *msg () { return &in_progress; }
+
+    protected:
+
+        //  Looks for a complete frame in the size_ bytes at data_, the first
+        //  scanned_ of which were passed in before. If there is one, stores
+        //  its offset and size along with the number of bytes it takes up on
+        //  the wire and returns 1. If more data are needed, returns 0 and
+        //  sets needed_ to the number of bytes required if that is known.
+        //  On error, returns -1 with errno set.
+        virtual int find_frame (const unsigned char *data_, size_t size_,
+            size_t scanned_, size_t &offset_, size_t &frame_size_,
+            size_t &used_, size_t &needed_) = 0;
+
+        const int64_t maxmsgsize;
+
+    private:
+
+        //  Moves to a new buffer of size capacity_, carrying over the
+        //  pending part of a frame found at data_.
+        int reallocate (size_t capacity_, const unsigned char *data_);
+
+        //  Fills in_progress with the frame, checking its size.
+        int frame_ready (unsigned char *data_, size_t size_);
+
+        //  Drops a reference to the buffer; hint_ is its reference count.
+        static void release (void *data_, void *hint_);
+
+        msg_t in_progress;
+
+        //  Size of the buffer to start over with once messages refer to
+        //  the current one.
+        const size_t batch_size;
+
+        //  The reference count lives at the beginning of the allocated
+        //  block, followed by bufsize bytes of data.
+        atomic_counter_t *refcnt;
+        unsigned char *buffer;
+        size_t bufsize;
+
+        //  Number of bytes at the front of the buffer that belong to a frame
+        //  which is not complete yet.
+        size_t pending;
+
+        frame_decoder_t (const frame_decoder_t&);
+        void operator = (const frame_decoder_t&);
+    };
+
+}
+
+#endif
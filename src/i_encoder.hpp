@@ -43,6 +43,10 @@ namespace zmq
         //  Load a new message into encoder.
         virtual void load_msg (msg_t *msg_) = 0;
 
+        //  Touches the encoder's own buffer so that its pages are mapped
+        //  before the first message is encoded.
+        virtual void warmup () = 0;
+
     };
 
 }
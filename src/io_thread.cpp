@@ -18,14 +18,18 @@
 */
 
 #include <new>
+#include <algorithm>
 
 #include "io_thread.hpp"
 #include "platform.hpp"
 #include "err.hpp"
 #include "ctx.hpp"
+#include "mux.hpp"
 
 zmq::io_thread_t::io_thread_t (ctx_t *ctx_, uint32_t tid_) :
-    object_t (ctx_, tid_)
+    object_t (ctx_, tid_),
+    stopping (false),
+    rtt_sync ("io_thread_t::rtt_sync")
 {
     poller = new (std::nothrow) poller_t;
     alloc_assert (poller);
@@ -60,21 +64,80 @@ int zmq::io_thread_t::get_load ()
     return poller->get_load ();
 }
 
+void zmq::io_thread_t::get_stats (zmq_io_thread_stats_t *stats_)
+{
+    poller->get_stats (stats_);
+}
+
+void zmq::io_thread_t::enable_stats ()
+{
+    poller->enable_stats ();
+}
+
+int zmq::io_thread_t::pin (const std::vector <int> &cpus_)
+{
+    const int rc = poller->set_cpus (cpus_, cpus);
+    if (rc == -1)
+        cpus.clear ();
+    return rc;
+}
+
+void zmq::io_thread_t::unpin (const std::vector <int> &cpus_)
+{
+    poller->set_cpus (cpus_, cpus);
+    cpus.clear ();
+}
+
+bool zmq::io_thread_t::is_pinned_to (int cpu_) const
+{
+    return std::find (cpus.begin (), cpus.end (), cpu_) != cpus.end ();
+}
+
+zmq::mux_t *zmq::io_thread_t::find_mux (const std::string &key_)
+{
+    muxes_t::iterator it = muxes.find (key_);
+    return it == muxes.end () ? NULL : it->second;
+}
+
+void zmq::io_thread_t::register_mux (const std::string &key_, mux_t *mux_)
+{
+    const bool inserted = muxes.insert (muxes_t::value_type (key_, mux_)).second;
+    zmq_assert (inserted);
+    owned_muxes.insert (mux_);
+}
+
+void zmq::io_thread_t::unregister_mux (const std::string &key_, mux_t *mux_)
+{
+    muxes_t::iterator it = muxes.find (key_);
+    if (it != muxes.end () && it->second == mux_)
+        muxes.erase (it);
+}
+
+void zmq::io_thread_t::mux_terminated (mux_t *mux_)
+{
+    owned_muxes.erase (mux_);
+    check_stop ();
+}
+
 void zmq::io_thread_t::in_event ()
 {
     //  TODO: Do we want to limit number of commands I/O thread can
     //  process in a single go?
 
     command_t cmd;
+    int commands = 0;
     int rc = mailbox.recv (&cmd, 0);
 
     while (rc == 0 || errno == EINTR) {
-        if (rc == 0)
+        if (rc == 0) {
             cmd.destination->process_command (cmd);
+            commands++;
+        }
         rc = mailbox.recv (&cmd, 0);
     }
 
     errno_assert (rc != 0 && errno == EAGAIN);
+    poller->commands_processed (commands);
 }
 
 void zmq::io_thread_t::out_event ()
@@ -97,6 +160,52 @@ zmq::poller_t *zmq::io_thread_t::get_poller ()
 
 void zmq::io_thread_t::process_stop ()
 {
-    poller->rm_fd (mailbox_handle);
-    poller->stop ();
+    //  The multiplexed connections don't belong to any socket, so nobody
+    //  has terminated them yet. Wait for them to shut down.
+    stopping = true;
+    for (owned_muxes_t::iterator it = owned_muxes.begin ();
+          it != owned_muxes.end (); ++it)
+        (*it)->close ();
+    check_stop ();
+}
+
+void zmq::io_thread_t::check_stop ()
+{
+    if (stopping && owned_muxes.empty ()) {
+        poller->rm_fd (mailbox_handle);
+        poller->stop ();
+    }
+}
+
+void zmq::io_thread_t::update_rtt_stats (int socket_id_,
+    zmq_peer_rtt_stats_t &stats_)
+{
+    if (stats_.peer == 0)
+        stats_.peer = last_rtt_peer.add (1) + 1;
+    rtt_sync.lock ();
+    rtt_stats [std::make_pair (socket_id_, stats_.peer)] = stats_;
+    rtt_sync.unlock ();
+}
+
+void zmq::io_thread_t::remove_rtt_stats (int socket_id_, uint32_t peer_)
+{
+    rtt_sync.lock ();
+    rtt_stats.erase (std::make_pair (socket_id_, peer_));
+    rtt_sync.unlock ();
 }
+
+size_t zmq::io_thread_t::get_rtt_stats (int socket_id_,
+    zmq_peer_rtt_stats_t *stats_, size_t count_)
+{
+    size_t filled = 0;
+    rtt_sync.lock ();
+    for (rtt_stats_t::iterator it = rtt_stats.lower_bound (
+          std::make_pair (socket_id_, (uint32_t) 0));
+          it != rtt_stats.end () && it->first.first == socket_id_ &&
+          filled < count_; ++it)
+        stats_ [filled++] = it->second;
+    rtt_sync.unlock ();
+    return filled;
+}
+
+zmq::atomic_counter_t zmq::io_thread_t::last_rtt_peer;
@@ -21,9 +21,14 @@
 #define __ZMQ_IO_THREAD_HPP_INCLUDED__
 
 #include <vector>
+#include <map>
+#include <set>
+#include <string>
 
 #include "stdint.hpp"
 #include "object.hpp"
+#include "mutex.hpp"
+#include "atomic_counter.hpp"
 #include "poller.hpp"
 #include "i_poll_events.hpp"
 #include "mailbox.hpp"
@@ -32,6 +37,7 @@ namespace zmq
 {
 
     class ctx_t;
+    class mux_t;
 
     //  Generic part of the I/O thread. Polling-mechanism-specific features
     //  are implemented in separate "polling objects".
@@ -69,6 +75,46 @@ namespace zmq
         //  Returns load experienced by the I/O thread.
         int get_load ();
 
+        //  Retrieves the event loop statistics of the I/O thread.
+        void get_stats (zmq_io_thread_stats_t *stats_);
+
+        //  Makes the I/O thread keep the statistics of its event loop.
+        //  To be called before the thread is started.
+        void enable_stats ();
+
+        //  Pins the I/O thread to the CPU cores listed. To be called once,
+        //  right after the thread is started. Returns -1 and sets errno if
+        //  the thread can't be pinned; it isn't considered pinned then.
+        int pin (const std::vector <int> &cpus_);
+
+        //  Lets the I/O thread run on the CPU cores listed again, without
+        //  considering it pinned to them.
+        void unpin (const std::vector <int> &cpus_);
+
+        //  True iff the I/O thread is pinned to a set of CPU cores
+        //  including cpu_.
+        bool is_pinned_to (int cpu_) const;
+
+        //  Registry of the multiplexed connections opened by the sessions
+        //  living in this thread. It is to be used from within the thread.
+        //  The thread owns the connections from their registration till
+        //  they are deallocated, which they report by mux_terminated, and
+        //  doesn't stop before they are gone.
+        mux_t *find_mux (const std::string &key_);
+        void register_mux (const std::string &key_, mux_t *mux_);
+        void unregister_mux (const std::string &key_, mux_t *mux_);
+        void mux_terminated (mux_t *mux_);
+
+        //  Round-trip time statistics of the connections whose engines live
+        //  in this thread. Updates only contend with readers, never with the
+        //  engines of other threads. Connections are assigned their ID on
+        //  the first update. get_rtt_stats fills in at most count_ records
+        //  of the socket and returns the number of records filled in.
+        void update_rtt_stats (int socket_id_, zmq_peer_rtt_stats_t &stats_);
+        void remove_rtt_stats (int socket_id_, uint32_t peer_);
+        size_t get_rtt_stats (int socket_id_, zmq_peer_rtt_stats_t *stats_,
+            size_t count_);
+
     private:
 
         //  I/O thread accesses incoming commands via this mailbox.
@@ -80,6 +126,35 @@ namespace zmq
         //  I/O multiplexing is performed using a poller object.
         poller_t *poller;
 
+        //  CPU cores the thread is pinned to; empty if it isn't.
+        std::vector <int> cpus;
+
+        //  Multiplexed connections by the endpoint and the options they
+        //  were opened with.
+        typedef std::map <std::string, mux_t*> muxes_t;
+        muxes_t muxes;
+
+        //  Multiplexed connections owned by the thread, including those
+        //  that were unregistered and are shutting down.
+        typedef std::set <mux_t*> owned_muxes_t;
+        owned_muxes_t owned_muxes;
+
+        //  True once the thread was asked to stop.
+        bool stopping;
+
+        //  Stops the thread if it was asked to and owns no more
+        //  connections.
+        void check_stop ();
+
+        //  Round-trip time statistics by socket ID and connection ID.
+        typedef std::map <std::pair <int, uint32_t>, zmq_peer_rtt_stats_t>
+            rtt_stats_t;
+        rtt_stats_t rtt_stats;
+        mutex_t rtt_sync;
+
+        //  Last connection ID assigned, by any of the I/O threads.
+        static atomic_counter_t last_rtt_peer;
+
         io_thread_t (const io_thread_t&);
         const io_thread_t &operator = (const io_thread_t&);
     };
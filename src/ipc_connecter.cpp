@@ -55,6 +55,7 @@ zmq::ipc_connecter_t::ipc_connecter_t (class io_thread_t *io_thread_,
     zmq_assert (addr);
     zmq_assert (addr->protocol == "ipc");
     addr->to_string (endpoint);
+    endpoint_id = addr->endpoint_id;
     socket = session-> get_socket();
 }
 
@@ -113,7 +114,7 @@ void zmq::ipc_connecter_t::out_event ()
     }
     //  Create the engine object for this connection.
     stream_engine_t *engine = new (std::nothrow)
-        stream_engine_t (fd, options, endpoint);
+        stream_engine_t (fd, options, endpoint, endpoint_id);
     alloc_assert (engine);
 
     //  Attach the engine to the corresponding session object.
@@ -122,7 +123,7 @@ void zmq::ipc_connecter_t::out_event ()
     //  Shut the connecter down.
     terminate ();
 
-    socket->event_connected (endpoint, fd);
+    socket->event_connected (endpoint, endpoint_id, fd);
 }
 
 void zmq::ipc_connecter_t::timer_event (int id_)
@@ -150,7 +151,7 @@ void zmq::ipc_connecter_t::start_connecting ()
         handle = add_fd (s);
         handle_valid = true;
         set_pollout (handle);
-        socket->event_connect_delayed (endpoint, zmq_errno());
+        socket->event_connect_delayed (endpoint, endpoint_id, zmq_errno());
     }
 
     //  Handle any other error condition by eventual reconnect.
@@ -165,7 +166,7 @@ void zmq::ipc_connecter_t::add_reconnect_timer()
 {
     int rc_ivl = get_new_reconnect_ivl();
     add_timer (rc_ivl, reconnect_timer_id);
-    socket->event_connect_retried (endpoint, rc_ivl);
+    socket->event_connect_retried (endpoint, endpoint_id, rc_ivl);
     timer_started = true;
 }
 
@@ -226,7 +227,7 @@ int zmq::ipc_connecter_t::close ()
     zmq_assert (s != retired_fd);
     int rc = ::close (s);
     errno_assert (rc == 0);
-    socket->event_closed (endpoint, s);
+    socket->event_closed (endpoint, endpoint_id, s);
     s = retired_fd;
     return 0;
 }
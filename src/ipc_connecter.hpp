@@ -112,6 +112,9 @@ namespace zmq
         // String representation of endpoint to connect to
         std::string endpoint;
 
+        //  ID the monitor ring reports the endpoint with.
+        uint32_t endpoint_id;
+
         // Socket
         zmq::socket_base_t *socket;
 
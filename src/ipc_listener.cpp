@@ -53,7 +53,8 @@ zmq::ipc_listener_t::ipc_listener_t (io_thread_t *io_thread_,
     io_object_t (io_thread_),
     has_file (false),
     s (retired_fd),
-    socket (socket_)
+    socket (socket_),
+    endpoint_id (0)
 {
 }
 
@@ -83,13 +84,13 @@ void zmq::ipc_listener_t::in_event ()
     //  If connection was reset by the peer in the meantime, just ignore it.
     //  TODO: Handle specific errors like ENFILE/EMFILE etc.
     if (fd == retired_fd) {
-        socket->event_accept_failed (endpoint, zmq_errno());
+        socket->event_accept_failed (endpoint, endpoint_id, zmq_errno());
         return;
     }
 
     //  Create the engine object for this connection.
     stream_engine_t *engine = new (std::nothrow)
-        stream_engine_t (fd, options, endpoint);
+        stream_engine_t (fd, options, endpoint, endpoint_id);
     alloc_assert (engine);
 
     //  Choose I/O thread to run connecter in. Given that we are already
@@ -104,7 +105,7 @@ void zmq::ipc_listener_t::in_event ()
     session->inc_seqnum ();
     launch_child (session);
     send_attach (session, engine, false);
-    socket->event_accepted (endpoint, fd);
+    socket->event_accepted (endpoint, endpoint_id, fd);
 }
 
 int zmq::ipc_listener_t::get_address (std::string &addr_)
@@ -157,6 +158,7 @@ int zmq::ipc_listener_t::set_address (const char *addr_)
         return -1;
 
     address.to_string (endpoint);
+    endpoint_id = socket->intern_endpoint (endpoint);
 
     //  Bind the socket to the file path.
     rc = bind (s, address.addr (), address.addrlen ());
@@ -171,7 +173,7 @@ int zmq::ipc_listener_t::set_address (const char *addr_)
     if (rc != 0)
         goto error;
 
-    socket->event_listening (endpoint, s);
+    socket->event_listening (endpoint, endpoint_id, s);
     return 0;
 
 error:
@@ -194,12 +196,12 @@ int zmq::ipc_listener_t::close ()
     if (has_file && !filename.empty ()) {
         rc = ::unlink(filename.c_str ());
         if (rc != 0) {
-            socket->event_close_failed (endpoint, zmq_errno());
+            socket->event_close_failed (endpoint, endpoint_id, zmq_errno());
             return -1;
         }
     }
 
-    socket->event_closed (endpoint, s);
+    socket->event_closed (endpoint, endpoint_id, s);
     return 0;
 }
 
@@ -92,6 +92,9 @@ namespace zmq
        // String representation of endpoint to bind to
         std::string endpoint;
 
+        //  ID the monitor ring reports the endpoint with.
+        uint32_t endpoint_id;
+
         ipc_listener_t (const ipc_listener_t&);
         const ipc_listener_t &operator = (const ipc_listener_t&);
     };
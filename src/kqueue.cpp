@@ -147,6 +147,12 @@ void zmq::kqueue_t::start ()
     worker.start (worker_routine, this);
 }
 
+int zmq::kqueue_t::set_cpus (const std::vector <int> &cpus_,
+    std::vector <int> &cpus_out_)
+{
+    return worker.set_cpus (cpus_, cpus_out_);
+}
+
 void zmq::kqueue_t::stop ()
 {
     stopping = true;
@@ -167,8 +173,10 @@ void zmq::kqueue_t::loop ()
         //  Wait for events.
         struct kevent ev_buf [max_io_events];
         timespec ts = {timeout / 1000, (timeout % 1000) * 1000000};
+        wait_begin ();
         int n = kevent (kqueue_fd, NULL, 0, &ev_buf [0], max_io_events,
             timeout ? &ts: NULL);
+        wait_end (n);
 #ifdef HAVE_FORK
         if (unlikely(pid != getpid())) {
             //printf("zmq::kqueue_t::loop aborting on forked child %d\n", (int)getpid());
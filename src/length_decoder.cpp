@@ -0,0 +1,74 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "platform.hpp"
+#ifdef ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#endif
+
+#include "length_decoder.hpp"
+#include "likely.hpp"
+#include "wire.hpp"
+#include "err.hpp"
+
+zmq::length_decoder_t::length_decoder_t (size_t bufsize_,
+      size_t prefix_size_, size_t frame_size_, int64_t maxmsgsize_) :
+    frame_decoder_t (bufsize_, maxmsgsize_),
+    prefix_size (prefix_size_),
+    frame_size (frame_size_)
+{
+    zmq_assert (prefix_size == 0 || prefix_size == 2 || prefix_size == 4);
+    zmq_assert (prefix_size != 0 || frame_size != 0);
+}
+
+zmq::length_decoder_t::~length_decoder_t ()
+{
+}
+
+int zmq::length_decoder_t::find_frame (const uint8_t *data_, size_t size_,
+    size_t, size_t &offset_, size_t &frame_size_, size_t &used_,
+    size_t &needed_)
+{
+    if (size_ < prefix_size)
+        return 0;
+
+    size_t msg_size = frame_size;
+    if (prefix_size == 2)
+        msg_size = get_uint16 (data_);
+    else
+    if (prefix_size == 4)
+        msg_size = get_uint32 (data_);
+
+    //  Message size must not exceed the maximum allowed size. Check it
+    //  before the decoder starts buffering the frame.
+    if (maxmsgsize >= 0)
+        if (unlikely (msg_size > static_cast <uint64_t> (maxmsgsize))) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+
+    if (size_ - prefix_size < msg_size) {
+        needed_ = prefix_size + msg_size;
+        return 0;
+    }
+
+    offset_ = prefix_size;
+    frame_size_ = msg_size;
+    used_ = prefix_size + msg_size;
+    return 1;
+}
@@ -0,0 +1,56 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __ZMQ_LENGTH_DECODER_HPP_INCLUDED__
+#define __ZMQ_LENGTH_DECODER_HPP_INCLUDED__
+
+#include "frame_decoder.hpp"
+
+namespace zmq
+{
+    //  Decoder for ZMQ_STREAM sockets speaking a fixed-size or length-prefixed
+    //  application protocol. Each application frame is delivered as a single
+    //  message. The length prefix is in network byte order and is not part of
+    //  the delivered message.
+    class length_decoder_t : public frame_decoder_t
+    {
+    public:
+
+        //  If prefix_size_ is zero, all frames are frame_size_ bytes long.
+        //  Otherwise prefix_size_ must be 2 or 4.
+        length_decoder_t (size_t bufsize_, size_t prefix_size_,
+            size_t frame_size_, int64_t maxmsgsize_);
+        virtual ~length_decoder_t ();
+
+    private:
+
+        //  frame_decoder_t interface.
+        virtual int find_frame (const unsigned char *data_, size_t size_,
+            size_t scanned_, size_t &offset_, size_t &frame_size_,
+            size_t &used_, size_t &needed_);
+
+        const size_t prefix_size;
+        const size_t frame_size;
+
+        length_decoder_t (const length_decoder_t&);
+        void operator = (const length_decoder_t&);
+    };
+
+}
+
+#endif
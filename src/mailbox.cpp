@@ -20,7 +20,8 @@
 #include "mailbox.hpp"
 #include "err.hpp"
 
-zmq::mailbox_t::mailbox_t ()
+zmq::mailbox_t::mailbox_t () :
+    sync ("mailbox_t::sync")
 {
     //  Get the pipe into passive state. That way, if the users starts by
     //  polling on the associated file descriptor it will get woken up when
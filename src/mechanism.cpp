@@ -26,7 +26,11 @@
 #include "wire.hpp"
 
 zmq::mechanism_t::mechanism_t (const options_t &options_) :
-    options (options_)
+    options (options_),
+    peer_batching (false),
+    peer_ping (false),
+    peer_patterns (false),
+    peer_mux (false)
 {
 }
 
@@ -57,6 +61,16 @@ zmq::blob_t zmq::mechanism_t::get_user_id () const
     return user_id;
 }
 
+bool zmq::mechanism_t::batching () const
+{
+    return options.batch_size > 0 && peer_batching;
+}
+
+bool zmq::mechanism_t::pinging () const
+{
+    return options.ping_ivl > 0 && peer_ping;
+}
+
 const char *zmq::mechanism_t::socket_type_string (int socket_type) const
 {
     static const char *names [] = {"PAIR", "PUB", "SUB", "REQ", "REP",
@@ -82,6 +96,20 @@ size_t zmq::mechanism_t::add_property (unsigned char *ptr, const char *name,
     return 1 + name_len + 4 + value_len;
 }
 
+size_t zmq::mechanism_t::add_extension_properties (unsigned char *ptr) const
+{
+    size_t bytes = 0;
+    if (options.batch_size > 0)
+        bytes += add_property (ptr + bytes, "X-Batch", "1", 1);
+    if (options.ping_ivl > 0)
+        bytes += add_property (ptr + bytes, "X-Ping", "1", 1);
+    if (options.tcp_mux)
+        bytes += add_property (ptr + bytes, "X-Mux", "1", 1);
+    if (options.topic_patterns)
+        bytes += add_property (ptr + bytes, "X-Pattern", "1", 1);
+    return bytes;
+}
+
 int zmq::mechanism_t::parse_metadata (const unsigned char *ptr_,
                                       size_t length_)
 {
@@ -113,6 +141,18 @@ int zmq::mechanism_t::parse_metadata (const unsigned char *ptr_,
         if (name == "Identity" && options.recv_identity)
             set_peer_identity (value, value_length);
         else
+        if (name == "X-Batch")
+            peer_batching = true;
+        else
+        if (name == "X-Ping")
+            peer_ping = true;
+        else
+        if (name == "X-Mux")
+            peer_mux = true;
+        else
+        if (name == "X-Pattern")
+            peer_patterns = true;
+        else
         if (name == "Socket-Type") {
             const std::string socket_type ((char *) value, value_length);
             if (!check_socket_type (socket_type)) {
@@ -130,6 +170,18 @@ int zmq::mechanism_t::parse_metadata (const unsigned char *ptr_,
         errno = EPROTO;
         return -1;
     }
+    //  A multiplexed connection carries channel commands the peer would
+    //  not understand, and a multiplexing peer sends them.
+    if (options.tcp_mux != peer_mux) {
+        errno = EPROTO;
+        return -1;
+    }
+    //  A subscription would match other topics on the publisher than the
+    //  subscriber meant it to.
+    if (options.topic_patterns != peer_patterns) {
+        errno = EPROTO;
+        return -1;
+    }
     return 0;
 }
 
@@ -64,6 +64,14 @@ namespace zmq
 
         blob_t get_user_id () const;
 
+        //  True iff both this socket and the peer coalesce small messages
+        //  into batch frames.
+        bool batching () const;
+
+        //  True iff both this socket and the peer measure the round-trip
+        //  time using PINGs.
+        bool pinging () const;
+
     protected:
 
         //  Only used to identify the socket for the Socket-Type
@@ -73,6 +81,12 @@ namespace zmq
         size_t add_property (unsigned char *ptr, const char *name,
             const void *value, size_t value_len) const;
 
+        //  Adds the properties advertising the protocol extensions enabled
+        //  on the socket. Returns the number of bytes added, which is at
+        //  most extension_properties_max.
+        size_t add_extension_properties (unsigned char *ptr) const;
+        enum { extension_properties_max = 64 };
+
         //  Parses a metadata.
         //  Metadata consists of a list of properties consisting of
         //  name and value as size-specified strings.
@@ -97,6 +111,18 @@ namespace zmq
 
         blob_t user_id;
 
+        //  True iff the peer advertised the X-Batch property.
+        bool peer_batching;
+
+        //  True iff the peer advertised the X-Ping property.
+        bool peer_ping;
+
+        //  True iff the peer advertised the X-Pattern property.
+        bool peer_patterns;
+
+        //  True iff the peer advertised the X-Mux property.
+        bool peer_mux;
+
         //  Returns true iff socket associated with the mechanism
         //  is compatible with a given socket type 'type_'.
         bool check_socket_type (const std::string& type_) const;
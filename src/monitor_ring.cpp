@@ -0,0 +1,131 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <new>
+
+#include "monitor_ring.hpp"
+#include "err.hpp"
+
+static uint32_t round_up_pow2 (int value_)
+{
+    uint32_t result = 2;
+    while (result < (uint32_t) value_)
+        result <<= 1;
+    return result;
+}
+
+zmq::monitor_ring_t::monitor_ring_t (int capacity_) :
+    mask (round_up_pow2 (capacity_) - 1),
+    dequeue_pos (0),
+    drops (0),
+    drops_sync ("monitor_ring_t::drops_sync")
+{
+    cells = new (std::nothrow) cell_t [mask + 1];
+    alloc_assert (cells);
+    for (uint32_t i = 0; i <= mask; i++)
+        cells [i].seq.set (i);
+}
+
+zmq::monitor_ring_t::~monitor_ring_t ()
+{
+    delete [] cells;
+}
+
+int zmq::monitor_ring_t::capacity ()
+{
+    return (int) (mask + 1);
+}
+
+zmq::fd_t zmq::monitor_ring_t::get_fd ()
+{
+    return signaler.get_fd ();
+}
+
+bool zmq::monitor_ring_t::push (int event_, int value_,
+    uint32_t endpoint_id_)
+{
+    //  Claim a ticket whose cell has already been consumed.
+    cell_t *cell;
+    uint32_t pos = enqueue_pos.get ();
+    while (true) {
+        cell = &cells [pos & mask];
+        const int32_t diff = (int32_t) (cell->seq.get_acquire () - pos);
+        if (diff == 0) {
+            const uint32_t old = enqueue_pos.cas (pos, pos + 1);
+            if (old == pos)
+                break;
+            pos = old;
+        }
+        else
+        if (diff < 0) {
+            scoped_lock_t lock (drops_sync);
+            drops++;
+            return false;
+        }
+        else
+            pos = enqueue_pos.get ();
+    }
+
+    //  Fill in the record and hand the cell over to the consumer.
+    cell->record.event = (uint32_t) event_;
+    cell->record.value = value_;
+    cell->record.endpoint = endpoint_id_;
+    cell->seq.add (1);
+
+    //  Wake up the consumer unless it was already woken up.
+    if (signalled.cas (0, 1) == 0)
+        signaler.send ();
+    return true;
+}
+
+int zmq::monitor_ring_t::pull (zmq_monitor_record_t *records_, int count_)
+{
+    int nread = 0;
+    while (true) {
+        while (nread < count_) {
+            //  The record must not be read before the sequence number
+            //  telling it's complete.
+            cell_t *cell = &cells [dequeue_pos & mask];
+            if (cell->seq.get_acquire () != dequeue_pos + 1)
+                break;
+            records_ [nread++] = cell->record;
+
+            //  Free the cell for the producer one lap ahead.
+            cell->seq.add (mask);
+            dequeue_pos++;
+        }
+        if (nread > 0)
+            return nread;
+
+        //  The ring looks empty. Consume the pending wake-up, if any, and
+        //  look again: a producer may have filled a cell in the meantime
+        //  without signalling, since the previous signal was still pending.
+        if (signalled.get () == 0 || signaler.wait (0) != 0)
+            return 0;
+        signaler.recv ();
+        signalled.cas (1, 0);
+        if (cells [dequeue_pos & mask].seq.get_acquire () != dequeue_pos + 1)
+            return 0;
+    }
+}
+
+uint64_t zmq::monitor_ring_t::dropped ()
+{
+    scoped_lock_t lock (drops_sync);
+    return drops;
+}
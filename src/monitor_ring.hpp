@@ -0,0 +1,100 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __ZMQ_MONITOR_RING_HPP_INCLUDED__
+#define __ZMQ_MONITOR_RING_HPP_INCLUDED__
+
+#include "../include/zmq.h"
+#include "atomic_counter.hpp"
+#include "signaler.hpp"
+#include "mutex.hpp"
+#include "fd.hpp"
+
+namespace zmq
+{
+
+    //  Bounded ring of socket monitor records. Records are pushed by any
+    //  thread that reports socket events (typically the I/O threads) and
+    //  pulled by the application thread owning the socket. Pushing never
+    //  allocates and takes no lock unless the ring is full, in which case
+    //  the record is dropped and counted. Endpoints are identified by the
+    //  IDs the socket assigned to them when they were bound or connected.
+    //
+    //  The algorithm is Dmitry Vyukov's bounded queue: each cell carries
+    //  a sequence number telling whether it is free for the producer
+    //  holding the matching ticket or ready for the consumer.
+
+    class monitor_ring_t
+    {
+    public:
+
+        //  Capacity is rounded up to the next power of two.
+        monitor_ring_t (int capacity_);
+        ~monitor_ring_t ();
+
+        //  Returns the capacity of the ring.
+        int capacity ();
+
+        //  Returns the file descriptor that becomes readable once there
+        //  are records to pull.
+        fd_t get_fd ();
+
+        //  Appends a record. Returns false if the ring is full.
+        bool push (int event_, int value_, uint32_t endpoint_id_);
+
+        //  Pulls up to count_ records. Returns the number of records read,
+        //  zero if the ring is empty.
+        int pull (zmq_monitor_record_t *records_, int count_);
+
+        //  Number of records dropped because the ring was full.
+        uint64_t dropped ();
+
+    private:
+
+        struct cell_t
+        {
+            atomic_counter_t seq;
+            zmq_monitor_record_t record;
+        };
+
+        cell_t *cells;
+        const uint32_t mask;
+
+        //  Next ticket for producers.
+        atomic_counter_t enqueue_pos;
+
+        //  Next cell to read. Only accessed by the consumer.
+        uint32_t dequeue_pos;
+
+        //  Drop counter. It's 64 bits wide and thus guarded by a mutex,
+        //  which is only taken when the ring is full.
+        uint64_t drops;
+        mutex_t drops_sync;
+
+        //  Signals the consumer. There is at most one signal in flight,
+        //  tracked by the 'signalled' flag.
+        signaler_t signaler;
+        atomic_counter_t signalled;
+
+        monitor_ring_t (const monitor_ring_t&);
+        const monitor_ring_t &operator = (const monitor_ring_t&);
+    };
+
+}
+
+#endif
@@ -26,6 +26,7 @@
 
 #include "stdint.hpp"
 #include "likely.hpp"
+#include "release_queue.hpp"
 #include "err.hpp"
 
 //  Check whether the sizes of public representation of the message (zmq_msg_t)
@@ -130,17 +131,8 @@ int zmq::msg_t::close ()
         //  If the content is not shared, or if it is shared and the reference
         //  count has dropped to zero, deallocate it.
         if (!(u.lmsg.flags & msg_t::shared) ||
-              !u.lmsg.content->refcnt.sub (1)) {
-
-            //  We used "placement new" operator to initialize the reference
-            //  counter so we call the destructor explicitly now.
-            u.lmsg.content->refcnt.~atomic_counter_t ();
-
-            if (u.lmsg.content->ffn)
-                u.lmsg.content->ffn (u.lmsg.content->data,
-                    u.lmsg.content->hint);
-            free (u.lmsg.content);
-        }
+              !u.lmsg.content->refcnt.sub (1))
+            free_content (u.lmsg.content);
     }
 
     //  Make the message invalid.
@@ -272,6 +264,11 @@ bool zmq::msg_t::is_credential () const
     return (u.base.flags & credential) == credential;
 }
 
+bool zmq::msg_t::is_ring () const
+{
+    return (u.base.flags & ring) == ring;
+}
+
 bool zmq::msg_t::is_delimiter () const
 {
     return u.base.type == type_delimiter;
@@ -323,17 +320,79 @@ bool zmq::msg_t::rm_refs (int refs_)
 
     //  The only message type that needs special care are long messages.
     if (!u.lmsg.content->refcnt.sub (refs_)) {
-        //  We used "placement new" operator to initialize the reference
-        //  counter so we call the destructor explicitly now.
-        u.lmsg.content->refcnt.~atomic_counter_t ();
-
-        if (u.lmsg.content->ffn)
-            u.lmsg.content->ffn (u.lmsg.content->data, u.lmsg.content->hint);
-        free (u.lmsg.content);
-
+        free_content (u.lmsg.content);
         return false;
     }
 
     return true;
 }
 
+//  Deallocation deferred to a release queue. The node is allocated when
+//  the message is bound to the queue and takes the place of the message's
+//  own deallocation function, which it calls once drained.
+struct deferred_release_t
+{
+    //  Must be the first member, see release_deferred.
+    zmq::release_queue_t::item_t item;
+    zmq::release_queue_t *queue;
+
+    void *data;
+    msg_free_fn *ffn;
+    void *hint;
+};
+
+static void release_deferred (zmq::release_queue_t::item_t *item_)
+{
+    deferred_release_t *node = (deferred_release_t*) item_;
+    zmq::release_queue_t *queue = node->queue;
+
+    node->ffn (node->data, node->hint);
+    free (node);
+    queue->rm_ref ();
+}
+
+static void free_deferred (void *data_, void *hint_)
+{
+    deferred_release_t *node = (deferred_release_t*) hint_;
+    node->data = data_;
+    if (!node->queue->push (&node->item))
+        release_deferred (&node->item);
+}
+
+void zmq::msg_t::set_release_queue (release_queue_t *queue_)
+{
+    if (u.base.type != type_lmsg || !u.lmsg.content->ffn ||
+          u.lmsg.content->ffn == free_deferred)
+        return;
+
+    //  Copies of a shared message may be closed by other threads, which
+    //  would then race with the content being modified here. If this is
+    //  the only reference left, the other threads are done with it.
+    if ((u.lmsg.flags & msg_t::shared) &&
+          u.lmsg.content->refcnt.get_acquire () != 1)
+        return;
+
+    //  If the node can't be allocated, the release is just not deferred.
+    deferred_release_t *node =
+        (deferred_release_t*) malloc (sizeof (deferred_release_t));
+    if (unlikely (!node))
+        return;
+    queue_->add_ref ();
+    node->item.release = release_deferred;
+    node->queue = queue_;
+    node->ffn = u.lmsg.content->ffn;
+    node->hint = u.lmsg.content->hint;
+    u.lmsg.content->ffn = free_deferred;
+    u.lmsg.content->hint = node;
+}
+
+void zmq::msg_t::free_content (content_t *content_)
+{
+    //  We used "placement new" operator to initialize the reference
+    //  counter so we call the destructor explicitly now.
+    content_->refcnt.~atomic_counter_t ();
+
+    if (content_->ffn)
+        content_->ffn (content_->data, content_->hint);
+    free (content_);
+}
@@ -37,6 +37,8 @@ extern "C"
 namespace zmq
 {
 
+    class release_queue_t;
+
     //  Note that this structure needs to be explicitly constructed
     //  (init functions) and destructed (close function).
 
@@ -49,6 +51,8 @@ namespace zmq
         {
             more = 1,           //  Followed by more parts
             command = 2,        //  Command frame (see ZMTP spec)
+            batch = 4,          //  Frame holding coalesced small messages
+            ring = 16,          //  Hands a broadcast ring over to a pipe
             credential = 32,
             identity = 64,
             shared = 128
@@ -72,6 +76,7 @@ namespace zmq
         void set_fd (int64_t fd_);
         bool is_identity () const;
         bool is_credential () const;
+        bool is_ring () const;
         bool is_delimiter () const;
         bool is_vsm ();
         bool is_cmsg ();
@@ -84,6 +89,13 @@ namespace zmq
         //  references drops to 0, the message is closed and false is returned.
         bool rm_refs (int refs_);
 
+        //  Defers the deallocation function of a zero-copy message to the
+        //  owner of the queue, which runs it when draining the queue. The
+        //  call has no effect if the message is already bound to a queue,
+        //  or if its content is shared with copies, which may be closed by
+        //  other threads meanwhile.
+        void set_release_queue (release_queue_t *queue_);
+
     private:
 
         //  Size in bytes of the largest message that is still copied around
@@ -106,6 +118,9 @@ namespace zmq
             zmq::atomic_counter_t refcnt;
         };
 
+        //  Deallocates the content once there are no references left.
+        static void free_content (content_t *content_);
+
         //  Different message types.
         enum type_t
         {
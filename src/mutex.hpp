@@ -22,8 +22,30 @@
 
 #include "platform.hpp"
 #include "err.hpp"
+#include "mutex_stats.hpp"
 
 //  Mutex class encapsulates OS mutex in a platform-independent way.
+//
+//  Mutexes can be given the name of their site, e.g. the member they
+//  implement. When built with ZMQ_MUTEX_STATS, acquisitions, contentions
+//  and time spent waiting are accounted per site. A failed try_lock counts
+//  as a contention without wait. Unnamed mutexes are not accounted.
+
+#ifdef ZMQ_MUTEX_STATS
+#define ZMQ_MUTEX_SITE_INIT(name_) \
+    site (name_ ? mutex_site_t::find (name_) : NULL)
+#define ZMQ_MUTEX_LOCK(try_lock_, lock_) \
+    if (site) { \
+        if (!(try_lock_)) { \
+            const uint64_t start = mutex_site_t::now (); \
+            lock_; \
+            site->contended (mutex_site_t::now () - start); \
+        } \
+        site->acquired (); \
+    } \
+    else \
+        lock_;
+#endif
 
 #ifdef ZMQ_HAVE_WINDOWS
 
@@ -35,8 +57,12 @@ namespace zmq
     class mutex_t
     {
     public:
-        inline mutex_t ()
+        inline mutex_t (const char *name_ = NULL)
+#ifdef ZMQ_MUTEX_STATS
+            : ZMQ_MUTEX_SITE_INIT (name_)
+#endif
         {
+            (void) name_;
             InitializeCriticalSection (&cs);
         }
 
@@ -47,12 +73,26 @@ namespace zmq
 
         inline void lock ()
         {
+#ifdef ZMQ_MUTEX_STATS
+            ZMQ_MUTEX_LOCK (TryEnterCriticalSection (&cs),
+                EnterCriticalSection (&cs))
+#else
             EnterCriticalSection (&cs);
+#endif
         }
 
         inline bool try_lock ()
         {
-            return (TryEnterCriticalSection (&cs)) ? true : false;
+            const bool locked = TryEnterCriticalSection (&cs) ? true : false;
+#ifdef ZMQ_MUTEX_STATS
+            if (site) {
+                if (locked)
+                    site->acquired ();
+                else
+                    site->contended (0);
+            }
+#endif
+            return locked;
         }
 
         inline void unlock ()
@@ -64,6 +104,10 @@ namespace zmq
 
         CRITICAL_SECTION cs;
 
+#ifdef ZMQ_MUTEX_STATS
+        mutex_site_t *site;
+#endif
+
         //  Disable copy construction and assignment.
         mutex_t (const mutex_t&);
         void operator = (const mutex_t&);
@@ -81,8 +125,12 @@ namespace zmq
     class mutex_t
     {
     public:
-        inline mutex_t ()
+        inline mutex_t (const char *name_ = NULL)
+#ifdef ZMQ_MUTEX_STATS
+            : ZMQ_MUTEX_SITE_INIT (name_)
+#endif
         {
+            (void) name_;
             int rc = pthread_mutex_init (&mutex, NULL);
             posix_assert (rc);
         }
@@ -95,17 +143,32 @@ namespace zmq
 
         inline void lock ()
         {
-            int rc = pthread_mutex_lock (&mutex);
+            int rc;
+#ifdef ZMQ_MUTEX_STATS
+            ZMQ_MUTEX_LOCK ((rc = pthread_mutex_trylock (&mutex)) != EBUSY,
+                rc = pthread_mutex_lock (&mutex))
+#else
+            rc = pthread_mutex_lock (&mutex);
+#endif
             posix_assert (rc);
         }
 
         inline bool try_lock ()
         {
             int rc = pthread_mutex_trylock (&mutex);
-            if (rc == EBUSY)
+            if (rc == EBUSY) {
+#ifdef ZMQ_MUTEX_STATS
+                if (site)
+                    site->contended (0);
+#endif
                 return false;
+            }
 
             posix_assert (rc);
+#ifdef ZMQ_MUTEX_STATS
+            if (site)
+                site->acquired ();
+#endif
             return true;
         }
 
@@ -119,6 +182,10 @@ namespace zmq
 
         pthread_mutex_t mutex;
 
+#ifdef ZMQ_MUTEX_STATS
+        mutex_site_t *site;
+#endif
+
         // Disable copy construction and assignment.
         mutex_t (const mutex_t&);
         const mutex_t &operator = (const mutex_t&);
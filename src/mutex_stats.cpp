@@ -0,0 +1,113 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "platform.hpp"
+
+#ifdef ZMQ_MUTEX_STATS
+
+#include <new>
+#include <string.h>
+
+#include "mutex_stats.hpp"
+#include "clock.hpp"
+#include "err.hpp"
+
+//  List of all sites. Sites are only ever pushed to the front, so the list
+//  can be walked without locking. A plain pointer rather than atomic_ptr_t,
+//  so that it is valid before any static constructor runs.
+static zmq::mutex_site_t *sites = NULL;
+
+//  Compare-and-swap of the list head. Also used with NULL arguments to
+//  read the head with a memory barrier.
+static zmq::mutex_site_t *cas_sites (zmq::mutex_site_t *cmp_,
+    zmq::mutex_site_t *val_)
+{
+#if defined ZMQ_HAVE_WINDOWS
+    return (zmq::mutex_site_t *) InterlockedCompareExchangePointer (
+        (volatile PVOID *) &sites, val_, cmp_);
+#else
+    return __sync_val_compare_and_swap (&sites, cmp_, val_);
+#endif
+}
+
+static zmq::mutex_site_t *find_site (zmq::mutex_site_t *head_,
+    const char *name_)
+{
+    for (zmq::mutex_site_t *site = head_; site; site = site->next)
+        if (strcmp (site->name, name_) == 0)
+            return site;
+    return NULL;
+}
+
+zmq::mutex_site_t *zmq::mutex_site_t::find (const char *name_)
+{
+    mutex_site_t *site = NULL;
+    mutex_site_t *head = cas_sites (NULL, NULL);
+    while (true) {
+        mutex_site_t *found = find_site (head, name_);
+        if (found) {
+            delete site;
+            return found;
+        }
+        if (!site) {
+            site = new (std::nothrow) mutex_site_t;
+            alloc_assert (site);
+            site->name = name_;
+            site->acquisitions = 0;
+            site->contentions = 0;
+            site->wait_ticks = 0;
+        }
+        site->next = head;
+
+        //  If another site was pushed in the meantime, it may be the one
+        //  we are looking for.
+        mutex_site_t *old = cas_sites (head, site);
+        if (old == head)
+            return site;
+        head = old;
+    }
+}
+
+int zmq::mutex_site_t::get_stats (zmq_mutex_stats_t *stats_, int count_)
+{
+    uint64_t ticks_per_us = clock_t::rdtsc_per_us ();
+    if (!ticks_per_us)
+        ticks_per_us = 1;
+
+    int n = 0;
+    for (mutex_site_t *site = cas_sites (NULL, NULL); site; site = site->next) {
+        if (n < count_) {
+            stats_ [n].name = site->name;
+            stats_ [n].acquisitions = site->acquisitions;
+            stats_ [n].contentions = site->contentions;
+            stats_ [n].wait_ns = site->wait_ticks * 1000 / ticks_per_us;
+        }
+        n++;
+    }
+    return n;
+}
+
+uint64_t zmq::mutex_site_t::now ()
+{
+    const uint64_t tsc = clock_t::rdtsc ();
+    return tsc ? tsc : clock_t::now_us ();
+}
+
+#endif
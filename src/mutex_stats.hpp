@@ -0,0 +1,91 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_MUTEX_STATS_HPP_INCLUDED__
+#define __ZMQ_MUTEX_STATS_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#ifdef ZMQ_MUTEX_STATS
+
+#include "../include/zmq.h"
+#include "stdint.hpp"
+
+#ifdef ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#endif
+
+namespace zmq
+{
+
+    //  Lock statistics shared by all the mutexes of a site, i.e. all the
+    //  mutexes constructed with the same name. Sites are never deallocated
+    //  so that the statistics outlive the mutexes.
+
+    struct mutex_site_t
+    {
+        //  Returns the site with the given name, creating it if needed.
+        static mutex_site_t *find (const char *name_);
+
+        //  Copies the statistics of up to count_ sites into stats_ and
+        //  returns the total number of sites.
+        static int get_stats (zmq_mutex_stats_t *stats_, int count_);
+
+        //  Timestamp used to measure the waits.
+        static uint64_t now ();
+
+        inline void acquired ()
+        {
+            add (&acquisitions, 1);
+        }
+
+        inline void contended (uint64_t wait_)
+        {
+            add (&contentions, 1);
+            if (wait_)
+                add (&wait_ticks, wait_);
+        }
+
+        const char *name;
+        volatile uint64_t acquisitions;
+        volatile uint64_t contentions;
+        volatile uint64_t wait_ticks;
+        mutex_site_t *next;
+
+    private:
+
+        static inline void add (volatile uint64_t *counter_, uint64_t value_)
+        {
+#if defined ZMQ_HAVE_WINDOWS
+            InterlockedExchangeAdd64 ((volatile LONGLONG *) counter_,
+                (LONGLONG) value_);
+#elif defined __GNUC__
+            __sync_fetch_and_add (counter_, value_);
+#else
+#error "mutex statistics require GCC-compatible atomics or Windows"
+#endif
+        }
+    };
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,579 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <new>
+#include <string.h>
+
+#include "mux.hpp"
+#include "mux_channel.hpp"
+#include "io_thread.hpp"
+#include "address.hpp"
+#include "tcp_address.hpp"
+#include "options.hpp"
+#include "config.hpp"
+#include "likely.hpp"
+#include "wire.hpp"
+#include "err.hpp"
+
+//  Appends a length-prefixed field to the key of a connection.
+static void append_field (std::string &key_, const void *data_, size_t size_)
+{
+    unsigned char size [4];
+    zmq::put_uint32 (size, (uint32_t) size_);
+    key_.append ((const char *) size, sizeof size);
+    key_.append ((const char *) data_, size_);
+}
+
+//  Connections are only shared by sessions that would have negotiated
+//  them the same way. The CURVE secret key is left out; the public key
+//  stands for the key pair.
+static std::string connection_key (const zmq::options_t &options_,
+    const zmq::address_t *addr_)
+{
+    const int fields [] = {options_.type, options_.mechanism,
+        options_.as_server, options_.curve_aesgcm};
+
+    std::string key;
+    append_field (key, addr_->address.data (), addr_->address.size ());
+    append_field (key, fields, sizeof fields);
+    append_field (key, options_.zap_domain.data (),
+        options_.zap_domain.size ());
+    if (options_.mechanism == ZMQ_PLAIN) {
+        append_field (key, options_.plain_username.data (),
+            options_.plain_username.size ());
+        append_field (key, options_.plain_password.data (),
+            options_.plain_password.size ());
+    }
+    if (options_.mechanism == ZMQ_CURVE) {
+        append_field (key, options_.curve_public_key,
+            sizeof options_.curve_public_key);
+        append_field (key, options_.curve_server_key,
+            sizeof options_.curve_server_key);
+    }
+    return key;
+}
+
+//  Number of messages a channel lets the peer send ahead.
+static uint32_t channel_window (const zmq::options_t &options_)
+{
+    return options_.rcvhwm > 0 ?
+        (uint32_t) options_.rcvhwm : (uint32_t) zmq::mux_default_window;
+}
+
+zmq::mux_channel_t *zmq::mux_t::open_channel (io_thread_t *io_thread_,
+    session_base_t *session_, const options_t &options_,
+    const address_t *addr_)
+{
+    const std::string key = connection_key (options_, addr_);
+    mux_t *mux = io_thread_->find_mux (key);
+
+    if (!mux) {
+        //  The connection outlives the session that opened it, so it
+        //  needs an address of its own.
+        address_t *addr = new (std::nothrow) address_t (addr_->protocol,
+            addr_->address);
+        alloc_assert (addr);
+        addr->resolved.tcp_addr = new (std::nothrow) tcp_address_t (
+            *addr_->resolved.tcp_addr);
+        alloc_assert (addr->resolved.tcp_addr);
+        for (std::vector <tcp_address_t*>::size_type i = 0;
+              i != addr_->tcp_addrs.size (); i++) {
+            tcp_address_t *tcp_addr = new (std::nothrow) tcp_address_t (
+                *addr_->tcp_addrs [i]);
+            alloc_assert (tcp_addr);
+            addr->tcp_addrs.push_back (tcp_addr);
+        }
+
+        mux = new (std::nothrow) mux_t (io_thread_, true, NULL, options_,
+            addr);
+        alloc_assert (mux);
+        mux->key = key;
+        io_thread_->register_mux (key, mux);
+        mux->send_plug (mux);
+    }
+
+    mux_channel_t *channel = new (std::nothrow) mux_channel_t (mux,
+        session_, ++mux->last_id, channel_window (options_),
+        blob_t (options_.identity, options_.identity_size));
+    alloc_assert (channel);
+    mux->channels.insert (
+        channels_t::value_type (channel->get_id (), channel));
+    return channel;
+}
+
+zmq::mux_t::mux_t (io_thread_t *io_thread_, bool active_,
+      socket_base_t *socket_, const options_t &options_,
+      const address_t *addr_) :
+    session_base_t (io_thread_, active_, socket_, options_, addr_),
+    client (active_),
+    last_id (0),
+    current (0),
+    sending (NULL),
+    out_id (0),
+    has_out_id (false),
+    has_next_msg (false),
+    in_channel (NULL),
+    has_peer_identity (false),
+    kick_pending (false),
+    pushing (false),
+    closing (false)
+{
+    int rc = next_msg.init ();
+    errno_assert (rc == 0);
+}
+
+zmq::mux_t::~mux_t ()
+{
+    zmq_assert (channels.empty ());
+
+    while (!commands.empty ()) {
+        int rc = commands.front ().close ();
+        errno_assert (rc == 0);
+        commands.pop_front ();
+    }
+    int rc = next_msg.close ();
+    errno_assert (rc == 0);
+
+    if (client)
+        io_thread->mux_terminated (this);
+}
+
+bool zmq::mux_t::is_mux () const
+{
+    return true;
+}
+
+void zmq::mux_t::plugged (mux_channel_t *channel_)
+{
+    zmq_assert (channel_->is_plugged ());
+
+    if (client) {
+        //  Tell the peer about the channel. If the connection isn't up
+        //  yet, the command waits for it.
+        const blob_t &identity = channel_->get_identity ();
+        queue_command ("OPEN", channel_->get_id (), identity.data (),
+            identity.size ());
+        channel_->set_open (true);
+        if (options.recv_identity && has_peer_identity)
+            channel_->push_property (peer_identity, msg_t::identity);
+    }
+    else {
+        if (options.recv_identity)
+            channel_->push_property (channel_->get_identity (),
+                msg_t::identity);
+        if (!credential.empty ())
+            channel_->push_property (credential, msg_t::credential);
+    }
+    channel_->flush ();
+
+    //  Let the peer send as much as the socket can take.
+    grant_credit (channel_, channel_->get_window ());
+    activate (channel_);
+}
+
+void zmq::mux_t::detach (mux_channel_t *channel_)
+{
+    forget (channel_);
+    if (channel_->is_open ()) {
+        queue_command ("CLOSE", channel_->get_id (), NULL, 0);
+        kick ();
+    }
+
+    if (client && channels.empty ())
+        close ();
+}
+
+void zmq::mux_t::activate (mux_channel_t *channel_)
+{
+    if (channel_->is_ready () || !channel_->is_plugged () ||
+          !channel_->has_credit ())
+        return;
+
+    ready.push_back (channel_);
+    channel_->set_ready (true);
+    kick ();
+}
+
+void zmq::mux_t::grant_credit (mux_channel_t *channel_, uint32_t credit_)
+{
+    unsigned char credit [4];
+    put_uint32 (credit, credit_);
+    queue_command ("CREDIT", channel_->get_id (), credit, sizeof credit);
+    channel_->add_receive_credit (credit_);
+    kick ();
+}
+
+int zmq::mux_t::pull_msg (msg_t *msg_)
+{
+    //  The message the CHANNEL command was sent for goes next.
+    if (has_next_msg) {
+        has_next_msg = false;
+        const int rc = msg_->move (next_msg);
+        errno_assert (rc == 0);
+        return 0;
+    }
+
+    //  Parts of a message are not interleaved with anything else.
+    if (sending) {
+        mux_channel_t *channel = sending;
+        if (channel->pull_msg (msg_) == -1)
+            return -1;
+        if (!(msg_->flags () & msg_t::more))
+            sent (channel);
+        return 0;
+    }
+
+    if (!commands.empty ()) {
+        const int rc = msg_->move (commands.front ());
+        errno_assert (rc == 0);
+        commands.pop_front ();
+        return 0;
+    }
+
+    while (!ready.empty ()) {
+        if (current >= ready.size ())
+            current = 0;
+        mux_channel_t *channel = ready [current];
+
+        if (channel->pull_msg (&next_msg) == -1) {
+            //  The channel is activated again once the session has
+            //  messages to send.
+            deactivate (channel);
+            continue;
+        }
+        current++;
+
+        if (next_msg.flags () & msg_t::more)
+            sending = channel;
+        else
+            sent (channel);
+
+        if (has_out_id && out_id == channel->get_id ()) {
+            const int rc = msg_->move (next_msg);
+            errno_assert (rc == 0);
+            return 0;
+        }
+
+        //  Tell the peer which channel the message belongs to.
+        out_id = channel->get_id ();
+        has_out_id = true;
+        has_next_msg = true;
+        make_command (msg_, "CHANNEL", out_id, NULL, 0);
+        return 0;
+    }
+
+    errno = EAGAIN;
+    return -1;
+}
+
+int zmq::mux_t::xpush_msg (msg_t *msg_)
+{
+    if (likely (!(msg_->flags () &
+          (msg_t::command | msg_t::identity | msg_t::credential)))) {
+        pushing = true;
+
+        //  A peer sending more than it was granted credit for loses the
+        //  channel, along with the message.
+        if (in_channel && !(msg_->flags () & msg_t::more) &&
+              !in_channel->use_receive_credit ()) {
+            mux_channel_t *channel = in_channel;
+            detach (channel);
+            channel->error ();
+        }
+
+        if (in_channel)
+            in_channel->push_msg (msg_);
+        else {
+            //  The channel is gone; drop its messages.
+            int rc = msg_->close ();
+            errno_assert (rc == 0);
+            rc = msg_->init ();
+            errno_assert (rc == 0);
+        }
+        return 0;
+    }
+
+    if (msg_->flags () & msg_t::command) {
+        pushing = true;
+        if (process_mux_command (msg_) == -1)
+            return -1;
+    }
+    else {
+        const blob_t data ((const unsigned char *) msg_->data (),
+            msg_->size ());
+        if (msg_->flags () & msg_t::identity) {
+            peer_identity = data;
+            has_peer_identity = true;
+
+            //  On the accepting side the channels are told the identities
+            //  their sockets opened them with instead.
+            for (channels_t::iterator it = channels.begin ();
+                  client && it != channels.end (); ++it)
+                if (it->second->is_plugged ()) {
+                    it->second->push_property (peer_identity,
+                        msg_t::identity);
+                    it->second->flush ();
+                }
+        }
+        else
+            credential = data;
+    }
+
+    int rc = msg_->close ();
+    errno_assert (rc == 0);
+    rc = msg_->init ();
+    errno_assert (rc == 0);
+    return 0;
+}
+
+int zmq::mux_t::process_mux_command (msg_t *msg_)
+{
+    const unsigned char *data = (const unsigned char *) msg_->data ();
+    const size_t size = msg_->size ();
+
+    //  Other commands are of no interest to the multiplexer.
+    if (size < 1 || size < 1 + (size_t) data [0] + 4)
+        return 0;
+    const std::string name ((const char *) data + 1, data [0]);
+    const uint32_t id = get_uint32 (data + 1 + data [0]);
+    const unsigned char *body = data + 1 + data [0] + 4;
+    const size_t body_size = size - (1 + data [0] + 4);
+
+    channels_t::iterator it = channels.find (id);
+    mux_channel_t *channel = it == channels.end () ? NULL : it->second;
+
+    if (name == "CHANNEL") {
+        if (in_channel && in_channel != channel)
+            in_channel->flush ();
+        in_channel = channel;
+    }
+    else
+    if (name == "CREDIT") {
+        if (body_size != 4) {
+            errno = EPROTO;
+            return -1;
+        }
+        if (channel) {
+            if (channel->add_credit (get_uint32 (body)) == -1)
+                return -1;
+            activate (channel);
+        }
+    }
+    else
+    if (name == "OPEN") {
+        if (client || channel || id == 0) {
+            errno = EPROTO;
+            return -1;
+        }
+        const blob_t identity (body, body_size);
+        if (is_terminating ())
+            queue_command ("CLOSE", id, NULL, 0);
+        else
+            accept_channel (id, identity);
+    }
+    else
+    if (name == "CLOSE") {
+        if (channel) {
+            //  The peer has forgotten about the channel already.
+            channel->set_open (false);
+            forget (channel);
+            channel->error ();
+            if (client && channels.empty ())
+                close ();
+        }
+    }
+
+    return 0;
+}
+
+void zmq::mux_t::accept_channel (uint32_t id_, const blob_t &identity_)
+{
+    //  Each channel gets a session of its own, the way each connection
+    //  does when the listener accepts it.
+    session_base_t *session = session_base_t::create (io_thread, false,
+        get_socket (), options, NULL);
+    errno_assert (session);
+
+    mux_channel_t *channel = new (std::nothrow) mux_channel_t (this,
+        session, id_, channel_window (options), identity_);
+    alloc_assert (channel);
+    channels.insert (channels_t::value_type (id_, channel));
+    channel->set_open (true);
+
+    session->inc_seqnum ();
+    launch_child (session);
+    send_attach (session, channel, false);
+}
+
+void zmq::mux_t::queue_command (const char *name_, uint32_t id_,
+    const void *data_, size_t size_)
+{
+    commands.push_back (msg_t ());
+    make_command (&commands.back (), name_, id_, data_, size_);
+}
+
+void zmq::mux_t::make_command (msg_t *msg_, const char *name_, uint32_t id_,
+    const void *data_, size_t size_)
+{
+    const size_t name_size = strlen (name_);
+
+    const int rc = msg_->init_size (1 + name_size + 4 + size_);
+    errno_assert (rc == 0);
+    msg_->set_flags (msg_t::command);
+
+    unsigned char *data = (unsigned char *) msg_->data ();
+    data [0] = (unsigned char) name_size;
+    memcpy (data + 1, name_, name_size);
+    put_uint32 (data + 1 + name_size, id_);
+    if (size_ > 0)
+        memcpy (data + 1 + name_size + 4, data_, size_);
+}
+
+void zmq::mux_t::forget (mux_channel_t *channel_)
+{
+    deactivate (channel_);
+    channels.erase (channel_->get_id ());
+    if (in_channel == channel_)
+        in_channel = NULL;
+
+    //  If the channel goes away in the middle of a message, the rest of
+    //  it is dropped by the peer along with the channel.
+    if (sending == channel_)
+        sending = NULL;
+}
+
+void zmq::mux_t::deactivate (mux_channel_t *channel_)
+{
+    if (!channel_->is_ready ())
+        return;
+
+    ready.erase (channel_);
+    channel_->set_ready (false);
+}
+
+void zmq::mux_t::sent (mux_channel_t *channel_)
+{
+    sending = NULL;
+    channel_->use_credit ();
+    if (!channel_->has_credit ())
+        deactivate (channel_);
+}
+
+void zmq::mux_t::flush ()
+{
+    pushing = false;
+    if (in_channel)
+        in_channel->flush ();
+    if (kick_pending)
+        kick ();
+}
+
+void zmq::mux_t::kick ()
+{
+    //  Output is resumed once the engine is done with the input, so that
+    //  a batch of incoming commands restarts it once.
+    if (pushing) {
+        kick_pending = true;
+        return;
+    }
+    kick_pending = false;
+    if (engine)
+        engine->restart_output ();
+}
+
+void zmq::mux_t::engine_error ()
+{
+    pushing = false;
+    kick_pending = false;
+    session_base_t::engine_error ();
+    drop_channels ();
+}
+
+void zmq::mux_t::drop_channels ()
+{
+    //  Whatever was on its way belongs to the lost connection.
+    while (!commands.empty ()) {
+        int rc = commands.front ().close ();
+        errno_assert (rc == 0);
+        commands.pop_front ();
+    }
+    if (has_next_msg) {
+        int rc = next_msg.close ();
+        errno_assert (rc == 0);
+        rc = next_msg.init ();
+        errno_assert (rc == 0);
+        has_next_msg = false;
+    }
+    sending = NULL;
+    has_out_id = false;
+    in_channel = NULL;
+    has_peer_identity = false;
+    credential.clear ();
+
+    //  The sessions of the channels start over; on the connecting side
+    //  they open channels on the connection being re-established.
+    channels_t dropped;
+    dropped.swap (channels);
+    for (channels_t::iterator it = dropped.begin (); it != dropped.end ();
+          ++it) {
+        deactivate (it->second);
+        it->second->set_open (false);
+        it->second->error ();
+    }
+
+    if (client && channels.empty ())
+        close ();
+}
+
+void zmq::mux_t::close ()
+{
+    if (closing)
+        return;
+    closing = true;
+
+    if (!key.empty ()) {
+        io_thread->unregister_mux (key, this);
+        key.clear ();
+    }
+
+    //  The engine may be on the call stack; go away asynchronously.
+    send_term (this, 0);
+}
+
+void zmq::mux_t::process_attach (i_engine *engine_)
+{
+    zmq_assert (engine_ != NULL);
+    zmq_assert (engine == NULL);
+
+    //  The messages come from the channels, not from a pipe.
+    engine = engine_;
+    engine->plug (io_thread, this);
+}
+
+void zmq::mux_t::process_term (int linger_)
+{
+    //  No more channels may join the connection.
+    if (!key.empty ()) {
+        io_thread->unregister_mux (key, this);
+        key.clear ();
+    }
+
+    session_base_t::process_term (linger_);
+}
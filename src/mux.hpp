@@ -0,0 +1,184 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_MUX_HPP_INCLUDED__
+#define __ZMQ_MUX_HPP_INCLUDED__
+
+#include <deque>
+#include <map>
+#include <string>
+
+#include "session_base.hpp"
+#include "array.hpp"
+#include "blob.hpp"
+#include "msg.hpp"
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    class io_thread_t;
+    class socket_base_t;
+    class mux_channel_t;
+    struct address_t;
+    struct options_t;
+
+    //  Session owning a TCP connection that carries several channels, each
+    //  of them attached to a session of its own. The messages are tagged
+    //  with the channel they belong to and flow-controlled per channel, so
+    //  that a channel whose socket doesn't keep up doesn't hold the others.
+    //
+    //  On the connecting side the connection is shared by the sessions of
+    //  an I/O thread connecting to the same endpoint with the same socket
+    //  type and security options. It doesn't belong to any socket; it's
+    //  owned by the I/O thread and goes away with its last channel or when
+    //  the I/O thread stops. On the accepting side it's launched by
+    //  the listener and launches a session for each channel the peer opens.
+
+    class mux_t : public session_base_t
+    {
+    public:
+
+        //  Creates a channel for the session, sharing the connection to
+        //  the address if there's one already.
+        static mux_channel_t *open_channel (zmq::io_thread_t *io_thread_,
+            zmq::session_base_t *session_, const options_t &options_,
+            const address_t *addr_);
+
+        mux_t (zmq::io_thread_t *io_thread_, bool active_,
+            zmq::socket_base_t *socket_, const options_t &options_,
+            const address_t *addr_);
+        ~mux_t ();
+
+        //  Following functions are the interface exposed towards the
+        //  channels.
+        void plugged (mux_channel_t *channel_);
+        void detach (mux_channel_t *channel_);
+        void activate (mux_channel_t *channel_);
+        void grant_credit (mux_channel_t *channel_, uint32_t credit_);
+
+        //  Overrides of the session_base_t functions.
+        int pull_msg (msg_t *msg_);
+        void flush ();
+        void engine_error ();
+        bool is_mux () const;
+
+        //  Takes the connection out of service once it has no channels, or
+        //  because the I/O thread is stopping.
+        void close ();
+
+    private:
+
+        int xpush_msg (msg_t *msg_);
+
+        //  Handlers for incoming commands.
+        void process_attach (zmq::i_engine *engine_);
+        void process_term (int linger_);
+
+        //  Handles a command of the multiplexing protocol.
+        int process_mux_command (msg_t *msg_);
+
+        //  Launches a session for the channel the peer opened.
+        void accept_channel (uint32_t id_, const blob_t &identity_);
+
+        //  Queues a command for the peer, composed by make_command.
+        void queue_command (const char *name_, uint32_t id_,
+            const void *data_, size_t size_);
+        static void make_command (msg_t *msg_, const char *name_,
+            uint32_t id_, const void *data_, size_t size_);
+
+        //  Removes the channel from all the lists of the multiplexer.
+        void forget (mux_channel_t *channel_);
+
+        //  Takes the channel off the list of channels ready to send.
+        void deactivate (mux_channel_t *channel_);
+
+        //  Called after a complete message of the channel was pulled.
+        void sent (mux_channel_t *channel_);
+
+        //  Drops the channels of a lost connection.
+        void drop_channels ();
+
+        //  Makes the engine come for the queued data.
+        void kick ();
+
+        //  True on the connecting side.
+        const bool client;
+
+        //  Key the connection is registered with in the I/O thread; empty
+        //  on the accepting side and once the connection is closing.
+        std::string key;
+
+        //  All the channels of the connection by their IDs.
+        typedef std::map <uint32_t, mux_channel_t*> channels_t;
+        channels_t channels;
+
+        //  ID of the last channel opened on the connecting side.
+        uint32_t last_id;
+
+        //  Channels with messages to send and credit to send them with,
+        //  served round-robin.
+        typedef array_t <mux_channel_t> ready_t;
+        ready_t ready;
+        ready_t::size_type current;
+
+        //  Commands to send at the next message boundary.
+        std::deque <msg_t> commands;
+
+        //  Channel whose message is being sent; NULL at message
+        //  boundaries.
+        mux_channel_t *sending;
+
+        //  The channel the messages on the wire currently belong to, as
+        //  announced by the last CHANNEL command.
+        uint32_t out_id;
+        bool has_out_id;
+
+        //  Message pulled from a channel that is to follow the CHANNEL
+        //  command being sent.
+        msg_t next_msg;
+        bool has_next_msg;
+
+        //  The channel the incoming messages currently belong to; NULL
+        //  if they are to be dropped.
+        mux_channel_t *in_channel;
+
+        //  Identity and credential the peer presented on the connection.
+        blob_t peer_identity;
+        bool has_peer_identity;
+        blob_t credential;
+
+        //  True if the engine is to be asked to resume output once it's
+        //  done pushing the incoming data.
+        bool kick_pending;
+
+        //  True while the engine is pushing incoming data.
+        bool pushing;
+
+        //  True once the connection was asked to go away.
+        bool closing;
+
+        mux_t (const mux_t&);
+        const mux_t &operator = (const mux_t&);
+    };
+
+}
+
+#endif
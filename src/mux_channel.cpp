@@ -0,0 +1,264 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <string.h>
+
+#include "mux_channel.hpp"
+#include "mux.hpp"
+#include "session_base.hpp"
+#include "err.hpp"
+
+zmq::mux_channel_t::mux_channel_t (mux_t *mux_, session_base_t *session_,
+      uint32_t id_, uint32_t window_, const blob_t &identity_) :
+    mux (mux_),
+    session (session_),
+    plugged (false),
+    id (id_),
+    window (window_),
+    identity (identity_),
+    open (false),
+    ready (false),
+    credit (0),
+    receive_credit (0),
+    delivered_count (0)
+{
+}
+
+zmq::mux_channel_t::~mux_channel_t ()
+{
+    while (!backlog.empty ()) {
+        int rc = backlog.front ().close ();
+        errno_assert (rc == 0);
+        backlog.pop_front ();
+    }
+}
+
+void zmq::mux_channel_t::plug (io_thread_t *, session_base_t *session_)
+{
+    zmq_assert (!plugged);
+    zmq_assert (session_ == session);
+    plugged = true;
+
+    //  The channel was lost before the session got to it.
+    if (!mux) {
+        session->engine_error ();
+        delete this;
+        return;
+    }
+
+    mux->plugged (this);
+    drain ();
+}
+
+void zmq::mux_channel_t::terminate ()
+{
+    if (mux)
+        mux->detach (this);
+    delete this;
+}
+
+void zmq::mux_channel_t::restart_input ()
+{
+    drain ();
+}
+
+void zmq::mux_channel_t::restart_output ()
+{
+    if (mux)
+        mux->activate (this);
+}
+
+void zmq::mux_channel_t::zap_msg_available ()
+{
+}
+
+uint32_t zmq::mux_channel_t::get_id () const
+{
+    return id;
+}
+
+const zmq::blob_t &zmq::mux_channel_t::get_identity () const
+{
+    return identity;
+}
+
+uint32_t zmq::mux_channel_t::get_window () const
+{
+    return window;
+}
+
+bool zmq::mux_channel_t::is_plugged () const
+{
+    return plugged;
+}
+
+bool zmq::mux_channel_t::is_open () const
+{
+    return open;
+}
+
+void zmq::mux_channel_t::set_open (bool open_)
+{
+    open = open_;
+}
+
+bool zmq::mux_channel_t::is_ready () const
+{
+    return ready;
+}
+
+void zmq::mux_channel_t::set_ready (bool ready_)
+{
+    ready = ready_;
+}
+
+bool zmq::mux_channel_t::has_credit () const
+{
+    return credit > 0;
+}
+
+int zmq::mux_channel_t::add_credit (uint32_t credit_)
+{
+    if (credit_ > 0xffffffff - credit) {
+        errno = EPROTO;
+        return -1;
+    }
+    credit += credit_;
+    return 0;
+}
+
+void zmq::mux_channel_t::use_credit ()
+{
+    zmq_assert (credit > 0);
+    credit--;
+}
+
+void zmq::mux_channel_t::add_receive_credit (uint32_t credit_)
+{
+    //  Credit is only granted for messages taken off the backlog, so it
+    //  never exceeds the window.
+    receive_credit += credit_;
+    zmq_assert (receive_credit <= window);
+}
+
+bool zmq::mux_channel_t::use_receive_credit ()
+{
+    if (receive_credit == 0)
+        return false;
+    receive_credit--;
+    return true;
+}
+
+int zmq::mux_channel_t::pull_msg (msg_t *msg_)
+{
+    zmq_assert (plugged);
+    return session->pull_msg (msg_);
+}
+
+void zmq::mux_channel_t::push_msg (msg_t *msg_)
+{
+    //  Rather than stopping the whole connection when the session's pipe
+    //  is full, the message is kept aside. The multiplexer drops the
+    //  channel of a peer that sends more than it has credit for, which
+    //  bounds the backlog.
+    if (plugged && backlog.empty ()) {
+        const bool more = (msg_->flags () & msg_t::more) != 0;
+        if (session->push_msg (msg_) == 0) {
+            if (!more)
+                delivered ();
+            return;
+        }
+    }
+
+    backlog.push_back (msg_t ());
+    int rc = backlog.back ().init ();
+    errno_assert (rc == 0);
+    rc = backlog.back ().move (*msg_);
+    errno_assert (rc == 0);
+}
+
+void zmq::mux_channel_t::push_property (const blob_t &data_,
+    unsigned char flag_)
+{
+    msg_t msg;
+    int rc = msg.init_size (data_.size ());
+    errno_assert (rc == 0);
+    if (data_.size () > 0)
+        memcpy (msg.data (), data_.data (), data_.size ());
+    msg.set_flags (flag_);
+
+    //  Unlike messages, properties take no credit. They are delivered
+    //  before any message is, so there's room for them unless the
+    //  session is shutting down.
+    zmq_assert (plugged);
+    if (session->push_msg (&msg) == -1) {
+        rc = msg.close ();
+        errno_assert (rc == 0);
+    }
+}
+
+void zmq::mux_channel_t::flush ()
+{
+    if (plugged)
+        session->flush ();
+}
+
+void zmq::mux_channel_t::error ()
+{
+    mux = NULL;
+    open = false;
+    ready = false;
+
+    //  Otherwise the session is told when it plugs the channel.
+    if (!plugged)
+        return;
+
+    session->flush ();
+    session->engine_error ();
+    delete this;
+}
+
+void zmq::mux_channel_t::drain ()
+{
+    bool pushed = false;
+    while (!backlog.empty ()) {
+        msg_t &msg = backlog.front ();
+        const bool more = (msg.flags () & msg_t::more) != 0;
+        if (session->push_msg (&msg) == -1)
+            break;
+        backlog.pop_front ();
+        pushed = true;
+        if (!more)
+            delivered ();
+    }
+    if (pushed)
+        session->flush ();
+}
+
+void zmq::mux_channel_t::delivered ()
+{
+    //  Credit is given back in batches of half the window, so that it
+    //  doesn't take a command per message.
+    delivered_count++;
+    if (mux && delivered_count >= (window + 1) / 2) {
+        mux->grant_credit (this, delivered_count);
+        delivered_count = 0;
+    }
+}
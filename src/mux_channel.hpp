@@ -0,0 +1,157 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_MUX_CHANNEL_HPP_INCLUDED__
+#define __ZMQ_MUX_CHANNEL_HPP_INCLUDED__
+
+#include <deque>
+
+#include "i_engine.hpp"
+#include "array.hpp"
+#include "blob.hpp"
+#include "msg.hpp"
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    class io_thread_t;
+    class session_base_t;
+    class mux_t;
+
+    //  Engine attaching a session to a channel of a multiplexed TCP
+    //  connection. It keeps the messages the session's pipe has no room
+    //  for and grants the peer credit as the session takes them.
+
+    class mux_channel_t : public i_engine, public array_item_t <>
+    {
+    public:
+
+        mux_channel_t (zmq::mux_t *mux_, zmq::session_base_t *session_,
+            uint32_t id_, uint32_t window_, const blob_t &identity_);
+        ~mux_channel_t ();
+
+        //  i_engine interface implementation.
+        void plug (zmq::io_thread_t *io_thread_,
+           zmq::session_base_t *session_);
+        void terminate ();
+        void restart_input ();
+        void restart_output ();
+        void zap_msg_available ();
+
+        //  Following functions are the interface exposed towards the
+        //  multiplexer.
+        uint32_t get_id () const;
+        const blob_t &get_identity () const;
+        uint32_t get_window () const;
+        bool is_plugged () const;
+
+        //  True iff the peer knows about the channel, i.e. it has to be
+        //  told when the channel is closed.
+        bool is_open () const;
+        void set_open (bool open_);
+
+        //  True iff the channel is in the multiplexer's list of channels
+        //  with messages to send.
+        bool is_ready () const;
+        void set_ready (bool ready_);
+
+        //  Credit is the number of messages the peer is ready to accept.
+        //  Sending a message uses one credit up. Returns -1 if the credit
+        //  added would overflow.
+        bool has_credit () const;
+        int add_credit (uint32_t credit_);
+        void use_credit ();
+
+        //  Receive credit is the number of messages the peer was granted
+        //  and may still send. Receiving a message uses one credit up;
+        //  returns false if the peer had none left.
+        void add_receive_credit (uint32_t credit_);
+        bool use_receive_credit ();
+
+        //  Fetches a message sent by the session.
+        int pull_msg (msg_t *msg_);
+
+        //  Delivers a message to the session. Never fails; messages are
+        //  queued till the session has room for them.
+        void push_msg (msg_t *msg_);
+
+        //  Delivers identity or credential of the peer to the session.
+        void push_property (const blob_t &data_, unsigned char flag_);
+
+        void flush ();
+
+        //  The channel is lost, either with the connection or because
+        //  the peer closed it. The session is told to start over and the
+        //  channel goes away.
+        void error ();
+
+    private:
+
+        //  Passes the queued messages to the session, as far as its pipe
+        //  has room for them.
+        void drain ();
+
+        //  Called each time the session accepts the last part of a message.
+        void delivered ();
+
+        //  The multiplexer the channel belongs to; NULL once the channel
+        //  was dropped by it.
+        zmq::mux_t *mux;
+
+        //  The session to exchange messages with and whether it has
+        //  already plugged the channel.
+        zmq::session_base_t *session;
+        bool plugged;
+
+        //  Channel ID unique within the connection.
+        const uint32_t id;
+
+        //  Number of messages the peer may send before it's granted more
+        //  credit.
+        const uint32_t window;
+
+        //  Socket identity announced when the channel was opened.
+        const blob_t identity;
+
+        bool open;
+        bool ready;
+
+        //  Number of messages the channel may send.
+        uint32_t credit;
+
+        //  Number of messages the peer may send.
+        uint32_t receive_credit;
+
+        //  Number of messages delivered to the session the peer was not
+        //  yet granted credit for.
+        uint32_t delivered_count;
+
+        //  Messages received while the session's pipe was full.
+        typedef std::deque <msg_t> backlog_t;
+        backlog_t backlog;
+
+        mux_channel_t (const mux_channel_t&);
+        const mux_channel_t &operator = (const mux_channel_t&);
+    };
+
+}
+
+#endif
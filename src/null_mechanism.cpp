@@ -95,6 +95,9 @@ int zmq::null_mechanism_t::next_handshake_command (msg_t *msg_)
             options.identity, options.identity_size);
     }
 
+    //  Add the properties of the protocol extensions in use
+    ptr += add_extension_properties (ptr);
+
     const size_t command_size = ptr - command_buffer;
     const int rc = msg_->init_size (command_size);
     errno_assert (rc == 0);
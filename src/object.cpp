@@ -30,13 +30,15 @@
 
 zmq::object_t::object_t (ctx_t *ctx_, uint32_t tid_) :
     ctx (ctx_),
-    tid (tid_)
+    tid (tid_),
+    recorder (ctx_->get_flight_recorder (tid_))
 {
 }
 
 zmq::object_t::object_t (object_t *parent_) :
     ctx (parent_->ctx),
-    tid (parent_->tid)
+    tid (parent_->tid),
+    recorder (parent_->recorder)
 {
 }
 
@@ -52,6 +54,7 @@ uint32_t zmq::object_t::get_tid ()
 void zmq::object_t::set_tid(uint32_t id)
 {
     tid = id;
+    recorder = ctx->get_flight_recorder (id);
 }
 
 zmq::ctx_t *zmq::object_t::get_ctx ()
@@ -61,6 +64,8 @@ zmq::ctx_t *zmq::object_t::get_ctx ()
 
 void zmq::object_t::process_command (command_t &cmd_)
 {
+    record (flight_recorder_t::command, cmd_.type);
+
     switch (cmd_.type) {
 
     case command_t::activate_read:
@@ -100,7 +105,7 @@ void zmq::object_t::process_command (command_t &cmd_)
         break;
 
     case command_t::pipe_term:
-        process_pipe_term ();
+        process_pipe_term (cmd_.args.pipe_term.drop);
         break;
 
     case command_t::pipe_term_ack:
@@ -142,9 +147,10 @@ int zmq::object_t::register_endpoint (const char *addr_, endpoint_t &endpoint_)
     return ctx->register_endpoint (addr_, endpoint_);
 }
 
-void zmq::object_t::unregister_endpoints (socket_base_t *socket_)
+void zmq::object_t::unregister_endpoint (const std::string &addr_,
+    socket_base_t *socket_)
 {
-    return ctx->unregister_endpoints (socket_);
+    return ctx->unregister_endpoint (addr_, socket_);
 }
 
 zmq::endpoint_t zmq::object_t::find_endpoint (const char *addr_)
@@ -172,6 +178,18 @@ zmq::io_thread_t *zmq::object_t::choose_io_thread (uint64_t affinity_)
     return ctx->choose_io_thread (affinity_);
 }
 
+zmq::io_thread_t *zmq::object_t::choose_io_thread_for_cpu (int cpu_,
+    uint64_t affinity_)
+{
+    return ctx->choose_io_thread_for_cpu (cpu_, affinity_);
+}
+
+zmq::io_thread_t *zmq::object_t::choose_io_thread_for_hash (uint32_t hash_,
+    uint64_t affinity_)
+{
+    return ctx->choose_io_thread_for_hash (hash_, affinity_);
+}
+
 void zmq::object_t::send_stop ()
 {
     //  'stop' command goes always from administrative thread to
@@ -256,11 +274,12 @@ void zmq::object_t::send_hiccup (pipe_t *destination_, void *pipe_)
     send_command (cmd);
 }
 
-void zmq::object_t::send_pipe_term (pipe_t *destination_)
+void zmq::object_t::send_pipe_term (pipe_t *destination_, bool drop_)
 {
     command_t cmd;
     cmd.destination = destination_;
     cmd.type = command_t::pipe_term;
+    cmd.args.pipe_term.drop = drop_;
     send_command (cmd);
 }
 
@@ -372,7 +391,7 @@ void zmq::object_t::process_hiccup (void *)
     zmq_assert (false);
 }
 
-void zmq::object_t::process_pipe_term ()
+void zmq::object_t::process_pipe_term (bool)
 {
     zmq_assert (false);
 }
@@ -20,7 +20,10 @@
 #ifndef __ZMQ_OBJECT_HPP_INCLUDED__
 #define __ZMQ_OBJECT_HPP_INCLUDED__
 
+#include <string>
+
 #include "stdint.hpp"
+#include "flight_recorder.hpp"
 
 namespace zmq
 {
@@ -59,7 +62,8 @@ namespace zmq
         //  Using following function, socket is able to access global
         //  repository of inproc endpoints.
         int register_endpoint (const char *addr_, zmq::endpoint_t &endpoint_);
-        void unregister_endpoints (zmq::socket_base_t *socket_);
+        void unregister_endpoint (const std::string &addr_,
+            zmq::socket_base_t *socket_);
         zmq::endpoint_t find_endpoint (const char *addr_);
         void pend_connection (const char *addr_, pending_connection_t &pending_connection_);
         void connect_pending (const char *addr_, zmq::socket_base_t *bind_socket_);
@@ -69,9 +73,26 @@ namespace zmq
         //  Logs an message.
         void log (const char *format_, ...);
 
+        //  Records an event into the flight recorder of the object's
+        //  thread, if flight recording is enabled.
+        inline void record (flight_recorder_t::event_t event_,
+            uint32_t value_ = 0)
+        {
+            if (recorder)
+                recorder->record (event_, this, value_);
+        }
+
         //  Chooses least loaded I/O thread.
         zmq::io_thread_t *choose_io_thread (uint64_t affinity_);
 
+        //  Chooses the I/O thread associated with the specified CPU core.
+        zmq::io_thread_t *choose_io_thread_for_cpu (int cpu_,
+            uint64_t affinity_);
+
+        //  Chooses the I/O thread the hash value maps to.
+        zmq::io_thread_t *choose_io_thread_for_hash (uint32_t hash_,
+            uint64_t affinity_);
+
         //  Derived object can use these functions to send commands
         //  to other objects.
         void send_stop ();
@@ -85,7 +106,7 @@ namespace zmq
         void send_activate_write (zmq::pipe_t *destination_,
              uint64_t msgs_read_);
         void send_hiccup (zmq::pipe_t *destination_, void *pipe_);
-        void send_pipe_term (zmq::pipe_t *destination_);
+        void send_pipe_term (zmq::pipe_t *destination_, bool drop_ = false);
         void send_pipe_term_ack (zmq::pipe_t *destination_);
         void send_term_req (zmq::own_t *destination_,
             zmq::own_t *object_);
@@ -105,7 +126,7 @@ namespace zmq
         virtual void process_activate_read ();
         virtual void process_activate_write (uint64_t msgs_read_);
         virtual void process_hiccup (void *pipe_);
-        virtual void process_pipe_term ();
+        virtual void process_pipe_term (bool drop_);
         virtual void process_pipe_term_ack ();
         virtual void process_term_req (zmq::own_t *object_);
         virtual void process_term (int linger_);
@@ -126,6 +147,9 @@ namespace zmq
         //  Thread ID of the thread the object belongs to.
         uint32_t tid;
 
+        //  Flight recorder of the object's thread, NULL if disabled.
+        flight_recorder_t *recorder;
+
         void send_command (command_t &cmd_);
 
         object_t (const object_t&);
@@ -21,11 +21,14 @@
 
 #include "options.hpp"
 #include "err.hpp"
+#include "config.hpp"
 #include "../include/zmq_utils.h"
 
 zmq::options_t::options_t () :
     sndhwm (1000),
     rcvhwm (1000),
+    hwm_target_delay (0),
+    hwm_min (100),
     affinity (0),
     identity_size (0),
     rate (100),
@@ -51,8 +54,23 @@ zmq::options_t::options_t () :
     tcp_keepalive_cnt (-1),
     tcp_keepalive_idle (-1),
     tcp_keepalive_intvl (-1),
+    tcp_incoming_cpu (false),
+    tcp_fastopen (false),
+    tcp_connect_stagger (0),
+    stream_framing (ZMQ_FRAMING_RAW),
+    stream_frame_size (0),
+    inbound_poll_rate (zmq::inbound_poll_rate),
+    command_delay (-1),
+    command_adaptive (false),
+    batch_size (0),
+    ping_ivl (0),
+    tcp_mux (false),
+    topic_patterns (false),
+    deferred_release (false),
+    warmup (false),
     mechanism (ZMQ_NULL),
     as_server (0),
+    curve_aesgcm (false),
     socket_id (0),
     conflate (false)
 {
@@ -79,6 +97,20 @@ int zmq::options_t::setsockopt (int option_, const void *optval_,
             }
             break;
 
+        case ZMQ_HWM_TARGET_DELAY:
+            if (is_int && value >= 0) {
+                hwm_target_delay = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_HWM_MIN:
+            if (is_int && value > 0) {
+                hwm_min = value;
+                return 0;
+            }
+            break;
+
         case ZMQ_AFFINITY:
             if (optvallen_ == sizeof (uint64_t)) {
                 affinity = *((uint64_t*) optval_);
@@ -240,6 +272,112 @@ int zmq::options_t::setsockopt (int option_, const void *optval_,
             }
             break;
 
+        case ZMQ_TCP_INCOMING_CPU:
+            if (is_int && (value == 0 || value == 1)) {
+                tcp_incoming_cpu = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_TCP_FASTOPEN:
+            if (is_int && (value == 0 || value == 1)) {
+                tcp_fastopen = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_TCP_CONNECT_STAGGER:
+            if (is_int && value >= 0) {
+                tcp_connect_stagger = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_STREAM_FRAMING:
+            //  The frame size or delimiter the framing needs is checked
+            //  at bind and connect time, see check_stream_framing.
+            if (is_int && value >= ZMQ_FRAMING_RAW
+            &&  value <= ZMQ_FRAMING_DELIMITER) {
+                stream_framing = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_STREAM_FRAME_SIZE:
+            if (is_int && value >= 0) {
+                stream_frame_size = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_STREAM_DELIMITER:
+            if (optvallen_ == 0) {
+                stream_delimiter.clear ();
+                return 0;
+            }
+            if (optvallen_ < 256 && optval_ != NULL) {
+                stream_delimiter.assign ((const char *) optval_, optvallen_);
+                return 0;
+            }
+            break;
+
+        case ZMQ_INBOUND_POLL_RATE:
+            if (is_int && value > 0) {
+                inbound_poll_rate = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_COMMAND_DELAY:
+            if (is_int && value >= -1) {
+                command_delay = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_COMMAND_ADAPTIVE:
+            if (is_int && (value == 0 || value == 1)) {
+                command_adaptive = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_BATCH_SIZE:
+            //  A batch frame has to fit in the encoder's buffer.
+            if (is_int && value >= 0 && value <= (int) out_batch_size) {
+                batch_size = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_PING_IVL:
+            if (is_int && value >= 0) {
+                ping_ivl = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_TCP_MUX:
+            if (is_int && (value == 0 || value == 1)) {
+                tcp_mux = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_DEFERRED_RELEASE:
+            if (is_int && (value == 0 || value == 1)) {
+                deferred_release = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_WARMUP:
+            if (is_int && (value == 0 || value == 1)) {
+                warmup = (value != 0);
+                return 0;
+            }
+            break;
+
         case ZMQ_TCP_ACCEPT_FILTER:
             if (optvallen_ == 0 && optval_ == NULL) {
                 tcp_accept_filters.clear ();
@@ -393,6 +531,13 @@ int zmq::options_t::setsockopt (int option_, const void *optval_,
                 return 0;
             }
             break;
+
+        case ZMQ_CURVE_AESGCM:
+            if (is_int && (value == 0 || value == 1)) {
+                curve_aesgcm = (value != 0);
+                return 0;
+            }
+            break;
 #       endif
 
         case ZMQ_CONFLATE:
@@ -429,6 +574,20 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
             }
             break;
 
+        case ZMQ_HWM_TARGET_DELAY:
+            if (is_int) {
+                *value = hwm_target_delay;
+                return 0;
+            }
+            break;
+
+        case ZMQ_HWM_MIN:
+            if (is_int) {
+                *value = hwm_min;
+                return 0;
+            }
+            break;
+
         case ZMQ_AFFINITY:
             if (*optvallen_ == sizeof (uint64_t)) {
                 *((uint64_t *) optval_) = affinity;
@@ -591,6 +750,106 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
             }
             break;
 
+        case ZMQ_TCP_INCOMING_CPU:
+            if (is_int) {
+                *value = tcp_incoming_cpu;
+                return 0;
+            }
+            break;
+
+        case ZMQ_TCP_FASTOPEN:
+            if (is_int) {
+                *value = tcp_fastopen;
+                return 0;
+            }
+            break;
+
+        case ZMQ_TCP_CONNECT_STAGGER:
+            if (is_int) {
+                *value = tcp_connect_stagger;
+                return 0;
+            }
+            break;
+
+        case ZMQ_STREAM_FRAMING:
+            if (is_int) {
+                *value = stream_framing;
+                return 0;
+            }
+            break;
+
+        case ZMQ_STREAM_FRAME_SIZE:
+            if (is_int) {
+                *value = stream_frame_size;
+                return 0;
+            }
+            break;
+
+        case ZMQ_STREAM_DELIMITER:
+            if (*optvallen_ >= stream_delimiter.size ()) {
+                memcpy (optval_, stream_delimiter.data (),
+                    stream_delimiter.size ());
+                *optvallen_ = stream_delimiter.size ();
+                return 0;
+            }
+            break;
+
+        case ZMQ_INBOUND_POLL_RATE:
+            if (is_int) {
+                *value = inbound_poll_rate;
+                return 0;
+            }
+            break;
+
+        case ZMQ_COMMAND_DELAY:
+            if (is_int) {
+                *value = command_delay;
+                return 0;
+            }
+            break;
+
+        case ZMQ_COMMAND_ADAPTIVE:
+            if (is_int) {
+                *value = command_adaptive;
+                return 0;
+            }
+            break;
+
+        case ZMQ_BATCH_SIZE:
+            if (is_int) {
+                *value = batch_size;
+                return 0;
+            }
+            break;
+
+        case ZMQ_PING_IVL:
+            if (is_int) {
+                *value = ping_ivl;
+                return 0;
+            }
+            break;
+
+        case ZMQ_TCP_MUX:
+            if (is_int) {
+                *value = tcp_mux;
+                return 0;
+            }
+            break;
+
+        case ZMQ_DEFERRED_RELEASE:
+            if (is_int) {
+                *value = deferred_release;
+                return 0;
+            }
+            break;
+
+        case ZMQ_WARMUP:
+            if (is_int) {
+                *value = warmup;
+                return 0;
+            }
+            break;
+
         case ZMQ_MECHANISM:
             if (is_int) {
                 *value = mechanism;
@@ -673,6 +932,13 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
                 return 0;
             }
             break;
+
+        case ZMQ_CURVE_AESGCM:
+            if (is_int) {
+                *value = curve_aesgcm;
+                return 0;
+            }
+            break;
 #       endif
 
         case ZMQ_CONFLATE:
@@ -686,3 +952,13 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
     errno = EINVAL;
     return -1;
 }
+
+int zmq::options_t::check_stream_framing () const
+{
+    if ((stream_framing == ZMQ_FRAMING_FIXED && stream_frame_size == 0)
+    ||  (stream_framing == ZMQ_FRAMING_DELIMITER && stream_delimiter.empty ())) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
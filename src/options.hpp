@@ -47,10 +47,22 @@ namespace zmq
         int setsockopt (int option_, const void *optval_, size_t optvallen_);
         int getsockopt (int option_, void *optval_, size_t *optvallen_);
 
+        //  Checks that the stream framing options are consistent. They are
+        //  checked when endpoints are bound or connected, so that they can
+        //  be set in any order. Returns -1 with errno set to EINVAL if not.
+        int check_stream_framing () const;
+
         //  High-water marks for message pipes.
         int sndhwm;
         int rcvhwm;
 
+        //  If non-zero, high-water marks adapt to the rate at which the peer
+        //  drains the pipe so that messages are queued for at most this many
+        //  milliseconds. The values above act as upper bounds, hwm_min as
+        //  the lower bound.
+        int hwm_target_delay;
+        int hwm_min;
+
         //  I/O thread affinity.
         uint64_t affinity;
 
@@ -121,6 +133,63 @@ namespace zmq
         int tcp_keepalive_idle;
         int tcp_keepalive_intvl;
 
+        //  If true, accepted TCP connections are handed to the I/O thread
+        //  matching the CPU the connection's packets are delivered on.
+        bool tcp_incoming_cpu;
+
+        //  If true, TCP Fast Open is used on both listening and connecting
+        //  sockets, so that the ZMTP greeting is carried in the SYN segment.
+        bool tcp_fastopen;
+
+        //  Delay in milliseconds before connecting to the next address when
+        //  a TCP hostname resolves to several addresses. Zero means only
+        //  the first address is used.
+        int tcp_connect_stagger;
+
+        //  Framing decoder used by ZMQ_STREAM sockets for incoming data,
+        //  along with the frame size for ZMQ_FRAMING_FIXED and the delimiter
+        //  for ZMQ_FRAMING_DELIMITER.
+        int stream_framing;
+        int stream_frame_size;
+        std::string stream_delimiter;
+
+        //  Number of messages received between two checks for commands,
+        //  and minimal delay in microseconds between two checks for commands
+        //  on send (-1 for the built-in delay of max_command_delay CPU
+        //  ticks). If command_adaptive is true, the socket polls more often
+        //  while commands pile up and less often while there are none.
+        int inbound_poll_rate;
+        int command_delay;
+        bool command_adaptive;
+
+        //  Maximal size of a frame small messages are coalesced into, if
+        //  the peer supports it. Zero disables the coalescing.
+        int batch_size;
+
+        //  Interval between the PINGs measuring the round-trip time of
+        //  connections to peers doing the same, in milliseconds. Zero
+        //  disables the measurement.
+        int ping_ivl;
+
+        //  If true, TCP connections to the same endpoint are shared by the
+        //  sockets of the context connecting to it, each socket talking
+        //  over a channel of its own. Both peers have to enable it.
+        bool tcp_mux;
+
+        //  If true, (X)PUB and (X)SUB sockets treat non-empty subscriptions
+        //  as wildcard patterns rather than prefixes. Set by the sockets
+        //  themselves, see ZMQ_TOPIC_PATTERNS. Both peers have to agree.
+        bool topic_patterns;
+
+        //  If true, the deallocation functions of zero-copy messages sent
+        //  are run by the socket's thread rather than by whichever thread
+        //  drops the last reference.
+        bool deferred_release;
+
+        //  If true, pipes and engine buffers of new connections are
+        //  allocated and touched up front rather than on first use.
+        bool warmup;
+
         // TCP accept() filters
         typedef std::vector <tcp_address_mask_t> tcp_accept_filters_t;
         tcp_accept_filters_t tcp_accept_filters;
@@ -156,6 +225,10 @@ namespace zmq
         uint8_t curve_secret_key [CURVE_KEYSIZE];
         uint8_t curve_server_key [CURVE_KEYSIZE];
 
+        //  If true, CURVE protects messages with AES-256-GCM when the
+        //  peer asks for it as well.
+        bool curve_aesgcm;
+
         //  ID of the socket.
         int socket_id;
 
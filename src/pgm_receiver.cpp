@@ -22,6 +22,7 @@
 #if defined ZMQ_HAVE_OPENPGM
 
 #include <new>
+#include <string.h>
 
 #ifdef ZMQ_HAVE_WINDOWS
 #include "windows.hpp"
@@ -31,6 +32,7 @@
 #include "session_base.hpp"
 #include "v1_decoder.hpp"
 #include "stdint.hpp"
+#include "config.hpp"
 #include "wire.hpp"
 #include "err.hpp"
 
@@ -38,6 +40,7 @@ zmq::pgm_receiver_t::pgm_receiver_t (class io_thread_t *parent_,
       const options_t &options_) :
     io_object_t (parent_),
     has_rx_timer (false),
+    last_peer (peers.end ()),
     pgm_socket (true, options_),
     options (options_),
     session (NULL),
@@ -83,6 +86,7 @@ void zmq::pgm_receiver_t::unplug ()
             delete it->second.decoder;
     }
     peers.clear ();
+    last_peer = peers.end ();
     active_tsi = NULL;
 
     if (has_rx_timer) {
@@ -155,8 +159,13 @@ void zmq::pgm_receiver_t::in_event ()
         has_rx_timer = false;
     }
 
-    //  TODO: This loop can effectively block other engines in the same I/O
-    //  thread in the case of high load.
+    //  Number of batches read from the socket and APDUs returned from
+    //  the current batch. Reading stops after pgm_max_rx_batches batches
+    //  so that other engines in the I/O thread get their turn; the socket
+    //  keeps signalling while there is data left.
+    int batches = 0;
+    int apdus = 0;
+
     while (true) {
 
         //  Get new batch of data.
@@ -166,18 +175,27 @@ void zmq::pgm_receiver_t::in_event ()
         inpos = (unsigned char*) tmp;
 
         //  No data to process. This may happen if the packet received is
-        //  neither ODATA nor ODATA.
+        //  neither ODATA nor ODATA, or if the current batch was processed.
         if (received == 0) {
             if (errno == ENOMEM || errno == EBUSY) {
                 const long timeout = pgm_socket.get_rx_timeout ();
                 add_timer (timeout, rx_timer_id);
                 has_rx_timer = true;
             }
+            else if (errno == EAGAIN && apdus > 0 &&
+                  ++batches < pgm_max_rx_batches) {
+                apdus = 0;
+                continue;
+            }
             break;
         }
+        apdus++;
 
         //  Find the peer based on its TSI.
-        peers_t::iterator it = peers.find (*tsi);
+        peers_t::iterator it = last_peer;
+        if (it == peers.end () ||
+              memcmp (&it->first, tsi, sizeof (pgm_tsi_t)) != 0)
+            it = peers.find (*tsi);
 
         //  Data loss. Delete decoder and mark the peer as disjoint.
         if (received == -1) {
@@ -196,6 +214,7 @@ void zmq::pgm_receiver_t::in_event ()
             peer_info_t peer_info = {false, NULL};
             it = peers.insert (peers_t::value_type (*tsi, peer_info)).first;
         }
+        last_peer = it;
 
         insize = static_cast <size_t> (received);
 
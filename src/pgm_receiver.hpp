@@ -108,6 +108,10 @@ namespace zmq
         typedef std::map <pgm_tsi_t, peer_info_t, tsi_comp> peers_t;
         peers_t peers;
 
+        //  The peer the last APDU came from, or peers.end (). APDUs tend
+        //  to arrive in runs from the same peer, which spares the lookup.
+        peers_t::iterator last_peer;
+
         //  PGM socket.
         pgm_socket_t pgm_socket;
 
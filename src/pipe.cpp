@@ -19,9 +19,11 @@
 
 #include <new>
 #include <stddef.h>
+#include <limits.h>
 
 #include "pipe.hpp"
 #include "err.hpp"
+#include "clock.hpp"
 
 #include "ypipe.hpp"
 #include "ypipe_conflate.hpp"
@@ -74,16 +76,30 @@ zmq::pipe_t::pipe_t (object_t *parent_, upipe_t *inpipe_, upipe_t *outpipe_,
     msgs_read (0),
     msgs_written (0),
     peers_msgs_read (0),
+    hwm_delay (0),
+    hwm_min (0),
+    hwm_max (0),
+    drain_start_time (0),
+    drain_start_msgs (0),
     peer (NULL),
     sink (NULL),
     state (active),
     delay (true),
-    conflate (conflate_)
+    dropped (false),
+    conflate (conflate_),
+    inproc (false),
+    ring_peer (NULL),
+    ring_reader (NULL)
 {
+    int rc = ring_handle.init ();
+    errno_assert (rc == 0);
 }
 
 zmq::pipe_t::~pipe_t ()
 {
+    //  Closing the handle detaches the reader from the broadcast ring.
+    int rc = ring_handle.close ();
+    errno_assert (rc == 0);
 }
 
 void zmq::pipe_t::set_peer (pipe_t *peer_)
@@ -110,6 +126,16 @@ zmq::blob_t zmq::pipe_t::get_identity ()
     return identity;
 }
 
+void zmq::pipe_t::set_endpoint (const std::string &endpoint_)
+{
+    endpoint = endpoint_;
+}
+
+const std::string &zmq::pipe_t::get_endpoint () const
+{
+    return endpoint;
+}
+
 zmq::blob_t zmq::pipe_t::get_credential () const
 {
     return credential;
@@ -122,12 +148,24 @@ bool zmq::pipe_t::check_read ()
     if (unlikely (state != active && state != waiting_for_delimiter))
         return false;
 
+    if (ring_reader)
+        return check_ring ();
+
     //  Check if there's an item in the pipe.
     if (!inpipe->check_read ()) {
         in_active = false;
         return false;
     }
 
+    //  If the peer handed over a broadcast ring, read from it.
+    if (unlikely (inpipe->probe (is_ring_handle))) {
+        msg_t msg;
+        bool ok = inpipe->read (&msg);
+        zmq_assert (ok);
+        receive_ring (&msg);
+        return check_ring ();
+    }
+
     //  If the next item in the pipe is message delimiter,
     //  initiate termination process.
     if (inpipe->probe (is_delimiter)) {
@@ -148,12 +186,33 @@ bool zmq::pipe_t::read (msg_t *msg_)
     if (unlikely (state != active && state != waiting_for_delimiter))
         return false;
 
+    if (ring_reader) {
+        if (!check_ring ())
+            return false;
+        bool ok = ring_reader->ring->read (ring_reader, msg_);
+        zmq_assert (ok);
+        if (!(msg_->flags () & msg_t::more))
+            msgs_read++;
+
+        //  Progress is not reported to the writer as the ring has no
+        //  watermarks, except when the writer waits for room in the ring.
+        if (unlikely (ring_reader->ring->writer_waiting ()))
+            send_activate_write (peer, msgs_read);
+        return true;
+    }
+
 read_message:
     if (!inpipe->read (msg_)) {
         in_active = false;
         return false;
     }
 
+    //  If the peer handed over a broadcast ring, read from it.
+    if (unlikely (msg_->is_ring ())) {
+        receive_ring (msg_);
+        return read (msg_);
+    }
+
     //  If this is a credential, save a copy and receive next message.
     if (unlikely (msg_->is_credential ())) {
         const unsigned char *data = static_cast <const unsigned char *> (msg_->data ());
@@ -183,10 +242,13 @@ bool zmq::pipe_t::check_write ()
     if (unlikely (!out_active || state != active))
         return false;
 
-    bool full = hwm > 0 && msgs_written - peers_msgs_read == uint64_t (hwm);
+    //  Adaptive high watermark may drop below the number of messages
+    //  already queued, hence the inequality.
+    bool full = hwm > 0 && msgs_written - peers_msgs_read >= uint64_t (hwm);
 
     if (unlikely (full)) {
         out_active = false;
+        record (flight_recorder_t::hwm_reached, hwm);
         return false;
     }
 
@@ -225,6 +287,10 @@ void zmq::pipe_t::flush ()
     if (state == term_ack_sent)
         return;
 
+    //  Wake up the peer if it's waiting for the broadcast ring.
+    if (ring_peer && ring_peer->ring->wake (ring_peer))
+        send_activate_read (peer);
+
     if (outpipe && !outpipe->flush ())
         send_activate_read (peer);
 }
@@ -233,17 +299,22 @@ void zmq::pipe_t::process_activate_read ()
 {
     if (!in_active && (state == active || state == waiting_for_delimiter)) {
         in_active = true;
+        record (flight_recorder_t::activate_read);
         sink->read_activated (this);
     }
 }
 
 void zmq::pipe_t::process_activate_write (uint64_t msgs_read_)
 {
+    if (hwm_delay > 0)
+        adapt_hwm (msgs_read_);
+
     //  Remember the peers's message sequence number.
     peers_msgs_read = msgs_read_;
 
     if (!out_active && state == active) {
         out_active = true;
+        record (flight_recorder_t::activate_write, (uint32_t) msgs_read_);
         sink->write_activated (this);
     }
 }
@@ -271,15 +342,17 @@ void zmq::pipe_t::process_hiccup (void *pipe_)
         sink->hiccuped (this);
 }
 
-void zmq::pipe_t::process_pipe_term ()
+void zmq::pipe_t::process_pipe_term (bool drop_)
 {
+    dropped = drop_;
+
     //  This is the simple case of peer-induced termination. If there are no
-    //  more pending messages to read, or if the pipe was configured to drop
-    //  pending messages, we can move directly to the term_ack_sent state.
-    //  Otherwise we'll hang up in waiting_for_delimiter state till all
-    //  pending messages are read.
+    //  more pending messages to read, or if the pipe was configured (or the
+    //  peer asked us) to drop pending messages, we can move directly to the
+    //  term_ack_sent state. Otherwise we'll hang up in waiting_for_delimiter
+    //  state till all pending messages are read.
     if (state == active) {
-        if (!delay) {
+        if (!delay || drop_) {
             state = term_ack_sent;
             outpipe = NULL;
             send_pipe_term_ack (peer);
@@ -354,7 +427,12 @@ void zmq::pipe_t::set_nodelay ()
     this->delay = false;
 }
 
-void zmq::pipe_t::terminate (bool delay_)
+bool zmq::pipe_t::is_dropped ()
+{
+    return dropped;
+}
+
+void zmq::pipe_t::terminate (bool delay_, bool drop_)
 {
     //  Overload the value specified at pipe creation.
     delay = delay_;
@@ -373,7 +451,7 @@ void zmq::pipe_t::terminate (bool delay_)
     //  for the ack.
     else
     if (state == active) {
-        send_pipe_term (peer);
+        send_pipe_term (peer, drop_);
         state = term_req_sent1;
     }
 
@@ -396,7 +474,7 @@ void zmq::pipe_t::terminate (bool delay_)
     //  active state.
     else
     if (state == delimiter_received) {
-        send_pipe_term (peer);
+        send_pipe_term (peer, drop_);
         state = term_req_sent1;
     }
 
@@ -426,6 +504,11 @@ bool zmq::pipe_t::is_delimiter (const msg_t &msg_)
     return msg_.is_delimiter ();
 }
 
+bool zmq::pipe_t::is_ring_handle (const msg_t &msg_)
+{
+    return msg_.is_ring ();
+}
+
 int zmq::pipe_t::compute_lwm (int hwm_)
 {
     //  Compute the low water mark. Following point should be taken
@@ -498,3 +581,154 @@ void zmq::pipe_t::set_hwms (int inhwm_, int outhwm_)
     lwm = compute_lwm (inhwm_);
     hwm = outhwm_;
 }
+
+void zmq::pipe_t::set_hwm_target (int delay_, int min_)
+{
+    zmq_assert (delay_ > 0 && min_ > 0);
+
+    //  Conflating pipes have no watermarks to adapt.
+    if (conflate)
+        return;
+
+    hwm_delay = delay_;
+    hwm_max = hwm;
+    hwm_min = hwm_max > 0 && min_ > hwm_max ? hwm_max : min_;
+
+    //  Start low and let the measured drain rate raise the watermark.
+    hwm = hwm_min;
+    drain_start_time = 0;
+
+    //  The peer reports its progress each time it reads lwm messages. For
+    //  the writer to be woken up whatever the current watermark, the peer's
+    //  low watermark has to be derived from the lowest one possible.
+    zmq_assert (peer);
+    peer->lwm = compute_lwm (hwm_min);
+}
+
+void zmq::pipe_t::warmup ()
+{
+    //  With adaptive watermarks, the queue may grow up to the upper bound.
+    const int limit = hwm_max > 0 ? hwm_max : hwm;
+
+    //  Unbounded pipes have no natural size to reserve.
+    if (limit > 0 && outpipe)
+        outpipe->reserve (limit);
+}
+
+void zmq::pipe_t::adapt_hwm (uint64_t msgs_read_)
+{
+    const uint64_t now = clock_t::now_us ();
+
+    //  If the peer has read everything written so far, it may go idle
+    //  waiting for us. Time spent idle says nothing about the rate it
+    //  is able to drain the pipe at, so drop the current measurement.
+    if (msgs_read_ == msgs_written) {
+        drain_start_time = 0;
+        return;
+    }
+
+    //  Start a new measurement.
+    if (drain_start_time == 0) {
+        drain_start_time = now;
+        drain_start_msgs = msgs_read_;
+        return;
+    }
+
+    //  Measure over a period long enough to even out scheduling noise.
+    if (now - drain_start_time < hwm_sample_interval)
+        return;
+
+    //  Number of messages the peer is able to read within the target delay.
+    //  Smooth it with the current watermark and keep it within the bounds.
+    uint64_t target = (msgs_read_ - drain_start_msgs) * hwm_delay * 1000 /
+        (now - drain_start_time);
+    target = (target + hwm) / 2;
+    if (target < uint64_t (hwm_min))
+        target = hwm_min;
+    if (hwm_max > 0 && target > uint64_t (hwm_max))
+        target = hwm_max;
+    if (target > uint64_t (INT_MAX))
+        target = INT_MAX;
+    hwm = (int) target;
+
+    drain_start_time = now;
+    drain_start_msgs = msgs_read_;
+}
+
+void zmq::pipe_t::set_inproc ()
+{
+    inproc = true;
+}
+
+bool zmq::pipe_t::is_inproc ()
+{
+    return inproc;
+}
+
+bool zmq::pipe_t::attach_ring (broadcast_ring_t *ring_)
+{
+    zmq_assert (!ring_peer && outpipe);
+
+    //  The peer of a conflating pipe reads the latest message only.
+    if (conflate)
+        return false;
+
+    ring_peer = ring_->attach ();
+
+    //  The handle holds the reader's references until it's closed, be it
+    //  by the peer or, if the peer never reads it, along with the pipe.
+    msg_t handle;
+    int rc = handle.init_data (ring_peer, sizeof (*ring_peer),
+        &broadcast_ring_t::reader_closed, ring_);
+    errno_assert (rc == 0);
+    handle.set_flags (msg_t::ring);
+    outpipe->write (handle, false);
+    flush ();
+    return true;
+}
+
+void zmq::pipe_t::detach_ring ()
+{
+    zmq_assert (ring_peer);
+    ring_peer->ring->detach (ring_peer);
+    ring_peer = NULL;
+}
+
+bool zmq::pipe_t::is_broadcast ()
+{
+    return ring_peer != NULL || ring_reader != NULL;
+}
+
+void zmq::pipe_t::receive_ring (msg_t *handle_)
+{
+    zmq_assert (!ring_reader);
+    int rc = ring_handle.move (*handle_);
+    errno_assert (rc == 0);
+    ring_reader = (broadcast_ring_t::reader_t*) ring_handle.data ();
+}
+
+bool zmq::pipe_t::check_ring ()
+{
+    broadcast_ring_t *ring = ring_reader->ring;
+    while (!ring->check_read (ring_reader)) {
+
+        //  Only the delimiter may follow the handle in the pipe. Messages
+        //  published before it was written may have arrived in the ring
+        //  meanwhile, so check the ring once again before terminating.
+        if (inpipe->check_read ()) {
+            if (ring->check_read (ring_reader))
+                return true;
+            msg_t msg;
+            bool ok = inpipe->read (&msg);
+            zmq_assert (ok && msg.is_delimiter ());
+            process_delimiter ();
+            return false;
+        }
+
+        if (ring->sleep (ring_reader)) {
+            in_active = false;
+            return false;
+        }
+    }
+    return true;
+}
@@ -20,6 +20,8 @@
 #ifndef __ZMQ_PIPE_HPP_INCLUDED__
 #define __ZMQ_PIPE_HPP_INCLUDED__
 
+#include <string>
+
 #include "msg.hpp"
 #include "ypipe_base.hpp"
 #include "config.hpp"
@@ -27,6 +29,7 @@
 #include "stdint.hpp"
 #include "array.hpp"
 #include "blob.hpp"
+#include "broadcast_ring.hpp"
 
 namespace zmq
 {
@@ -80,6 +83,11 @@ namespace zmq
 
         blob_t get_credential () const;
 
+        //  Address of the endpoint the pipe was created for, if any. Lets
+        //  the owner of the pipe find it by the endpoint.
+        void set_endpoint (const std::string &endpoint_);
+        const std::string &get_endpoint () const;
+
         //  Returns true if there is at least one message to read in the pipe.
         bool check_read ();
 
@@ -111,12 +119,46 @@ namespace zmq
         //  Ask pipe to terminate. The termination will happen asynchronously
         //  and user will be notified about actual deallocation by 'terminated'
         //  event. If delay is true, the pending messages will be processed
-        //  before actual shutdown.
-        void terminate (bool delay_);
+        //  before actual shutdown. If drop is true, the peer is asked to
+        //  terminate immediately, discarding the messages it has not read.
+        void terminate (bool delay_, bool drop_ = false);
+
+        //  Returns true if the peer has terminated the pipe with the drop
+        //  flag set, i.e. the unread messages were discarded.
+        bool is_dropped ();
 
         // set the high water marks.
         void set_hwms (int inhwm_, int outhwm_);
 
+        //  Makes the outbound high watermark follow the rate at which the
+        //  peer reads messages, so that they are queued for at most delay_
+        //  milliseconds. The current high watermark becomes the upper bound
+        //  (zero meaning no bound), min_ the lower one. Must be called
+        //  before the peer starts reading from the pipe.
+        void set_hwm_target (int delay_, int min_);
+
+        //  Allocates the outbound queue up to the high watermark so that
+        //  no allocations are needed once the traffic starts. Must be
+        //  called before the pipe is passed to the peer's thread.
+        void warmup ();
+
+        //  Marks the pipe as connecting two sockets directly, i.e. as an
+        //  inproc connection.
+        void set_inproc ();
+        bool is_inproc ();
+
+        //  Makes the peer read messages from the broadcast ring rather than
+        //  from the pipe. Nothing may be written to the pipe afterwards,
+        //  and flush wakes the peer up if needed. detach_ring must be
+        //  called once the pipe is terminated. Returns false if the pipe
+        //  conflates messages, which the ring doesn't support.
+        bool attach_ring (broadcast_ring_t *ring_);
+        void detach_ring ();
+
+        //  Returns true if messages are passed through a broadcast ring
+        //  rather than through the pipe.
+        bool is_broadcast ();
+
     private:
 
         //  Type of the underlying lock-free pipe.
@@ -126,12 +168,21 @@ namespace zmq
         void process_activate_read ();
         void process_activate_write (uint64_t msgs_read_);
         void process_hiccup (void *pipe_);
-        void process_pipe_term ();
+        void process_pipe_term (bool drop_);
         void process_pipe_term_ack ();
 
         //  Handler for delimiter read from the pipe.
         void process_delimiter ();
 
+        //  Starts reading from the broadcast ring handed over by the peer.
+        void receive_ring (msg_t *handle_);
+
+        //  Same as check_read, for pipes reading from a broadcast ring.
+        bool check_ring ();
+
+        //  Adjusts the adaptive high watermark given the peer's msgs_read.
+        void adapt_hwm (uint64_t msgs_read_);
+
         //  Constructor is private. Pipe can only be created using
         //  pipepair function.
         pipe_t (object_t *parent_, upipe_t *inpipe_, upipe_t *outpipe_,
@@ -166,6 +217,18 @@ namespace zmq
         //  can be higher at the moment.
         uint64_t peers_msgs_read;
 
+        //  Adaptive high watermark: target queueing delay in milliseconds
+        //  (zero if the watermark is fixed) and the bounds of the watermark.
+        int hwm_delay;
+        int hwm_min;
+        int hwm_max;
+
+        //  Start of the current drain rate measurement, as a time in
+        //  microseconds (zero if no measurement is running) and the peer's
+        //  msgs_read at that time.
+        uint64_t drain_start_time;
+        uint64_t drain_start_msgs;
+
         //  The pipe object on the other side of the pipepair.
         pipe_t *peer;
 
@@ -197,20 +260,40 @@ namespace zmq
         //  asks us to.
         bool delay;
 
+        //  True if the peer asked us to terminate with the drop flag set.
+        bool dropped;
+
         //  Identity of the writer. Used uniquely by the reader side.
         blob_t identity;
 
         //  Pipe's credential.
         blob_t credential;
 
+        //  Address of the endpoint the pipe was created for.
+        std::string endpoint;
+
         //  Returns true if the message is delimiter; false otherwise.
         static bool is_delimiter (const msg_t &msg_);
 
+        //  Returns true if the message hands over a broadcast ring.
+        static bool is_ring_handle (const msg_t &msg_);
+
         //  Computes appropriate low watermark from the given high watermark.
         static int compute_lwm (int hwm_);
 
         bool conflate;
 
+        //  True if the pipe is an inproc connection.
+        bool inproc;
+
+        //  On the writer's side of a broadcast ring, the state of the peer
+        //  reading from it. On the reader's side, the reader's own state
+        //  and the message that handed it over, which is kept until the
+        //  pipe is deallocated.
+        broadcast_ring_t::reader_t *ring_peer;
+        broadcast_ring_t::reader_t *ring_reader;
+        msg_t ring_handle;
+
         //  Disable copying.
         pipe_t (const pipe_t&);
         const pipe_t &operator = (const pipe_t&);
@@ -269,6 +269,9 @@ int zmq::plain_mechanism_t::produce_initiate (msg_t *msg_) const
             options.identity, options.identity_size);
     }
 
+    //  Add the properties of the protocol extensions in use
+    ptr += add_extension_properties (ptr);
+
     const size_t command_size = ptr - command_buffer;
     const int rc = msg_->init_size (command_size);
     errno_assert (rc == 0);
@@ -315,6 +318,9 @@ int zmq::plain_mechanism_t::produce_ready (msg_t *msg_) const
             options.identity, options.identity_size);
     }
 
+    //  Add the properties of the protocol extensions in use
+    ptr += add_extension_properties (ptr);
+
     const size_t command_size = ptr - command_buffer;
     const int rc = msg_->init_size (command_size);
     errno_assert (rc == 0);
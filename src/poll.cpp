@@ -109,6 +109,12 @@ void zmq::poll_t::start ()
     worker.start (worker_routine, this);
 }
 
+int zmq::poll_t::set_cpus (const std::vector <int> &cpus_,
+    std::vector <int> &cpus_out_)
+{
+    return worker.set_cpus (cpus_, cpus_out_);
+}
+
 void zmq::poll_t::stop ()
 {
     stopping = true;
@@ -127,7 +133,9 @@ void zmq::poll_t::loop ()
         int timeout = (int) execute_timers ();
 
         //  Wait for events.
+        wait_begin ();
         int rc = poll (&pollset [0], pollset.size (), timeout ? timeout : -1);
+        wait_end (rc);
         if (rc == -1) {
             errno_assert (errno == EINTR);
             continue;
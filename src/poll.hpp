@@ -59,6 +59,11 @@ namespace zmq
         void start ();
         void stop ();
 
+        //  Restricts the worker thread to the CPU cores listed, see
+        //  thread_t::set_cpus.
+        int set_cpus (const std::vector <int> &cpus_,
+            std::vector <int> &cpus_out_);
+
         static int max_fds ();
 
     private:
@@ -17,12 +17,19 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <string.h>
+
 #include "poller_base.hpp"
 #include "i_poll_events.hpp"
 #include "err.hpp"
 
-zmq::poller_base_t::poller_base_t ()
+zmq::poller_base_t::poller_base_t () :
+    stats_enabled (false),
+    stats_sync ("poller_base_t::stats_sync"),
+    last_mark (0)
 {
+    memset (&local_stats, 0, sizeof local_stats);
+    memset (&stats, 0, sizeof stats);
 }
 
 zmq::poller_base_t::~poller_base_t ()
@@ -36,6 +43,54 @@ int zmq::poller_base_t::get_load ()
     return load.get ();
 }
 
+void zmq::poller_base_t::get_stats (zmq_io_thread_stats_t *stats_)
+{
+    stats_sync.lock ();
+    *stats_ = stats;
+    stats_sync.unlock ();
+    stats_->load = get_load ();
+}
+
+void zmq::poller_base_t::enable_stats ()
+{
+    stats_enabled = true;
+    last_mark = clock_t::now_us ();
+}
+
+void zmq::poller_base_t::commands_processed (int count_)
+{
+    local_stats.commands += count_;
+}
+
+void zmq::poller_base_t::wait_begin ()
+{
+    if (!stats_enabled)
+        return;
+
+    const uint64_t now = clock_t::now_us ();
+    local_stats.busy_us += now - last_mark;
+    last_mark = now;
+
+    //  The thread is about to sleep, so this is the time to publish
+    //  what it has done since the last wakeup.
+    stats_sync.lock ();
+    stats = local_stats;
+    stats_sync.unlock ();
+}
+
+void zmq::poller_base_t::wait_end (int events_)
+{
+    if (!stats_enabled)
+        return;
+
+    const uint64_t now = clock_t::now_us ();
+    local_stats.wait_us += now - last_mark;
+    last_mark = now;
+    local_stats.wakeups++;
+    if (events_ > 0)
+        local_stats.events += events_;
+}
+
 void zmq::poller_base_t::adjust_load (int amount_)
 {
     if (amount_ > 0)
@@ -87,6 +142,7 @@ uint64_t zmq::poller_base_t::execute_timers ()
 
         //  Trigger the timer.
         it->second.sink->timer_event (it->second.id);
+        local_stats.timers++;
 
         //  Remove it from the list of active timers.
         timers_t::iterator o = it;
@@ -22,8 +22,10 @@
 
 #include <map>
 
+#include "../include/zmq.h"
 #include "clock.hpp"
 #include "atomic_counter.hpp"
+#include "mutex.hpp"
 
 namespace zmq
 {
@@ -41,6 +43,19 @@ namespace zmq
         //  invoked from a different thread!
         int get_load ();
 
+        //  Copies the statistics of the event loop into stats_. Note that
+        //  this function can be invoked from a different thread!
+        void get_stats (zmq_io_thread_stats_t *stats_);
+
+        //  Makes the poller keep the statistics of the event loop, which
+        //  costs two clock reads and a lock per wakeup. To be called before
+        //  the poller's thread is started.
+        void enable_stats ();
+
+        //  Accounts for commands processed by the thread running the
+        //  poller. To be called from that thread.
+        void commands_processed (int count_);
+
         //  Add a timeout to expire in timeout_ milliseconds. After the
         //  expiration timer_event on sink_ object will be called with
         //  argument set to id_.
@@ -58,6 +73,13 @@ namespace zmq
         //  to wait to match the next timer or 0 meaning "no timers".
         uint64_t execute_timers ();
 
+        //  Called by individual poller implementations right before and
+        //  right after waiting for events, so that the time spent waiting
+        //  is told apart from the time spent processing. events_ is the
+        //  number of events returned by the wait.
+        void wait_begin ();
+        void wait_end (int events_);
+
     private:
 
         //  Clock instance private to this I/O thread.
@@ -76,6 +98,17 @@ namespace zmq
         //  registered.
         atomic_counter_t load;
 
+        //  Statistics of the event loop, if enabled. They are updated by
+        //  the poller's thread only, and copied to 'stats' once per wakeup
+        //  for other threads to read.
+        bool stats_enabled;
+        zmq_io_thread_stats_t local_stats;
+        zmq_io_thread_stats_t stats;
+        mutex_t stats_sync;
+
+        //  Time the poller last started or stopped waiting, in microseconds.
+        uint64_t last_mark;
+
         poller_base_t (const poller_base_t&);
         const poller_base_t &operator = (const poller_base_t&);
     };
@@ -0,0 +1,327 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <new>
+
+#include "ptrie.hpp"
+#include "err.hpp"
+
+zmq::ptrie_t::node_t::node_t () :
+    any (NULL)
+{
+}
+
+zmq::ptrie_t::node_t::~node_t ()
+{
+    for (children_t::iterator it = children.begin (); it != children.end ();
+          ++it)
+        delete it->second;
+    delete any;
+}
+
+bool zmq::ptrie_t::node_t::is_redundant () const
+{
+    return children.empty () && !any && pipes.empty () && rest.empty ();
+}
+
+zmq::ptrie_t::ptrie_t ()
+{
+}
+
+zmq::ptrie_t::~ptrie_t ()
+{
+}
+
+//  Returns the length of the first token of the pattern or topic.
+static size_t token_length (unsigned char *data_, size_t size_)
+{
+    size_t len = 0;
+    while (len < size_ && data_ [len] != '.')
+        len++;
+    return len;
+}
+
+static bool is_rest (unsigned char *token_, size_t len_, size_t size_)
+{
+    return len_ == 1 && len_ == size_ && *token_ == '>';
+}
+
+static bool is_any (unsigned char *token_, size_t len_)
+{
+    return len_ == 1 && *token_ == '*';
+}
+
+zmq::ptrie_t::pipes_t *zmq::ptrie_t::find (unsigned char *pattern_,
+    size_t size_, bool create_)
+{
+    node_t *node = &root;
+    while (true) {
+        const size_t len = token_length (pattern_, size_);
+        if (is_rest (pattern_, len, size_))
+            return &node->rest;
+
+        node_t *next;
+        if (is_any (pattern_, len)) {
+            next = node->any;
+            if (!next && create_) {
+                next = new (std::nothrow) node_t;
+                alloc_assert (next);
+                node->any = next;
+            }
+        }
+        else {
+            std::string key ((char*) pattern_, len);
+            children_t::iterator it = node->children.find (key);
+            if (it != node->children.end ())
+                next = it->second;
+            else {
+                next = NULL;
+                if (create_) {
+                    next = new (std::nothrow) node_t;
+                    alloc_assert (next);
+                    node->children.insert (children_t::value_type (key, next));
+                }
+            }
+        }
+        if (!next)
+            return NULL;
+        node = next;
+
+        if (len == size_)
+            return &node->pipes;
+        pattern_ += len + 1;
+        size_ -= len + 1;
+    }
+}
+
+void zmq::ptrie_t::prune (node_t *node_, unsigned char *pattern_,
+    size_t size_)
+{
+    const size_t len = token_length (pattern_, size_);
+    if (is_rest (pattern_, len, size_))
+        return;
+
+    if (is_any (pattern_, len)) {
+        if (!node_->any)
+            return;
+        if (len < size_)
+            prune (node_->any, pattern_ + len + 1, size_ - len - 1);
+        if (node_->any->is_redundant ()) {
+            delete node_->any;
+            node_->any = NULL;
+        }
+        return;
+    }
+
+    children_t::iterator it =
+        node_->children.find (std::string ((char*) pattern_, len));
+    if (it == node_->children.end ())
+        return;
+    if (len < size_)
+        prune (it->second, pattern_ + len + 1, size_ - len - 1);
+    if (it->second->is_redundant ()) {
+        delete it->second;
+        node_->children.erase (it);
+    }
+}
+
+bool zmq::ptrie_t::add (unsigned char *pattern_, size_t size_,
+    pipe_t *pipe_)
+{
+    pipes_t *pipes = find (pattern_, size_, true);
+    const bool result = pipes->empty ();
+    (*pipes) [pipe_]++;
+    return result;
+}
+
+bool zmq::ptrie_t::rm (unsigned char *pattern_, size_t size_, pipe_t *pipe_)
+{
+    pipes_t *pipes = find (pattern_, size_, false);
+    if (!pipes)
+        return false;
+    pipes_t::iterator it = pipes->find (pipe_);
+    if (it == pipes->end ())
+        return false;
+    if (--it->second > 0)
+        return false;
+    pipes->erase (it);
+    if (!pipes->empty ())
+        return false;
+
+    prune (&root, pattern_, size_);
+    return true;
+}
+
+void zmq::ptrie_t::rm (pipe_t *pipe_,
+    void (*func_) (unsigned char *data_, size_t size_, void *arg_),
+    void *arg_)
+{
+    std::string path;
+    rm_helper (&root, path, pipe_, func_, arg_);
+}
+
+void zmq::ptrie_t::rm_helper (node_t *node_, std::string &path_,
+    pipe_t *pipe_,
+    void (*func_) (unsigned char *data_, size_t size_, void *arg_),
+    void *arg_)
+{
+    const size_t path_len = path_.size ();
+    const bool root_node = node_ == &root;
+
+    //  Remove the subscriptions ending at this node.
+    if (node_->pipes.erase (pipe_) && node_->pipes.empty ())
+        func_ ((unsigned char*) path_.data (), path_len, arg_);
+    if (node_->rest.erase (pipe_) && node_->rest.empty ()) {
+        path_ += root_node ? ">" : ".>";
+        func_ ((unsigned char*) path_.data (), path_.size (), arg_);
+        path_.resize (path_len);
+    }
+
+    //  Recurse into the subtrees, dropping those left empty.
+    if (node_->any) {
+        path_ += root_node ? "*" : ".*";
+        rm_helper (node_->any, path_, pipe_, func_, arg_);
+        path_.resize (path_len);
+        if (node_->any->is_redundant ()) {
+            delete node_->any;
+            node_->any = NULL;
+        }
+    }
+    children_t::iterator it = node_->children.begin ();
+    while (it != node_->children.end ()) {
+        if (!root_node)
+            path_ += '.';
+        path_ += it->first;
+        rm_helper (it->second, path_, pipe_, func_, arg_);
+        path_.resize (path_len);
+        if (it->second->is_redundant ()) {
+            delete it->second;
+            node_->children.erase (it++);
+        }
+        else
+            ++it;
+    }
+}
+
+void zmq::ptrie_t::apply (void (*func_) (unsigned char *data_, size_t size_,
+    void *arg_), void *arg_)
+{
+    std::string path;
+    apply_helper (&root, path, func_, arg_);
+}
+
+void zmq::ptrie_t::apply_helper (node_t *node_, std::string &path_,
+    void (*func_) (unsigned char *data_, size_t size_, void *arg_),
+    void *arg_)
+{
+    const size_t path_len = path_.size ();
+    const bool root_node = node_ == &root;
+
+    if (!node_->pipes.empty ())
+        func_ ((unsigned char*) path_.data (), path_len, arg_);
+    if (!node_->rest.empty ()) {
+        path_ += root_node ? ">" : ".>";
+        func_ ((unsigned char*) path_.data (), path_.size (), arg_);
+        path_.resize (path_len);
+    }
+
+    if (node_->any) {
+        path_ += root_node ? "*" : ".*";
+        apply_helper (node_->any, path_, func_, arg_);
+        path_.resize (path_len);
+    }
+    for (children_t::iterator it = node_->children.begin ();
+          it != node_->children.end (); ++it) {
+        if (!root_node)
+            path_ += '.';
+        path_ += it->first;
+        apply_helper (it->second, path_, func_, arg_);
+        path_.resize (path_len);
+    }
+}
+
+void zmq::ptrie_t::match (unsigned char *data_, size_t size_,
+    void (*func_) (pipe_t *pipe_, void *arg_), void *arg_)
+{
+    match_helper (data_, size_, func_, arg_);
+}
+
+bool zmq::ptrie_t::check (unsigned char *data_, size_t size_)
+{
+    return match_helper (data_, size_, NULL, NULL);
+}
+
+bool zmq::ptrie_t::match_helper (unsigned char *data_, size_t size_,
+    void (*func_) (pipe_t *pipe_, void *arg_), void *arg_)
+{
+    bool matched = false;
+
+    //  The set of nodes reached by the tokens consumed so far. All of them
+    //  advance on each token of the topic.
+    states.clear ();
+    states.push_back (&root);
+    while (true) {
+        const size_t len = token_length (data_, size_);
+        token.assign ((char*) data_, len);
+
+        next_states.clear ();
+        for (size_t i = 0; i != states.size (); i++) {
+            node_t *node = states [i];
+
+            //  There's at least one more token, so '>' matches.
+            if (!node->rest.empty ()) {
+                if (!func_)
+                    return true;
+                matched = true;
+                for (pipes_t::iterator it = node->rest.begin ();
+                      it != node->rest.end (); ++it)
+                    func_ (it->first, arg_);
+            }
+
+            if (!node->children.empty ()) {
+                children_t::iterator it = node->children.find (token);
+                if (it != node->children.end ())
+                    next_states.push_back (it->second);
+            }
+            if (node->any)
+                next_states.push_back (node->any);
+        }
+        states.swap (next_states);
+
+        if (states.empty () || len == size_)
+            break;
+        data_ += len + 1;
+        size_ -= len + 1;
+    }
+
+    //  The topic is consumed. Patterns ending at the nodes reached match.
+    for (size_t i = 0; i != states.size (); i++) {
+        node_t *node = states [i];
+        if (!node->pipes.empty ()) {
+            if (!func_)
+                return true;
+            matched = true;
+            for (pipes_t::iterator it = node->pipes.begin ();
+                  it != node->pipes.end (); ++it)
+                func_ (it->first, arg_);
+        }
+    }
+    return matched;
+}
@@ -0,0 +1,134 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_PTRIE_HPP_INCLUDED__
+#define __ZMQ_PTRIE_HPP_INCLUDED__
+
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    class pipe_t;
+
+    //  Trie of wildcard subscription patterns. Patterns and topics are
+    //  sequences of tokens separated by dots. In a pattern, '*' matches
+    //  any single token and a trailing '>' matches one or more tokens.
+    //  Patterns share the nodes for their common leading tokens, so the
+    //  trie works as a nondeterministic automaton that matches a topic
+    //  against all the patterns in a single pass over the topic.
+    //  Subscriptions are reference counted per pipe. Sockets that don't
+    //  track pipes use NULL.
+
+    class ptrie_t
+    {
+    public:
+
+        ptrie_t ();
+        ~ptrie_t ();
+
+        //  Add pattern to the trie. Returns true if nobody was subscribed
+        //  to the pattern yet.
+        bool add (unsigned char *pattern_, size_t size_, zmq::pipe_t *pipe_);
+
+        //  Remove a subscription to the pattern. Returns true if nobody is
+        //  subscribed to the pattern anymore.
+        bool rm (unsigned char *pattern_, size_t size_, zmq::pipe_t *pipe_);
+
+        //  Remove all subscriptions for a specific peer from the trie.
+        //  If nobody is subscribed to some patterns anymore, invoke the
+        //  supplied callback function.
+        void rm (zmq::pipe_t *pipe_,
+            void (*func_) (unsigned char *data_, size_t size_, void *arg_),
+            void *arg_);
+
+        //  Apply the function supplied to each pattern in the trie.
+        void apply (void (*func_) (unsigned char *data_, size_t size_,
+            void *arg_), void *arg_);
+
+        //  Signal all the pipes subscribed to a pattern matching the topic.
+        //  A pipe is signaled once per matching pattern.
+        void match (unsigned char *data_, size_t size_,
+            void (*func_) (zmq::pipe_t *pipe_, void *arg_), void *arg_);
+
+        //  Check whether the topic matches at least one pattern.
+        bool check (unsigned char *data_, size_t size_);
+
+    private:
+
+        struct node_t;
+        typedef std::map <zmq::pipe_t*, uint32_t> pipes_t;
+        typedef std::map <std::string, node_t*> children_t;
+
+        struct node_t
+        {
+            node_t ();
+            ~node_t ();
+            bool is_redundant () const;
+
+            //  Nodes for the next literal token and for '*'.
+            children_t children;
+            node_t *any;
+
+            //  Subscribers of patterns ending at this node, and of those
+            //  ending with '>' right after it.
+            pipes_t pipes;
+            pipes_t rest;
+        };
+
+        //  Returns the subscribers of the pattern, creating the path to
+        //  them if required and possible.
+        pipes_t *find (unsigned char *pattern_, size_t size_, bool create_);
+
+        //  Drops the nodes left without subscriptions along the pattern.
+        void prune (node_t *node_, unsigned char *pattern_, size_t size_);
+
+        void rm_helper (node_t *node_, std::string &path_,
+            zmq::pipe_t *pipe_,
+            void (*func_) (unsigned char *data_, size_t size_, void *arg_),
+            void *arg_);
+        void apply_helper (node_t *node_, std::string &path_,
+            void (*func_) (unsigned char *data_, size_t size_, void *arg_),
+            void *arg_);
+
+        //  Runs the automaton over the topic. If func_ is NULL, stops at
+        //  the first match.
+        bool match_helper (unsigned char *data_, size_t size_,
+            void (*func_) (zmq::pipe_t *pipe_, void *arg_), void *arg_);
+
+        node_t root;
+
+        //  Scratch space for matching, kept to avoid allocations.
+        std::vector <node_t*> states;
+        std::vector <node_t*> next_states;
+        std::string token;
+
+        ptrie_t (const ptrie_t&);
+        const ptrie_t &operator = (const ptrie_t&);
+    };
+
+}
+
+#endif
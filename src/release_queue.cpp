@@ -0,0 +1,94 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "release_queue.hpp"
+#include "err.hpp"
+
+zmq::release_queue_t::release_queue_t () :
+    refs (1)
+{
+    head.set (NULL);
+}
+
+zmq::release_queue_t::~release_queue_t ()
+{
+}
+
+void zmq::release_queue_t::add_ref ()
+{
+    refs.add (1);
+}
+
+void zmq::release_queue_t::rm_ref ()
+{
+    if (!refs.sub (1))
+        delete this;
+}
+
+bool zmq::release_queue_t::push (item_t *item_)
+{
+    //  Standard lock-free stack push. The consumer always takes the whole
+    //  stack at once, so there's no ABA problem.
+    item_t *expected = NULL;
+    while (expected != &closed) {
+        item_->next = expected;
+        item_t *old = head.cas (expected, item_);
+        if (old == expected)
+            return true;
+        expected = old;
+    }
+    return false;
+}
+
+int zmq::release_queue_t::drain ()
+{
+    item_t *list = head.xchg (NULL);
+    zmq_assert (list != &closed);
+    return release_list (list);
+}
+
+void zmq::release_queue_t::close ()
+{
+    item_t *list = head.xchg (&closed);
+    zmq_assert (list != &closed);
+    release_list (list);
+    rm_ref ();
+}
+
+int zmq::release_queue_t::release_list (item_t *list_)
+{
+    //  Reverse the list to release the items in the order of pushing.
+    item_t *ordered = NULL;
+    while (list_) {
+        item_t *next = list_->next;
+        list_->next = ordered;
+        ordered = list_;
+        list_ = next;
+    }
+
+    int count = 0;
+    while (ordered) {
+        item_t *next = ordered->next;
+        ordered->release (ordered);
+        ordered = next;
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,90 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ZMQ_RELEASE_QUEUE_HPP_INCLUDED__
+#define __ZMQ_RELEASE_QUEUE_HPP_INCLUDED__
+
+#include <stddef.h>
+
+#include "atomic_ptr.hpp"
+#include "atomic_counter.hpp"
+
+namespace zmq
+{
+
+    //  Lock-free queue of items whose release is deferred to the thread
+    //  owning the queue. Any thread may push items, while only the owner
+    //  drains them, taking all the queued items in one go. Once the owner
+    //  closes the queue, pushing fails and items are to be released by the
+    //  pushing thread. The queue is reference counted so that it outlives
+    //  its owner as long as there are items that may be pushed to it.
+
+    class release_queue_t
+    {
+    public:
+
+        struct item_t
+        {
+            item_t *next;
+
+            //  Releases the item. Invoked by the owner while draining.
+            void (*release) (item_t *item_);
+        };
+
+        release_queue_t ();
+
+        //  Adds a reference to the queue.
+        void add_ref ();
+
+        //  Drops a reference to the queue. The last one deallocates it.
+        void rm_ref ();
+
+        //  Enqueues the item. Returns false if the queue is closed, in
+        //  which case the item is left to the caller.
+        bool push (item_t *item_);
+
+        //  Releases all the queued items in the order they were pushed.
+        //  Returns the number of items released.
+        int drain ();
+
+        //  Releases the queued items, closes the queue and drops the
+        //  owner's reference.
+        void close ();
+
+    private:
+
+        ~release_queue_t ();
+
+        //  Releases the list of items, which is in reverse order.
+        static int release_list (item_t *list_);
+
+        //  Last item pushed, or 'closed' once the queue is closed.
+        atomic_ptr_t <item_t> head;
+        item_t closed;
+
+        atomic_counter_t refs;
+
+        release_queue_t (const release_queue_t&);
+        const release_queue_t &operator = (const release_queue_t&);
+    };
+
+}
+
+#endif
@@ -139,6 +139,12 @@ void zmq::select_t::start ()
     worker.start (worker_routine, this);
 }
 
+int zmq::select_t::set_cpus (const std::vector <int> &cpus_,
+    std::vector <int> &cpus_out_)
+{
+    return worker.set_cpus (cpus_, cpus_out_);
+}
+
 void zmq::select_t::stop ()
 {
     stopping = true;
@@ -164,13 +170,16 @@ void zmq::select_t::loop ()
         //  Wait for events.
         struct timeval tv = {(long) (timeout / 1000),
             (long) (timeout % 1000 * 1000)};
+        wait_begin ();
 #ifdef ZMQ_HAVE_WINDOWS
         int rc = select (0, &readfds, &writefds, &exceptfds,
             timeout ? &tv : NULL);
+        wait_end (rc);
         wsa_assert (rc != SOCKET_ERROR);
 #else
         int rc = select (maxfd + 1, &readfds, &writefds, &exceptfds,
             timeout ? &tv : NULL);
+        wait_end (rc);
         if (rc == -1) {
             errno_assert (errno == EINTR);
             continue;
@@ -23,6 +23,8 @@
 #include "pipe.hpp"
 #include "likely.hpp"
 #include "tcp_connecter.hpp"
+#include "mux.hpp"
+#include "mux_channel.hpp"
 #include "ipc_connecter.hpp"
 #include "tipc_connecter.hpp"
 #include "pgm_sender.hpp"
@@ -70,14 +72,15 @@ zmq::session_base_t::session_base_t (class io_thread_t *io_thread_,
       const address_t *addr_) :
     own_t (io_thread_, options_),
     io_object_t (io_thread_),
+    engine (NULL),
+    io_thread (io_thread_),
     active (active_),
     pipe (NULL),
     zap_pipe (NULL),
     incomplete_in (false),
     pending (false),
-    engine (NULL),
+    linger (0),
     socket (socket_),
-    io_thread (io_thread_),
     has_linger_timer (false),
     addr (addr_)
 {
@@ -123,6 +126,11 @@ int zmq::session_base_t::pull_msg (msg_t *msg_)
 }
 
 int zmq::session_base_t::push_msg (msg_t *msg_)
+{
+    return xpush_msg (msg_);
+}
+
+int zmq::session_base_t::xpush_msg (msg_t *msg_)
 {
     if (pipe && pipe->write (msg_)) {
         int rc = msg_->init ();
@@ -205,6 +213,10 @@ void zmq::session_base_t::pipe_terminated (pipe_t *pipe_)
              || pipe_ == zap_pipe
              || terminating_pipes.count (pipe_) == 1);
 
+    //  The socket may have dropped the connection's pipe, e.g. to evict
+    //  a slow subscriber. The connection is to be closed as well.
+    bool dropped = pipe_ == pipe && pipe_->is_dropped ();
+
     if (pipe_ == pipe)
         // If this is our current pipe, remove it
         pipe = NULL;
@@ -222,6 +234,15 @@ void zmq::session_base_t::pipe_terminated (pipe_t *pipe_)
         }
         terminate ();
     }
+    else
+    if (!is_terminating () && !pending && dropped && engine) {
+        engine->terminate ();
+        engine = NULL;
+        if (active)
+            reconnect ();
+        else
+            terminate ();
+    }
 
     //  If we are waiting for pending messages to be sent, at this point
     //  we are sure that there will be no more messages and we can proceed
@@ -273,6 +294,11 @@ zmq::socket_base_t *zmq::session_base_t::get_socket ()
     return socket;
 }
 
+bool zmq::session_base_t::is_mux () const
+{
+    return false;
+}
+
 void zmq::session_base_t::process_plug ()
 {
     if (active)
@@ -347,6 +373,18 @@ void zmq::session_base_t::process_attach (i_engine *engine_)
         int rc = pipepair (parents, pipes, hwms, conflates);
         errno_assert (rc == 0);
 
+        if (options.hwm_target_delay > 0) {
+            pipes [0]->set_hwm_target (options.hwm_target_delay,
+                options.hwm_min);
+            pipes [1]->set_hwm_target (options.hwm_target_delay,
+                options.hwm_min);
+        }
+
+        if (options.warmup) {
+            pipes [0]->warmup ();
+            pipes [1]->warmup ();
+        }
+
         //  Plug the local end of the pipe.
         pipes [0]->set_event_sink (this);
 
@@ -389,6 +427,7 @@ void zmq::session_base_t::engine_error ()
 void zmq::session_base_t::process_term (int linger_)
 {
     zmq_assert (!pending);
+    linger = linger_;
 
     //  If the termination of the pipe happens before the term command is
     //  delivered there's nothing much to do. We can proceed with the
@@ -429,8 +468,10 @@ void zmq::session_base_t::proceed_with_term ()
     //  The pending phase has just ended.
     pending = false;
 
-    //  Continue with standard termination.
-    own_t::process_term (0);
+    //  Continue with standard termination. The objects a session owns
+    //  don't linger, except for the sessions of a multiplexer's channels,
+    //  which still have to flush their messages.
+    own_t::process_term (is_mux () ? linger : 0);
 }
 
 void zmq::session_base_t::timer_event (int id_)
@@ -473,6 +514,16 @@ void zmq::session_base_t::start_connecting (bool wait_)
 {
     zmq_assert (active);
 
+    //  Multiplexing sessions get a channel of the connection shared by
+    //  the sessions of this thread connecting to the same endpoint.
+    if (addr->protocol == "tcp" && options.tcp_mux && !options.raw_sock &&
+          !is_mux ()) {
+        mux_channel_t *channel = mux_t::open_channel (io_thread, this,
+            options, addr);
+        send_attach (this, channel);
+        return;
+    }
+
     //  Choose I/O thread to run connecter in. Given that we are already
     //  running in an I/O thread, there must be at least one available.
     io_thread_t *io_thread = choose_io_thread (options.affinity);
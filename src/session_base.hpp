@@ -54,8 +54,8 @@ namespace zmq
 
         //  Following functions are the interface exposed towards the engine.
         virtual void reset ();
-        void flush ();
-        void engine_error ();
+        virtual void flush ();
+        virtual void engine_error ();
 
         //  i_pipe_events interface implementation.
         void read_activated (zmq::pipe_t *pipe_);
@@ -72,7 +72,7 @@ namespace zmq
         //  Fetches a message. Returns 0 if successful; -1 otherwise.
         //  The caller is responsible for freeing the message when no
         //  longer used.
-        int pull_msg (msg_t *msg_);
+        virtual int pull_msg (msg_t *msg_);
 
         //  Receives message from ZAP socket.
         //  Returns 0 on success; -1 otherwise.
@@ -86,6 +86,10 @@ namespace zmq
 
         socket_base_t *get_socket ();
 
+        //  True iff the session carries a multiplexed connection rather
+        //  than being one of its channels.
+        virtual bool is_mux () const;
+
     protected:
 
         session_base_t (zmq::io_thread_t *io_thread_, bool active_,
@@ -93,6 +97,21 @@ namespace zmq
             const address_t *addr_);
         virtual ~session_base_t ();
 
+        //  Writes the message delivered by push_msg to the pipe. Sessions
+        //  not passing the messages to a pipe of their own override it.
+        virtual int xpush_msg (msg_t *msg_);
+
+        //  Handlers for incoming commands.
+        void process_attach (zmq::i_engine *engine_);
+        void process_term (int linger_);
+
+        //  The protocol I/O engine connected to the session.
+        zmq::i_engine *engine;
+
+        //  I/O thread the session is living in. It will be used to plug in
+        //  the engines into the same thread.
+        zmq::io_thread_t *io_thread;
+
     private:
 
         void start_connecting (bool wait_);
@@ -101,8 +120,6 @@ namespace zmq
 
         //  Handlers for incoming commands.
         void process_plug ();
-        void process_attach (zmq::i_engine *engine_);
-        void process_term (int linger_);
 
         //  i_poll_events handlers.
         void timer_event (int id_);
@@ -135,16 +152,13 @@ namespace zmq
         //  messages to the network.
         bool pending;
 
-        //  The protocol I/O engine connected to the session.
-        zmq::i_engine *engine;
+        //  Linger period the session was asked to terminate with, passed
+        //  on to the sessions a multiplexer owns.
+        int linger;
 
         //  The socket the session belongs to.
         zmq::socket_base_t *socket;
 
-        //  I/O thread the session is living in. It will be used to plug in
-        //  the engines into the same thread.
-        zmq::io_thread_t *io_thread;
-
         //  ID of the linger timer
         enum {linger_timer_id = 0x20};
 
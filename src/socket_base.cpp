@@ -19,6 +19,7 @@
 
 #include <new>
 #include <string>
+#include <sstream>
 #include <algorithm>
 
 #include "platform.hpp"
@@ -50,6 +51,7 @@
 #include "platform.hpp"
 #include "likely.hpp"
 #include "msg.hpp"
+#include "monitor_ring.hpp"
 #include "address.hpp"
 #include "ipc_address.hpp"
 #include "tcp_address.hpp"
@@ -133,20 +135,36 @@ zmq::socket_base_t::socket_base_t (ctx_t *parent_, uint32_t tid_, int sid_) :
     tag (0xbaddecaf),
     ctx_terminated (false),
     destroyed (false),
+    poller (NULL),
+    reaper_polled (false),
     last_tsc (0),
     ticks (0),
+    poll_rate (inbound_poll_rate),
+    command_delay (max_command_delay),
+    max_delay (max_command_delay),
     rcvmore (false),
     file_desc(-1),
     monitor_socket (NULL),
-    monitor_events (0)
+    monitor_events (0),
+    ring (NULL),
+    ring_events (0),
+    endpoint_sync ("socket_base_t::endpoint_sync"),
+    release_queue (NULL),
+    sync ("socket_base_t::sync")
 {
     options.socket_id = sid_;
     options.ipv6 = (parent_->get (ZMQ_IPV6) != 0);
+    loopback_shortcut = (parent_->get (ZMQ_LOOPBACK_SHORTCUT) != 0);
+
+    //  Endpoint ID 0 stands for events not related to any endpoint.
+    endpoint_names.push_back (std::string ());
+    endpoint_ids [std::string ()] = 0;
 }
 
 zmq::socket_base_t::~socket_base_t ()
 {
     stop_monitor ();
+    delete ring;
     zmq_assert (destroyed);
 }
 
@@ -266,7 +284,15 @@ int zmq::socket_base_t::setsockopt (int option_, const void *optval_,
 
     //  If the socket type doesn't support the option, pass it to
     //  the generic option parser.
-    return options.setsockopt (option_, optval_, optvallen_);
+    rc = options.setsockopt (option_, optval_, optvallen_);
+    if (rc == 0 && (option_ == ZMQ_INBOUND_POLL_RATE ||
+          option_ == ZMQ_COMMAND_DELAY || option_ == ZMQ_COMMAND_ADAPTIVE))
+        set_command_throttle ();
+    if (rc == 0 && options.deferred_release && !release_queue) {
+        release_queue = new (std::nothrow) release_queue_t;
+        alloc_assert (release_queue);
+    }
+    return rc;
 }
 
 int zmq::socket_base_t::getsockopt (int option_, void *optval_,
@@ -306,6 +332,8 @@ int zmq::socket_base_t::getsockopt (int option_, void *optval_,
         if (rc != 0 && (errno == EINTR || errno == ETERM))
             return -1;
         errno_assert (rc == 0);
+        if (release_queue)
+            release_queue->drain ();
         *((int*) optval_) = 0;
         if (has_out ())
             *((int*) optval_) |= ZMQ_POLLOUT;
@@ -315,6 +343,30 @@ int zmq::socket_base_t::getsockopt (int option_, void *optval_,
         return 0;
     }
 
+    if (option_ == ZMQ_MONITOR_RING_FD) {
+        if (*optvallen_ < sizeof (fd_t)) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (!ring) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((fd_t*) optval_) = ring->get_fd ();
+        *optvallen_ = sizeof (fd_t);
+        return 0;
+    }
+
+    if (option_ == ZMQ_MONITOR_RING_DROPPED) {
+        if (*optvallen_ < sizeof (uint64_t)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((uint64_t*) optval_) = ring ? ring->dropped () : 0;
+        *optvallen_ = sizeof (uint64_t);
+        return 0;
+    }
+
     if (option_ == ZMQ_LAST_ENDPOINT) {
         if (*optvallen_ < last_endpoint.size () + 1) {
             errno = EINVAL;
@@ -325,6 +377,24 @@ int zmq::socket_base_t::getsockopt (int option_, void *optval_,
         return 0;
     }
 
+    if (option_ == ZMQ_PEER_RTT_STATS) {
+        if (!optvallen_ || (*optvallen_ > 0 && !optval_)) {
+            errno = EINVAL;
+            return -1;
+        }
+        //  Fill in as many records as fit into the buffer.
+        *optvallen_ = get_ctx ()->get_rtt_stats (options.socket_id,
+            (zmq_peer_rtt_stats_t *) optval_,
+            *optvallen_ / sizeof (zmq_peer_rtt_stats_t)) *
+            sizeof (zmq_peer_rtt_stats_t);
+        return 0;
+    }
+
+    //  Check whether specific socket type provides the option.
+    int rc = xgetsockopt (option_, optval_, optvallen_);
+    if (rc == 0 || errno != EINVAL)
+        return rc;
+
     return options.getsockopt (option_, optval_, optvallen_);
 }
 
@@ -351,10 +421,15 @@ int zmq::socket_base_t::bind (const char *addr_)
     if (rc != 0)
         return -1;
 
+    rc = options.check_stream_framing ();
+    if (rc != 0)
+        return -1;
+
     if (protocol == "inproc") {
         endpoint_t endpoint = {this, options};
         int rc = register_endpoint (addr_, endpoint);
         if (rc == 0) {
+            inproc_endpoints.push_back (addr_);
             connect_pending(addr_, this);
             last_endpoint.assign (addr_);
         }
@@ -382,7 +457,7 @@ int zmq::socket_base_t::bind (const char *addr_)
         int rc = listener->set_address (address.c_str ());
         if (rc != 0) {
             delete listener;
-            event_bind_failed (address, zmq_errno());
+            event_bind_failed (address, intern_endpoint (address), zmq_errno());
             return -1;
         }
 
@@ -390,6 +465,7 @@ int zmq::socket_base_t::bind (const char *addr_)
         listener->get_address (last_endpoint);
 
         add_endpoint (addr_, (own_t *) listener, NULL);
+        register_loopback_endpoint (addr_);
         return 0;
     }
 
@@ -401,7 +477,7 @@ int zmq::socket_base_t::bind (const char *addr_)
         int rc = listener->set_address (address.c_str ());
         if (rc != 0) {
             delete listener;
-            event_bind_failed (address, zmq_errno());
+            event_bind_failed (address, intern_endpoint (address), zmq_errno());
             return -1;
         }
 
@@ -409,6 +485,7 @@ int zmq::socket_base_t::bind (const char *addr_)
         listener->get_address (last_endpoint);
 
         add_endpoint (addr_, (own_t *) listener, NULL);
+        register_loopback_endpoint (addr_);
         return 0;
     }
 #endif
@@ -420,7 +497,7 @@ int zmq::socket_base_t::bind (const char *addr_)
          int rc = listener->set_address (address.c_str ());
          if (rc != 0) {
              delete listener;
-             event_bind_failed (address, zmq_errno());
+             event_bind_failed (address, intern_endpoint (address), zmq_errno());
              return -1;
          }
 
@@ -459,6 +536,10 @@ int zmq::socket_base_t::connect (const char *addr_)
     if (rc != 0)
         return -1;
 
+    rc = options.check_stream_framing ();
+    if (rc != 0)
+        return -1;
+
     if (protocol == "inproc") {
 
         //  TODO: inproc connect is specific with respect to creating pipes
@@ -468,83 +549,7 @@ int zmq::socket_base_t::connect (const char *addr_)
         //  Find the peer endpoint.
         endpoint_t peer = find_endpoint (addr_);
 
-        // The total HWM for an inproc connection should be the sum of
-        // the binder's HWM and the connector's HWM.
-        int sndhwm = 0;
-        if (peer.socket == NULL)
-            sndhwm = options.sndhwm;
-        else if (options.sndhwm != 0 && peer.options.rcvhwm != 0)
-            sndhwm = options.sndhwm + peer.options.rcvhwm;
-        int rcvhwm = 0;
-        if (peer.socket == NULL)
-            rcvhwm = options.rcvhwm;
-        else if (options.rcvhwm != 0 && peer.options.sndhwm != 0)
-            rcvhwm = options.rcvhwm + peer.options.sndhwm;
-
-        //  Create a bi-directional pipe to connect the peers.
-        object_t *parents [2] = {this, peer.socket == NULL ? this : peer.socket};
-        pipe_t *new_pipes [2] = {NULL, NULL};
-
-        bool conflate = options.conflate &&
-            (options.type == ZMQ_DEALER ||
-             options.type == ZMQ_PULL ||
-             options.type == ZMQ_PUSH ||
-             options.type == ZMQ_PUB ||
-             options.type == ZMQ_SUB);
-
-        int hwms [2] = {conflate? -1 : sndhwm, conflate? -1 : rcvhwm};
-        bool conflates [2] = {conflate, conflate};
-        int rc = pipepair (parents, new_pipes, hwms, conflates);
-        errno_assert (rc == 0);
-
-        //  Attach local end of the pipe to this socket object.
-        attach_pipe (new_pipes [0]);
-
-        if (!peer.socket)
-        {
-            endpoint_t endpoint = {this, options};
-            pending_connection_t pending_connection = {endpoint, new_pipes [0], new_pipes [1]};
-            pend_connection (addr_, pending_connection);
-        }
-        else
-        {
-            //  If required, send the identity of the local socket to the peer.
-            if (peer.options.recv_identity) {
-    
-                msg_t id;
-                rc = id.init_size (options.identity_size);
-                errno_assert (rc == 0);
-                memcpy (id.data (), options.identity, options.identity_size);
-                id.set_flags (msg_t::identity);
-                bool written = new_pipes [0]->write (&id);
-                zmq_assert (written);
-                new_pipes [0]->flush ();
-            }
-
-            //  If required, send the identity of the peer to the local socket.
-            if (options.recv_identity) {
-                msg_t id;
-                rc = id.init_size (peer.options.identity_size);
-                errno_assert (rc == 0);
-                memcpy (id.data (), peer.options.identity, peer.options.identity_size);
-                id.set_flags (msg_t::identity);
-                bool written = new_pipes [1]->write (&id);
-                zmq_assert (written);
-                new_pipes [1]->flush ();
-            }
-
-            //  Attach remote end of the pipe to the peer socket. Note that peer's
-            //  seqnum was incremented in find_endpoint function. We don't need it
-            //  increased here.
-            send_bind (peer.socket, new_pipes [1], false);
-        }
-
-        // Save last endpoint URI
-        last_endpoint.assign (addr_);
-
-        // remember inproc connections for disconnect
-        inprocs.insert (inprocs_t::value_type (std::string (addr_), new_pipes[0]));
-
+        connect_inproc (addr_, peer);
         return 0;
     }
     bool is_single_connect = (options.type == ZMQ_DEALER ||
@@ -552,7 +557,7 @@ int zmq::socket_base_t::connect (const char *addr_)
                               options.type == ZMQ_REQ);
     if (unlikely (is_single_connect)) {
         endpoints_t::iterator it = endpoints.find (addr_);
-        if (it != endpoints.end ()) {
+        if (it != endpoints.end () || inprocs.find (addr_) != inprocs.end ()) {
             // There is no valid use for multiple connects for SUB-PUB nor
             // DEALER-ROUTER nor REQ-REP. Multiple connects produces
             // nonsensical results.
@@ -560,8 +565,18 @@ int zmq::socket_base_t::connect (const char *addr_)
         }
     }
 
-    //  Choose the I/O thread to run the session in.
-    io_thread_t *io_thread = choose_io_thread (options.affinity);
+    //  Choose the I/O thread to run the session in. Sessions multiplexing
+    //  their connections to an endpoint have to meet in the same thread,
+    //  so the thread is picked by the endpoint rather than by the load.
+    io_thread_t *io_thread = NULL;
+    if (protocol == "tcp" && options.tcp_mux && !options.raw_sock) {
+        uint32_t hash = 2166136261u;
+        for (std::string::size_type i = 0; i != address.size (); i++)
+            hash = (hash ^ (unsigned char) address [i]) * 16777619u;
+        io_thread = choose_io_thread_for_hash (hash, options.affinity);
+    }
+    else
+        io_thread = choose_io_thread (options.affinity);
     if (!io_thread) {
         errno = EMTHREAD;
         return -1;
@@ -580,6 +595,12 @@ int zmq::socket_base_t::connect (const char *addr_)
             delete paddr;
             return -1;
         }
+
+        //  To race connections, we need all the addresses the name maps to.
+        //  The connecter falls back to the primary address if this fails.
+        if (options.tcp_connect_stagger > 0)
+            tcp_address_t::resolve_all (address.c_str (), options.ipv6,
+                paddr->tcp_addrs);
     }
 #if !defined ZMQ_HAVE_WINDOWS && !defined ZMQ_HAVE_OPENVMS
     else
@@ -617,6 +638,26 @@ int zmq::socket_base_t::connect (const char *addr_)
     }
 #endif
 
+    //  If the address is bound by a socket of this context, connect to it
+    //  directly the way inproc does, bypassing the network stack.
+    if (loopback_shortcut && (protocol == "tcp" || protocol == "ipc") &&
+          options.mechanism == ZMQ_NULL && options.zap_domain.empty () &&
+          !options.raw_sock) {
+        endpoint_t peer = find_loopback_endpoint (paddr);
+        if (peer.socket) {
+            connect_inproc (addr_, peer);
+            paddr->to_string (last_endpoint);
+            delete paddr;
+            return 0;
+        }
+    }
+
+    //  Intern the endpoint for the monitor ring before the connecters
+    //  start reporting events about it.
+    std::string endpoint;
+    paddr->to_string (endpoint);
+    paddr->endpoint_id = intern_endpoint (endpoint);
+
     //  Create session.
     session_base_t *session = session_base_t::create (io_thread, true, this,
         options, paddr);
@@ -645,9 +686,22 @@ int zmq::socket_base_t::connect (const char *addr_)
         rc = pipepair (parents, new_pipes, hwms, conflates);
         errno_assert (rc == 0);
 
+        if (options.hwm_target_delay > 0) {
+            new_pipes [0]->set_hwm_target (options.hwm_target_delay,
+                options.hwm_min);
+            new_pipes [1]->set_hwm_target (options.hwm_target_delay,
+                options.hwm_min);
+        }
+
+        if (options.warmup) {
+            new_pipes [0]->warmup ();
+            new_pipes [1]->warmup ();
+        }
+
         //  Attach local end of the pipe to the socket object.
         attach_pipe (new_pipes [0], subscribe_to_all);
         newpipe = new_pipes [0];
+        newpipe->set_endpoint (addr_);
 
         //  Attach remote end of the pipe to the session object later on.
         session->attach_pipe (new_pipes [1]);
@@ -667,6 +721,145 @@ void zmq::socket_base_t::add_endpoint (const char *addr_, own_t *endpoint_, pipe
     endpoints.insert (endpoints_t::value_type (std::string (addr_), endpoint_pipe_t(endpoint_, pipe)));
 }
 
+void zmq::socket_base_t::connect_inproc (const char *addr_, endpoint_t &peer_)
+{
+    // The total HWM for an inproc connection should be the sum of
+    // the binder's HWM and the connector's HWM.
+    int sndhwm = 0;
+    if (peer_.socket == NULL)
+        sndhwm = options.sndhwm;
+    else if (options.sndhwm != 0 && peer_.options.rcvhwm != 0)
+        sndhwm = options.sndhwm + peer_.options.rcvhwm;
+    int rcvhwm = 0;
+    if (peer_.socket == NULL)
+        rcvhwm = options.rcvhwm;
+    else if (options.rcvhwm != 0 && peer_.options.sndhwm != 0)
+        rcvhwm = options.rcvhwm + peer_.options.sndhwm;
+
+    //  Create a bi-directional pipe to connect the peers.
+    object_t *parents [2] = {this, peer_.socket == NULL ? this : peer_.socket};
+    pipe_t *new_pipes [2] = {NULL, NULL};
+
+    bool conflate = options.conflate &&
+        (options.type == ZMQ_DEALER ||
+         options.type == ZMQ_PULL ||
+         options.type == ZMQ_PUSH ||
+         options.type == ZMQ_PUB ||
+         options.type == ZMQ_SUB);
+
+    int hwms [2] = {conflate? -1 : sndhwm, conflate? -1 : rcvhwm};
+    bool conflates [2] = {conflate, conflate};
+    int rc = pipepair (parents, new_pipes, hwms, conflates);
+    errno_assert (rc == 0);
+
+    if (options.hwm_target_delay > 0) {
+        new_pipes [0]->set_hwm_target (options.hwm_target_delay,
+            options.hwm_min);
+        new_pipes [1]->set_hwm_target (options.hwm_target_delay,
+            options.hwm_min);
+    }
+
+    if (options.warmup) {
+        new_pipes [0]->warmup ();
+        new_pipes [1]->warmup ();
+    }
+
+    new_pipes [0]->set_inproc ();
+    new_pipes [1]->set_inproc ();
+
+    //  Attach local end of the pipe to this socket object.
+    attach_pipe (new_pipes [0]);
+
+    if (!peer_.socket)
+    {
+        endpoint_t endpoint = {this, options};
+        pending_connection_t pending_connection = {endpoint, new_pipes [0], new_pipes [1]};
+        pend_connection (addr_, pending_connection);
+    }
+    else
+    {
+        //  If required, send the identity of the local socket to the peer_.
+        if (peer_.options.recv_identity) {
+
+            msg_t id;
+            rc = id.init_size (options.identity_size);
+            errno_assert (rc == 0);
+            memcpy (id.data (), options.identity, options.identity_size);
+            id.set_flags (msg_t::identity);
+            bool written = new_pipes [0]->write (&id);
+            zmq_assert (written);
+            new_pipes [0]->flush ();
+        }
+
+        //  If required, send the identity of the peer_ to the local socket.
+        if (options.recv_identity) {
+            msg_t id;
+            rc = id.init_size (peer_.options.identity_size);
+            errno_assert (rc == 0);
+            memcpy (id.data (), peer_.options.identity, peer_.options.identity_size);
+            id.set_flags (msg_t::identity);
+            bool written = new_pipes [1]->write (&id);
+            zmq_assert (written);
+            new_pipes [1]->flush ();
+        }
+
+        //  Attach remote end of the pipe to the peer_ socket. Note that peer_'s
+        //  seqnum was incremented in find_endpoint function. We don't need it
+        //  increased here.
+        send_bind (peer_.socket, new_pipes [1], false);
+    }
+
+    // Save last endpoint URI
+    last_endpoint.assign (addr_);
+
+    // remember inproc connections for disconnect
+    new_pipes [0]->set_endpoint (addr_);
+    inprocs.insert (inprocs_t::value_type (std::string (addr_), new_pipes[0]));
+}
+
+void zmq::socket_base_t::register_loopback_endpoint (const char *addr_)
+{
+    //  Security mechanisms and raw sockets need the actual connection.
+    if (!loopback_shortcut || options.mechanism != ZMQ_NULL ||
+          !options.zap_domain.empty () || options.raw_sock)
+        return;
+
+    //  The endpoint is registered under the address the listener is
+    //  actually bound to, which is what connecting peers resolve to.
+    endpoint_t endpoint = {this, options};
+    if (register_endpoint (last_endpoint.c_str (), endpoint) == 0) {
+        inproc_endpoints.push_back (last_endpoint);
+        loopback_endpoints.insert (loopback_endpoints_t::value_type (
+            std::string (addr_), last_endpoint));
+    }
+}
+
+zmq::endpoint_t zmq::socket_base_t::find_loopback_endpoint (
+    const address_t *paddr_)
+{
+    std::string addr;
+    int rc = paddr_->to_string (addr);
+    if (rc != 0) {
+        endpoint_t empty = {NULL, options_t ()};
+        return empty;
+    }
+    endpoint_t peer = find_endpoint (addr.c_str ());
+    if (peer.socket || paddr_->protocol != "tcp" ||
+          !paddr_->resolved.tcp_addr->is_loopback ())
+        return peer;
+
+    //  Listeners bound to all interfaces accept loopback connections too.
+    const uint16_t port = paddr_->resolved.tcp_addr->port ();
+    std::stringstream s;
+    s << "tcp://0.0.0.0:" << port;
+    peer = find_endpoint (s.str ().c_str ());
+    if (peer.socket)
+        return peer;
+    s.str ("");
+    s << "tcp://[::]:" << port;
+    return find_endpoint (s.str ().c_str ());
+}
+
 int zmq::socket_base_t::term_endpoint (const char *addr_)
 {
     //  Check whether the library haven't been shut down yet.
@@ -712,6 +905,15 @@ int zmq::socket_base_t::term_endpoint (const char *addr_)
         return 0;
     }
 
+    //  Disconnect a connection made through the loopback shortcut.
+    std::pair <inprocs_t::iterator, inprocs_t::iterator> shortcuts = inprocs.equal_range (std::string (addr_));
+    if (shortcuts.first != shortcuts.second) {
+        for (inprocs_t::iterator it = shortcuts.first; it != shortcuts.second; ++it)
+            it->second->terminate (true);
+        inprocs.erase (shortcuts.first, shortcuts.second);
+        return 0;
+    }
+
     //  Find the endpoints range (if any) corresponding to the addr_ string.
     std::pair <endpoints_t::iterator, endpoints_t::iterator> range = endpoints.equal_range (std::string (addr_));
     if (range.first == range.second) {
@@ -719,6 +921,14 @@ int zmq::socket_base_t::term_endpoint (const char *addr_)
         return -1;
     }
 
+    //  Stop short-circuiting connections to the listeners being closed.
+    std::pair <loopback_endpoints_t::iterator, loopback_endpoints_t::iterator>
+        loopbacks = loopback_endpoints.equal_range (std::string (addr_));
+    for (loopback_endpoints_t::iterator it = loopbacks.first;
+          it != loopbacks.second; ++it)
+        unregister_endpoint (it->second, this);
+    loopback_endpoints.erase (loopbacks.first, loopbacks.second);
+
     for (endpoints_t::iterator it = range.first; it != range.second; ++it) {
         //  If we have an associated pipe, terminate it.
         if (it->second.second != NULL)
@@ -748,6 +958,14 @@ int zmq::socket_base_t::send (msg_t *msg_, int flags_)
     if (unlikely (rc != 0))
         return -1;
 
+    //  Release the zero-copy messages the I/O threads are done with, and
+    //  defer the release of this one as well.
+    if (release_queue) {
+        release_queue->drain ();
+        if (options.deferred_release)
+            msg_->set_release_queue (release_queue);
+    }
+
     //  Clear any user-visible flags that are set on the message.
     msg_->reset_flags (msg_t::more);
 
@@ -761,6 +979,7 @@ int zmq::socket_base_t::send (msg_t *msg_, int flags_)
         return 0;
     if (unlikely (errno != EAGAIN))
         return -1;
+    record (flight_recorder_t::send_blocked, flags_);
 
     //  In case of non-blocking send we'll simply propagate
     //  the error - including EAGAIN - up the stack.
@@ -808,7 +1027,12 @@ int zmq::socket_base_t::recv (msg_t *msg_, int flags_)
         return -1;
     }
 
-    //  Once every inbound_poll_rate messages check for signals and process
+    //  Release the zero-copy messages the I/O threads are done with, so
+    //  that sockets used mostly for receiving don't hold on to them.
+    if (release_queue)
+        release_queue->drain ();
+
+    //  Once every poll_rate messages check for signals and process
     //  incoming commands. This happens only if we are not polling altogether
     //  because there are messages available all the time. If poll occurs,
     //  ticks is set to zero and thus we avoid this code.
@@ -816,7 +1040,7 @@ int zmq::socket_base_t::recv (msg_t *msg_, int flags_)
     //  Note that 'recv' uses different command throttling algorithm (the one
     //  described above) from the one used by 'send'. This is because counting
     //  ticks is more efficient than doing RDTSC all the time.
-    if (++ticks == inbound_poll_rate) {
+    if (++ticks >= poll_rate) {
         if (unlikely (process_commands (0, false) != 0))
             return -1;
         ticks = 0;
@@ -853,6 +1077,8 @@ int zmq::socket_base_t::recv (msg_t *msg_, int flags_)
         return 0;
     }
 
+    record (flight_recorder_t::recv_blocked, flags_);
+
     //  Compute the time when the timeout should occur.
     //  If the timeout is infinite, don't care.
     int timeout = options.rcvtimeo;
@@ -864,6 +1090,8 @@ int zmq::socket_base_t::recv (msg_t *msg_, int flags_)
     while (true) {
         if (unlikely (process_commands (block ? timeout : 0, false) != 0))
             return -1;
+        if (release_queue)
+            release_queue->drain ();
         rc = xrecv (msg_);
         if (rc == 0) {
             ticks = 0;
@@ -891,6 +1119,13 @@ int zmq::socket_base_t::close ()
 {
     //  Mark the socket as dead
     tag = 0xdeadbeef;
+
+    //  Messages released from now on are deallocated by the thread
+    //  dropping the last reference.
+    if (release_queue) {
+        release_queue->close ();
+        release_queue = NULL;
+    }
     
     //  Transfer the ownership of the socket from this application thread
     //  to the reaper thread which will take care of the rest of shutdown
@@ -912,17 +1147,54 @@ bool zmq::socket_base_t::has_out ()
 
 void zmq::socket_base_t::start_reaping (poller_t *poller_)
 {
-    //  Plug the socket to the reaper thread.
-    poller = poller_;
-    handle = poller->add_fd (mailbox.get_fd (), this);
-    poller->set_pollin (handle);
-
     //  Initialise the termination and check whether it can be deallocated
-    //  immediately.
+    //  immediately. Only if it can't, plug the socket to the reaper thread
+    //  to wait for the commands that complete the termination. As the poller
+    //  is level-triggered, commands that arrived in the meantime are not lost.
+    poller = poller_;
     terminate ();
+    if (!destroyed) {
+        handle = poller->add_fd (mailbox.get_fd (), this);
+        poller->set_pollin (handle);
+        reaper_polled = true;
+    }
     check_destroy ();
 }
 
+void zmq::socket_base_t::set_command_throttle ()
+{
+    poll_rate = options.inbound_poll_rate;
+    if (options.command_delay < 0)
+        max_delay = max_command_delay;
+    else
+        max_delay = options.command_delay * clock_t::rdtsc_per_us ();
+    command_delay = max_delay;
+}
+
+void zmq::socket_base_t::adapt_command_throttle (int commands_)
+{
+    //  Several commands waiting means they have been piling up since the
+    //  last check, so check twice as often. No command waiting means the
+    //  check was wasted, so check half as often. A single command is what
+    //  we are aiming for.
+    if (commands_ > 1) {
+        int min_rate = (options.inbound_poll_rate +
+            command_throttle_range - 1) / command_throttle_range;
+        poll_rate = poll_rate / 2 > min_rate ? poll_rate / 2 : min_rate;
+        uint64_t min_delay = (max_delay +
+            command_throttle_range - 1) / command_throttle_range;
+        command_delay = command_delay / 2 > min_delay ?
+            command_delay / 2 : min_delay;
+    }
+    else
+    if (commands_ == 0) {
+        poll_rate = poll_rate < options.inbound_poll_rate / 2 ?
+            poll_rate * 2 : options.inbound_poll_rate;
+        command_delay = command_delay < max_delay / 2 ?
+            command_delay * 2 : max_delay;
+    }
+}
+
 int zmq::socket_base_t::process_commands (int timeout_, bool throttle_)
 {
     int rc;
@@ -951,7 +1223,7 @@ int zmq::socket_base_t::process_commands (int timeout_, bool throttle_)
             //  Check whether TSC haven't jumped backwards (in case of migration
             //  between CPU cores) and whether certain time have elapsed since
             //  last command processing. If it didn't do nothing.
-            if (tsc >= last_tsc && tsc - last_tsc <= max_command_delay)
+            if (tsc >= last_tsc && tsc - last_tsc <= command_delay)
                 return 0;
             last_tsc = tsc;
         }
@@ -961,11 +1233,16 @@ int zmq::socket_base_t::process_commands (int timeout_, bool throttle_)
     }
 
     //  Process all available commands.
+    int commands = 0;
     while (rc == 0) {
         cmd.destination->process_command (cmd);
+        commands++;
         rc = mailbox.recv (&cmd, 0);
     }
 
+    if (timeout_ == 0 && options.command_adaptive)
+        adapt_command_throttle (commands);
+
     if (errno == EINTR)
         return -1;
 
@@ -999,9 +1276,14 @@ void zmq::socket_base_t::process_term (int linger_)
     //  Unregister all inproc endpoints associated with this socket.
     //  Doing this we make sure that no new pipes from other sockets (inproc)
     //  will be initiated.
-    unregister_endpoints (this);
-
-    //  Ask all attached pipes to terminate.
+    for (inproc_endpoints_t::size_type i = 0; i != inproc_endpoints.size ();
+          i++)
+        unregister_endpoint (inproc_endpoints [i], this);
+    inproc_endpoints.clear ();
+
+    //  Ask all attached pipes to terminate. As all of them are going away,
+    //  forget the inproc connections at once rather than one by one.
+    inprocs.clear ();
     for (pipes_t::size_type i = 0; i != pipes.size (); ++i)
         pipes [i]->terminate (false);
     register_term_acks ((int) pipes.size ());
@@ -1021,6 +1303,12 @@ int zmq::socket_base_t::xsetsockopt (int, const void *, size_t)
     return -1;
 }
 
+int zmq::socket_base_t::xgetsockopt (int, void *, size_t *)
+{
+    errno = EINVAL;
+    return -1;
+}
+
 bool zmq::socket_base_t::xhas_out ()
 {
     return false;
@@ -1088,7 +1376,8 @@ void zmq::socket_base_t::check_destroy ()
     if (destroyed) {
 
         //  Remove the socket from the reaper's poller.
-        poller->rm_fd (handle);
+        if (reaper_polled)
+            poller->rm_fd (handle);
 
         //  Remove the socket from the context.
         destroy_socket (this);
@@ -1125,13 +1414,29 @@ void zmq::socket_base_t::pipe_terminated (pipe_t *pipe_)
     //  Notify the specific socket type about the pipe termination.
     xpipe_terminated (pipe_);
 
-    // Remove pipe from inproc pipes
-    for (inprocs_t::iterator it = inprocs.begin(); it != inprocs.end(); ++it) {
+    //  Remove pipe from inproc pipes. Only the connections to the pipe's
+    //  endpoint have to be searched. The map is emptied in one go when the
+    //  socket starts terminating, so there's nothing to search then.
+    std::pair <inprocs_t::iterator, inprocs_t::iterator> range =
+        inprocs.equal_range (pipe_->get_endpoint ());
+    for (inprocs_t::iterator it = range.first; it != range.second; ++it)
         if (it->second == pipe_) {
-            inprocs.erase(it);
+            inprocs.erase (it);
             break;
         }
-    }    
+
+    //  Forget the pipe of the connecting endpoint it belongs to, if any.
+    //  Its session outlives the pipe when the pipe was dropped or the
+    //  connection has been lost.
+    if (!is_terminating ()) {
+        std::pair <endpoints_t::iterator, endpoints_t::iterator> eps =
+            endpoints.equal_range (pipe_->get_endpoint ());
+        for (endpoints_t::iterator it = eps.first; it != eps.second; ++it)
+            if (it->second.second == pipe_) {
+                it->second.second = NULL;
+                break;
+            }
+    }
 
     //  Remove the pipe from the list of attached pipes and confirm its
     //  termination if we are already shutting down.
@@ -1200,6 +1505,86 @@ int zmq::socket_base_t::monitor (const char *addr_, int events_)
     return rc;
 }
 
+int zmq::socket_base_t::monitor_ring (int events_, int capacity_)
+{
+    if (unlikely (ctx_terminated)) {
+        errno = ETERM;
+        return -1;
+    }
+
+    //  Zero events mask stops pushing events into the ring. The ring itself
+    //  is kept, as I/O threads may still be reporting events.
+    if (events_ == 0) {
+        if (ring && (ring_events & ZMQ_EVENT_MONITOR_STOPPED))
+            ring->push (ZMQ_EVENT_MONITOR_STOPPED, 0, 0);
+        ring_events = 0;
+        return 0;
+    }
+
+    //  The capacity is fixed when the ring is created.
+    if (!ring) {
+        if (capacity_ <= 0 || capacity_ > monitor_ring_max_capacity) {
+            errno = EINVAL;
+            return -1;
+        }
+        ring = new (std::nothrow) monitor_ring_t (capacity_);
+        alloc_assert (ring);
+    }
+    ring_events = events_;
+    return 0;
+}
+
+int zmq::socket_base_t::monitor_ring_recv (zmq_monitor_record_t *records_,
+    int count_)
+{
+    if (unlikely (ctx_terminated)) {
+        errno = ETERM;
+        return -1;
+    }
+    if (!ring || count_ <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    const int nread = ring->pull (records_, count_);
+    if (nread == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    return nread;
+}
+
+int zmq::socket_base_t::monitor_ring_endpoint (uint32_t id_, char *buf_,
+    size_t size_)
+{
+    std::string endpoint;
+    {
+        scoped_lock_t lock (endpoint_sync);
+        if (!ring || id_ >= endpoint_names.size ()) {
+            errno = EINVAL;
+            return -1;
+        }
+        endpoint = endpoint_names [id_];
+    }
+    if (size_ > 0) {
+        const size_t len = std::min (endpoint.size (), size_ - 1);
+        memcpy (buf_, endpoint.data (), len);
+        buf_ [len] = 0;
+    }
+    return (int) endpoint.size ();
+}
+
+uint32_t zmq::socket_base_t::intern_endpoint (const std::string &endpoint_)
+{
+    scoped_lock_t lock (endpoint_sync);
+    endpoint_ids_t::iterator it = endpoint_ids.find (endpoint_);
+    if (it != endpoint_ids.end ())
+        return it->second;
+    const uint32_t id = (uint32_t) endpoint_names.size ();
+    endpoint_names.push_back (endpoint_);
+    endpoint_ids [endpoint_] = id;
+    return id;
+}
+
 void zmq::socket_base_t::set_fd(zmq::fd_t fd_)
 {
     file_desc = fd_;
@@ -1210,107 +1595,127 @@ zmq::fd_t zmq::socket_base_t::fd()
     return file_desc;
 }
 
-void zmq::socket_base_t::event_connected (std::string &addr_, int fd_)
+void zmq::socket_base_t::event_connected (std::string &addr_,
+    uint32_t endpoint_id_, int fd_)
 {
-    if (monitor_events & ZMQ_EVENT_CONNECTED) {
+    if ((monitor_events | ring_events) & ZMQ_EVENT_CONNECTED) {
         zmq_event_t event;
         event.event = ZMQ_EVENT_CONNECTED;
         event.value = fd_;
-        monitor_event (event, addr_);
+        monitor_event (event, addr_, endpoint_id_);
     }
 }
 
-void zmq::socket_base_t::event_connect_delayed (std::string &addr_, int err_)
+void zmq::socket_base_t::event_connect_delayed (std::string &addr_,
+    uint32_t endpoint_id_, int err_)
 {
-    if (monitor_events & ZMQ_EVENT_CONNECT_DELAYED) {
+    if ((monitor_events | ring_events) & ZMQ_EVENT_CONNECT_DELAYED) {
         zmq_event_t event;
         event.event = ZMQ_EVENT_CONNECT_DELAYED;
         event.value = err_;
-        monitor_event (event, addr_);
+        monitor_event (event, addr_, endpoint_id_);
     }
 }
 
-void zmq::socket_base_t::event_connect_retried (std::string &addr_, int interval_)
+void zmq::socket_base_t::event_connect_retried (std::string &addr_,
+    uint32_t endpoint_id_, int interval_)
 {
-    if (monitor_events & ZMQ_EVENT_CONNECT_RETRIED) {
+    if ((monitor_events | ring_events) & ZMQ_EVENT_CONNECT_RETRIED) {
         zmq_event_t event;
         event.event = ZMQ_EVENT_CONNECT_RETRIED;
         event.value = interval_;
-        monitor_event (event, addr_);
+        monitor_event (event, addr_, endpoint_id_);
     }
 }
 
-void zmq::socket_base_t::event_listening (std::string &addr_, int fd_)
+void zmq::socket_base_t::event_listening (std::string &addr_,
+    uint32_t endpoint_id_, int fd_)
 {
-    if (monitor_events & ZMQ_EVENT_LISTENING) {
+    if ((monitor_events | ring_events) & ZMQ_EVENT_LISTENING) {
         zmq_event_t event;
         event.event = ZMQ_EVENT_LISTENING;
         event.value = fd_;
-        monitor_event (event, addr_);
+        monitor_event (event, addr_, endpoint_id_);
     }
 }
 
-void zmq::socket_base_t::event_bind_failed (std::string &addr_, int err_)
+void zmq::socket_base_t::event_bind_failed (std::string &addr_,
+    uint32_t endpoint_id_, int err_)
 {
-    if (monitor_events & ZMQ_EVENT_BIND_FAILED) {
+    if ((monitor_events | ring_events) & ZMQ_EVENT_BIND_FAILED) {
         zmq_event_t event;
         event.event = ZMQ_EVENT_BIND_FAILED;
         event.value = err_;
-        monitor_event (event, addr_);
+        monitor_event (event, addr_, endpoint_id_);
     }
 }
 
-void zmq::socket_base_t::event_accepted (std::string &addr_, int fd_)
+void zmq::socket_base_t::event_accepted (std::string &addr_,
+    uint32_t endpoint_id_, int fd_)
 {
-    if (monitor_events & ZMQ_EVENT_ACCEPTED) {
+    if ((monitor_events | ring_events) & ZMQ_EVENT_ACCEPTED) {
         zmq_event_t event;
         event.event = ZMQ_EVENT_ACCEPTED;
         event.value = fd_;
-        monitor_event (event, addr_);
+        monitor_event (event, addr_, endpoint_id_);
     }
 }
 
-void zmq::socket_base_t::event_accept_failed (std::string &addr_, int err_)
+void zmq::socket_base_t::event_accept_failed (std::string &addr_,
+    uint32_t endpoint_id_, int err_)
 {
-    if (monitor_events & ZMQ_EVENT_ACCEPT_FAILED) {
+    if ((monitor_events | ring_events) & ZMQ_EVENT_ACCEPT_FAILED) {
         zmq_event_t event;
         event.event = ZMQ_EVENT_ACCEPT_FAILED;
         event.value= err_;
-        monitor_event (event, addr_);
+        monitor_event (event, addr_, endpoint_id_);
     }
 }
 
-void zmq::socket_base_t::event_closed (std::string &addr_, int fd_)
+void zmq::socket_base_t::event_closed (std::string &addr_,
+    uint32_t endpoint_id_, int fd_)
 {
-    if (monitor_events & ZMQ_EVENT_CLOSED) {
+    if ((monitor_events | ring_events) & ZMQ_EVENT_CLOSED) {
         zmq_event_t event;
         event.event = ZMQ_EVENT_CLOSED;
         event.value = fd_;
-        monitor_event (event, addr_);
+        monitor_event (event, addr_, endpoint_id_);
     }
 }
         
-void zmq::socket_base_t::event_close_failed (std::string &addr_, int err_)
+void zmq::socket_base_t::event_close_failed (std::string &addr_,
+    uint32_t endpoint_id_, int err_)
 {
-    if (monitor_events & ZMQ_EVENT_CLOSE_FAILED) {
+    if ((monitor_events | ring_events) & ZMQ_EVENT_CLOSE_FAILED) {
         zmq_event_t event;
         event.event = ZMQ_EVENT_CLOSE_FAILED;
         event.value = err_;
-        monitor_event (event, addr_);
+        monitor_event (event, addr_, endpoint_id_);
     }
 }
 
-void zmq::socket_base_t::event_disconnected (std::string &addr_, int fd_)
+void zmq::socket_base_t::event_disconnected (std::string &addr_,
+    uint32_t endpoint_id_, int fd_)
 {
-    if (monitor_events & ZMQ_EVENT_DISCONNECTED) {
+    if ((monitor_events | ring_events) & ZMQ_EVENT_DISCONNECTED) {
         zmq_event_t event;
         event.event = ZMQ_EVENT_DISCONNECTED;
         event.value = fd_;
-        monitor_event (event, addr_);
+        monitor_event (event, addr_, endpoint_id_);
     }
 }
 
-void zmq::socket_base_t::monitor_event (zmq_event_t event_, const std::string& addr_)
+void zmq::socket_base_t::monitor_event (zmq_event_t event_,
+    const std::string& addr_, uint32_t endpoint_id_)
+{
+    if (monitor_events & event_.event)
+        monitor_socket_event (event_, addr_);
+    if (ring_events & event_.event)
+        ring->push (event_.event, event_.value, endpoint_id_);
+}
+
+void zmq::socket_base_t::monitor_socket_event (zmq_event_t event_,
+    const std::string& addr_)
 {
     if (monitor_socket) {
         const uint16_t eid = (uint16_t)event_.event;
@@ -1338,7 +1743,7 @@ void zmq::socket_base_t::stop_monitor()
             zmq_event_t event;
             event.event = ZMQ_EVENT_MONITOR_STOPPED;
             event.value = 0;
-            monitor_event (event, "");
+            monitor_socket_event (event, "");
         }
         zmq_close (monitor_socket);
         monitor_socket = NULL;
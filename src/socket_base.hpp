@@ -22,6 +22,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include <stdarg.h>
 
 #include "own.hpp"
@@ -35,6 +36,7 @@
 #include "stdint.hpp"
 #include "clock.hpp"
 #include "pipe.hpp"
+#include "release_queue.hpp"
 
 extern "C"
 {
@@ -47,6 +49,8 @@ namespace zmq
     class ctx_t;
     class msg_t;
     class pipe_t;
+    class monitor_ring_t;
+    struct address_t;
 
     class socket_base_t :
         public own_t,
@@ -106,20 +110,38 @@ namespace zmq
         void unlock();
 
         int monitor (const char *endpoint_, int events_);
+        int monitor_ring (int events_, int capacity_);
+        int monitor_ring_recv (zmq_monitor_record_t *records_, int count_);
+        int monitor_ring_endpoint (uint32_t id_, char *buf_, size_t size_);
+
+        //  Returns the ID the monitor ring reports the endpoint with,
+        //  assigning one if needed. Endpoints are interned once when they
+        //  are bound or connected, so that reporting events stays cheap.
+        uint32_t intern_endpoint (const std::string &endpoint_);
 
         void set_fd(fd_t fd_);
         fd_t fd();
 
-        void event_connected (std::string &addr_, int fd_);
-        void event_connect_delayed (std::string &addr_, int err_);
-        void event_connect_retried (std::string &addr_, int interval_);
-        void event_listening (std::string &addr_, int fd_);
-        void event_bind_failed (std::string &addr_, int err_);
-        void event_accepted (std::string &addr_, int fd_);
-        void event_accept_failed (std::string &addr_, int err_);
-        void event_closed (std::string &addr_, int fd_);        
-        void event_close_failed (std::string &addr_, int fd_);  
-        void event_disconnected (std::string &addr_, int fd_); 
+        void event_connected (std::string &addr_, uint32_t endpoint_id_,
+            int fd_);
+        void event_connect_delayed (std::string &addr_, uint32_t endpoint_id_,
+            int err_);
+        void event_connect_retried (std::string &addr_, uint32_t endpoint_id_,
+            int interval_);
+        void event_listening (std::string &addr_, uint32_t endpoint_id_,
+            int fd_);
+        void event_bind_failed (std::string &addr_, uint32_t endpoint_id_,
+            int err_);
+        void event_accepted (std::string &addr_, uint32_t endpoint_id_,
+            int fd_);
+        void event_accept_failed (std::string &addr_, uint32_t endpoint_id_,
+            int err_);
+        void event_closed (std::string &addr_, uint32_t endpoint_id_,
+            int fd_);
+        void event_close_failed (std::string &addr_, uint32_t endpoint_id_,
+            int fd_);
+        void event_disconnected (std::string &addr_, uint32_t endpoint_id_,
+            int fd_);
 
     protected:
 
@@ -137,6 +159,10 @@ namespace zmq
         virtual int xsetsockopt (int option_, const void *optval_,
             size_t optvallen_);
 
+        //  Same as above, for retrieving socket type specific options.
+        virtual int xgetsockopt (int option_, void *optval_,
+            size_t *optvallen_);
+
         //  The default implementation assumes that send is not supported.
         virtual bool xhas_out ();
         virtual int xsend (zmq::msg_t *msg_);
@@ -160,10 +186,14 @@ namespace zmq
         void process_destroy ();
 
         // Socket event data dispath
-        void monitor_event (zmq_event_t data_, const std::string& addr_);
+        void monitor_event (zmq_event_t data_, const std::string& addr_,
+            uint32_t endpoint_id_);
 
         // Monitor socket cleanup
         void stop_monitor ();
+
+        //  Sends the event to the monitor socket.
+        void monitor_socket_event (zmq_event_t data_, const std::string& addr_);
         
         // Next assigned name on a zmq_connect() call used by ROUTER and STREAM socket types
         std::string connect_rid;
@@ -181,6 +211,30 @@ namespace zmq
         typedef std::multimap <std::string, pipe_t *> inprocs_t;
         inprocs_t inprocs;
 
+        //  Inproc endpoints this socket is bound to. Kept so that they can
+        //  be unregistered without scanning the context's whole registry.
+        typedef std::vector <std::string> inproc_endpoints_t;
+        inproc_endpoints_t inproc_endpoints;
+
+        //  If true, TCP and IPC connections to sockets of the same context
+        //  use inproc pipes instead (see ZMQ_LOOPBACK_SHORTCUT).
+        bool loopback_shortcut;
+
+        //  Addresses registered for the loopback shortcut, by the endpoint
+        //  they were bound as.
+        typedef std::multimap <std::string, std::string> loopback_endpoints_t;
+        loopback_endpoints_t loopback_endpoints;
+
+        //  Connects to the peer using a pipe pair, the way inproc does.
+        void connect_inproc (const char *addr_, endpoint_t &peer_);
+
+        //  Makes the listener just bound reachable for the loopback
+        //  shortcut, if enabled.
+        void register_loopback_endpoint (const char *addr_);
+
+        //  Finds the socket of this context bound to the address, if any.
+        endpoint_t find_loopback_endpoint (const address_t *paddr_);
+
         //  To be called after processing commands or invoking any command
         //  handlers explicitly. If required, it will deallocate the socket.
         void check_destroy ();
@@ -211,6 +265,13 @@ namespace zmq
         //  Register the pipe with this socket.
         void attach_pipe (zmq::pipe_t *pipe_, bool subscribe_to_all_ = false);
 
+        //  Applies the command throttling options.
+        void set_command_throttle ();
+
+        //  Adjusts adaptive command throttling to the number of commands
+        //  found by a non-blocking check for commands.
+        void adapt_command_throttle (int commands_);
+
         //  Processes commands sent to this socket (if any). If timeout is -1,
         //  returns only after at least one command was processed.
         //  If throttle argument is true, commands are processed at most once
@@ -229,9 +290,11 @@ namespace zmq
         typedef array_t <pipe_t, 3> pipes_t;
         pipes_t pipes;
 
-        //  Reaper's poller and handle of this socket within it.
+        //  Reaper's poller and handle of this socket within it. Sockets that
+        //  can be deallocated right away are never added to the poller.
         poller_t *poller;
         poller_t::handle_t handle;
+        bool reaper_polled;
 
         //  Timestamp of when commands were processed the last time.
         uint64_t last_tsc;
@@ -239,6 +302,15 @@ namespace zmq
         //  Number of messages received since last command processing.
         int ticks;
 
+        //  Command throttling in effect: number of messages received between
+        //  checks for commands and minimal delay between checks on send (in
+        //  CPU ticks), along with the delay set by the options. Adaptive
+        //  throttling varies the first two down to 1/command_throttle_range
+        //  of the configured values.
+        int poll_rate;
+        uint64_t command_delay;
+        uint64_t max_delay;
+
         //  True if the last message received had MORE flag set.
         bool rcvmore;
 
@@ -254,6 +326,22 @@ namespace zmq
         // Bitmask of events being monitored
         int monitor_events;
 
+        //  Monitor ring and the bitmask of events pushed into it. The ring
+        //  lives as long as the socket, as I/O threads may be writing to it.
+        monitor_ring_t *ring;
+        int ring_events;
+
+        //  Interned endpoint names, indexed by their IDs. ID 0 stands for
+        //  events not related to any endpoint.
+        typedef std::map <std::string, uint32_t> endpoint_ids_t;
+        endpoint_ids_t endpoint_ids;
+        std::vector <std::string> endpoint_names;
+        mutex_t endpoint_sync;
+
+        //  Queue of zero-copy messages whose deallocation is deferred to
+        //  this socket's thread. Created once deferred release is enabled.
+        release_queue_t *release_queue;
+
         // Last socket endpoint resolved URI
         std::string last_endpoint;
 
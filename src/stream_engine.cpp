@@ -30,31 +30,41 @@
 #include <fcntl.h>
 #endif
 
+#include <stdlib.h>
 #include <string.h>
 #include <new>
 #include <sstream>
+#include <algorithm>
 
 #include "stream_engine.hpp"
 #include "io_thread.hpp"
 #include "session_base.hpp"
+#include "ctx.hpp"
 #include "v1_encoder.hpp"
 #include "v1_decoder.hpp"
 #include "v2_encoder.hpp"
 #include "v2_decoder.hpp"
+#include "v2_protocol.hpp"
 #include "null_mechanism.hpp"
 #include "plain_mechanism.hpp"
 #include "curve_client.hpp"
 #include "curve_server.hpp"
+#include "curve_aesgcm_client.hpp"
+#include "curve_aesgcm_server.hpp"
 #include "raw_decoder.hpp"
 #include "raw_encoder.hpp"
+#include "length_decoder.hpp"
+#include "delimiter_decoder.hpp"
 #include "config.hpp"
+#include "clock.hpp"
 #include "err.hpp"
 #include "ip.hpp"
 #include "likely.hpp"
 #include "wire.hpp"
 
 zmq::stream_engine_t::stream_engine_t (fd_t fd_, const options_t &options_, 
-                                       const std::string &endpoint_) :
+                                       const std::string &endpoint_,
+                                       uint32_t endpoint_id_) :
     s (fd_),
     inpos (NULL),
     insize (0),
@@ -68,6 +78,7 @@ zmq::stream_engine_t::stream_engine_t (fd_t fd_, const options_t &options_,
     session (NULL),
     options (options_),
     endpoint (endpoint_),
+    endpoint_id (endpoint_id_),
     plugged (false),
     read_msg (&stream_engine_t::read_identity),
     write_msg (&stream_engine_t::write_identity),
@@ -76,10 +87,23 @@ zmq::stream_engine_t::stream_engine_t (fd_t fd_, const options_t &options_,
     mechanism (NULL),
     input_stopped (false),
     output_stopped (false),
-    socket (NULL)
+    batch_buf (NULL),
+    has_batch_next (false),
+    batch_pos (0),
+    has_ping_timer (false),
+    ping_pending (false),
+    pong_pending (false),
+    pong_context_size (0),
+    io_thread (NULL),
+    mid_message (false),
+    socket (NULL),
+    recorder (NULL)
 {
     int rc = tx_msg.init ();
     errno_assert (rc == 0);
+    rc = batch_next.init ();
+    errno_assert (rc == 0);
+    memset (&rtt_stats, 0, sizeof (rtt_stats));
     
     //  Put the socket into non-blocking mode.
     unblock_socket (s);
@@ -141,6 +165,9 @@ zmq::stream_engine_t::~stream_engine_t ()
 
     int rc = tx_msg.close ();
     errno_assert (rc == 0);
+    rc = batch_next.close ();
+    errno_assert (rc == 0);
+    free (batch_buf);
 
     delete encoder;
     delete decoder;
@@ -158,6 +185,12 @@ void zmq::stream_engine_t::plug (io_thread_t *io_thread_,
     zmq_assert (session_);
     session = session_;
     socket = session-> get_socket ();
+    io_thread = io_thread_;
+
+    //  Only the connections of multiplexing sessions are multiplexed.
+    options.tcp_mux = session->is_mux ();
+    recorder = session->get_ctx ()->get_flight_recorder (
+        session->get_tid ());
 
     //  Connect to I/O threads poller object.
     io_object_t::plug (io_thread_);
@@ -169,9 +202,29 @@ void zmq::stream_engine_t::plug (io_thread_t *io_thread_,
         encoder = new (std::nothrow) raw_encoder_t (out_batch_size);
         alloc_assert (encoder);
 
-        decoder = new (std::nothrow) raw_decoder_t (in_batch_size);
+        //  Pick the framing decoder requested by the application.
+        if (options.stream_framing == ZMQ_FRAMING_FIXED)
+            decoder = new (std::nothrow) length_decoder_t (in_batch_size,
+                0, options.stream_frame_size, options.maxmsgsize);
+        else
+        if (options.stream_framing == ZMQ_FRAMING_LENGTH16)
+            decoder = new (std::nothrow) length_decoder_t (in_batch_size,
+                2, 0, options.maxmsgsize);
+        else
+        if (options.stream_framing == ZMQ_FRAMING_LENGTH32)
+            decoder = new (std::nothrow) length_decoder_t (in_batch_size,
+                4, 0, options.maxmsgsize);
+        else
+        if (options.stream_framing == ZMQ_FRAMING_DELIMITER)
+            decoder = new (std::nothrow) delimiter_decoder_t (in_batch_size,
+                options.stream_delimiter, options.maxmsgsize);
+        else
+            decoder = new (std::nothrow) raw_decoder_t (in_batch_size);
         alloc_assert (decoder);
 
+        if (options.warmup)
+            warmup ();
+
         // disable handshaking for raw socket
         handshaking = false;
 
@@ -202,11 +255,29 @@ void zmq::stream_engine_t::plug (io_thread_t *io_thread_,
     in_event ();
 }
 
+void zmq::stream_engine_t::warmup ()
+{
+    encoder->warmup ();
+
+    //  Nothing has been read into the decoder's buffer yet.
+    unsigned char *buffer;
+    size_t size;
+    decoder->get_buffer (&buffer, &size);
+    memset (buffer, 0, size);
+}
+
 void zmq::stream_engine_t::unplug ()
 {
     zmq_assert (plugged);
     plugged = false;
 
+    if (has_ping_timer) {
+        cancel_timer (ping_timer_id);
+        has_ping_timer = false;
+    }
+    if (rtt_stats.peer)
+        io_thread->remove_rtt_stats (options.socket_id, rtt_stats.peer);
+
     //  Cancel all fd subscriptions.
     if (!io_error)
         rm_fd (handle);
@@ -262,6 +333,9 @@ void zmq::stream_engine_t::in_event ()
             return;
         }
 
+        if (recorder)
+            recorder->record (flight_recorder_t::engine_read, this, rc);
+
         //  Adjust input size
         insize = static_cast <size_t> (rc);
     }
@@ -339,6 +413,8 @@ void zmq::stream_engine_t::out_event ()
     //  limited transmission buffer and thus the actual number of bytes
     //  written should be reasonably modest.
     int nbytes = write (outpos, outsize);
+    if (recorder && nbytes > 0)
+        recorder->record (flight_recorder_t::engine_write, this, nbytes);
 
     //  IO error has occurred. We stop waiting for output events.
     //  The engine is not terminated until we detect input error;
@@ -484,6 +560,9 @@ bool zmq::stream_engine_t::handshake ()
                     else
                     if (options.mechanism == ZMQ_PLAIN)
                         memcpy (outpos + outsize, "PLAIN", 5);
+                    else
+                    if (curve_aesgcm_offered ())
+                        memcpy (outpos + outsize, "CURVE-AESGCM", 12);
                     else
                         memcpy (outpos + outsize, "CURVE", 5);
                     outsize += 20;
@@ -498,6 +577,16 @@ bool zmq::stream_engine_t::handshake ()
     //  Position of the revision field in the greeting.
     const size_t revision_pos = 10;
 
+    //  The channels of a multiplexed connection are told apart by means
+    //  of commands, which the older protocol versions don't have.
+    if (options.tcp_mux && (greeting_recv [0] != 0xff ||
+          !(greeting_recv [9] & 0x01) ||
+          greeting_recv [revision_pos] == ZMTP_1_0 ||
+          greeting_recv [revision_pos] == ZMTP_2_0)) {
+        error ();
+        return false;
+    }
+
     //  Is the peer using ZMTP/1.0 with no revision number?
     //  If so, we send and receive rest of identity message
     if (greeting_recv [0] != 0xff || !(greeting_recv [9] & 0x01)) {
@@ -580,10 +669,22 @@ bool zmq::stream_engine_t::handshake ()
         }
 #ifdef HAVE_LIBSODIUM
         else
-        if (memcmp (greeting_recv + 12, "CURVE\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 20) == 0) {
+        if (memcmp (greeting_recv + 12, "CURVE\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 20) == 0
+        ||  memcmp (greeting_recv + 12, "CURVE-AESGCM\0\0\0\0\0\0\0\0", 20) == 0) {
+            //  Messages are protected by AES-GCM only if both peers
+            //  asked for it, otherwise CURVE falls back to crypto_box.
+            const bool aesgcm = curve_aesgcm_offered ()
+                && greeting_recv [12 + 5] == '-';
+            if (options.as_server && aesgcm)
+                mechanism = new (std::nothrow)
+                    curve_aesgcm_server_t (session, peer_address, options);
+            else
             if (options.as_server)
                 mechanism = new (std::nothrow)
                     curve_server_t (session, peer_address, options);
+            else
+            if (aesgcm)
+                mechanism = new (std::nothrow) curve_aesgcm_client_t (options);
             else
                 mechanism = new (std::nothrow) curve_client_t (options);
             alloc_assert (mechanism);
@@ -597,6 +698,9 @@ bool zmq::stream_engine_t::handshake ()
         write_msg = &stream_engine_t::process_handshake_command;
     }
 
+    if (options.warmup)
+        warmup ();
+
     // Start polling for output if necessary.
     if (outsize == 0)
         set_pollout (handle);
@@ -608,6 +712,15 @@ bool zmq::stream_engine_t::handshake ()
     return true;
 }
 
+bool zmq::stream_engine_t::curve_aesgcm_offered ()
+{
+#ifdef HAVE_LIBSODIUM
+    return options.curve_aesgcm && curve_aesgcm_client_t::is_available ();
+#else
+    return false;
+#endif
+}
+
 int zmq::stream_engine_t::read_identity (msg_t *msg_)
 {
     int rc = msg_->init_size (options.identity_size);
@@ -701,6 +814,22 @@ void zmq::stream_engine_t::mechanism_ready ()
 
     read_msg = &stream_engine_t::pull_and_encode;
     write_msg = &stream_engine_t::write_credential;
+
+    //  Coalesce small messages if the peer supports it.
+    if (mechanism->batching ()) {
+        batch_buf = (unsigned char *) malloc (options.batch_size);
+        alloc_assert (batch_buf);
+        if (options.warmup)
+            memset (batch_buf, 0, options.batch_size);
+        read_msg = &stream_engine_t::pull_batch_and_encode;
+    }
+
+    //  Measure the round-trip time if the peer supports it.
+    if (mechanism->pinging ()) {
+        add_timer (options.ping_ivl, ping_timer_id);
+        has_ping_timer = true;
+        ping_pending = true;
+    }
 }
 
 int zmq::stream_engine_t::pull_msg_from_session (msg_t *msg_)
@@ -740,19 +869,151 @@ int zmq::stream_engine_t::pull_and_encode (msg_t *msg_)
 {
     zmq_assert (mechanism != NULL);
 
-    if (session->pull_msg (msg_) == -1)
+    if (unlikely ((ping_pending || pong_pending) && !mid_message))
+        next_ping_command (msg_);
+    else {
+        if (session->pull_msg (msg_) == -1)
+            return -1;
+        mid_message = (msg_->flags () & msg_t::more) != 0;
+    }
+    if (mechanism->encode (msg_) == -1)
+        return -1;
+    return 0;
+}
+
+int zmq::stream_engine_t::pull_batch_and_encode (msg_t *msg_)
+{
+    zmq_assert (mechanism != NULL);
+
+    if (unlikely ((ping_pending || pong_pending) && !mid_message))
+        next_ping_command (msg_);
+    else
+    if (pull_batch (msg_) == -1)
         return -1;
     if (mechanism->encode (msg_) == -1)
         return -1;
     return 0;
 }
 
+//  Returns true if the message can be put into a batch frame.
+static bool batchable (zmq::msg_t *msg_)
+{
+    return msg_->size () <= zmq::v2_protocol_t::batch_msg_max &&
+        !(msg_->flags () & (zmq::msg_t::command | zmq::msg_t::identity |
+            zmq::msg_t::credential));
+}
+
+int zmq::stream_engine_t::pull_batch (msg_t *msg_)
+{
+    //  Start with the message left over by the previous batch, if any.
+    if (has_batch_next) {
+        int rc = msg_->move (batch_next);
+        errno_assert (rc == 0);
+        has_batch_next = false;
+    }
+    else
+    if (session->pull_msg (msg_) == -1)
+        return -1;
+    mid_message = (msg_->flags () & msg_t::more) != 0;
+
+    if (!batchable (msg_))
+        return 0;
+
+    //  Coalesce the messages that are ready to be sent, as long as they
+    //  fit into the batch. A message that is alone is sent as is, so
+    //  that batching never costs anything when there's little traffic.
+    const size_t batch_size = (size_t) options.batch_size;
+    size_t pos = 0;
+    while (session->pull_msg (&batch_next) == 0) {
+        has_batch_next = true;
+        const size_t needed = (pos ? pos : 1 + msg_->size ()) + 1 +
+            batch_next.size ();
+        if (!batchable (&batch_next) || needed > batch_size)
+            break;
+
+        msg_t *msgs [] = {msg_, &batch_next};
+        for (int i = pos ? 1 : 0; i != 2; i++) {
+            const size_t size = msgs [i]->size ();
+            batch_buf [pos] = (unsigned char) size;
+            if (msgs [i]->flags () & msg_t::more)
+                batch_buf [pos] |= 0x80;
+            memcpy (batch_buf + pos + 1, msgs [i]->data (), size);
+            pos += 1 + size;
+        }
+        mid_message = (batch_next.flags () & msg_t::more) != 0;
+        int rc = batch_next.close ();
+        errno_assert (rc == 0);
+        rc = batch_next.init ();
+        errno_assert (rc == 0);
+        has_batch_next = false;
+    }
+
+    if (pos > 0) {
+        int rc = msg_->close ();
+        errno_assert (rc == 0);
+        rc = msg_->init_size (pos);
+        errno_assert (rc == 0);
+        memcpy (msg_->data (), batch_buf, pos);
+        msg_->set_flags (msg_t::batch);
+    }
+    return 0;
+}
+
+int zmq::stream_engine_t::push_batch (msg_t *msg_)
+{
+    const unsigned char *data = (const unsigned char *) msg_->data ();
+    const size_t size = msg_->size ();
+
+    while (batch_pos < size) {
+        const size_t msg_size = data [batch_pos] & 0x7f;
+        if (msg_size > size - batch_pos - 1) {
+            errno = EPROTO;
+            return -1;
+        }
+
+        msg_t msg;
+        int rc = msg.init_size (msg_size);
+        errno_assert (rc == 0);
+        memcpy (msg.data (), data + batch_pos + 1, msg_size);
+        if (data [batch_pos] & 0x80)
+            msg.set_flags (msg_t::more);
+        if (session->push_msg (&msg) == -1) {
+            rc = msg.close ();
+            errno_assert (rc == 0);
+            //  Resume with the same message once the session has room.
+            if (errno == EAGAIN)
+                write_msg = &stream_engine_t::push_batch;
+            return -1;
+        }
+        batch_pos += 1 + msg_size;
+    }
+
+    //  The batch is consumed; the decoder expects an empty message back.
+    batch_pos = 0;
+    int rc = msg_->close ();
+    errno_assert (rc == 0);
+    rc = msg_->init ();
+    errno_assert (rc == 0);
+    write_msg = &stream_engine_t::decode_and_push;
+    return 0;
+}
+
 int zmq::stream_engine_t::decode_and_push (msg_t *msg_)
 {
     zmq_assert (mechanism != NULL);
 
     if (mechanism->decode (msg_) == -1)
         return -1;
+    if (unlikely (msg_->flags () & msg_t::command) &&
+          process_ping_command (msg_))
+        return 0;
+    if (msg_->flags () & msg_t::batch) {
+        if (!mechanism->batching ()) {
+            errno = EPROTO;
+            return -1;
+        }
+        return push_batch (msg_);
+    }
     if (session->push_msg (msg_) == -1) {
         if (errno == EAGAIN)
             write_msg = &stream_engine_t::push_one_then_decode_and_push;
@@ -761,6 +1022,99 @@ int zmq::stream_engine_t::decode_and_push (msg_t *msg_)
     return 0;
 }
 
+void zmq::stream_engine_t::timer_event (int id_)
+{
+    zmq_assert (id_ == ping_timer_id);
+    add_timer (options.ping_ivl, ping_timer_id);
+
+    //  If the previous PING wasn't sent yet, the output is congested
+    //  anyway; the next one will tell how much.
+    ping_pending = true;
+    restart_output ();
+}
+
+void zmq::stream_engine_t::next_ping_command (msg_t *msg_)
+{
+    //  The commands follow the ZMTP 3.1 layout: the command name, then,
+    //  for PING, a time-to-live we don't use and the context to echo.
+    if (pong_pending) {
+        int rc = msg_->init_size (5 + pong_context_size);
+        errno_assert (rc == 0);
+        unsigned char *data = (unsigned char *) msg_->data ();
+        memcpy (data, "\4PONG", 5);
+        memcpy (data + 5, pong_context, pong_context_size);
+        pong_pending = false;
+    }
+    else {
+        int rc = msg_->init_size (5 + 2 + 8);
+        errno_assert (rc == 0);
+        unsigned char *data = (unsigned char *) msg_->data ();
+        memcpy (data, "\4PING", 5);
+        put_uint16 (data + 5, 0);
+        put_uint64 (data + 7, clock_t::now_us ());
+        ping_pending = false;
+    }
+    msg_->set_flags (msg_t::command);
+}
+
+bool zmq::stream_engine_t::process_ping_command (msg_t *msg_)
+{
+    const unsigned char *data = (const unsigned char *) msg_->data ();
+    const size_t size = msg_->size ();
+
+    if (size >= 7 && memcmp (data, "\4PING", 5) == 0) {
+        //  Answer with the peer's context. PINGs arriving before the PONG
+        //  is sent are answered once.
+        pong_context_size = std::min (size - 7, sizeof (pong_context));
+        memcpy (pong_context, data + 7, pong_context_size);
+        pong_pending = true;
+        restart_output ();
+    }
+    else
+    if (size >= 5 && memcmp (data, "\4PONG", 5) == 0) {
+        //  Contexts of other sizes were not sent by us.
+        if (size == 5 + 8) {
+            const uint64_t sent = get_uint64 (data + 5);
+            const uint64_t now = clock_t::now_us ();
+            if (now >= sent)
+                update_rtt (now - sent);
+        }
+    }
+    else
+        return false;
+
+    int rc = msg_->close ();
+    errno_assert (rc == 0);
+    rc = msg_->init ();
+    errno_assert (rc == 0);
+    return true;
+}
+
+void zmq::stream_engine_t::update_rtt (uint64_t rtt_)
+{
+    const uint32_t rtt = rtt_ > 0xffffffff ? 0xffffffff : (uint32_t) rtt_;
+
+    //  Smoothed round-trip time and its variation are computed the way
+    //  TCP does (RFC 6298).
+    if (rtt_stats.samples == 0) {
+        rtt_stats.srtt = rtt;
+        rtt_stats.rttvar = rtt / 2;
+        rtt_stats.min_rtt = rtt;
+    }
+    else {
+        const uint32_t delta = rtt_stats.srtt > rtt ?
+            rtt_stats.srtt - rtt : rtt - rtt_stats.srtt;
+        rtt_stats.rttvar = (uint32_t) ((3 * (uint64_t) rtt_stats.rttvar +
+            delta) / 4);
+        rtt_stats.srtt = (uint32_t) ((7 * (uint64_t) rtt_stats.srtt +
+            rtt) / 8);
+        if (rtt < rtt_stats.min_rtt)
+            rtt_stats.min_rtt = rtt;
+    }
+    rtt_stats.samples++;
+    io_thread->update_rtt_stats (options.socket_id, rtt_stats);
+}
+
 int zmq::stream_engine_t::push_one_then_decode_and_push (msg_t *msg_)
 {
     const int rc = session->push_msg (msg_);
@@ -797,7 +1151,8 @@ void zmq::stream_engine_t::error ()
         terminator.close();
     }
     zmq_assert (session);
-    socket->event_disconnected (endpoint, s);
+    if (socket)
+        socket->event_disconnected (endpoint, endpoint_id, s);
     session->flush ();
     session->engine_error ();
     unplug ();
@@ -834,9 +1189,11 @@ int zmq::stream_engine_t::write (const void *data_, size_t size_)
 
     //  Several errors are OK. When speculative write is being done we may not
     //  be able to write a single byte from the socket. Also, SIGSTOP issued
-    //  by a debugging tool can result in EINTR error.
+    //  by a debugging tool can result in EINTR error. With TCP Fast Open
+    //  the first write starts the connection and may return EINPROGRESS
+    //  if the data could not be queued with the SYN.
     if (nbytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK ||
-          errno == EINTR))
+          errno == EINTR || errno == EINPROGRESS))
         return 0;
 
     //  Signalise peer failure.
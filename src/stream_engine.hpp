@@ -53,7 +53,8 @@ namespace zmq
     public:
 
         stream_engine_t (fd_t fd_, const options_t &options_, 
-                         const std::string &endpoint);
+                         const std::string &endpoint,
+                         uint32_t endpoint_id_);
         ~stream_engine_t ();
 
         //  i_engine interface implementation.
@@ -67,6 +68,7 @@ namespace zmq
         //  i_poll_events interface implementation.
         void in_event ();
         void out_event ();
+        void timer_event (int id_);
 
     private:
 
@@ -82,6 +84,17 @@ namespace zmq
         //  Detects the protocol used by the peer.
         bool handshake ();
 
+        //  Returns true if the greeting asks for AES-GCM protection of
+        //  CURVE messages, which needs both the option and CPU support.
+        //  There is no software fallback: libsodium implements AES-GCM
+        //  with AES-NI and PCLMULQDQ only, and on other CPUs the option
+        //  is ignored and plain CURVE is offered.
+        bool curve_aesgcm_offered ();
+
+        //  Touches the encoder and decoder buffers so that the first
+        //  messages exchanged do not incur page faults.
+        void warmup ();
+
         //  Writes data to the socket. Returns the number of bytes actually
         //  written (even zero is to be considered to be a success). In case
         //  of error or orderly shutdown by the other peer -1 is returned.
@@ -103,9 +116,27 @@ namespace zmq
 
         int write_credential (msg_t *msg_);
         int pull_and_encode (msg_t *msg_);
+        int pull_batch_and_encode (msg_t *msg_);
         int decode_and_push (msg_t *msg_);
         int push_one_then_decode_and_push (msg_t *msg_);
 
+        //  Pulls a message from the session. If more small messages are
+        //  ready to be sent, they are coalesced into a batch frame.
+        int pull_batch (msg_t *msg_);
+
+        //  Pushes the messages of a batch frame to the session.
+        int push_batch (msg_t *msg_);
+
+        //  Builds the PING or PONG command that is due.
+        void next_ping_command (msg_t *msg_);
+
+        //  Handles PING and PONG commands. Returns false if the message
+        //  is not one of them.
+        bool process_ping_command (msg_t *msg_);
+
+        //  Adds a round-trip time sample to the statistics.
+        void update_rtt (uint64_t rtt_);
+
         void mechanism_ready ();
 
         int write_subscription_msg (msg_t *msg_);
@@ -162,6 +193,9 @@ namespace zmq
         // String representation of endpoint
         std::string endpoint;
 
+        //  ID the monitor ring reports the endpoint with.
+        uint32_t endpoint_id;
+
         bool plugged;
 
         int (stream_engine_t::*read_msg) (msg_t *msg_);
@@ -183,9 +217,40 @@ namespace zmq
         //  True iff the engine doesn't have any message to encode.
         bool output_stopped;
 
+        //  Buffer to coalesce small messages in, and the message pulled
+        //  from the session that didn't fit into the last batch.
+        unsigned char *batch_buf;
+        msg_t batch_next;
+        bool has_batch_next;
+
+        //  Offset of the next message to push in the batch being received.
+        size_t batch_pos;
+
+        //  Round-trip time measurement. A PING carries the time it was sent
+        //  at, which the peer echoes back in its PONG. Whether a PING is
+        //  due, and whether a PONG is due along with the context to echo.
+        enum {ping_timer_id = 0x50};
+        bool has_ping_timer;
+        bool ping_pending;
+        bool pong_pending;
+        unsigned char pong_context [16];
+        size_t pong_context_size;
+        zmq_peer_rtt_stats_t rtt_stats;
+
+        //  The I/O thread keeping the round-trip time statistics.
+        zmq::io_thread_t *io_thread;
+
+        //  True iff the last message pulled from the session, or the last
+        //  one in the last batch, has more parts to follow. PINGs and PONGs
+        //  are only sent between messages, never between their parts.
+        bool mid_message;
+
         // Socket
         zmq::socket_base_t *socket;
 
+        //  Flight recorder of the I/O thread, NULL if disabled.
+        flight_recorder_t *recorder;
+
         std::string peer_address;
 
         stream_engine_t (const stream_engine_t&);
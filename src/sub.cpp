@@ -37,10 +37,8 @@ zmq::sub_t::~sub_t ()
 int zmq::sub_t::xsetsockopt (int option_, const void *optval_,
     size_t optvallen_)
 {
-    if (option_ != ZMQ_SUBSCRIBE && option_ != ZMQ_UNSUBSCRIBE) {
-        errno = EINVAL;
-        return -1;
-    }
+    if (option_ != ZMQ_SUBSCRIBE && option_ != ZMQ_UNSUBSCRIBE)
+        return xsub_t::xsetsockopt (option_, optval_, optvallen_);
 
     //  Create the subscription message.
     msg_t msg;
@@ -139,3 +139,48 @@ void zmq::tune_tcp_keepalives (fd_t s_, int keepalive_, int keepalive_cnt_, int
 #endif // ZMQ_HAVE_SO_KEEPALIVE
 #endif // ZMQ_HAVE_WINDOWS
 }
+
+int zmq::get_tcp_incoming_cpu (fd_t s_)
+{
+#ifdef SO_INCOMING_CPU
+    int cpu = -1;
+    socklen_t len = sizeof (cpu);
+    const int rc = getsockopt (s_, SOL_SOCKET, SO_INCOMING_CPU,
+        (char*) &cpu, &len);
+    if (rc != 0)
+        return -1;
+    return cpu;
+#else
+    (void) s_;
+    return -1;
+#endif
+}
+
+void zmq::set_tcp_fastopen_listener (fd_t s_, int qlen_)
+{
+#ifdef TCP_FASTOPEN
+    //  Fast Open is an optimisation only. If the kernel does not support it
+    //  or has it disabled, connections are accepted the usual way.
+    const int rc = setsockopt (s_, IPPROTO_TCP, TCP_FASTOPEN,
+        (char*) &qlen_, sizeof (int));
+    (void) rc;
+#else
+    (void) s_;
+    (void) qlen_;
+#endif
+}
+
+void zmq::set_tcp_fastopen_connect (fd_t s_)
+{
+#ifdef TCP_FASTOPEN_CONNECT
+    //  With this option set, connect () returns immediately and the SYN
+    //  is deferred until the first write, carrying the written data with it.
+    //  Same as above, failure just means plain connect is used.
+    int flag = 1;
+    const int rc = setsockopt (s_, IPPROTO_TCP, TCP_FASTOPEN_CONNECT,
+        (char*) &flag, sizeof (int));
+    (void) rc;
+#else
+    (void) s_;
+#endif
+}
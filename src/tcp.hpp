@@ -37,6 +37,20 @@ namespace zmq
     //  Tunes TCP keep-alives
     void tune_tcp_keepalives (fd_t s_, int keepalive_, int keepalive_cnt_, int keepalive_idle_, int keepalive_intvl_);
 
+    //  Returns the CPU core on which the packets of the connection are
+    //  being processed by the kernel, or -1 if this information is not
+    //  available on the platform.
+    int get_tcp_incoming_cpu (fd_t s_);
+
+    //  Enables TCP Fast Open on the listening socket, allowing up to qlen_
+    //  pending Fast Open requests. No-op if not supported by the platform.
+    void set_tcp_fastopen_listener (fd_t s_, int qlen_);
+
+    //  Makes the subsequent connect () on the socket use TCP Fast Open, i.e.
+    //  the data written first are sent in the SYN segment. No-op if not
+    //  supported by the platform.
+    void set_tcp_fastopen_connect (fd_t s_);
+
 }
 
 #endif 
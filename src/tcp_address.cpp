@@ -17,6 +17,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <new>
 #include <string>
 #include <sstream>
 
@@ -372,7 +373,8 @@ zmq::tcp_address_t::~tcp_address_t ()
 {
 }
 
-int zmq::tcp_address_t::resolve (const char *name_, bool local_, bool ipv6_)
+int zmq::tcp_address_t::split_name (const char *name_,
+    std::string &addr_str_, uint16_t &port_)
 {
     //  Find the ':' at end that separates address from the port number.
     const char *delimiter = strrchr (name_, ':');
@@ -381,28 +383,45 @@ int zmq::tcp_address_t::resolve (const char *name_, bool local_, bool ipv6_)
         return -1;
     }
     //  Separate the address/port.
-    std::string addr_str (name_, delimiter - name_);
+    addr_str_.assign (name_, delimiter - name_);
     std::string port_str (delimiter + 1);
 
     //  Remove square brackets around the address, if any.
-    if (addr_str.size () >= 2 && addr_str [0] == '[' &&
-          addr_str [addr_str.size () - 1] == ']')
-        addr_str = addr_str.substr (1, addr_str.size () - 2);
+    if (addr_str_.size () >= 2 && addr_str_ [0] == '[' &&
+          addr_str_ [addr_str_.size () - 1] == ']')
+        addr_str_ = addr_str_.substr (1, addr_str_.size () - 2);
 
     //  Allow 0 specifically, to detect invalid port error in atoi if not
-    uint16_t port;
     if (port_str == "*" || port_str == "0")
         //  Resolve wildcard to 0 to allow autoselection of port
-        port = 0;
+        port_ = 0;
     else {
         //  Parse the port number (0 is not a valid port).
-        port = (uint16_t) atoi (port_str.c_str ());
-        if (port == 0) {
+        port_ = (uint16_t) atoi (port_str.c_str ());
+        if (port_ == 0) {
             errno = EINVAL;
             return -1;
         }
     }
 
+    return 0;
+}
+
+void zmq::tcp_address_t::set_port (uint16_t port_)
+{
+    if (address.generic.sa_family == AF_INET6)
+        address.ipv6.sin6_port = htons (port_);
+    else
+        address.ipv4.sin_port = htons (port_);
+}
+
+int zmq::tcp_address_t::resolve (const char *name_, bool local_, bool ipv6_)
+{
+    std::string addr_str;
+    uint16_t port;
+    if (split_name (name_, addr_str, port) != 0)
+        return -1;
+
     //  Resolve the IP address.
     int rc;
     if (local_)
@@ -413,14 +432,77 @@ int zmq::tcp_address_t::resolve (const char *name_, bool local_, bool ipv6_)
         return -1;
 
     //  Set the port into the address structure.
-    if (address.generic.sa_family == AF_INET6)
-        address.ipv6.sin6_port = htons (port);
-    else
-        address.ipv4.sin_port = htons (port);
+    set_port (port);
 
     return 0;
 }
 
+int zmq::tcp_address_t::resolve_all (const char *name_, bool ipv6_,
+    std::vector <tcp_address_t*> &addrs_)
+{
+    std::string addr_str;
+    uint16_t port;
+    if (split_name (name_, addr_str, port) != 0)
+        return -1;
+
+    //  Set up the query. Unlike resolve_hostname, both address families
+    //  are asked for natively instead of relying on IPv4-mapped addresses.
+#if defined ZMQ_HAVE_OPENVMS && defined __ia64 && __INITIAL_POINTER_SIZE == 64
+    __addrinfo64 req;
+#else
+    addrinfo req;
+#endif
+    memset (&req, 0, sizeof (req));
+    req.ai_family = ipv6_? AF_UNSPEC: AF_INET;
+    req.ai_socktype = SOCK_STREAM;
+
+#if defined ZMQ_HAVE_OPENVMS && defined __ia64 && __INITIAL_POINTER_SIZE == 64
+    __addrinfo64 *res;
+#else
+    addrinfo *res;
+#endif
+    int rc = getaddrinfo (addr_str.c_str (), NULL, &req, &res);
+    if (rc) {
+        switch (rc) {
+        case EAI_MEMORY:
+            errno = ENOMEM;
+            break;
+        default:
+            errno = EINVAL;
+            break;
+        }
+        return -1;
+    }
+
+    //  Split the results by address family, keeping the resolver's order
+    //  within each family.
+    std::vector <tcp_address_t*> preferred;
+    std::vector <tcp_address_t*> others;
+    for (addrinfo *ai = res; ai; ai = ai->ai_next) {
+        if (ai->ai_family != AF_INET && ai->ai_family != AF_INET6)
+            continue;
+        tcp_address_t *addr = new (std::nothrow) tcp_address_t (
+            ai->ai_addr, (socklen_t) ai->ai_addrlen);
+        alloc_assert (addr);
+        addr->set_port (port);
+        if (preferred.empty () || addr->family () == preferred [0]->family ())
+            preferred.push_back (addr);
+        else
+            others.push_back (addr);
+    }
+    freeaddrinfo (res);
+
+    //  Interleave the families so that a broken path in one of them
+    //  delays the connection by one attempt only.
+    for (size_t i = 0; i < preferred.size () || i < others.size (); i++) {
+        if (i < preferred.size ())
+            addrs_.push_back (preferred [i]);
+        if (i < others.size ())
+            addrs_.push_back (others [i]);
+    }
+    return 0;
+}
+
 int zmq::tcp_address_t::to_string (std::string &addr_)
 {
     if (address.generic.sa_family != AF_INET
@@ -463,6 +545,22 @@ socklen_t zmq::tcp_address_t::addrlen () const
         return (socklen_t) sizeof (address.ipv4);
 }
 
+uint16_t zmq::tcp_address_t::port () const
+{
+    if (address.generic.sa_family == AF_INET6)
+        return ntohs (address.ipv6.sin6_port);
+    else
+        return ntohs (address.ipv4.sin_port);
+}
+
+bool zmq::tcp_address_t::is_loopback () const
+{
+    if (address.generic.sa_family == AF_INET6)
+        return IN6_IS_ADDR_LOOPBACK (&address.ipv6.sin6_addr) != 0;
+    else
+        return (ntohl (address.ipv4.sin_addr.s_addr) >> 24) == 127;
+}
+
 #if defined ZMQ_HAVE_WINDOWS
 unsigned short zmq::tcp_address_t::family () const
 #else
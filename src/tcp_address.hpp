@@ -20,7 +20,11 @@
 #ifndef __ZMQ_TCP_ADDRESS_HPP_INCLUDED__
 #define __ZMQ_TCP_ADDRESS_HPP_INCLUDED__
 
+#include <string>
+#include <vector>
+
 #include "platform.hpp"
+#include "stdint.hpp"
 
 #if defined ZMQ_HAVE_WINDOWS
 #include "windows.hpp"
@@ -46,6 +50,14 @@ namespace zmq
         //  If 'ipv6' is true, the name may resolve to IPv6 address.
         int resolve (const char *name_, bool local_, bool ipv6_);
 
+        //  Resolves the remote hostname into all the addresses it maps to
+        //  and appends them to 'addrs_'. Address families are interleaved,
+        //  starting with the one preferred by the resolver, as required
+        //  for racing connections (RFC 8305). If 'ipv6' is true, both IPv6
+        //  and IPv4 addresses are returned. Caller owns the new objects.
+        static int resolve_all (const char *name_, bool ipv6_,
+            std::vector <tcp_address_t*> &addrs_);
+
         //  The opposite to resolve()
         virtual int to_string (std::string &addr_);
 
@@ -57,7 +69,16 @@ namespace zmq
         const sockaddr *addr () const;
         socklen_t addrlen () const;
 
+        //  Returns the port number in host byte order.
+        uint16_t port () const;
+
+        //  Returns true if the address belongs to the loopback interface.
+        bool is_loopback () const;
+
     protected:
+        static int split_name (const char *name_, std::string &addr_str_,
+            uint16_t &port_);
+        void set_port (uint16_t port_);
         int resolve_nic_name (const char *nic_, bool ipv6_);
         int resolve_interface (const char *interface_, bool ipv6_);
         int resolve_hostname (const char *hostname_, bool ipv6_);
@@ -53,25 +53,34 @@ zmq::tcp_connecter_t::tcp_connecter_t (class io_thread_t *io_thread_,
       const address_t *addr_, bool delayed_start_) :
     own_t (io_thread_, options_),
     io_object_t (io_thread_),
+    io_thread (io_thread_),
     addr (addr_),
-    s (retired_fd),
-    handle_valid (false),
+    next_addr (0),
     delayed_start (delayed_start_),
     timer_started (false),
+    stagger_timer_started (false),
     session (session_),
     current_reconnect_ivl(options.reconnect_ivl)
 {
     zmq_assert (addr);
     zmq_assert (addr->protocol == "tcp");
     addr->to_string (endpoint);
+    endpoint_id = addr->endpoint_id;
     socket = session-> get_socket();
+
+    //  Race the connections to all the addresses of the peer if these
+    //  are known, otherwise use just the primary one.
+    if (addr->tcp_addrs.empty ())
+        addrs.push_back (addr->resolved.tcp_addr);
+    else
+        addrs.assign (addr->tcp_addrs.begin (), addr->tcp_addrs.end ());
 }
 
 zmq::tcp_connecter_t::~tcp_connecter_t ()
 {
     zmq_assert (!timer_started);
-    zmq_assert (!handle_valid);
-    zmq_assert (s == retired_fd);
+    zmq_assert (!stagger_timer_started);
+    zmq_assert (attempts.empty ());
 }
 
 void zmq::tcp_connecter_t::process_plug ()
@@ -89,99 +98,153 @@ void zmq::tcp_connecter_t::process_term (int linger_)
         timer_started = false;
     }
 
-    if (handle_valid) {
-        rm_fd (handle);
-        handle_valid = false;
+    if (stagger_timer_started) {
+        cancel_timer (stagger_timer_id);
+        stagger_timer_started = false;
     }
 
-    if (s != retired_fd)
-        close ();
+    cancel_attempts ();
 
     own_t::process_term (linger_);
 }
 
-void zmq::tcp_connecter_t::in_event ()
-{
-    //  We are not polling for incoming data, so we are actually called
-    //  because of error here. However, we can get error on out event as well
-    //  on some platforms, so we'll simply handle both events in the same way.
-    out_event ();
-}
-
-void zmq::tcp_connecter_t::out_event ()
+void zmq::tcp_connecter_t::timer_event (int id_)
 {
-    fd_t fd = connect ();
-    rm_fd (handle);
-    handle_valid = false;
-
-    //  Handle the error condition by attempt to reconnect.
-    if (fd == retired_fd) {
-        close ();
-        add_reconnect_timer();
-        return;
+    if (id_ == reconnect_timer_id) {
+        timer_started = false;
+        start_connecting ();
+    }
+    else {
+        zmq_assert (id_ == stagger_timer_id);
+        stagger_timer_started = false;
+        start_attempt ();
     }
-
-    tune_tcp_socket (fd);
-    tune_tcp_keepalives (fd, options.tcp_keepalive, options.tcp_keepalive_cnt, options.tcp_keepalive_idle, options.tcp_keepalive_intvl);
-
-    // remember our fd for ZMQ_SRCFD in messages
-    socket->set_fd(fd);
-
-    //  Create the engine object for this connection.
-    stream_engine_t *engine = new (std::nothrow)
-        stream_engine_t (fd, options, endpoint);
-    alloc_assert (engine);
-
-    //  Attach the engine to the corresponding session object.
-    send_attach (session, engine);
-
-    //  Shut the connecter down.
-    terminate ();
-
-    socket->event_connected (endpoint, fd);
 }
 
-void zmq::tcp_connecter_t::timer_event (int id_)
+void zmq::tcp_connecter_t::start_connecting ()
 {
-    zmq_assert (id_ == reconnect_timer_id);
-    timer_started = false;
-    start_connecting ();
+    next_addr = 0;
+    start_attempt ();
 }
 
-void zmq::tcp_connecter_t::start_connecting ()
+void zmq::tcp_connecter_t::start_attempt ()
 {
+    zmq_assert (next_addr < addrs.size ());
+    attempt_t *attempt = new (std::nothrow)
+        attempt_t (io_thread, this, addrs [next_addr++]);
+    alloc_assert (attempt);
+
     //  Open the connecting socket.
-    int rc = open ();
+    int rc = attempt->open ();
 
     //  Connect may succeed in synchronous manner.
     if (rc == 0) {
-        handle = add_fd (s);
-        handle_valid = true;
-        out_event ();
+        attempts.push_back (attempt);
+        attempt_completed (attempt);
     }
 
     //  Connection establishment may be delayed. Poll for its completion.
     else
     if (rc == -1 && errno == EINPROGRESS) {
-        handle = add_fd (s);
-        handle_valid = true;
-        set_pollout (handle);
-        socket->event_connect_delayed (endpoint, zmq_errno());
+        attempts.push_back (attempt);
+        attempt->start_polling ();
+        if (socket)
+            socket->event_connect_delayed (endpoint, endpoint_id, zmq_errno());
+
+        //  Give the attempt a head start before racing it against
+        //  the connection to the next address (RFC 8305).
+        if (next_addr < addrs.size ()) {
+            add_timer (options.tcp_connect_stagger, stagger_timer_id);
+            stagger_timer_started = true;
+        }
     }
 
-    //  Handle any other error condition by eventual reconnect.
+    //  Handle any other error condition by trying the next address
+    //  or eventual reconnect.
     else {
-        if (s != retired_fd)
-            close ();
+        delete attempt;
+        attempt_failed ();
+    }
+}
+
+void zmq::tcp_connecter_t::attempt_completed (attempt_t *attempt_)
+{
+    for (attempts_t::iterator it = attempts.begin (); it != attempts.end ();
+          ++it)
+        if (*it == attempt_) {
+            attempts.erase (it);
+            break;
+        }
+
+    fd_t fd = attempt_->connect ();
+    delete attempt_;
+
+    if (fd == retired_fd)
+        attempt_failed ();
+    else
+        connected (fd);
+}
+
+void zmq::tcp_connecter_t::attempt_failed ()
+{
+    //  There's no point in waiting for the stagger timer once
+    //  the attempt has failed. Try the next address straight away.
+    if (next_addr < addrs.size ()) {
+        if (stagger_timer_started) {
+            cancel_timer (stagger_timer_id);
+            stagger_timer_started = false;
+        }
+        start_attempt ();
+    }
+    else
+    if (attempts.empty ())
         add_reconnect_timer ();
+}
+
+void zmq::tcp_connecter_t::cancel_attempts ()
+{
+    for (attempts_t::size_type i = 0; i != attempts.size (); i++)
+        delete attempts [i];
+    attempts.clear ();
+}
+
+void zmq::tcp_connecter_t::connected (fd_t fd_)
+{
+    //  The first connection to complete wins. Abort all the others.
+    if (stagger_timer_started) {
+        cancel_timer (stagger_timer_id);
+        stagger_timer_started = false;
     }
+    cancel_attempts ();
+
+    tune_tcp_socket (fd_);
+    tune_tcp_keepalives (fd_, options.tcp_keepalive, options.tcp_keepalive_cnt, options.tcp_keepalive_idle, options.tcp_keepalive_intvl);
+
+    // remember our fd for ZMQ_SRCFD in messages
+    if (socket)
+        socket->set_fd(fd_);
+
+    //  Create the engine object for this connection.
+    stream_engine_t *engine = new (std::nothrow)
+        stream_engine_t (fd_, options, endpoint, endpoint_id);
+    alloc_assert (engine);
+
+    //  Attach the engine to the corresponding session object.
+    send_attach (session, engine);
+
+    //  Shut the connecter down.
+    terminate ();
+
+    if (socket)
+        socket->event_connected (endpoint, endpoint_id, fd_);
 }
 
 void zmq::tcp_connecter_t::add_reconnect_timer()
 {
     int rc_ivl = get_new_reconnect_ivl();
     add_timer (rc_ivl, reconnect_timer_id);
-    socket->event_connect_retried (endpoint, rc_ivl);
+    if (socket)
+        socket->event_connect_retried (endpoint, endpoint_id, rc_ivl);
     timer_started = true;
 }
 
@@ -205,12 +268,56 @@ int zmq::tcp_connecter_t::get_new_reconnect_ivl ()
     return this_interval;
 }
 
-int zmq::tcp_connecter_t::open ()
+zmq::tcp_connecter_t::attempt_t::attempt_t (io_thread_t *io_thread_,
+      tcp_connecter_t *connecter_, const tcp_address_t *addr_) :
+    io_object_t (io_thread_),
+    connecter (connecter_),
+    addr (addr_),
+    s (retired_fd),
+    handle_valid (false)
+{
+}
+
+zmq::tcp_connecter_t::attempt_t::~attempt_t ()
+{
+    if (handle_valid) {
+        rm_fd (handle);
+        handle_valid = false;
+    }
+
+    if (s != retired_fd)
+        close ();
+}
+
+void zmq::tcp_connecter_t::attempt_t::start_polling ()
+{
+    zmq_assert (!handle_valid);
+    handle = add_fd (s);
+    handle_valid = true;
+    set_pollout (handle);
+}
+
+void zmq::tcp_connecter_t::attempt_t::in_event ()
+{
+    //  We are not polling for incoming data, so we are actually called
+    //  because of error here. However, we can get error on out event as well
+    //  on some platforms, so we'll simply handle both events in the same way.
+    out_event ();
+}
+
+void zmq::tcp_connecter_t::attempt_t::out_event ()
+{
+    rm_fd (handle);
+    handle_valid = false;
+    connecter->attempt_completed (this);
+}
+
+int zmq::tcp_connecter_t::attempt_t::open ()
 {
     zmq_assert (s == retired_fd);
 
     //  Create the socket.
-    s = open_socket (addr->resolved.tcp_addr->family (), SOCK_STREAM, IPPROTO_TCP);
+    s = open_socket (addr->family (), SOCK_STREAM, IPPROTO_TCP);
 #ifdef ZMQ_HAVE_WINDOWS
     if (s == INVALID_SOCKET) {
         errno = wsa_error_to_errno (WSAGetLastError ());
@@ -223,30 +330,34 @@ int zmq::tcp_connecter_t::open ()
 
     //  On some systems, IPv4 mapping in IPv6 sockets is disabled by default.
     //  Switch it on in such cases.
-    if (addr->resolved.tcp_addr->family () == AF_INET6)
+    if (addr->family () == AF_INET6)
         enable_ipv4_mapping (s);
 
     // Set the IP Type-Of-Service priority for this socket
-    if (options.tos != 0)
-        set_ip_type_of_service (s, options.tos);
+    if (connecter->options.tos != 0)
+        set_ip_type_of_service (s, connecter->options.tos);
 
     // Set the socket to non-blocking mode so that we get async connect().
     unblock_socket (s);
 
     //  Set the socket buffer limits for the underlying socket.
-    if (options.sndbuf != 0)
-        set_tcp_send_buffer (s, options.sndbuf);
-    if (options.rcvbuf != 0)
-        set_tcp_receive_buffer (s, options.rcvbuf);
+    if (connecter->options.sndbuf != 0)
+        set_tcp_send_buffer (s, connecter->options.sndbuf);
+    if (connecter->options.rcvbuf != 0)
+        set_tcp_receive_buffer (s, connecter->options.rcvbuf);
 
     // Set the IP Type-Of-Service for the underlying socket
-    if (options.tos != 0)
-        set_ip_type_of_service (s, options.tos);
+    if (connecter->options.tos != 0)
+        set_ip_type_of_service (s, connecter->options.tos);
+
+    //  Defer the SYN so that the greeting written by the engine rides in it.
+    if (connecter->options.tcp_fastopen)
+        set_tcp_fastopen_connect (s);
 
     //  Connect to the remote peer.
     int rc = ::connect (
-        s, addr->resolved.tcp_addr->addr (),
-        addr->resolved.tcp_addr->addrlen ());
+        s, addr->addr (),
+        addr->addrlen ());
 
     //  Connect was successfull immediately.
     if (rc == 0)
@@ -267,7 +378,7 @@ int zmq::tcp_connecter_t::open ()
     return -1;
 }
 
-zmq::fd_t zmq::tcp_connecter_t::connect ()
+zmq::fd_t zmq::tcp_connecter_t::attempt_t::connect ()
 {
     //  Async connect has finished. Check whether an error occurred
     int err = 0;
@@ -321,7 +432,7 @@ zmq::fd_t zmq::tcp_connecter_t::connect ()
     return result;
 }
 
-void zmq::tcp_connecter_t::close ()
+void zmq::tcp_connecter_t::attempt_t::close ()
 {
     zmq_assert (s != retired_fd);
 #ifdef ZMQ_HAVE_WINDOWS
@@ -331,6 +442,8 @@ void zmq::tcp_connecter_t::close ()
     int rc = ::close (s);
     errno_assert (rc == 0);
 #endif
-    socket->event_closed (endpoint, s);
+    if (connecter->socket)
+        connecter->socket->event_closed (connecter->endpoint,
+            connecter->endpoint_id, s);
     s = retired_fd;
 }
@@ -20,6 +20,8 @@
 #ifndef __TCP_CONNECTER_HPP_INCLUDED__
 #define __TCP_CONNECTER_HPP_INCLUDED__
 
+#include <vector>
+
 #include "fd.hpp"
 #include "own.hpp"
 #include "stdint.hpp"
@@ -31,6 +33,7 @@ namespace zmq
 
     class io_thread_t;
     class session_base_t;
+    class tcp_address_t;
     struct address_t;
 
     class tcp_connecter_t : public own_t, public io_object_t
@@ -49,18 +52,89 @@ namespace zmq
         //  ID of the timer used to delay the reconnection.
         enum {reconnect_timer_id = 1};
 
+        //  ID of the timer used to delay the connection attempt
+        //  to the next address of the peer.
+        enum {stagger_timer_id = 2};
+
+        //  Connection attempt to a single address of the peer. If the peer
+        //  has several addresses, attempts to them can run in parallel,
+        //  each one polling its own socket.
+        class attempt_t : public io_object_t
+        {
+        public:
+
+            attempt_t (zmq::io_thread_t *io_thread_,
+                tcp_connecter_t *connecter_, const tcp_address_t *addr_);
+
+            //  Destroying the attempt aborts the connection in progress.
+            ~attempt_t ();
+
+            //  Open TCP connecting socket. Returns -1 in case of error,
+            //  0 if connect was successfull immediately. Returns -1 with
+            //  EINPROGRESS errno if async connect was launched.
+            int open ();
+
+            //  Poll the socket for completion of the async connect.
+            void start_polling ();
+
+            //  Get the file descriptor of newly created connection. Returns
+            //  retired_fd if the connection was unsuccessfull.
+            fd_t connect ();
+
+        private:
+
+            //  Handlers for I/O events.
+            void in_event ();
+            void out_event ();
+
+            //  Close the connecting socket.
+            void close ();
+
+            tcp_connecter_t *connecter;
+
+            //  Address to connect to. Owned by session_base_t.
+            const tcp_address_t *addr;
+
+            //  Underlying socket.
+            fd_t s;
+
+            //  Handle corresponding to the connecting socket.
+            handle_t handle;
+
+            //  If true file descriptor is registered with the poller and
+            //  'handle' contains valid value.
+            bool handle_valid;
+
+            attempt_t (const attempt_t&);
+            const attempt_t &operator = (const attempt_t&);
+        };
+
         //  Handlers for incoming commands.
         void process_plug ();
         void process_term (int linger_);
 
         //  Handlers for I/O events.
-        void in_event ();
-        void out_event ();
         void timer_event (int id_);
 
         //  Internal function to start the actual connection establishment.
         void start_connecting ();
 
+        //  Starts connecting to the next address of the peer.
+        void start_attempt ();
+
+        //  Invoked when the attempt has completed, successfully or not.
+        void attempt_completed (attempt_t *attempt_);
+
+        //  Moves on to the next address, if any, or schedules reconnection
+        //  once all the attempts have failed.
+        void attempt_failed ();
+
+        //  Aborts all the attempts in progress.
+        void cancel_attempts ();
+
+        //  Creates the engine for the connected socket and shuts down.
+        void connected (fd_t fd_);
+
         //  Internal function to add a reconnect timer
         void add_reconnect_timer();
 
@@ -69,30 +143,21 @@ namespace zmq
         //  Returns the currently used interval
         int get_new_reconnect_ivl ();
 
-        //  Open TCP connecting socket. Returns -1 in case of error,
-        //  0 if connect was successfull immediately. Returns -1 with
-        //  EAGAIN errno if async connect was launched.
-        int open ();
-
-        //  Close the connecting socket.
-        void close ();
-
-        //  Get the file descriptor of newly created connection. Returns
-        //  retired_fd if the connection was unsuccessfull.
-        fd_t connect ();
+        //  I/O thread the connecter runs in.
+        zmq::io_thread_t *io_thread;
 
         //  Address to connect to. Owned by session_base_t.
         const address_t *addr;
 
-        //  Underlying socket.
-        fd_t s;
+        //  Addresses of the peer, in the order they are tried.
+        std::vector <const tcp_address_t*> addrs;
 
-        //  Handle corresponding to the listening socket.
-        handle_t handle;
+        //  Index of the next address to try.
+        std::vector <const tcp_address_t*>::size_type next_addr;
 
-        //  If true file descriptor is registered with the poller and 'handle'
-        //  contains valid value.
-        bool handle_valid;
+        //  Connection attempts in progress.
+        typedef std::vector <attempt_t*> attempts_t;
+        attempts_t attempts;
 
         //  If true, connecter is waiting a while before trying to connect.
         const bool delayed_start;
@@ -100,6 +165,9 @@ namespace zmq
         //  True iff a timer has been started.
         bool timer_started;
 
+        //  True iff the stagger timer has been started.
+        bool stagger_timer_started;
+
         //  Reference to the session we belong to.
         zmq::session_base_t *session;
 
@@ -109,6 +177,9 @@ namespace zmq
         // String representation of endpoint to connect to
         std::string endpoint;
 
+        //  ID the monitor ring reports the endpoint with.
+        uint32_t endpoint_id;
+
         // Socket
         zmq::socket_base_t *socket;
 
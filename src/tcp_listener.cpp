@@ -27,6 +27,7 @@
 #include "stream_engine.hpp"
 #include "io_thread.hpp"
 #include "session_base.hpp"
+#include "mux.hpp"
 #include "config.hpp"
 #include "err.hpp"
 #include "ip.hpp"
@@ -54,7 +55,8 @@ zmq::tcp_listener_t::tcp_listener_t (io_thread_t *io_thread_,
     own_t (io_thread_, options_),
     io_object_t (io_thread_),
     s (retired_fd),
-    socket (socket_)
+    socket (socket_),
+    endpoint_id (0)
 {
 }
 
@@ -84,7 +86,7 @@ void zmq::tcp_listener_t::in_event ()
     //  If connection was reset by the peer in the meantime, just ignore it.
     //  TODO: Handle specific errors like ENFILE/EMFILE etc.
     if (fd == retired_fd) {
-        socket->event_accept_failed (endpoint, zmq_errno());
+        socket->event_accept_failed (endpoint, endpoint_id, zmq_errno());
         return;
     }
 
@@ -96,22 +98,41 @@ void zmq::tcp_listener_t::in_event ()
 
     //  Create the engine object for this connection.
     stream_engine_t *engine = new (std::nothrow)
-        stream_engine_t (fd, options, endpoint);
+        stream_engine_t (fd, options, endpoint, endpoint_id);
     alloc_assert (engine);
 
-    //  Choose I/O thread to run connecter in. Given that we are already
-    //  running in an I/O thread, there must be at least one available.
-    io_thread_t *io_thread = choose_io_thread (options.affinity);
+    //  Choose I/O thread to run connecter in. If requested, prefer the
+    //  I/O thread associated with the CPU core the kernel delivers the
+    //  connection's packets on, so that the packets are produced and
+    //  consumed on the same core. Given that we are already running in
+    //  an I/O thread, there must be at least one available.
+    io_thread_t *io_thread = NULL;
+    if (options.tcp_incoming_cpu) {
+        const int cpu = get_tcp_incoming_cpu (fd);
+        if (cpu >= 0)
+            io_thread = choose_io_thread_for_cpu (cpu, options.affinity);
+    }
+    if (!io_thread)
+        io_thread = choose_io_thread (options.affinity);
     zmq_assert (io_thread);
 
-    //  Create and launch a session object.
-    session_base_t *session = session_base_t::create (io_thread, false, socket,
-        options, NULL);
-    errno_assert (session);
+    //  Create and launch a session object. Multiplexed connections get a
+    //  session launching one for each channel the peer opens.
+    session_base_t *session = NULL;
+    if (options.tcp_mux && !options.raw_sock) {
+        session = new (std::nothrow) mux_t (io_thread, false, socket,
+            options, NULL);
+        alloc_assert (session);
+    }
+    else {
+        session = session_base_t::create (io_thread, false, socket,
+            options, NULL);
+        errno_assert (session);
+    }
     session->inc_seqnum ();
     launch_child (session);
     send_attach (session, engine, false);
-    socket->event_accepted (endpoint, fd);
+    socket->event_accepted (endpoint, endpoint_id, fd);
 }
 
 void zmq::tcp_listener_t::close ()
@@ -124,7 +145,7 @@ void zmq::tcp_listener_t::close ()
     int rc = ::close (s);
     errno_assert (rc == 0);
 #endif
-    socket->event_closed (endpoint, s);
+    socket->event_closed (endpoint, endpoint_id, s);
     s = retired_fd;
 }
 
@@ -227,6 +248,10 @@ int zmq::tcp_listener_t::set_address (const char *addr_)
         goto error;
 #endif
 
+    //  Accept data carried in the SYN segment if requested.
+    if (options.tcp_fastopen)
+        set_tcp_fastopen_listener (s, options.backlog);
+
     //  Listen for incomming connections.
     rc = listen (s, options.backlog);
 #ifdef ZMQ_HAVE_WINDOWS
@@ -239,7 +264,11 @@ int zmq::tcp_listener_t::set_address (const char *addr_)
         goto error;
 #endif
 
-    socket->event_listening (endpoint, s);
+    //  Report events with the port a wildcard address was bound to.
+    get_address (endpoint);
+    endpoint_id = socket->intern_endpoint (endpoint);
+
+    socket->event_listening (endpoint, endpoint_id, s);
     return 0;
 
 error:
@@ -80,6 +80,9 @@ namespace zmq
        // String representation of endpoint to bind to
         std::string endpoint;
 
+        //  ID the monitor ring reports the endpoint with.
+        uint32_t endpoint_id;
+
         tcp_listener_t (const tcp_listener_t&);
         const tcp_listener_t &operator = (const tcp_listener_t&);
     };
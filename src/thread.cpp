@@ -59,6 +59,13 @@ void zmq::thread_t::stop ()
     win_assert (rc2 != 0);
 }
 
+int zmq::thread_t::set_cpus (const std::vector <int> &,
+    std::vector <int> &cpus_out_)
+{
+    cpus_out_.clear ();
+    return 0;
+}
+
 #else
 
 #include <signal.h>
@@ -97,6 +104,36 @@ void zmq::thread_t::stop ()
     posix_assert (rc);
 }
 
+int zmq::thread_t::set_cpus (const std::vector <int> &cpus_,
+    std::vector <int> &cpus_out_)
+{
+    cpus_out_.clear ();
+#if defined ZMQ_HAVE_LINUX
+    cpu_set_t set;
+    CPU_ZERO (&set);
+    for (std::vector <int>::size_type i = 0; i != cpus_.size (); i++)
+        if (cpus_ [i] >= 0 && cpus_ [i] < CPU_SETSIZE)
+            CPU_SET (cpus_ [i], &set);
+
+    //  If the cores can't be used, the thread keeps running wherever it
+    //  was allowed to before.
+    const int set_rc = pthread_setaffinity_np (descriptor, sizeof (set),
+        &set);
+    int rc = pthread_getaffinity_np (descriptor, sizeof (set), &set);
+    posix_assert (rc);
+    for (int cpu = 0; cpu != CPU_SETSIZE; cpu++)
+        if (CPU_ISSET (cpu, &set))
+            cpus_out_.push_back (cpu);
+    if (set_rc != 0) {
+        errno = set_rc;
+        return -1;
+    }
+#else
+    (void) cpus_;
+#endif
+    return 0;
+}
+
 #endif
 
 
@@ -22,6 +22,8 @@
 
 #include "platform.hpp"
 
+#include <vector>
+
 #ifdef ZMQ_HAVE_WINDOWS
 #include "windows.hpp"
 #else
@@ -55,6 +57,14 @@ namespace zmq
         //  Waits for thread termination.
         void stop ();
 
+        //  Restricts the running thread to the CPU cores listed and stores
+        //  the cores the thread is allowed to run on afterwards in cpus_out_,
+        //  which stays empty if the OS doesn't support thread affinity.
+        //  Returns -1 and sets errno if the thread can't be restricted to
+        //  the cores, e.g. because they are outside the process' cpuset.
+        int set_cpus (const std::vector <int> &cpus_,
+            std::vector <int> &cpus_out_);
+
         //  These are internal members. They should be private, however then
         //  they would not be accessible from the main C routine of the thread.
         thread_fn *tfn;
@@ -44,7 +44,8 @@ zmq::tipc_listener_t::tipc_listener_t (io_thread_t *io_thread_,
     own_t (io_thread_, options_),
     io_object_t (io_thread_),
     s (retired_fd),
-    socket (socket_)
+    socket (socket_),
+    endpoint_id (0)
 {
 }
 
@@ -74,12 +75,12 @@ void zmq::tipc_listener_t::in_event ()
     //  If connection was reset by the peer in the meantime, just ignore it.
     //  TODO: Handle specific errors like ENFILE/EMFILE etc.
     if (fd == retired_fd) {
-        socket->event_accept_failed (endpoint, zmq_errno());
+        socket->event_accept_failed (endpoint, endpoint_id, zmq_errno());
         return;
     }
 
     //  Create the engine object for this connection.
-    stream_engine_t *engine = new (std::nothrow) stream_engine_t (fd, options, endpoint);
+    stream_engine_t *engine = new (std::nothrow) stream_engine_t (fd, options, endpoint, endpoint_id);
     alloc_assert (engine);
 
     //  Choose I/O thread to run connecter in. Given that we are already
@@ -94,7 +95,7 @@ void zmq::tipc_listener_t::in_event ()
     session->inc_seqnum ();
     launch_child (session);
     send_attach (session, engine, false);
-    socket->event_accepted (endpoint, fd);
+    socket->event_accepted (endpoint, endpoint_id, fd);
 }
 
 int zmq::tipc_listener_t::get_address (std::string &addr_)
@@ -124,6 +125,7 @@ int zmq::tipc_listener_t::set_address (const char *addr_)
         return -1;
 
     address.to_string (endpoint);
+    endpoint_id = socket->intern_endpoint (endpoint);
 
     //  Bind the socket to tipc name.
     rc = bind (s, address.addr (), address.addrlen ());
@@ -135,7 +137,7 @@ int zmq::tipc_listener_t::set_address (const char *addr_)
     if (rc != 0)
         goto error;
 
-    socket->event_listening (endpoint, s);
+    socket->event_listening (endpoint, endpoint_id, s);
     return 0;
 
 error:
@@ -151,7 +153,7 @@ void zmq::tipc_listener_t::close ()
     int rc = ::close (s);
     errno_assert (rc == 0);
     s = retired_fd;
-    socket->event_closed (endpoint, s);
+    socket->event_closed (endpoint, endpoint_id, s);
 }
 
 zmq::fd_t zmq::tipc_listener_t::accept ()
@@ -85,6 +85,9 @@ namespace zmq
        // String representation of endpoint to bind to
         std::string endpoint;
 
+        //  ID the monitor ring reports the endpoint with.
+        uint32_t endpoint_id;
+
         tipc_listener_t (const tipc_listener_t&);
         const tipc_listener_t &operator = (const tipc_listener_t&);
     };
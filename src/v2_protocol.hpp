@@ -31,8 +31,17 @@ namespace zmq
         {
             more_flag = 1,
             large_flag = 2,
-            command_flag = 4
+            command_flag = 4,
+
+            //  The frame holds a batch of small messages. Used only if
+            //  both peers advertised the X-Batch property.
+            batch_flag = 8
         };
+
+        //  Largest message that is put into a batch. Each message in the
+        //  batch is preceded by one byte holding its size and, in the
+        //  highest bit, its more flag.
+        enum { batch_msg_max = 127 };
     };
 }
 
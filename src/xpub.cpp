@@ -19,14 +19,24 @@
 
 #include <string.h>
 
+#include <new>
+
 #include "xpub.hpp"
 #include "pipe.hpp"
+#include "config.hpp"
 #include "err.hpp"
 #include "msg.hpp"
 
 zmq::xpub_t::xpub_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
     socket_base_t (parent_, tid_, sid_),
     verbose(false),
+    pacing (0),
+    evict_drop_ratio (0),
+    evict_queue_age (0),
+    ring_capacity (0),
+    ring_block (false),
+    ring (NULL),
+    ring_skip (false),
     more (false)
 {
     options.type = ZMQ_XPUB;
@@ -34,12 +44,28 @@ zmq::xpub_t::xpub_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
 
 zmq::xpub_t::~xpub_t ()
 {
+    if (ring)
+        ring->release ();
 }
 
 void zmq::xpub_t::xattach_pipe (pipe_t *pipe_, bool subscribe_to_all_)
 {
     zmq_assert (pipe_);
-    dist.attach (pipe_);
+
+    //  Inproc subscribers read from the broadcast ring, if enabled.
+    if (ring_capacity > 0 && pipe_->is_inproc ()) {
+        if (!ring) {
+            ring = new (std::nothrow) broadcast_ring_t (ring_capacity,
+                ring_block);
+            alloc_assert (ring);
+        }
+        if (pipe_->attach_ring (ring))
+            ring_pipes.push_back (pipe_);
+        else
+            dist.attach (pipe_);
+    }
+    else
+        dist.attach (pipe_);
 
     //  If subscribe_to_all_ is specified, the caller would like to subscribe
     //  to all data on this pipe, implicitly.
@@ -61,6 +87,15 @@ void zmq::xpub_t::xread_activated (pipe_t *pipe_)
         const size_t size = sub.size ();
         if (size > 0 && (*data == 0 || *data == 1)) {
             bool unique;
+            if (options.topic_patterns && size > 1) {
+                if (*data == 0)
+                    unique = pattern_subscriptions.rm (data + 1, size - 1,
+                        pipe_);
+                else
+                    unique = pattern_subscriptions.add (data + 1, size - 1,
+                        pipe_);
+            }
+            else
             if (*data == 0)
                 unique = subscriptions.rm (data + 1, size - 1, pipe_);
             else
@@ -84,22 +119,138 @@ void zmq::xpub_t::xread_activated (pipe_t *pipe_)
 
 void zmq::xpub_t::xwrite_activated (pipe_t *pipe_)
 {
-    dist.activated (pipe_);
+    //  Readers of the broadcast ring ask for the blocked writer to be
+    //  woken up, which is all that's needed.
+    if (!pipe_->is_broadcast ())
+        dist.activated (pipe_);
 }
 
 int zmq::xpub_t::xsetsockopt (int option_, const void *optval_,
     size_t optvallen_)
 {
-    if (option_ != ZMQ_XPUB_VERBOSE) {
-        errno = EINVAL;
-        return -1;
+    bool is_int = (optvallen_ == sizeof (int));
+    int value = is_int? *static_cast <const int*> (optval_): 0;
+
+    switch (option_) {
+        case ZMQ_XPUB_VERBOSE:
+            if (is_int && value >= 0) {
+                verbose = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_TOPIC_PATTERNS:
+            if (is_int && value >= 0) {
+                options.topic_patterns = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_XPUB_PACING:
+            if (is_int && value >= 0) {
+                pacing = value;
+                dist.set_policies (pacing, evict_drop_ratio, evict_queue_age);
+                return 0;
+            }
+            break;
+
+        case ZMQ_XPUB_EVICT_DROP_RATIO:
+            if (is_int && value >= 0 && value <= 100) {
+                evict_drop_ratio = value;
+                dist.set_policies (pacing, evict_drop_ratio, evict_queue_age);
+                return 0;
+            }
+            break;
+
+        case ZMQ_XPUB_EVICT_QUEUE_AGE:
+            if (is_int && value >= 0) {
+                evict_queue_age = value;
+                dist.set_policies (pacing, evict_drop_ratio, evict_queue_age);
+                return 0;
+            }
+            break;
+
+        //  The ring is created with the first inproc subscriber. It can't
+        //  be changed afterwards.
+        case ZMQ_XPUB_BROADCAST_RING:
+            if (is_int && value >= 0 &&
+                  value <= broadcast_ring_max_capacity && !ring) {
+                ring_capacity = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_XPUB_BROADCAST_BLOCK:
+            if (is_int && value >= 0 && !ring) {
+                ring_block = (value != 0);
+                return 0;
+            }
+            break;
     }
-    if (optvallen_ != sizeof (int) || *static_cast <const int*> (optval_) < 0) {
-        errno = EINVAL;
-        return -1;
+
+    errno = EINVAL;
+    return -1;
+}
+
+int zmq::xpub_t::xgetsockopt (int option_, void *optval_,
+    size_t *optvallen_)
+{
+    bool is_int = (*optvallen_ == sizeof (int));
+    int *value = (int *) optval_;
+
+    switch (option_) {
+        case ZMQ_TOPIC_PATTERNS:
+            if (is_int) {
+                *value = options.topic_patterns ? 1 : 0;
+                return 0;
+            }
+            break;
+
+        case ZMQ_XPUB_PACING:
+            if (is_int) {
+                *value = pacing;
+                return 0;
+            }
+            break;
+
+        case ZMQ_XPUB_EVICT_DROP_RATIO:
+            if (is_int) {
+                *value = evict_drop_ratio;
+                return 0;
+            }
+            break;
+
+        case ZMQ_XPUB_EVICT_QUEUE_AGE:
+            if (is_int) {
+                *value = evict_queue_age;
+                return 0;
+            }
+            break;
+
+        case ZMQ_XPUB_BROADCAST_RING:
+            if (is_int) {
+                *value = ring_capacity;
+                return 0;
+            }
+            break;
+
+        case ZMQ_XPUB_BROADCAST_BLOCK:
+            if (is_int) {
+                *value = ring_block ? 1 : 0;
+                return 0;
+            }
+            break;
+
+        case ZMQ_XPUB_PEER_STATS:
+            //  Fill in as many records as fit into the buffer.
+            *optvallen_ = dist.get_stats ((zmq_xpub_peer_stats_t *) optval_,
+                *optvallen_ / sizeof (zmq_xpub_peer_stats_t)) *
+                sizeof (zmq_xpub_peer_stats_t);
+            return 0;
     }
-    verbose = (*static_cast <const int*> (optval_) != 0);
-    return 0;
+
+    errno = EINVAL;
+    return -1;
 }
 
 void zmq::xpub_t::xpipe_terminated (pipe_t *pipe_)
@@ -108,24 +259,74 @@ void zmq::xpub_t::xpipe_terminated (pipe_t *pipe_)
     //  is interested in anymore, send corresponding unsubscriptions
     //  upstream.
     subscriptions.rm (pipe_, send_unsubscription, this);
+    pattern_subscriptions.rm (pipe_, send_unsubscription, this);
 
-    dist.pipe_terminated (pipe_);
+    if (pipe_->is_broadcast ()) {
+        ring_pipes.erase (pipe_);
+        pipe_->detach_ring ();
+    }
+    else
+        dist.pipe_terminated (pipe_);
 }
 
 void zmq::xpub_t::mark_as_matching (pipe_t *pipe_, void *arg_)
 {
     xpub_t *self = (xpub_t*) arg_;
-    self->dist.match (pipe_);
+
+    //  Readers of the broadcast ring do their own filtering.
+    if (!pipe_->is_broadcast ())
+        self->dist.match (pipe_);
+}
+
+int zmq::xpub_t::write_to_ring (msg_t *msg_)
+{
+    //  Whether the message goes to the ring is decided by its first part
+    //  so that readers attached in the middle don't get partial messages.
+    if (!more)
+        ring_skip = !ring->has_readers ();
+    if (ring_skip)
+        return 0;
+
+    if (!ring->write (msg_)) {
+
+        //  Wait for the readers if required, unless the message would not
+        //  fit into the ring even if it was empty. Otherwise drop the
+        //  whole message.
+        if (ring->is_blocking () && !ring->is_oversized ()) {
+            errno = EAGAIN;
+            return -1;
+        }
+        ring->rollback ();
+        ring_skip = true;
+        return 0;
+    }
+
+    //  Publish complete messages and wake up the readers waiting for them.
+    if (!(msg_->flags () & msg_t::more) && ring->flush ())
+        for (ring_pipes_t::size_type i = 0; i != ring_pipes.size (); i++)
+            ring_pipes [i]->flush ();
+    return 0;
 }
 
 int zmq::xpub_t::xsend (msg_t *msg_)
 {
     bool msg_more = msg_->flags () & msg_t::more ? true : false;
 
+    //  The ring goes first as the message may have to be retried later.
+    if (ring) {
+        int rc = write_to_ring (msg_);
+        if (rc != 0)
+            return rc;
+    }
+
     //  For the first part of multi-part message, find the matching pipes.
-    if (!more)
+    //  Pipes matching both a prefix and a pattern are marked just once.
+    if (!more) {
         subscriptions.match ((unsigned char*) msg_->data (), msg_->size (),
             mark_as_matching, this);
+        pattern_subscriptions.match ((unsigned char*) msg_->data (),
+            msg_->size (), mark_as_matching, this);
+    }
 
     //  Send the message to all the pipes that were marked as matching
     //  in the previous step.
@@ -145,6 +346,10 @@ int zmq::xpub_t::xsend (msg_t *msg_)
 
 bool zmq::xpub_t::xhas_out ()
 {
+    //  A blocking ring can't take messages while it's full.
+    if (ring && ring->is_blocking () && ring->has_readers () &&
+          !more && !ring->check_write ())
+        return false;
     return dist.has_out ();
 }
 
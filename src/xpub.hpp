@@ -26,8 +26,10 @@
 #include "socket_base.hpp"
 #include "session_base.hpp"
 #include "mtrie.hpp"
+#include "ptrie.hpp"
 #include "array.hpp"
 #include "dist.hpp"
+#include "broadcast_ring.hpp"
 
 namespace zmq
 {
@@ -54,6 +56,7 @@ namespace zmq
         void xread_activated (zmq::pipe_t *pipe_);
         void xwrite_activated (zmq::pipe_t *pipe_);
         int xsetsockopt (int option_, const void *optval_, size_t optvallen_);
+        int xgetsockopt (int option_, void *optval_, size_t *optvallen_);
         void xpipe_terminated (zmq::pipe_t *pipe_);
 
     private:
@@ -66,9 +69,16 @@ namespace zmq
         //  Function to be applied to each matching pipes.
         static void mark_as_matching (zmq::pipe_t *pipe_, void *arg_);
 
+        //  Writes the message to the broadcast ring, if any.
+        int write_to_ring (zmq::msg_t *msg_);
+
         //  List of all subscriptions mapped to corresponding pipes.
         mtrie_t subscriptions;
 
+        //  Same for the wildcard patterns, used instead of the above for
+        //  non-empty subscriptions if options.topic_patterns is true.
+        ptrie_t pattern_subscriptions;
+
         //  Distributor of messages holding the list of outbound pipes.
         dist_t dist;
 
@@ -76,6 +86,26 @@ namespace zmq
         // unique ones
         bool verbose;
 
+        //  Per-subscriber policies: maximal number of messages per second,
+        //  and the percentage of dropped messages and the time in
+        //  milliseconds the subscriber's queue may stay full beyond which
+        //  the subscriber is disconnected. Zero means no limit.
+        int pacing;
+        int evict_drop_ratio;
+        int evict_queue_age;
+
+        //  Broadcast ring the inproc subscribers read from: its capacity
+        //  (zero if disabled) and whether to wait for the slowest reader
+        //  rather than drop messages once it's full, the ring itself, the
+        //  pipes of the readers, and whether the current message is left
+        //  out of the ring.
+        int ring_capacity;
+        bool ring_block;
+        broadcast_ring_t *ring;
+        typedef array_t <pipe_t, 2> ring_pipes_t;
+        ring_pipes_t ring_pipes;
+        bool ring_skip;
+
         //  True if we are in the middle of sending a multi-part message.
         bool more;
 
@@ -20,6 +20,7 @@
 #include <string.h>
 
 #include "xsub.hpp"
+#include "pipe.hpp"
 #include "err.hpp"
 
 zmq::xsub_t::xsub_t (class ctx_t *parent_, uint32_t tid_, int sid_) :
@@ -54,6 +55,7 @@ void zmq::xsub_t::xattach_pipe (pipe_t *pipe_, bool subscribe_to_all_)
 
     //  Send all the cached subscriptions to the new upstream peer.
     subscriptions.apply (send_subscription, pipe_);
+    pattern_subscriptions.apply (send_subscription, pipe_);
     pipe_->flush ();
 }
 
@@ -77,6 +79,7 @@ void zmq::xsub_t::xhiccuped (pipe_t *pipe_)
 {
     //  Send all the cached subscriptions to the hiccuped pipe.
     subscriptions.apply (send_subscription, pipe_);
+    pattern_subscriptions.apply (send_subscription, pipe_);
     pipe_->flush ();
 }
 
@@ -91,13 +94,21 @@ int zmq::xsub_t::xsend (msg_t *msg_)
         //  however this is alread done on the XPUB side and
         //  doing it here as well breaks ZMQ_XPUB_VERBOSE
         //  when there are forwarding devices involved.
-        subscriptions.add (data + 1, size - 1);
+        if (options.topic_patterns && size > 1)
+            pattern_subscriptions.add (data + 1, size - 1, NULL);
+        else
+            subscriptions.add (data + 1, size - 1);
         return dist.send_to_all (msg_);
     }
     else 
     if (size > 0 && *data == 0) {
         //  Process unsubscribe message
-        if (subscriptions.rm (data + 1, size - 1))
+        bool removed;
+        if (options.topic_patterns && size > 1)
+            removed = pattern_subscriptions.rm (data + 1, size - 1, NULL);
+        else
+            removed = subscriptions.rm (data + 1, size - 1);
+        if (removed)
             return dist.send_to_all (msg_);
     }
     else 
@@ -112,6 +123,31 @@ int zmq::xsub_t::xsend (msg_t *msg_)
     return 0;
 }
 
+int zmq::xsub_t::xsetsockopt (int option_, const void *optval_,
+    size_t optvallen_)
+{
+    if (option_ == ZMQ_TOPIC_PATTERNS && optvallen_ == sizeof (int) &&
+          *static_cast <const int*> (optval_) >= 0) {
+        options.topic_patterns = *static_cast <const int*> (optval_) != 0;
+        return 0;
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+int zmq::xsub_t::xgetsockopt (int option_, void *optval_,
+    size_t *optvallen_)
+{
+    if (option_ == ZMQ_TOPIC_PATTERNS && *optvallen_ == sizeof (int)) {
+        *((int*) optval_) = options.topic_patterns ? 1 : 0;
+        return 0;
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
 bool zmq::xsub_t::xhas_out ()
 {
     //  Subscription can be added/removed anytime.
@@ -136,7 +172,8 @@ int zmq::xsub_t::xrecv (msg_t *msg_)
     while (true) {
 
         //  Get a message using fair queueing algorithm.
-        int rc = fq.recv (msg_);
+        pipe_t *pipe = NULL;
+        int rc = fq.recvpipe (msg_, &pipe);
 
         //  If there's no message available, return immediately.
         //  The same when error occurs.
@@ -144,8 +181,10 @@ int zmq::xsub_t::xrecv (msg_t *msg_)
             return -1;
 
         //  Check whether the message matches at least one subscription.
-        //  Non-initial parts of the message are passed 
-        if (more || !options.filter || match (msg_)) {
+        //  Non-initial parts of the message are passed. Messages read
+        //  from a broadcast ring were not filtered by the publisher.
+        if (more || !(options.filter || pipe->is_broadcast ()) ||
+              match (msg_)) {
             more = msg_->flags () & msg_t::more ? true : false;
             return 0;
         }
@@ -175,7 +214,8 @@ bool zmq::xsub_t::xhas_in ()
     while (true) {
 
         //  Get a message using fair queueing algorithm.
-        int rc = fq.recv (&message);
+        pipe_t *pipe = NULL;
+        int rc = fq.recvpipe (&message, &pipe);
 
         //  If there's no message available, return immediately.
         //  The same when error occurs.
@@ -185,7 +225,7 @@ bool zmq::xsub_t::xhas_in ()
         }
 
         //  Check whether the message matches at least one subscription.
-        if (!options.filter || match (&message)) {
+        if (!(options.filter || pipe->is_broadcast ()) || match (&message)) {
             has_message = true;
             return true;
         }
@@ -206,7 +246,9 @@ zmq::blob_t zmq::xsub_t::get_credential () const
 
 bool zmq::xsub_t::match (msg_t *msg_)
 {
-    return subscriptions.check ((unsigned char*) msg_->data (), msg_->size ());
+    return subscriptions.check ((unsigned char*) msg_->data (), msg_->size ())
+        || pattern_subscriptions.check ((unsigned char*) msg_->data (),
+            msg_->size ());
 }
 
 void zmq::xsub_t::send_subscription (unsigned char *data_, size_t size_,
@@ -25,6 +25,7 @@
 #include "dist.hpp"
 #include "fq.hpp"
 #include "trie.hpp"
+#include "ptrie.hpp"
 
 namespace zmq
 {
@@ -49,6 +50,8 @@ namespace zmq
         bool xhas_out ();
         int xrecv (zmq::msg_t *msg_);
         bool xhas_in ();
+        int xsetsockopt (int option_, const void *optval_, size_t optvallen_);
+        int xgetsockopt (int option_, void *optval_, size_t *optvallen_);
         blob_t get_credential () const;
         void xread_activated (zmq::pipe_t *pipe_);
         void xwrite_activated (zmq::pipe_t *pipe_);
@@ -74,6 +77,10 @@ namespace zmq
         //  The repository of subscriptions.
         trie_t subscriptions;
 
+        //  The repository of wildcard patterns, used instead of the above
+        //  for non-empty subscriptions if options.topic_patterns is true.
+        ptrie_t pattern_subscriptions;
+
         //  If true, 'message' contains a matching message to return on the
         //  next recv call.
         bool has_message;
@@ -174,6 +174,13 @@ namespace zmq
                 return (*fn) (queue.front ());
         }
 
+        //  Allocates memory for count_ more items to be written without
+        //  further allocations. Must be called from the writer thread.
+        inline void reserve (int count_)
+        {
+            queue.reserve (count_);
+        }
+
     protected:
 
         //  Allocation-efficient queue to store pipe items.
@@ -38,6 +38,7 @@ namespace zmq
         virtual bool check_read () = 0;
         virtual bool read (T *value_) = 0;
         virtual bool probe (bool (*fn)(const T &)) = 0;
+        virtual void reserve (int count_) = 0;
     };
 }
 
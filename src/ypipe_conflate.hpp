@@ -112,6 +112,12 @@ namespace zmq
             return dbuffer.probe (fn);
         }
 
+        //  Conflating pipe holds at most two items, there's nothing to
+        //  allocate in advance.
+        inline void reserve (int)
+        {
+        }
+
     protected:
 
         dbuffer_t <T> dbuffer;
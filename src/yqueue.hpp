@@ -22,6 +22,7 @@
 
 #include <stdlib.h>
 #include <stddef.h>
+#include <string.h>
 
 #include "err.hpp"
 #include "atomic_ptr.hpp"
@@ -51,6 +52,7 @@ namespace zmq
         {
              begin_chunk = (chunk_t*) malloc (sizeof (chunk_t));
              alloc_assert (begin_chunk);
+             begin_chunk->next = NULL;
              begin_pos = 0;
              back_chunk = NULL;
              back_pos = 0;
@@ -61,11 +63,8 @@ namespace zmq
         //  Destroy the queue.
         inline ~yqueue_t ()
         {
-            while (true) {
-                if (begin_chunk == end_chunk) {
-                    free (begin_chunk);
-                    break;
-                } 
+            //  Chunks reserved beyond the end chunk are freed as well.
+            while (begin_chunk) {
                 chunk_t *o = begin_chunk;
                 begin_chunk = begin_chunk->next;
                 free (o);
@@ -98,6 +97,13 @@ namespace zmq
             if (++end_pos != N)
                 return;
 
+            //  Use the chunk reserved in advance, if any.
+            if (end_chunk->next) {
+                end_chunk = end_chunk->next;
+                end_pos = 0;
+                return;
+            }
+
             chunk_t *sc = spare_chunk.xchg (NULL);
             if (sc) {
                 end_chunk->next = sc;
@@ -108,9 +114,30 @@ namespace zmq
                 end_chunk->next->prev = end_chunk;
             }
             end_chunk = end_chunk->next;
+            end_chunk->next = NULL;
             end_pos = 0;
         }
 
+        //  Makes sure count_ more elements can be pushed without allocating
+        //  memory. Reserved chunks are zeroed so that their pages are mapped
+        //  before they are needed. Must be called by the queue writer.
+        inline void reserve (int count_)
+        {
+            chunk_t *chunk = end_chunk;
+            int room = N - end_pos;
+            while (room < count_) {
+                if (!chunk->next) {
+                    chunk_t *c = (chunk_t*) malloc (sizeof (chunk_t));
+                    alloc_assert (c);
+                    memset (c, 0, sizeof (chunk_t));
+                    c->prev = chunk;
+                    chunk->next = c;
+                }
+                chunk = chunk->next;
+                room += N;
+            }
+        }
+
         //  Removes element from the back end of the queue. In other words
         //  it rollbacks last push to the queue. Take care: Caller is
         //  responsible for destroying the object being unpushed.
@@ -131,14 +158,13 @@ namespace zmq
             //  Now, move 'end' position backwards. Note that obsolete end chunk
             //  is not used as a spare chunk. The analysis shows that doing so
             //  would require free and atomic operation per chunk deallocated
-            //  instead of a simple free.
+            //  instead of a simple free. It is kept reserved for the next
+            //  push instead, which requires no synchronisation at all.
             if (end_pos)
                 --end_pos;
             else {
                 end_pos = N - 1;
                 end_chunk = end_chunk->prev;
-                free (end_chunk->next);
-                end_chunk->next = NULL;
             }
         }
 
@@ -77,6 +77,7 @@ struct iovec {
 #include "ctx.hpp"
 #include "err.hpp"
 #include "msg.hpp"
+#include "mutex_stats.hpp"
 #include "fd.hpp"
 
 #if !defined ZMQ_HAVE_WINDOWS
@@ -218,6 +219,39 @@ int zmq_ctx_get (void *ctx_, int option_)
     return ((zmq::ctx_t*) ctx_)->get (option_);
 }
 
+int zmq_ctx_io_thread_stats (void *ctx_, int thread_,
+    zmq_io_thread_stats_t *stats_)
+{
+    if (!ctx_ || !((zmq::ctx_t*) ctx_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::ctx_t*) ctx_)->get_io_thread_stats (thread_, stats_);
+}
+
+int zmq_ctx_flight_recorder_dump (void *ctx_, const char *path_)
+{
+    if (!ctx_ || !((zmq::ctx_t*) ctx_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::ctx_t*) ctx_)->dump_flight_recorders (path_);
+}
+
+int zmq_mutex_stats (zmq_mutex_stats_t *stats_, int count_)
+{
+    if (count_ < 0 || (count_ > 0 && !stats_)) {
+        errno = EINVAL;
+        return -1;
+    }
+#ifdef ZMQ_MUTEX_STATS
+    return zmq::mutex_site_t::get_stats (stats_, count_);
+#else
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
 //  Stable/legacy context API
 
 void *zmq_init (int io_threads_)
@@ -299,6 +333,41 @@ int zmq_socket_monitor (void *s_, const char *addr_, int events_)
     return result;
 }
 
+int zmq_socket_monitor_ring (void *s_, int events_, int capacity_)
+{
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    zmq::socket_base_t *s = (zmq::socket_base_t *) s_;
+    int result = s->monitor_ring (events_, capacity_);
+    return result;
+}
+
+int zmq_monitor_ring_recv (void *s_, zmq_monitor_record_t *records_,
+    int count_)
+{
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    zmq::socket_base_t *s = (zmq::socket_base_t *) s_;
+    int result = s->monitor_ring_recv (records_, count_);
+    return result;
+}
+
+int zmq_monitor_ring_endpoint (void *s_, uint32_t id_, char *buf_,
+    size_t size_)
+{
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    zmq::socket_base_t *s = (zmq::socket_base_t *) s_;
+    int result = s->monitor_ring_endpoint (id_, buf_, size_);
+    return result;
+}
+
 int zmq_bind (void *s_, const char *addr_)
 {
     if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
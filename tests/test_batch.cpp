@@ -0,0 +1,120 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+//  Sends small messages of all sizes that fit into a batch, larger ones
+//  and multi-part ones, and checks they arrive intact and in order.
+static void test_transfer (void *ctx, int sender_batch, int receiver_batch)
+{
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_setsockopt (pull, ZMQ_BATCH_SIZE, &receiver_batch,
+        sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (pull, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof (endpoint);
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_setsockopt (push, ZMQ_BATCH_SIZE, &sender_batch, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_connect (push, endpoint);
+    assert (rc == 0);
+
+    char buf [350];
+    for (int i = 0; i != (int) sizeof (buf); i++)
+        buf [i] = (char) i;
+
+    const int count = 10000;
+    for (int i = 0; i != count; i++) {
+        const int size = i % 10 == 9 ? 200 + i % 100 : i % 128;
+        const int flags = i % 7 == 6 ? ZMQ_SNDMORE : 0;
+        rc = zmq_send (push, buf + i % 50, size, flags);
+        assert (rc == size);
+    }
+    rc = zmq_send (push, "end", 3, 0);
+    assert (rc == 3);
+
+    char recv_buf [300];
+    for (int i = 0; i != count; i++) {
+        const int size = i % 10 == 9 ? 200 + i % 100 : i % 128;
+        rc = zmq_recv (pull, recv_buf, sizeof (recv_buf), 0);
+        assert (rc == size);
+        assert (memcmp (recv_buf, buf + i % 50, size) == 0);
+        int more;
+        size_t more_size = sizeof (more);
+        rc = zmq_getsockopt (pull, ZMQ_RCVMORE, &more, &more_size);
+        assert (rc == 0);
+        assert (more == (i % 7 == 6 ? 1 : 0));
+    }
+    rc = zmq_recv (pull, recv_buf, sizeof (recv_buf), 0);
+    assert (rc == 3);
+
+    close_zero_linger (push);
+    close_zero_linger (pull);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    int batch_size = -1;
+    void *socket = zmq_socket (ctx, ZMQ_PUSH);
+    assert (socket);
+    int rc = zmq_setsockopt (socket, ZMQ_BATCH_SIZE, &batch_size,
+        sizeof (int));
+    assert (rc == -1 && errno == EINVAL);
+    batch_size = 8193;
+    rc = zmq_setsockopt (socket, ZMQ_BATCH_SIZE, &batch_size, sizeof (int));
+    assert (rc == -1 && errno == EINVAL);
+    batch_size = 8192;
+    rc = zmq_setsockopt (socket, ZMQ_BATCH_SIZE, &batch_size, sizeof (int));
+    assert (rc == 0);
+    batch_size = 0;
+    size_t size = sizeof (int);
+    rc = zmq_getsockopt (socket, ZMQ_BATCH_SIZE, &batch_size, &size);
+    assert (rc == 0);
+    assert (batch_size == 8192);
+    rc = zmq_close (socket);
+    assert (rc == 0);
+
+    //  Batching on both ends.
+    test_transfer (ctx, 1024, 1024);
+
+    //  Batches hardly larger than the messages.
+    test_transfer (ctx, 130, 130);
+
+    //  Only one end batching falls back to plain frames.
+    test_transfer (ctx, 1024, 0);
+    test_transfer (ctx, 0, 1024);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+void test_options (void *ctx)
+{
+    void *sb = zmq_socket (ctx, ZMQ_PULL);
+    assert (sb);
+
+    int value;
+    size_t size = sizeof (value);
+    int rc = zmq_getsockopt (sb, ZMQ_INBOUND_POLL_RATE, &value, &size);
+    assert (rc == 0);
+    assert (value == 100);
+    rc = zmq_getsockopt (sb, ZMQ_COMMAND_DELAY, &value, &size);
+    assert (rc == 0);
+    assert (value == -1);
+    rc = zmq_getsockopt (sb, ZMQ_COMMAND_ADAPTIVE, &value, &size);
+    assert (rc == 0);
+    assert (value == 0);
+
+    value = 0;
+    rc = zmq_setsockopt (sb, ZMQ_INBOUND_POLL_RATE, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+    value = -2;
+    rc = zmq_setsockopt (sb, ZMQ_COMMAND_DELAY, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+    value = 2;
+    rc = zmq_setsockopt (sb, ZMQ_COMMAND_ADAPTIVE, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+
+    value = 10;
+    rc = zmq_setsockopt (sb, ZMQ_INBOUND_POLL_RATE, &value, sizeof (value));
+    assert (rc == 0);
+    rc = zmq_getsockopt (sb, ZMQ_INBOUND_POLL_RATE, &value, &size);
+    assert (rc == 0);
+    assert (value == 10);
+
+    rc = zmq_close (sb);
+    assert (rc == 0);
+}
+
+//  Pipes attached while the receiver is busy with a steady stream of
+//  messages must be picked up whatever the throttling. Each run uses its own
+//  endpoint, as closed sockets unregister theirs asynchronously.
+void test_attach_under_load (void *ctx, const char *endpoint, int poll_rate,
+    int delay, int adaptive)
+{
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_setsockopt (pull, ZMQ_INBOUND_POLL_RATE, &poll_rate,
+        sizeof (poll_rate));
+    assert (rc == 0);
+    rc = zmq_setsockopt (pull, ZMQ_COMMAND_DELAY, &delay, sizeof (delay));
+    assert (rc == 0);
+    rc = zmq_setsockopt (pull, ZMQ_COMMAND_ADAPTIVE, &adaptive,
+        sizeof (adaptive));
+    assert (rc == 0);
+    rc = zmq_bind (pull, endpoint);
+    assert (rc == 0);
+
+    void *stream = zmq_socket (ctx, ZMQ_PUSH);
+    assert (stream);
+    rc = zmq_connect (stream, endpoint);
+    assert (rc == 0);
+
+    char buf [2];
+    for (int i = 0; i < 10; i++) {
+        //  Queue a batch of messages so that the receiver never blocks.
+        for (int j = 0; j < 500; j++) {
+            rc = zmq_send (stream, "x", 1, 0);
+            assert (rc == 1);
+        }
+
+        void *probe = zmq_socket (ctx, ZMQ_PUSH);
+        assert (probe);
+        rc = zmq_connect (probe, endpoint);
+        assert (rc == 0);
+        rc = zmq_send (probe, "pp", 2, 0);
+        assert (rc == 2);
+
+        //  The probe arrives interleaved with the stream.
+        int received = 0;
+        while (true) {
+            rc = zmq_recv (pull, buf, sizeof (buf), 0);
+            assert (rc == 1 || rc == 2);
+            if (rc == 2)
+                break;
+            received++;
+        }
+        assert (received <= 500);
+
+        //  Drain the rest of the batch.
+        while (received++ < 500) {
+            rc = zmq_recv (pull, buf, sizeof (buf), 0);
+            assert (rc == 1);
+        }
+
+        rc = zmq_close (probe);
+        assert (rc == 0);
+    }
+
+    rc = zmq_close (stream);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_options (ctx);
+    test_attach_under_load (ctx, "inproc://throttle-default", 100, -1, 0);
+    test_attach_under_load (ctx, "inproc://throttle-eager", 1, 0, 0);
+    test_attach_under_load (ctx, "inproc://throttle-adaptive", 1000, 5000,
+        1);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
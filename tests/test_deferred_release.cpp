@@ -0,0 +1,262 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+static int released;
+
+static void release_fn (void *data_, void *hint_)
+{
+    (void) data_;
+    (void) hint_;
+    released++;
+}
+
+static void send_zero_copy (void *socket)
+{
+    static char data [] = "zero-copy message";
+    zmq_msg_t msg;
+    int rc = zmq_msg_init_data (&msg, data, sizeof (data), release_fn, NULL);
+    assert (rc == 0);
+    rc = zmq_msg_send (&msg, socket, 0);
+    assert (rc == (int) sizeof (data));
+}
+
+static void recv_and_close (void *socket)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&msg, socket, 0);
+    assert (rc > 0);
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+}
+
+static void drain (void *socket)
+{
+    int events;
+    size_t size = sizeof (events);
+    int rc = zmq_getsockopt (socket, ZMQ_EVENTS, &events, &size);
+    assert (rc == 0);
+}
+
+static void test_inproc (void *ctx)
+{
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_bind (pull, "inproc://deferred");
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    int deferred = 1;
+    rc = zmq_setsockopt (push, ZMQ_DEFERRED_RELEASE, &deferred,
+        sizeof (deferred));
+    assert (rc == 0);
+    rc = zmq_connect (push, "inproc://deferred");
+    assert (rc == 0);
+
+    //  Messages released by the receiver are handed back to the sender.
+    released = 0;
+    for (int i = 0; i != 10; i++)
+        send_zero_copy (push);
+    for (int i = 0; i != 10; i++)
+        recv_and_close (pull);
+    assert (released == 0);
+    drain (push);
+    assert (released == 10);
+
+    //  Sending drains the queue as well.
+    send_zero_copy (push);
+    recv_and_close (pull);
+    assert (released == 10);
+    send_zero_copy (push);
+    assert (released == 11);
+
+    //  Closing the sender releases what is queued and makes the messages
+    //  released afterwards be deallocated right away.
+    send_zero_copy (push);
+    recv_and_close (pull);
+    assert (released == 11);
+    rc = zmq_close (push);
+    assert (rc == 0);
+    assert (released == 12);
+    recv_and_close (pull);
+    assert (released == 13);
+
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+static void test_recv (void *ctx)
+{
+    void *a = zmq_socket (ctx, ZMQ_PAIR);
+    assert (a);
+    int rc = zmq_bind (a, "inproc://deferred-recv");
+    assert (rc == 0);
+
+    void *b = zmq_socket (ctx, ZMQ_PAIR);
+    assert (b);
+    int deferred = 1;
+    rc = zmq_setsockopt (b, ZMQ_DEFERRED_RELEASE, &deferred,
+        sizeof (deferred));
+    assert (rc == 0);
+    rc = zmq_connect (b, "inproc://deferred-recv");
+    assert (rc == 0);
+
+    //  Receiving drains the queue, whether a message is there or not.
+    released = 0;
+    send_zero_copy (b);
+    recv_and_close (a);
+    assert (released == 0);
+    char buf [32];
+    rc = zmq_recv (b, buf, sizeof (buf), ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+    assert (released == 1);
+
+    send_zero_copy (b);
+    recv_and_close (a);
+    rc = zmq_send (a, "reply", 5, 0);
+    assert (rc == 5);
+    rc = zmq_recv (b, buf, sizeof (buf), 0);
+    assert (rc == 5);
+    assert (released == 2);
+
+    rc = zmq_close (b);
+    assert (rc == 0);
+    rc = zmq_close (a);
+    assert (rc == 0);
+}
+
+static void test_shared (void *ctx)
+{
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_bind (pull, "inproc://deferred-shared");
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    int deferred = 1;
+    rc = zmq_setsockopt (push, ZMQ_DEFERRED_RELEASE, &deferred,
+        sizeof (deferred));
+    assert (rc == 0);
+    rc = zmq_connect (push, "inproc://deferred-shared");
+    assert (rc == 0);
+
+    //  A message whose content is shared with a copy when it is sent is
+    //  released by whoever drops the last reference.
+    static char data [] = "shared message";
+    released = 0;
+    zmq_msg_t msg;
+    rc = zmq_msg_init_data (&msg, data, sizeof (data), release_fn, NULL);
+    assert (rc == 0);
+    zmq_msg_t copy;
+    rc = zmq_msg_init (&copy);
+    assert (rc == 0);
+    rc = zmq_msg_copy (&copy, &msg);
+    assert (rc == 0);
+    rc = zmq_msg_send (&msg, push, 0);
+    assert (rc == (int) sizeof (data));
+    recv_and_close (pull);
+    assert (released == 0);
+    rc = zmq_msg_close (&copy);
+    assert (rc == 0);
+    assert (released == 1);
+
+    //  Once the copies are closed, the release is deferred again.
+    rc = zmq_msg_init_data (&msg, data, sizeof (data), release_fn, NULL);
+    assert (rc == 0);
+    rc = zmq_msg_init (&copy);
+    assert (rc == 0);
+    rc = zmq_msg_copy (&copy, &msg);
+    assert (rc == 0);
+    rc = zmq_msg_close (&copy);
+    assert (rc == 0);
+    rc = zmq_msg_send (&msg, push, 0);
+    assert (rc == (int) sizeof (data));
+    recv_and_close (pull);
+    assert (released == 1);
+    drain (push);
+    assert (released == 2);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+static void test_tcp (void *ctx)
+{
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_bind (pull, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t size = sizeof (endpoint);
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, endpoint, &size);
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    int deferred = 1;
+    rc = zmq_setsockopt (push, ZMQ_DEFERRED_RELEASE, &deferred,
+        sizeof (deferred));
+    assert (rc == 0);
+    rc = zmq_connect (push, endpoint);
+    assert (rc == 0);
+
+    //  The I/O thread is done with the messages once they are sent, yet
+    //  they are only released by the sender's thread.
+    released = 0;
+    for (int i = 0; i != 10; i++)
+        send_zero_copy (push);
+    for (int i = 0; i != 10; i++)
+        recv_and_close (pull);
+    msleep (SETTLE_TIME);
+    assert (released == 0);
+    for (int i = 0; i != 100 && released != 10; i++) {
+        drain (push);
+        msleep (10);
+    }
+    assert (released == 10);
+
+    close_zero_linger (push);
+    close_zero_linger (pull);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_inproc (ctx);
+    test_recv (ctx);
+    test_shared (ctx);
+    test_tcp (ctx);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+static const char *dump_file = "test_flight_recorder.dump";
+
+static uint32_t get_uint32 (const unsigned char *buf_)
+{
+    return ((uint32_t) buf_ [0] << 24) | ((uint32_t) buf_ [1] << 16) |
+        ((uint32_t) buf_ [2] << 8) | buf_ [3];
+}
+
+//  Reads the dump and counts the records of each event type.
+static void count_events (int *counts_, int size_)
+{
+    memset (counts_, 0, size_ * sizeof (int));
+    FILE *file = fopen (dump_file, "rb");
+    assert (file);
+    unsigned char header [24];
+    size_t n = fread (header, 1, sizeof header, file);
+    assert (n == sizeof header);
+    assert (memcmp (header, "ZMQFR\0\0\1", 8) == 0);
+
+    unsigned char section [8];
+    while (fread (section, 1, sizeof section, file) == sizeof section) {
+        const uint32_t count = get_uint32 (section + 4);
+        for (uint32_t i = 0; i != count; i++) {
+            unsigned char record [24];
+            n = fread (record, 1, sizeof record, file);
+            assert (n == sizeof record);
+            const uint32_t event = get_uint32 (record + 16);
+            assert (event > 0 && event < (uint32_t) size_);
+            counts_ [event]++;
+        }
+    }
+    fclose (file);
+    remove (dump_file);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    assert (zmq_ctx_get (ctx, ZMQ_FLIGHT_RECORDER) ==
+        ZMQ_FLIGHT_RECORDER_DFLT);
+
+    //  Nothing to dump before the first socket, nor if disabled.
+    int rc = zmq_ctx_flight_recorder_dump (ctx, dump_file);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_ctx_set (ctx, ZMQ_FLIGHT_RECORDER, 0);
+    assert (rc == 0);
+    void *s = zmq_socket (ctx, ZMQ_PAIR);
+    assert (s);
+    rc = zmq_ctx_flight_recorder_dump (ctx, dump_file);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_close (s);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    ctx = zmq_ctx_new ();
+    assert (ctx);
+    rc = zmq_ctx_set (ctx, ZMQ_FLIGHT_RECORDER, 1000);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_FLIGHT_RECORDER) == 1000);
+
+    //  Engine reads and writes are recorded by the I/O thread.
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    rc = zmq_bind (pull, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t size = sizeof (endpoint);
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, endpoint, &size);
+    assert (rc == 0);
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_connect (push, endpoint);
+    assert (rc == 0);
+    for (int i = 0; i != 100; i++) {
+        rc = zmq_send (push, "ABC", 3, 0);
+        assert (rc == 3);
+    }
+    char buf [3];
+    for (int i = 0; i != 100; i++) {
+        rc = zmq_recv (pull, buf, sizeof (buf), 0);
+        assert (rc == 3);
+    }
+
+    //  Stalls on a full pipe are recorded by the sending socket.
+    void *sender = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sender);
+    int hwm = 1;
+    rc = zmq_setsockopt (sender, ZMQ_SNDHWM, &hwm, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (sender, "inproc://flight");
+    assert (rc == 0);
+    void *receiver = zmq_socket (ctx, ZMQ_PAIR);
+    assert (receiver);
+    rc = zmq_setsockopt (receiver, ZMQ_RCVHWM, &hwm, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_connect (receiver, "inproc://flight");
+    assert (rc == 0);
+    while (zmq_send (sender, "X", 1, ZMQ_DONTWAIT) == 1)
+        ;
+    assert (errno == EAGAIN);
+
+    //  Draining the pipe reactivates the sender, and a new message then
+    //  reactivates the receiver that found the pipe empty.
+    while (zmq_recv (receiver, buf, sizeof (buf), ZMQ_DONTWAIT) == 1)
+        ;
+    assert (errno == EAGAIN);
+    rc = zmq_send (sender, "Y", 1, 0);
+    assert (rc == 1);
+    rc = zmq_recv (receiver, buf, sizeof (buf), 0);
+    assert (rc == 1);
+
+    rc = zmq_ctx_flight_recorder_dump (ctx, dump_file);
+    assert (rc == 0);
+    int counts [9];
+    count_events (counts, 9);
+    assert (counts [1] > 0);    //  command
+    assert (counts [2] > 0);    //  activate_read
+    assert (counts [3] > 0);    //  activate_write
+    assert (counts [4] > 0);    //  hwm_reached
+    assert (counts [5] > 0);    //  engine_read
+    assert (counts [6] > 0);    //  engine_write
+    assert (counts [7] > 0);    //  send_blocked
+
+    close_zero_linger (receiver);
+    close_zero_linger (sender);
+    close_zero_linger (push);
+    close_zero_linger (pull);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
@@ -0,0 +1,136 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+const int MSG_COUNT = 20000;
+const int SLOW_READS = 2000;
+
+//  Number of messages sent so far by the producer thread.
+static volatile int sent = 0;
+
+static void producer (void *socket_)
+{
+    for (int i = 0; i < MSG_COUNT; i++) {
+        int rc = zmq_send (socket_, "x", 1, 0);
+        assert (rc == 1);
+        sent = i + 1;
+    }
+}
+
+void test_options ()
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    void *sb = zmq_socket (ctx, ZMQ_PUSH);
+    assert (sb);
+
+    int value;
+    size_t size = sizeof (value);
+    int rc = zmq_getsockopt (sb, ZMQ_HWM_TARGET_DELAY, &value, &size);
+    assert (rc == 0);
+    assert (value == 0);
+    rc = zmq_getsockopt (sb, ZMQ_HWM_MIN, &value, &size);
+    assert (rc == 0);
+    assert (value == 100);
+
+    value = 5;
+    rc = zmq_setsockopt (sb, ZMQ_HWM_TARGET_DELAY, &value, sizeof (value));
+    assert (rc == 0);
+    rc = zmq_getsockopt (sb, ZMQ_HWM_TARGET_DELAY, &value, &size);
+    assert (rc == 0);
+    assert (value == 5);
+
+    //  Lower bound of zero would mean no watermark at all.
+    value = 0;
+    rc = zmq_setsockopt (sb, ZMQ_HWM_MIN, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = zmq_close (sb);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+
+void test_slow_consumer ()
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Fixed watermarks would let 10000 messages pile up.
+    int hwm = 5000;
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_setsockopt (pull, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_bind (pull, "inproc://adaptive");
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_setsockopt (push, ZMQ_SNDHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    int delay = 5;
+    rc = zmq_setsockopt (push, ZMQ_HWM_TARGET_DELAY, &delay, sizeof (delay));
+    assert (rc == 0);
+    int hwm_min = 10;
+    rc = zmq_setsockopt (push, ZMQ_HWM_MIN, &hwm_min, sizeof (hwm_min));
+    assert (rc == 0);
+    rc = zmq_connect (push, "inproc://adaptive");
+    assert (rc == 0);
+
+    void *thread = zmq_threadstart (&producer, push);
+    assert (thread);
+
+    //  Consume about 10 messages per millisecond. With the watermark
+    //  tracking 5 ms worth of messages, the backlog stays small.
+    char buf [1];
+    for (int i = 0; i < SLOW_READS; i++) {
+        rc = zmq_recv (pull, buf, sizeof (buf), 0);
+        assert (rc == 1);
+        if (i % 10 == 9)
+            msleep (1);
+    }
+    int backlog = sent - SLOW_READS;
+    assert (backlog < 2000);
+
+    //  Everything sent is delivered.
+    for (int i = SLOW_READS; i < MSG_COUNT; i++) {
+        rc = zmq_recv (pull, buf, sizeof (buf), 0);
+        assert (rc == 1);
+    }
+    zmq_threadclose (thread);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    test_options ();
+    test_slow_consumer ();
+
+    return 0;
+}
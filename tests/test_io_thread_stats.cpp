@@ -0,0 +1,129 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    int rc = zmq_ctx_set (ctx, ZMQ_IO_THREADS, 2);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_IO_THREAD_STATS) == 0);
+    rc = zmq_ctx_set (ctx, ZMQ_IO_THREAD_STATS, 1);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_IO_THREAD_STATS) == 1);
+
+    //  I/O threads are not running before the first socket is created.
+    zmq_io_thread_stats_t stats;
+    rc = zmq_ctx_io_thread_stats (ctx, 0, &stats);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_ctx_io_thread_stats (NULL, 0, &stats);
+    assert (rc == -1 && errno == EFAULT);
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    rc = zmq_bind (pull, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t size = sizeof (endpoint);
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, endpoint, &size);
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_connect (push, endpoint);
+    assert (rc == 0);
+
+    //  A connection to a port nobody listens on keeps retrying, which
+    //  fires the reconnect timer.
+    void *dealer = zmq_socket (ctx, ZMQ_DEALER);
+    assert (dealer);
+    int interval = 10;
+    rc = zmq_setsockopt (dealer, ZMQ_RECONNECT_IVL, &interval, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_connect (dealer, "tcp://127.0.0.1:1");
+    assert (rc == 0);
+
+    for (int i = 0; i != 1000; i++) {
+        rc = zmq_send (push, "ABC", 3, 0);
+        assert (rc == 3);
+    }
+    char buf [3];
+    for (int i = 0; i != 1000; i++) {
+        rc = zmq_recv (pull, buf, sizeof (buf), 0);
+        assert (rc == 3);
+    }
+    msleep (100);
+
+    //  The I/O threads share the work, so check the totals.
+    zmq_io_thread_stats_t total;
+    memset (&total, 0, sizeof (total));
+    for (int i = 0; i != 2; i++) {
+        rc = zmq_ctx_io_thread_stats (ctx, i, &stats);
+        assert (rc == 0);
+        assert (stats.wakeups > 0);
+        assert (stats.busy_us + stats.wait_us > 0);
+        //  The thread's mailbox is always registered.
+        assert (stats.load >= 1);
+        total.events += stats.events;
+        total.timers += stats.timers;
+        total.commands += stats.commands;
+        total.load += stats.load;
+    }
+    assert (total.events > 0);
+    assert (total.timers > 0);
+    assert (total.commands > 0);
+    //  Mailboxes, listener and the two ends of the connection at least.
+    assert (total.load >= 5);
+
+    rc = zmq_ctx_io_thread_stats (ctx, 2, &stats);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_ctx_io_thread_stats (ctx, -1, &stats);
+    assert (rc == -1 && errno == EINVAL);
+
+    close_zero_linger (dealer);
+    close_zero_linger (push);
+    close_zero_linger (pull);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    //  Without the option, only the load is reported.
+    ctx = zmq_ctx_new ();
+    assert (ctx);
+    pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    rc = zmq_bind (pull, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+    rc = zmq_ctx_io_thread_stats (ctx, 0, &stats);
+    assert (rc == 0);
+    assert (stats.wakeups == 0);
+    assert (stats.busy_us == 0 && stats.wait_us == 0);
+    assert (stats.load >= 1);
+
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
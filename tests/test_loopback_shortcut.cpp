@@ -0,0 +1,135 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Binds a PULL socket with a queue of a single message to the endpoint
+//  and connects a PUSH socket with a queue of a single message to it,
+//  using the address the PULL socket was actually bound to on the port.
+static void setup (void *ctx, const char *bind_addr, const char *host,
+    void **push, void **pull, char *endpoint, const char *zap_domain = NULL)
+{
+    *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (*pull);
+    int hwm = 1;
+    int rc = zmq_setsockopt (*pull, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    if (zap_domain) {
+        rc = zmq_setsockopt (*pull, ZMQ_ZAP_DOMAIN, zap_domain,
+            strlen (zap_domain));
+        assert (rc == 0);
+    }
+    rc = zmq_bind (*pull, bind_addr);
+    assert (rc == 0);
+
+    char bound [256];
+    size_t size = sizeof (bound);
+    rc = zmq_getsockopt (*pull, ZMQ_LAST_ENDPOINT, bound, &size);
+    assert (rc == 0);
+    sprintf (endpoint, "tcp://%s%s", host, strrchr (bound, ':'));
+
+    *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (*push);
+    rc = zmq_setsockopt (*push, ZMQ_SNDHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_connect (*push, endpoint);
+    assert (rc == 0);
+
+    //  Wait for the connection to be established.
+    rc = zmq_send (*push, "A", 1, 0);
+    assert (rc == 1);
+    char buf [8];
+    rc = zmq_recv (*pull, buf, sizeof (buf), 0);
+    assert (rc == 1);
+}
+
+//  Returns the number of messages that can be queued without blocking.
+//  An inproc connection holds the sum of both high water marks, while
+//  a TCP connection, once the I/O thread drained the queue, holds whatever
+//  fits into the kernel buffers as well.
+static int fill (void *push)
+{
+    int count = 0;
+    for (int i = 0; i < 10 && count < 100; i++) {
+        while (count < 100 && zmq_send (push, "A", 1, ZMQ_DONTWAIT) == 1)
+            count++;
+        msleep (SETTLE_TIME);
+    }
+    return count;
+}
+
+void test_shortcut (void *ctx, const char *bind_addr, const char *host)
+{
+    void *push, *pull;
+    char endpoint [256];
+    setup (ctx, bind_addr, host, &push, &pull, endpoint);
+    assert (fill (push) == 2);
+
+    //  The connection can be closed like any other.
+    int rc = zmq_disconnect (push, endpoint);
+    assert (rc == 0);
+    rc = zmq_disconnect (push, endpoint);
+    assert (rc == -1 && errno == ENOENT);
+
+    close_zero_linger (push);
+    close_zero_linger (pull);
+}
+
+void test_no_shortcut (void *ctx, const char *zap_domain)
+{
+    void *push, *pull;
+    char endpoint [256];
+    setup (ctx, "tcp://127.0.0.1:*", "127.0.0.1", &push, &pull, endpoint,
+        zap_domain);
+    assert (fill (push) > 2);
+
+    close_zero_linger (push);
+    close_zero_linger (pull);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    //  Without the shortcut, connections go over TCP.
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    assert (zmq_ctx_get (ctx, ZMQ_LOOPBACK_SHORTCUT) == 0);
+    test_no_shortcut (ctx, NULL);
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    ctx = zmq_ctx_new ();
+    assert (ctx);
+    rc = zmq_ctx_set (ctx, ZMQ_LOOPBACK_SHORTCUT, 1);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_LOOPBACK_SHORTCUT) == 1);
+
+    test_shortcut (ctx, "tcp://127.0.0.1:*", "127.0.0.1");
+    test_shortcut (ctx, "tcp://*:*", "127.0.0.1");
+    test_shortcut (ctx, "tcp://*:*", "localhost");
+
+    //  Authenticated connections go over TCP.
+    test_no_shortcut (ctx, "test");
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "testutil.hpp"
+
+//  Waits for the ring to become readable and reads all available records.
+static int read_records (void *s, zmq_monitor_record_t *records, int count)
+{
+#if defined _WIN32
+    SOCKET fd;
+#else
+    int fd;
+#endif
+    size_t fd_size = sizeof fd;
+    int rc = zmq_getsockopt (s, ZMQ_MONITOR_RING_FD, &fd, &fd_size);
+    assert (rc == 0);
+
+    int nread = 0;
+    while (nread < count) {
+        rc = zmq_monitor_ring_recv (s, records + nread, count - nread);
+        if (rc > 0) {
+            nread += rc;
+            continue;
+        }
+        assert (rc == -1 && errno == EAGAIN);
+        if (nread > 0)
+            break;
+        zmq_pollitem_t item = { NULL, fd, ZMQ_POLLIN, 0 };
+        rc = zmq_poll (&item, 1, 2000);
+        assert (rc == 1);
+    }
+    return nread;
+}
+
+static int count_events (zmq_monitor_record_t *records, int count, int event)
+{
+    int n = 0;
+    for (int i = 0; i != count; i++)
+        if (records [i].event == (uint32_t) event)
+            n++;
+    return n;
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *server = zmq_socket (ctx, ZMQ_PULL);
+    assert (server);
+
+    //  No ring yet.
+    zmq_monitor_record_t records [64];
+    int rc = zmq_monitor_ring_recv (server, records, 64);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_socket_monitor_ring (server, ZMQ_EVENT_ALL, 0);
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = zmq_socket_monitor_ring (server, ZMQ_EVENT_ALL, 16);
+    assert (rc == 0);
+    rc = zmq_bind (server, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char last_endpoint [256];
+    size_t size = sizeof last_endpoint;
+    rc = zmq_getsockopt (server, ZMQ_LAST_ENDPOINT, last_endpoint, &size);
+    assert (rc == 0);
+
+    //  Listening event carries the interned endpoint.
+    int nread = read_records (server, records, 64);
+    assert (nread == 1);
+    assert (records [0].event == ZMQ_EVENT_LISTENING);
+    char endpoint [256];
+    rc = zmq_monitor_ring_endpoint (server, records [0].endpoint,
+        endpoint, sizeof endpoint);
+    assert (rc == (int) strlen (last_endpoint));
+    assert (streq (endpoint, last_endpoint));
+    rc = zmq_monitor_ring_endpoint (server, 1000, endpoint, sizeof endpoint);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  Connection storm: more connections than the ring can hold.
+    const int clients_count = 100;
+    void *clients [clients_count];
+    for (int i = 0; i != clients_count; i++) {
+        clients [i] = zmq_socket (ctx, ZMQ_PUSH);
+        assert (clients [i]);
+        rc = zmq_connect (clients [i], last_endpoint);
+        assert (rc == 0);
+    }
+
+    //  Wait until all connections have been accepted and reported.
+    int accepted = 0;
+    uint64_t dropped = 0;
+    size_t dropped_size = sizeof dropped;
+    for (int i = 0; i != 100 && accepted + (int) dropped < clients_count;
+          i++) {
+        msleep (SETTLE_TIME * 10);
+        rc = zmq_getsockopt (server, ZMQ_MONITOR_RING_DROPPED, &dropped,
+            &dropped_size);
+        assert (rc == 0);
+        nread = zmq_monitor_ring_recv (server, records, 64);
+        if (nread > 0)
+            accepted += count_events (records, nread, ZMQ_EVENT_ACCEPTED);
+    }
+    assert (accepted + (int) dropped == clients_count);
+    assert (dropped > 0);
+
+    //  Once drained, the ring takes new records again.
+    rc = zmq_close (clients [0]);
+    assert (rc == 0);
+    nread = read_records (server, records, 64);
+    assert (count_events (records, nread, ZMQ_EVENT_DISCONNECTED) == 1);
+
+    //  Switching off pushes the stop record.
+    rc = zmq_socket_monitor_ring (server, 0, 0);
+    assert (rc == 0);
+    nread = read_records (server, records, 64);
+    assert (nread == 1);
+    assert (records [0].event == ZMQ_EVENT_MONITOR_STOPPED);
+
+    for (int i = 1; i != clients_count; i++) {
+        rc = zmq_close (clients [i]);
+        assert (rc == 0);
+    }
+    rc = zmq_close (server);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
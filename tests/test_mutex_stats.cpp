@@ -0,0 +1,88 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+int main (void)
+{
+    setup_test_environment ();
+
+    int rc = zmq_mutex_stats (NULL, -1);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  Nothing to check unless the library was built with mutex statistics.
+    rc = zmq_mutex_stats (NULL, 0);
+    if (rc == -1) {
+        assert (errno == ENOTSUP);
+        return 0;
+    }
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    rc = zmq_bind (pull, "inproc://mutex_stats");
+    assert (rc == 0);
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_connect (push, "inproc://mutex_stats");
+    assert (rc == 0);
+
+    for (int i = 0; i != 1000; i++) {
+        rc = zmq_send (push, "ABC", 3, 0);
+        assert (rc == 3);
+    }
+    char buf [3];
+    for (int i = 0; i != 1000; i++) {
+        rc = zmq_recv (pull, buf, sizeof (buf), 0);
+        assert (rc == 3);
+    }
+
+    //  The number of sites is returned even if they don't all fit.
+    int count = zmq_mutex_stats (NULL, 0);
+    assert (count > 0);
+    zmq_mutex_stats_t stats [64];
+    assert (count <= 64);
+    rc = zmq_mutex_stats (stats, 1);
+    assert (rc == count);
+    rc = zmq_mutex_stats (stats, count);
+    assert (rc == count);
+
+    //  Commands are posted to the mailboxes under their lock.
+    bool found = false;
+    for (int i = 0; i != count; i++) {
+        assert (stats [i].name);
+        assert (stats [i].contentions <= stats [i].acquisitions);
+        if (strcmp (stats [i].name, "mailbox_t::sync") == 0) {
+            assert (stats [i].acquisitions > 0);
+            found = true;
+        }
+    }
+    assert (found);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
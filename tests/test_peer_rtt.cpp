@@ -0,0 +1,190 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+static char client_public [41];
+static char client_secret [41];
+static char server_public [41];
+static char server_secret [41];
+
+static void *create (void *ctx, int type, int ping_ivl, int batch_size)
+{
+    void *s = zmq_socket (ctx, type);
+    assert (s);
+    int rc = zmq_setsockopt (s, ZMQ_PING_IVL, &ping_ivl, sizeof (ping_ivl));
+    assert (rc == 0);
+    rc = zmq_setsockopt (s, ZMQ_BATCH_SIZE, &batch_size,
+        sizeof (batch_size));
+    assert (rc == 0);
+    return s;
+}
+
+//  Returns the number of connections with statistics, waiting for each to
+//  have measured at least the given number of round trips.
+static int wait_for_samples (void *s, uint64_t samples)
+{
+    zmq_peer_rtt_stats_t stats [4];
+    size_t size = 0;
+    for (int i = 0; i < 100; i++) {
+        size = sizeof (stats);
+        int rc = zmq_getsockopt (s, ZMQ_PEER_RTT_STATS, stats, &size);
+        assert (rc == 0);
+        assert (size % sizeof (zmq_peer_rtt_stats_t) == 0);
+        bool done = size > 0;
+        for (size_t j = 0; j < size / sizeof (zmq_peer_rtt_stats_t); j++) {
+            assert (stats [j].peer != 0);
+            if (stats [j].samples < samples)
+                done = false;
+            else {
+                assert (stats [j].min_rtt <= stats [j].srtt);
+                assert (stats [j].srtt < 1000000);
+            }
+        }
+        if (done)
+            break;
+        msleep (SETTLE_TIME);
+    }
+    return (int) (size / sizeof (zmq_peer_rtt_stats_t));
+}
+
+//  Sets up the CURVE keys so that the pings travel encrypted.
+static void set_curve (void *server, void *client)
+{
+    int as_server = 1;
+    int rc = zmq_setsockopt (server, ZMQ_CURVE_SERVER, &as_server,
+        sizeof (int));
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_CURVE_SECRETKEY, server_secret, 40);
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_SERVERKEY, server_public, 40);
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_PUBLICKEY, client_public, 40);
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_SECRETKEY, client_secret, 40);
+    assert (rc == 0);
+}
+
+void test_ping (void *ctx, int client_ivl, int server_ivl, int batch_size,
+    bool curve = false)
+{
+    void *server = create (ctx, ZMQ_DEALER, server_ivl, batch_size);
+    void *client = create (ctx, ZMQ_DEALER, client_ivl, batch_size);
+    if (curve)
+        set_curve (server, client);
+    int rc = zmq_bind (server, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof (endpoint);
+    rc = zmq_getsockopt (server, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+    rc = zmq_connect (client, endpoint);
+    assert (rc == 0);
+
+    //  Commands are interleaved with the messages without affecting them,
+    //  and never get between the parts of a message.
+    char buf [8];
+    for (int i = 0; i < 1000; i++) {
+        rc = zmq_send (client, "pi", 2, ZMQ_SNDMORE);
+        assert (rc == 2);
+        rc = zmq_send (client, "ng", 2, 0);
+        assert (rc == 2);
+        if (i % 100 == 0)
+            msleep (1);
+    }
+    for (int i = 0; i < 1000; i++) {
+        int more;
+        size_t more_size = sizeof (more);
+        rc = zmq_recv (server, buf, sizeof (buf), 0);
+        assert (rc == 2 && memcmp (buf, "pi", 2) == 0);
+        rc = zmq_getsockopt (server, ZMQ_RCVMORE, &more, &more_size);
+        assert (rc == 0 && more == 1);
+        rc = zmq_recv (server, buf, sizeof (buf), 0);
+        assert (rc == 2 && memcmp (buf, "ng", 2) == 0);
+        rc = zmq_getsockopt (server, ZMQ_RCVMORE, &more, &more_size);
+        assert (rc == 0 && more == 0);
+    }
+
+    //  Round trips are measured only if both peers ask for it.
+    const int expected = client_ivl > 0 && server_ivl > 0 ? 1 : 0;
+    assert (wait_for_samples (client, 3) == expected);
+    assert (wait_for_samples (server, 3) == expected);
+
+    rc = zmq_send (server, "pong", 4, 0);
+    assert (rc == 4);
+    rc = zmq_recv (client, buf, sizeof (buf), 0);
+    assert (rc == 4 && memcmp (buf, "pong", 4) == 0);
+
+    //  A buffer too small for a single record gets nothing.
+    zmq_peer_rtt_stats_t stats [1];
+    size_t size = sizeof (stats) - 1;
+    rc = zmq_getsockopt (client, ZMQ_PEER_RTT_STATS, stats, &size);
+    assert (rc == 0);
+    assert (size == 0);
+
+    //  A missing buffer is rejected.
+    size = sizeof (stats);
+    rc = zmq_getsockopt (client, ZMQ_PEER_RTT_STATS, NULL, &size);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_getsockopt (client, ZMQ_PEER_RTT_STATS, stats, NULL);
+    assert (rc == -1 && errno == EINVAL);
+
+    close_zero_linger (client);
+    close_zero_linger (server);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *s = zmq_socket (ctx, ZMQ_DEALER);
+    assert (s);
+    int ivl;
+    size_t size = sizeof (ivl);
+    int rc = zmq_getsockopt (s, ZMQ_PING_IVL, &ivl, &size);
+    assert (rc == 0);
+    assert (ivl == 0);
+    ivl = -1;
+    rc = zmq_setsockopt (s, ZMQ_PING_IVL, &ivl, sizeof (ivl));
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_close (s);
+    assert (rc == 0);
+
+    test_ping (ctx, 10, 10, 0);
+    test_ping (ctx, 10, 10, 8192);
+    test_ping (ctx, 10, 0, 0);
+
+    //  Pings are commands and must survive the CURVE encryption as such.
+#ifdef HAVE_LIBSODIUM
+    rc = zmq_curve_keypair (client_public, client_secret);
+    assert (rc == 0);
+    rc = zmq_curve_keypair (server_public, server_secret);
+    assert (rc == 0);
+    test_ping (ctx, 10, 10, 0, true);
+    test_ping (ctx, 10, 10, 8192, true);
+#endif
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+static char client_public [41];
+static char client_secret [41];
+static char server_public [41];
+static char server_secret [41];
+
+//  Connects a client to the server, either or both using AES-GCM, and
+//  checks that messages of various sizes get through.
+static void test_pair (void *ctx, int server_aesgcm, int client_aesgcm)
+{
+    void *server = zmq_socket (ctx, ZMQ_DEALER);
+    assert (server);
+    int as_server = 1;
+    int rc = zmq_setsockopt (server, ZMQ_CURVE_SERVER, &as_server,
+        sizeof (int));
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_CURVE_SECRETKEY, server_secret, 40);
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_CURVE_AESGCM, &server_aesgcm,
+        sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (server, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t size = sizeof (endpoint);
+    rc = zmq_getsockopt (server, ZMQ_LAST_ENDPOINT, endpoint, &size);
+    assert (rc == 0);
+
+    void *client = zmq_socket (ctx, ZMQ_DEALER);
+    assert (client);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_SERVERKEY, server_public, 40);
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_PUBLICKEY, client_public, 40);
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_SECRETKEY, client_secret, 40);
+    assert (rc == 0);
+    rc = zmq_setsockopt (client, ZMQ_CURVE_AESGCM, &client_aesgcm,
+        sizeof (int));
+    assert (rc == 0);
+    rc = zmq_connect (client, endpoint);
+    assert (rc == 0);
+
+    bounce (server, client);
+
+    //  Exercise empty messages, partial blocks and multipart messages.
+    static char buf [5000];
+    const size_t sizes [] = {0, 1, 15, 16, 17, 63, 64, 65, 1000, 5000};
+    const int count = sizeof (sizes) / sizeof (sizes [0]);
+    for (int i = 0; i != count; i++) {
+        memset (buf, i, sizes [i]);
+        rc = zmq_send (client, buf, sizes [i], i + 1 < count ? ZMQ_SNDMORE : 0);
+        assert (rc == (int) sizes [i]);
+    }
+    for (int i = 0; i != count; i++) {
+        char rbuf [5000];
+        rc = zmq_recv (server, rbuf, sizeof (rbuf), 0);
+        assert (rc == (int) sizes [i]);
+        for (size_t j = 0; j != sizes [i]; j++)
+            assert (rbuf [j] == (char) i);
+        int more;
+        size_t more_size = sizeof (more);
+        rc = zmq_getsockopt (server, ZMQ_RCVMORE, &more, &more_size);
+        assert (rc == 0);
+        assert (more == (i + 1 < count));
+    }
+
+    close_zero_linger (client);
+    close_zero_linger (server);
+}
+
+int main (void)
+{
+#ifndef HAVE_LIBSODIUM
+    printf ("libsodium not installed, skipping CURVE AES-GCM test\n");
+    return 0;
+#endif
+
+    int rc = zmq_curve_keypair (client_public, client_secret);
+    assert (rc == 0);
+    rc = zmq_curve_keypair (server_public, server_secret);
+    assert (rc == 0);
+
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *s = zmq_socket (ctx, ZMQ_DEALER);
+    assert (s);
+    int value;
+    size_t size = sizeof (value);
+    rc = zmq_getsockopt (s, ZMQ_CURVE_AESGCM, &value, &size);
+    assert (rc == 0);
+    assert (value == 0);
+    value = 2;
+    rc = zmq_setsockopt (s, ZMQ_CURVE_AESGCM, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_close (s);
+    assert (rc == 0);
+
+    //  AES-GCM is used if both peers ask for it, otherwise the connection
+    //  falls back to plain CURVE.
+    test_pair (ctx, 1, 1);
+    test_pair (ctx, 1, 0);
+    test_pair (ctx, 0, 1);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
@@ -0,0 +1,274 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "testutil.hpp"
+
+//  Client sends raw bytes over a plain ZMQ_STREAM socket; the server uses
+//  the requested framing decoder and must see whole application frames.
+
+static void send_raw (void *client, const void *id, size_t id_size,
+    const char *data, size_t size)
+{
+    int rc = zmq_send (client, id, id_size, ZMQ_SNDMORE);
+    assert (rc == (int) id_size);
+    rc = zmq_send (client, data, size, 0);
+    assert (rc == (int) size);
+}
+
+static void recv_frame (void *server, const char *expected, size_t size)
+{
+    char id [256];
+    int rc = zmq_recv (server, id, sizeof id, 0);
+    assert (rc > 0);
+
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&msg, server, 0);
+    assert (rc == (int) size);
+    assert (memcmp (zmq_msg_data (&msg), expected, size) == 0);
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+}
+
+static void *bind_server (void *ctx, int framing, char *endpoint)
+{
+    void *server = zmq_socket (ctx, ZMQ_STREAM);
+    assert (server);
+    int frame_size = 5;
+    int rc = zmq_setsockopt (server, ZMQ_STREAM_FRAME_SIZE,
+        &frame_size, sizeof frame_size);
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_STREAM_DELIMITER, "\r\n", 2);
+    assert (rc == 0);
+    rc = zmq_setsockopt (server, ZMQ_STREAM_FRAMING,
+        &framing, sizeof framing);
+    assert (rc == 0);
+    rc = zmq_bind (server, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    size_t endpoint_size = 256;
+    rc = zmq_getsockopt (server, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+    return server;
+}
+
+static void test_framing (void *ctx, int framing,
+    const char *wire, size_t wire_size, const char **frames, int frame_count)
+{
+    char endpoint [256];
+    void *server = bind_server (ctx, framing, endpoint);
+    int rc;
+
+    void *client = zmq_socket (ctx, ZMQ_STREAM);
+    assert (client);
+    rc = zmq_connect (client, endpoint);
+    assert (rc == 0);
+
+    //  Both sides get a connect notification: identity and empty frame.
+    char id [256];
+    size_t id_size = zmq_recv (client, id, sizeof id, 0);
+    assert (id_size > 0);
+    rc = zmq_recv (client, NULL, 0, 0);
+    assert (rc == 0);
+    recv_frame (server, "", 0);
+
+    //  Dribble the data in small chunks so that frames, length prefixes
+    //  and delimiters get split between reads.
+    for (size_t pos = 0; pos < wire_size; pos += 3) {
+        size_t chunk = wire_size - pos < 3 ? wire_size - pos : 3;
+        send_raw (client, id, id_size, wire + pos, chunk);
+        msleep (1);
+    }
+    for (int i = 0; i != frame_count; i++)
+        recv_frame (server, frames [i], strlen (frames [i]));
+
+    rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (server);
+    assert (rc == 0);
+}
+
+static void test_large_frame (void *ctx, int framing)
+{
+    char endpoint [256];
+    void *server = bind_server (ctx, framing, endpoint);
+    int rc;
+
+    void *client = zmq_socket (ctx, ZMQ_STREAM);
+    assert (client);
+    rc = zmq_connect (client, endpoint);
+    assert (rc == 0);
+
+    char id [256];
+    size_t id_size = zmq_recv (client, id, sizeof id, 0);
+    assert (id_size > 0);
+    rc = zmq_recv (client, NULL, 0, 0);
+    assert (rc == 0);
+    recv_frame (server, "", 0);
+
+    //  A frame larger than the engine's input batch grows the receive
+    //  buffer, either to the announced length or while the delimiter is
+    //  searched for across several reads.
+    const size_t size = 100000;
+    char *wire = (char *) malloc (size + 4);
+    assert (wire);
+    for (size_t i = 0; i != size; i++)
+        wire [i + 4] = (char) ('a' + i % 26);
+    if (framing == ZMQ_FRAMING_LENGTH32) {
+        wire [0] = 0;
+        wire [1] = (char) ((size >> 16) & 0xff);
+        wire [2] = (char) ((size >> 8) & 0xff);
+        wire [3] = (char) (size & 0xff);
+        send_raw (client, id, id_size, wire, size + 4);
+    }
+    else {
+        send_raw (client, id, id_size, wire + 4, size);
+        send_raw (client, id, id_size, "\r\n", 2);
+    }
+    recv_frame (server, wire + 4, size);
+    free (wire);
+
+    rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (server);
+    assert (rc == 0);
+}
+
+static void test_held_frames (void *ctx)
+{
+    char endpoint [256];
+    void *server = bind_server (ctx, ZMQ_FRAMING_LENGTH16, endpoint);
+    int rc;
+
+    void *client = zmq_socket (ctx, ZMQ_STREAM);
+    assert (client);
+    rc = zmq_connect (client, endpoint);
+    assert (rc == 0);
+
+    char id [256];
+    size_t id_size = zmq_recv (client, id, sizeof id, 0);
+    assert (id_size > 0);
+    rc = zmq_recv (client, NULL, 0, 0);
+    assert (rc == 0);
+    recv_frame (server, "", 0);
+
+    //  Large frames refer to the receive buffer. Keep all of them open
+    //  while more data arrive; none of them may be overwritten.
+    const int count = 100;
+    const size_t size = 1000;
+    char wire [size + 2];
+    wire [0] = (char) (size >> 8);
+    wire [1] = (char) (size & 0xff);
+    for (int i = 0; i != count; i++) {
+        memset (wire + 2, 'A' + i % 26, size);
+        send_raw (client, id, id_size, wire, sizeof wire);
+    }
+
+    zmq_msg_t msgs [count];
+    for (int i = 0; i != count; i++) {
+        rc = zmq_recv (server, id, sizeof id, 0);
+        assert (rc > 0);
+        rc = zmq_msg_init (&msgs [i]);
+        assert (rc == 0);
+        rc = zmq_msg_recv (&msgs [i], server, 0);
+        assert (rc == (int) size);
+    }
+    for (int i = 0; i != count; i++) {
+        memset (wire + 2, 'A' + i % 26, size);
+        assert (memcmp (zmq_msg_data (&msgs [i]), wire + 2, size) == 0);
+        rc = zmq_msg_close (&msgs [i]);
+        assert (rc == 0);
+    }
+
+    rc = zmq_close (client);
+    assert (rc == 0);
+    rc = zmq_close (server);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Invalid framing values are rejected.
+    void *s = zmq_socket (ctx, ZMQ_STREAM);
+    assert (s);
+    int value = 5;
+    int rc = zmq_setsockopt (s, ZMQ_STREAM_FRAMING, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    value = -1;
+    rc = zmq_setsockopt (s, ZMQ_STREAM_FRAME_SIZE, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  Fixed-size and delimiter framing need their parameter by the time
+    //  the socket is bound or connected, whatever order they are set in.
+    value = ZMQ_FRAMING_FIXED;
+    rc = zmq_setsockopt (s, ZMQ_STREAM_FRAMING, &value, sizeof value);
+    assert (rc == 0);
+    rc = zmq_bind (s, "tcp://127.0.0.1:*");
+    assert (rc == -1 && errno == EINVAL);
+    value = 5;
+    rc = zmq_setsockopt (s, ZMQ_STREAM_FRAME_SIZE, &value, sizeof value);
+    assert (rc == 0);
+    rc = zmq_bind (s, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+
+    //  Setting the frame size to 0 or the delimiter to nothing clears it.
+    value = 0;
+    rc = zmq_setsockopt (s, ZMQ_STREAM_FRAME_SIZE, &value, sizeof value);
+    assert (rc == 0);
+    rc = zmq_connect (s, "tcp://127.0.0.1:5560");
+    assert (rc == -1 && errno == EINVAL);
+    value = ZMQ_FRAMING_DELIMITER;
+    rc = zmq_setsockopt (s, ZMQ_STREAM_FRAMING, &value, sizeof value);
+    assert (rc == 0);
+    rc = zmq_setsockopt (s, ZMQ_STREAM_DELIMITER, "\n", 1);
+    assert (rc == 0);
+    rc = zmq_setsockopt (s, ZMQ_STREAM_DELIMITER, NULL, 0);
+    assert (rc == 0);
+    rc = zmq_connect (s, "tcp://127.0.0.1:5560");
+    assert (rc == -1 && errno == EINVAL);
+    size_t value_size = sizeof value;
+    rc = zmq_getsockopt (s, ZMQ_STREAM_FRAMING, &value, &value_size);
+    assert (rc == 0 && value == ZMQ_FRAMING_DELIMITER);
+    rc = zmq_close (s);
+    assert (rc == 0);
+
+    //  Empty frames are delivered as empty messages.
+    const char *frames [] = { "hello", "world", "", "0MQ!!" };
+    const char *fixed_frames [] = { "hello", "world", "0MQ!!" };
+
+    test_framing (ctx, ZMQ_FRAMING_FIXED,
+        "helloworld0MQ!!", 15, fixed_frames, 3);
+    test_framing (ctx, ZMQ_FRAMING_LENGTH16,
+        "\0\5hello\0\5world\0\0\0\5" "0MQ!!", 23, frames, 4);
+    test_framing (ctx, ZMQ_FRAMING_LENGTH32,
+        "\0\0\0\5hello\0\0\0\5world\0\0\0\0\0\0\0\5" "0MQ!!",
+        31, frames, 4);
+    test_framing (ctx, ZMQ_FRAMING_DELIMITER,
+        "hello\r\nworld\r\n\r\n0MQ!!\r\n", 23, frames, 4);
+    test_large_frame (ctx, ZMQ_FRAMING_LENGTH32);
+    test_large_frame (ctx, ZMQ_FRAMING_DELIMITER);
+    test_held_frames (ctx);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+
+//  Creates a listening socket that drops incoming SYNs. The accept queue
+//  of the socket is filled up by connections that are never accepted.
+static int syn_dropper (const sockaddr *addr_, socklen_t addrlen_,
+    int *fillers_, int nfillers_)
+{
+    int s = socket (addr_->sa_family, SOCK_STREAM, IPPROTO_TCP);
+    assert (s != -1);
+    int flag = 1;
+    int rc = setsockopt (s, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof (int));
+    assert (rc == 0);
+    rc = bind (s, addr_, addrlen_);
+    assert (rc == 0);
+    rc = listen (s, 0);
+    assert (rc == 0);
+
+    for (int i = 0; i != nfillers_; i++) {
+        fillers_ [i] = socket (addr_->sa_family, SOCK_STREAM, IPPROTO_TCP);
+        assert (fillers_ [i] != -1);
+        rc = fcntl (fillers_ [i], F_SETFL, O_NONBLOCK);
+        assert (rc == 0);
+        connect (fillers_ [i], addr_, addrlen_);
+    }
+    msleep (SETTLE_TIME * 10);
+    return s;
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *sc = zmq_socket (ctx, ZMQ_DEALER);
+    assert (sc);
+    int stagger = 100;
+    int rc = zmq_setsockopt (sc, ZMQ_TCP_CONNECT_STAGGER, &stagger,
+        sizeof (int));
+    assert (rc == 0);
+    stagger = 0;
+    size_t size = sizeof (stagger);
+    rc = zmq_getsockopt (sc, ZMQ_TCP_CONNECT_STAGGER, &stagger, &size);
+    assert (rc == 0);
+    assert (stagger == 100);
+
+    int invalid = -1;
+    rc = zmq_setsockopt (sc, ZMQ_TCP_CONNECT_STAGGER, &invalid, sizeof (int));
+    assert (rc == -1 && errno == EINVAL);
+
+    int ipv6 = 1;
+    rc = zmq_setsockopt (sc, ZMQ_IPV6, &ipv6, sizeof (int));
+    assert (rc == 0);
+
+    //  Find out what the local hostname resolves to.
+    addrinfo req;
+    memset (&req, 0, sizeof (req));
+    req.ai_family = AF_UNSPEC;
+    req.ai_socktype = SOCK_STREAM;
+    addrinfo *res;
+    rc = getaddrinfo ("localhost", NULL, &req, &res);
+    assert (rc == 0);
+
+    void *sb = zmq_socket (ctx, ZMQ_DEALER);
+    assert (sb);
+    rc = zmq_setsockopt (sb, ZMQ_IPV6, &ipv6, sizeof (int));
+    assert (rc == 0);
+    int timeout = 2000;
+    rc = zmq_setsockopt (sb, ZMQ_RCVTIMEO, &timeout, sizeof (int));
+    assert (rc == 0);
+
+    int dropper = -1;
+    int fillers [2];
+    char endpoint [256];
+    if (res->ai_next) {
+        //  The name has several addresses. Make the first one unreachable
+        //  and check that the connection to the second one is established
+        //  long before the connection to the first one would time out.
+        char host [NI_MAXHOST];
+        rc = getnameinfo (res->ai_next->ai_addr, res->ai_next->ai_addrlen,
+            host, sizeof (host), NULL, 0, NI_NUMERICHOST);
+        assert (rc == 0);
+        std::string wildcard = res->ai_next->ai_family == AF_INET6 ?
+            std::string ("tcp://[") + host + "]:*" :
+            std::string ("tcp://") + host + ":*";
+        rc = zmq_bind (sb, wildcard.c_str ());
+        assert (rc == 0);
+    }
+    else {
+        //  Only a single address is available, so there's nothing to race.
+        //  Just check the connection is established as usual.
+        rc = zmq_bind (sb, "tcp://127.0.0.1:*");
+        assert (rc == 0);
+    }
+    size = sizeof (endpoint);
+    rc = zmq_getsockopt (sb, ZMQ_LAST_ENDPOINT, endpoint, &size);
+    assert (rc == 0);
+    const char *port = strrchr (endpoint, ':') + 1;
+
+    if (res->ai_next) {
+        //  Listen on the same port of the first address, but never accept.
+        if (res->ai_family == AF_INET6)
+            ((sockaddr_in6*) res->ai_addr)->sin6_port = htons (atoi (port));
+        else
+            ((sockaddr_in*) res->ai_addr)->sin_port = htons (atoi (port));
+        dropper = syn_dropper (res->ai_addr, res->ai_addrlen, fillers, 2);
+    }
+    freeaddrinfo (res);
+
+    rc = zmq_connect (sc, (std::string ("tcp://localhost:") + port).c_str ());
+    assert (rc == 0);
+
+    rc = zmq_send (sc, "ABC", 3, 0);
+    assert (rc == 3);
+    char buffer [3];
+    rc = zmq_recv (sb, buffer, 3, 0);
+    assert (rc == 3);
+    assert (memcmp (buffer, "ABC", 3) == 0);
+
+    close_zero_linger (sc);
+    close_zero_linger (sb);
+
+    if (dropper != -1) {
+        close (fillers [0]);
+        close (fillers [1]);
+        close (dropper);
+    }
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0 ;
+}
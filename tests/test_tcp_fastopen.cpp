@@ -0,0 +1,111 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *sb = zmq_socket (ctx, ZMQ_REP);
+    assert (sb);
+    int fastopen = 1;
+    int rc = zmq_setsockopt (sb, ZMQ_TCP_FASTOPEN, &fastopen, sizeof (int));
+    assert (rc == 0);
+    fastopen = 0;
+    size_t size = sizeof (fastopen);
+    rc = zmq_getsockopt (sb, ZMQ_TCP_FASTOPEN, &fastopen, &size);
+    assert (rc == 0);
+    assert (fastopen == 1);
+
+    //  Only 0 and 1 are valid values.
+    int invalid = 2;
+    rc = zmq_setsockopt (sb, ZMQ_TCP_FASTOPEN, &invalid, sizeof (int));
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = zmq_bind (sb, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size = sizeof (endpoint);
+    rc = zmq_getsockopt (sb, ZMQ_LAST_ENDPOINT, endpoint, &size);
+    assert (rc == 0);
+
+    //  Several short-lived clients in a row. The first one obtains
+    //  the Fast Open cookie, the later ones (if the kernel allows) send
+    //  the greeting in the SYN. Either way, requests must get through.
+    char buffer [3];
+    for (int i = 0; i != 5; i++) {
+        void *sc = zmq_socket (ctx, ZMQ_REQ);
+        assert (sc);
+        rc = zmq_setsockopt (sc, ZMQ_TCP_FASTOPEN, &fastopen, sizeof (int));
+        assert (rc == 0);
+        rc = zmq_connect (sc, endpoint);
+        assert (rc == 0);
+
+        rc = zmq_send (sc, "ABC", 3, 0);
+        assert (rc == 3);
+        rc = zmq_recv (sb, buffer, 3, 0);
+        assert (rc == 3);
+        rc = zmq_send (sb, buffer, 3, 0);
+        assert (rc == 3);
+        rc = zmq_recv (sc, buffer, 3, 0);
+        assert (rc == 3);
+        assert (memcmp (buffer, "ABC", 3) == 0);
+
+        close_zero_linger (sc);
+    }
+
+    //  With Fast Open, a refused connection is reported by the engine rather
+    //  than by the connecter. Check that the socket keeps reconnecting until
+    //  the peer shows up again on the port just released.
+    rc = zmq_close (sb);
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+
+    void *sc = zmq_socket (ctx, ZMQ_DEALER);
+    assert (sc);
+    rc = zmq_setsockopt (sc, ZMQ_TCP_FASTOPEN, &fastopen, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_connect (sc, endpoint);
+    assert (rc == 0);
+    rc = zmq_send (sc, "ABC", 3, 0);
+    assert (rc == 3);
+
+    msleep (SETTLE_TIME);
+
+    sb = zmq_socket (ctx, ZMQ_DEALER);
+    assert (sb);
+    rc = zmq_setsockopt (sb, ZMQ_TCP_FASTOPEN, &fastopen, sizeof (int));
+    assert (rc == 0);
+    rc = zmq_bind (sb, endpoint);
+    assert (rc == 0);
+    rc = zmq_recv (sb, buffer, 3, 0);
+    assert (rc == 3);
+    assert (memcmp (buffer, "ABC", 3) == 0);
+
+    close_zero_linger (sc);
+    close_zero_linger (sb);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0 ;
+}
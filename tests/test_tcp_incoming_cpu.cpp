@@ -0,0 +1,93 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Use several I/O threads, pinned to the CPU cores, so that
+    //  connections can be handed to the thread of the CPU their packets
+    //  arrive on.
+    int rc = zmq_ctx_set (ctx, ZMQ_IO_THREADS, 4);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_IO_THREAD_PINNING) == 0);
+    rc = zmq_ctx_set (ctx, ZMQ_IO_THREAD_PINNING, 1);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_IO_THREAD_PINNING) == 1);
+
+    void *sb = zmq_socket (ctx, ZMQ_DEALER);
+    assert (sb);
+    int incoming_cpu = 1;
+    rc = zmq_setsockopt (sb, ZMQ_TCP_INCOMING_CPU, &incoming_cpu,
+        sizeof (incoming_cpu));
+    assert (rc == 0);
+    incoming_cpu = 0;
+    size_t size = sizeof (incoming_cpu);
+    rc = zmq_getsockopt (sb, ZMQ_TCP_INCOMING_CPU, &incoming_cpu, &size);
+    assert (rc == 0);
+    assert (incoming_cpu == 1);
+
+    //  Only 0 and 1 are valid values.
+    int invalid = 2;
+    rc = zmq_setsockopt (sb, ZMQ_TCP_INCOMING_CPU, &invalid, sizeof (invalid));
+    assert (rc == -1 && errno == EINVAL);
+
+    rc = zmq_bind (sb, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size = sizeof (endpoint);
+    rc = zmq_getsockopt (sb, ZMQ_LAST_ENDPOINT, endpoint, &size);
+    assert (rc == 0);
+
+    //  Whichever I/O thread the accepted connections end up in, they
+    //  must be fully functional.
+    void *clients [8];
+    for (int i = 0; i != 8; i++) {
+        clients [i] = zmq_socket (ctx, ZMQ_DEALER);
+        assert (clients [i]);
+        rc = zmq_connect (clients [i], endpoint);
+        assert (rc == 0);
+    }
+    for (int i = 0; i != 8; i++) {
+        rc = zmq_send (clients [i], "ABC", 3, 0);
+        assert (rc == 3);
+    }
+    char buffer [3];
+    for (int i = 0; i != 8; i++) {
+        rc = zmq_recv (sb, buffer, 3, 0);
+        assert (rc == 3);
+        assert (memcmp (buffer, "ABC", 3) == 0);
+    }
+
+    for (int i = 0; i != 8; i++) {
+        rc = zmq_close (clients [i]);
+        assert (rc == 0);
+    }
+    rc = zmq_close (sb);
+    assert (rc == 0);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0 ;
+}
@@ -0,0 +1,407 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+const int peers = 4;
+
+static void *create (void *ctx, int type, const char *identity)
+{
+    void *s = zmq_socket (ctx, type);
+    assert (s);
+    int mux = 1;
+    int rc = zmq_setsockopt (s, ZMQ_TCP_MUX, &mux, sizeof (mux));
+    assert (rc == 0);
+    if (identity) {
+        rc = zmq_setsockopt (s, ZMQ_IDENTITY, identity, strlen (identity));
+        assert (rc == 0);
+    }
+    int timeout = 5000;
+    rc = zmq_setsockopt (s, ZMQ_RCVTIMEO, &timeout, sizeof (timeout));
+    assert (rc == 0);
+    return s;
+}
+
+//  Sends a request from the dealer and the reply back from the router.
+static void round_trip (void *router, void *dealer, const char *identity)
+{
+    int rc = zmq_send (dealer, "request", 7, 0);
+    assert (rc == 7);
+
+    char buf [32];
+    rc = zmq_recv (router, buf, sizeof (buf), 0);
+    assert (rc == (int) strlen (identity));
+    assert (memcmp (buf, identity, rc) == 0);
+    rc = zmq_recv (router, buf, sizeof (buf), 0);
+    assert (rc == 7 && memcmp (buf, "request", 7) == 0);
+
+    rc = zmq_send (router, identity, strlen (identity), ZMQ_SNDMORE);
+    assert (rc == (int) strlen (identity));
+    rc = zmq_send (router, "reply", 5, 0);
+    assert (rc == 5);
+    rc = zmq_recv (dealer, buf, sizeof (buf), 0);
+    assert (rc == 5 && memcmp (buf, "reply", 5) == 0);
+}
+
+//  Returns the number of connections the listener has accepted so far.
+static int accepted (void *monitor)
+{
+    int count = 0;
+    while (true) {
+        zmq_msg_t msg;
+        zmq_msg_init (&msg);
+        int rc = zmq_msg_recv (&msg, monitor, ZMQ_DONTWAIT);
+        if (rc == -1) {
+            assert (errno == EAGAIN);
+            zmq_msg_close (&msg);
+            return count;
+        }
+        uint16_t event;
+        memcpy (&event, zmq_msg_data (&msg), sizeof (event));
+        if (event == ZMQ_EVENT_ACCEPTED)
+            count++;
+        assert (zmq_msg_more (&msg));
+        rc = zmq_msg_recv (&msg, monitor, 0);
+        assert (rc != -1);
+        zmq_msg_close (&msg);
+    }
+}
+
+static void put_uint32 (unsigned char *buffer, uint32_t value)
+{
+    buffer [0] = (unsigned char) (value >> 24);
+    buffer [1] = (unsigned char) (value >> 16);
+    buffer [2] = (unsigned char) (value >> 8);
+    buffer [3] = (unsigned char) value;
+}
+
+static uint32_t get_uint32 (const unsigned char *buffer)
+{
+    return ((uint32_t) buffer [0] << 24) | ((uint32_t) buffer [1] << 16) |
+        ((uint32_t) buffer [2] << 8) | buffer [3];
+}
+
+//  Raw ZMTP peer talking to a multiplexing socket through a STREAM socket.
+struct raw_peer_t
+{
+    void *stream;
+    unsigned char id [256];
+    int id_size;
+    unsigned char buf [4096];
+    size_t size;
+};
+
+static void raw_send (raw_peer_t *peer, const void *data, size_t size)
+{
+    int rc = zmq_send (peer->stream, peer->id, peer->id_size, ZMQ_SNDMORE);
+    assert (rc == peer->id_size);
+    rc = zmq_send (peer->stream, data, size, 0);
+    assert (rc == (int) size);
+}
+
+static void raw_send_frame (raw_peer_t *peer, unsigned char flags,
+    const void *data, size_t size)
+{
+    unsigned char frame [256];
+    assert (size + 2 <= sizeof (frame));
+    frame [0] = flags;
+    frame [1] = (unsigned char) size;
+    memcpy (frame + 2, data, size);
+    raw_send (peer, frame, size + 2);
+}
+
+static void raw_send_command (raw_peer_t *peer, const char *name,
+    uint32_t channel, const char *body)
+{
+    unsigned char data [64];
+    const size_t name_size = strlen (name);
+    const size_t body_size = body ? strlen (body) : 0;
+    data [0] = (unsigned char) name_size;
+    memcpy (data + 1, name, name_size);
+    put_uint32 (data + 1 + name_size, channel);
+    memcpy (data + 1 + name_size + 4, body, body_size);
+    raw_send_frame (peer, 0x04, data, 1 + name_size + 4 + body_size);
+}
+
+//  Reads frames till the multiplexer command with the given name arrives
+//  for the channel, and returns its body.
+static uint32_t raw_wait_command (raw_peer_t *peer, const char *name,
+    uint32_t channel)
+{
+    const size_t name_size = strlen (name);
+    while (true) {
+        //  Parse what's buffered so far.
+        while (peer->size >= 2 && !(peer->buf [0] & 0x02) &&
+              peer->size >= 2 + (size_t) peer->buf [1]) {
+            const size_t frame_size = 2 + peer->buf [1];
+            const unsigned char *body = peer->buf + 2;
+            const bool found = (peer->buf [0] & 0x04) &&
+                peer->buf [1] >= 1 + name_size + 4 && body [0] == name_size &&
+                memcmp (body + 1, name, name_size) == 0 &&
+                get_uint32 (body + 1 + name_size) == channel;
+            uint32_t value = 0;
+            if (found && peer->buf [1] >= 1 + name_size + 8)
+                value = get_uint32 (body + 1 + name_size + 4);
+            memmove (peer->buf, peer->buf + frame_size,
+                peer->size - frame_size);
+            peer->size -= frame_size;
+            if (found)
+                return value;
+        }
+        //  The frames in this test are all short ones.
+        assert (peer->size == 0 || !(peer->buf [0] & 0x02));
+
+        unsigned char id [256];
+        int rc = zmq_recv (peer->stream, id, sizeof (id), 0);
+        assert (rc == peer->id_size);
+        rc = zmq_recv (peer->stream, peer->buf + peer->size,
+            sizeof (peer->buf) - peer->size, 0);
+        assert (rc > 0);
+        peer->size += rc;
+    }
+}
+
+//  The multiplexer closes the channel of a peer sending more messages
+//  than it was granted credit for.
+static void test_credit_exceeded (void *ctx)
+{
+    void *router = create (ctx, ZMQ_ROUTER, NULL);
+    int hwm = 2;
+    int rc = zmq_setsockopt (router, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_bind (router, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof (endpoint);
+    rc = zmq_getsockopt (router, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+
+    raw_peer_t peer;
+    peer.size = 0;
+    peer.stream = zmq_socket (ctx, ZMQ_STREAM);
+    assert (peer.stream);
+    int timeout = 5000;
+    rc = zmq_setsockopt (peer.stream, ZMQ_RCVTIMEO, &timeout,
+        sizeof (timeout));
+    assert (rc == 0);
+    rc = zmq_connect (peer.stream, endpoint);
+    assert (rc == 0);
+    peer.id_size = zmq_recv (peer.stream, peer.id, sizeof (peer.id), 0);
+    assert (peer.id_size > 0);
+    rc = zmq_recv (peer.stream, peer.buf, sizeof (peer.buf), 0);
+    assert (rc == 0);
+
+    //  Greeting and handshake, then read past the peer's greeting.
+    const unsigned char greeting [64] = {0xff, 0, 0, 0, 0, 0, 0, 0, 1, 0x7f,
+        3, 0, 'N', 'U', 'L', 'L'};
+    raw_send (&peer, greeting, sizeof (greeting));
+    const unsigned char ready [] = {5, 'R', 'E', 'A', 'D', 'Y',
+        11, 'S', 'o', 'c', 'k', 'e', 't', '-', 'T', 'y', 'p', 'e',
+        0, 0, 0, 6, 'D', 'E', 'A', 'L', 'E', 'R',
+        5, 'X', '-', 'M', 'u', 'x', 0, 0, 0, 1, '1'};
+    raw_send_frame (&peer, 0x04, ready, sizeof (ready));
+    while (peer.size < sizeof (greeting)) {
+        unsigned char id [256];
+        rc = zmq_recv (peer.stream, id, sizeof (id), 0);
+        assert (rc == peer.id_size);
+        rc = zmq_recv (peer.stream, peer.buf + peer.size,
+            sizeof (peer.buf) - peer.size, 0);
+        assert (rc > 0);
+        peer.size += rc;
+    }
+    memmove (peer.buf, peer.buf + sizeof (greeting),
+        peer.size - sizeof (greeting));
+    peer.size -= sizeof (greeting);
+
+    //  Open a channel and send more messages than the router can take.
+    //  Credit is given back only for what its pipe has room for.
+    raw_send_command (&peer, "OPEN", 1, "raw");
+    const uint32_t credit = raw_wait_command (&peer, "CREDIT", 1);
+    assert (credit == (uint32_t) hwm);
+    raw_send_command (&peer, "CHANNEL", 1, NULL);
+    for (int i = 0; i < 4 * hwm; i++)
+        raw_send_frame (&peer, 0, "message", 7);
+    raw_wait_command (&peer, "CLOSE", 1);
+
+    //  No more than the pipe took before the channel was closed got
+    //  through.
+    timeout = 250;
+    rc = zmq_setsockopt (router, ZMQ_RCVTIMEO, &timeout, sizeof (timeout));
+    assert (rc == 0);
+    char buf [32];
+    int received = 0;
+    while (true) {
+        rc = zmq_recv (router, buf, sizeof (buf), 0);
+        if (rc == -1) {
+            assert (errno == EAGAIN);
+            break;
+        }
+        assert (rc == 3 && memcmp (buf, "raw", 3) == 0);
+        rc = zmq_recv (router, buf, sizeof (buf), 0);
+        assert (rc == 7 && memcmp (buf, "message", 7) == 0);
+        received++;
+    }
+    assert (received <= hwm);
+
+    close_zero_linger (peer.stream);
+    close_zero_linger (router);
+}
+
+//  The context terminates while the connection of a closed dealer is
+//  still being established.
+static void test_term_connecting ()
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Nobody listens on the endpoint once the router is gone.
+    void *router = create (ctx, ZMQ_ROUTER, NULL);
+    int rc = zmq_bind (router, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof (endpoint);
+    rc = zmq_getsockopt (router, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+    close_zero_linger (router);
+
+    for (int i = 0; i < peers; i++) {
+        void *dealer = create (ctx, ZMQ_DEALER, NULL);
+        rc = zmq_connect (dealer, endpoint);
+        assert (rc == 0);
+        close_zero_linger (dealer);
+    }
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *s = zmq_socket (ctx, ZMQ_DEALER);
+    assert (s);
+    int mux;
+    size_t size = sizeof (mux);
+    int rc = zmq_getsockopt (s, ZMQ_TCP_MUX, &mux, &size);
+    assert (rc == 0);
+    assert (mux == 0);
+    mux = 2;
+    rc = zmq_setsockopt (s, ZMQ_TCP_MUX, &mux, sizeof (mux));
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_close (s);
+    assert (rc == 0);
+
+    void *router = create (ctx, ZMQ_ROUTER, NULL);
+    rc = zmq_socket_monitor (router, "inproc://monitor.router",
+        ZMQ_EVENT_ACCEPTED);
+    assert (rc == 0);
+    void *monitor = zmq_socket (ctx, ZMQ_PAIR);
+    assert (monitor);
+    rc = zmq_connect (monitor, "inproc://monitor.router");
+    assert (rc == 0);
+
+    rc = zmq_bind (router, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof (endpoint);
+    rc = zmq_getsockopt (router, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+
+    //  The dealers get channels of a single connection, each of them with
+    //  an identity of its own.
+    const char *identities [peers] = {"A", "B", "C", "D"};
+    void *dealers [peers];
+    for (int i = 0; i < peers; i++) {
+        dealers [i] = create (ctx, ZMQ_DEALER, identities [i]);
+        rc = zmq_connect (dealers [i], endpoint);
+        assert (rc == 0);
+    }
+    for (int i = 0; i < peers; i++)
+        round_trip (router, dealers [i], identities [i]);
+    msleep (SETTLE_TIME);
+    assert (accepted (monitor) == 1);
+
+    //  A dealer that doesn't read holds only its own channel up. The
+    //  messages it has no room for stay with the router, which drops
+    //  them once its pipe is full.
+    int hwm = 10;
+    void *slow = create (ctx, ZMQ_DEALER, "slow");
+    rc = zmq_setsockopt (slow, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_connect (slow, endpoint);
+    assert (rc == 0);
+    round_trip (router, slow, "slow");
+
+    for (int i = 0; i < 10000; i++) {
+        rc = zmq_send (router, "slow", 4, ZMQ_SNDMORE);
+        assert (rc == 4);
+        rc = zmq_send (router, &i, sizeof (i), 0);
+        assert (rc == sizeof (i));
+    }
+    for (int j = 0; j < 10; j++)
+        for (int i = 0; i < peers; i++)
+            round_trip (router, dealers [i], identities [i]);
+
+    //  What the slow dealer gets arrives in order.
+    int received = 0;
+    int last = -1;
+    int timeout = 250;
+    rc = zmq_setsockopt (slow, ZMQ_RCVTIMEO, &timeout, sizeof (timeout));
+    assert (rc == 0);
+    while (true) {
+        int value;
+        rc = zmq_recv (slow, &value, sizeof (value), 0);
+        if (rc == -1) {
+            assert (errno == EAGAIN);
+            break;
+        }
+        assert (rc == sizeof (value));
+        assert (value > last);
+        last = value;
+        received++;
+    }
+    assert (received >= hwm);
+    round_trip (router, slow, "slow");
+
+    //  Closing a dealer closes its channel only.
+    close_zero_linger (slow);
+    close_zero_linger (dealers [0]);
+    for (int i = 1; i < peers; i++)
+        round_trip (router, dealers [i], identities [i]);
+    msleep (SETTLE_TIME);
+    assert (accepted (monitor) == 0);
+
+    for (int i = 1; i < peers; i++)
+        close_zero_linger (dealers [i]);
+    close_zero_linger (router);
+    close_zero_linger (monitor);
+
+    test_credit_exceeded (ctx);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    test_term_connecting ();
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+static void recv_string (void *socket, const char *expected)
+{
+    char buf [32];
+    int rc = zmq_recv (socket, buf, sizeof (buf), 0);
+    assert (rc == (int) strlen (expected));
+    assert (memcmp (buf, expected, rc) == 0);
+}
+
+static void send_string (void *socket, const char *data)
+{
+    int rc = zmq_send (socket, data, strlen (data), 0);
+    assert (rc == (int) strlen (data));
+}
+
+static void subscribe (void *sub, void *pub, const char *pattern)
+{
+    int rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, pattern, strlen (pattern));
+    assert (rc == 0);
+
+    char expected [32];
+    expected [0] = 1;
+    strcpy (expected + 1, pattern);
+    recv_string (pub, expected);
+}
+
+static uint64_t messages_sent (void *pub)
+{
+    zmq_xpub_peer_stats_t stats;
+    size_t size = sizeof (stats);
+    int rc = zmq_getsockopt (pub, ZMQ_XPUB_PEER_STATS, &stats, &size);
+    assert (rc == 0);
+    assert (size == sizeof (stats));
+    return stats.sent;
+}
+
+//  Over TCP the pattern mode is negotiated in the handshake, and peers
+//  that disagree about it are not connected.
+static void test_negotiation (void *ctx)
+{
+    void *pub = zmq_socket (ctx, ZMQ_XPUB);
+    assert (pub);
+    int patterns = 1;
+    int rc = zmq_setsockopt (pub, ZMQ_TOPIC_PATTERNS, &patterns,
+        sizeof (patterns));
+    assert (rc == 0);
+    int timeout = 250;
+    rc = zmq_setsockopt (pub, ZMQ_RCVTIMEO, &timeout, sizeof (timeout));
+    assert (rc == 0);
+    rc = zmq_bind (pub, "tcp://127.0.0.1:5561");
+    assert (rc == 0);
+
+    //  The subscription of a subscriber matching prefixes never arrives.
+    void *sub = zmq_socket (ctx, ZMQ_SUB);
+    assert (sub);
+    rc = zmq_connect (sub, "tcp://127.0.0.1:5561");
+    assert (rc == 0);
+    rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, "a.*", 3);
+    assert (rc == 0);
+    char buf [32];
+    rc = zmq_recv (pub, buf, sizeof (buf), 0);
+    assert (rc == -1 && errno == EAGAIN);
+    rc = zmq_close (sub);
+    assert (rc == 0);
+
+    //  A subscriber matching patterns as well is connected.
+    sub = zmq_socket (ctx, ZMQ_SUB);
+    assert (sub);
+    rc = zmq_setsockopt (sub, ZMQ_TOPIC_PATTERNS, &patterns,
+        sizeof (patterns));
+    assert (rc == 0);
+    rc = zmq_connect (sub, "tcp://127.0.0.1:5561");
+    assert (rc == 0);
+    subscribe (sub, pub, "a.*");
+    send_string (pub, "a.b");
+    recv_string (sub, "a.b");
+
+    rc = zmq_close (sub);
+    assert (rc == 0);
+    rc = zmq_close (pub);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *pub = zmq_socket (ctx, ZMQ_XPUB);
+    assert (pub);
+    int patterns = 1;
+    int rc = zmq_setsockopt (pub, ZMQ_TOPIC_PATTERNS, &patterns,
+        sizeof (patterns));
+    assert (rc == 0);
+    rc = zmq_bind (pub, "inproc://patterns");
+    assert (rc == 0);
+
+    void *sub = zmq_socket (ctx, ZMQ_SUB);
+    assert (sub);
+    rc = zmq_setsockopt (sub, ZMQ_TOPIC_PATTERNS, &patterns,
+        sizeof (patterns));
+    assert (rc == 0);
+    patterns = 0;
+    size_t size = sizeof (patterns);
+    rc = zmq_getsockopt (sub, ZMQ_TOPIC_PATTERNS, &patterns, &size);
+    assert (rc == 0);
+    assert (patterns == 1);
+    rc = zmq_connect (sub, "inproc://patterns");
+    assert (rc == 0);
+
+    subscribe (sub, pub, "md.*.us.>");
+    subscribe (sub, pub, "a.b");
+    subscribe (sub, pub, "x.>");
+
+    //  Only the matching topics are sent by the publisher.
+    send_string (pub, "md.1.us.q");
+    send_string (pub, "md.1.eu.q");
+    send_string (pub, "md.1.us");
+    send_string (pub, "a.b");
+    send_string (pub, "a.b.c");
+    send_string (pub, "a");
+    send_string (pub, "x.y.z");
+    send_string (pub, "x");
+    recv_string (sub, "md.1.us.q");
+    recv_string (sub, "a.b");
+    recv_string (sub, "x.y.z");
+    assert (messages_sent (pub) == 3);
+
+    //  Removing a pattern is forwarded and stops the matching.
+    rc = zmq_setsockopt (sub, ZMQ_UNSUBSCRIBE, "a.b", 3);
+    assert (rc == 0);
+    char buf [32];
+    rc = zmq_recv (pub, buf, sizeof (buf), 0);
+    assert (rc == 4 && memcmp (buf, "\0a.b", 4) == 0);
+    send_string (pub, "a.b");
+    send_string (pub, "md.2.us.r.s");
+    recv_string (sub, "md.2.us.r.s");
+    assert (messages_sent (pub) == 4);
+
+    //  The remaining patterns are unsubscribed once the subscriber is gone.
+    rc = zmq_close (sub);
+    assert (rc == 0);
+    int unsubscribed = 0;
+    for (int i = 0; i != 2; i++) {
+        rc = zmq_recv (pub, buf, sizeof (buf), 0);
+        assert (rc > 0 && buf [0] == 0);
+        if (rc == 10 && memcmp (buf + 1, "md.*.us.>", 9) == 0)
+            unsubscribed |= 1;
+        if (rc == 4 && memcmp (buf + 1, "x.>", 3) == 0)
+            unsubscribed |= 2;
+    }
+    assert (unsubscribed == 3);
+
+    rc = zmq_close (pub);
+    assert (rc == 0);
+
+    test_negotiation (ctx);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+//  Fills the pipe up to the high water mark and drains it again, twice,
+//  so that the reserved chunks are both used and recycled.
+static void fill_and_drain (void *push, void *pull, int count)
+{
+    for (int round = 0; round != 2; round++) {
+        for (int i = 0; i != count; i++) {
+            int rc = zmq_send (push, &i, sizeof (i), 0);
+            assert (rc == sizeof (i));
+        }
+        for (int i = 0; i != count; i++) {
+            int value;
+            int rc = zmq_recv (pull, &value, sizeof (value), 0);
+            assert (rc == sizeof (value));
+            assert (value == i);
+        }
+    }
+}
+
+static void test_transport (void *ctx, const char *endpoint, int hwm,
+    int target_delay)
+{
+    int warmup = 1;
+    int timeout = 1000;
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_setsockopt (pull, ZMQ_WARMUP, &warmup, sizeof (warmup));
+    assert (rc == 0);
+    rc = zmq_setsockopt (pull, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_setsockopt (pull, ZMQ_RCVTIMEO, &timeout, sizeof (timeout));
+    assert (rc == 0);
+    rc = zmq_bind (pull, endpoint);
+    assert (rc == 0);
+    char last_endpoint [256];
+    size_t size = sizeof (last_endpoint);
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, last_endpoint, &size);
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_setsockopt (push, ZMQ_WARMUP, &warmup, sizeof (warmup));
+    assert (rc == 0);
+    rc = zmq_setsockopt (push, ZMQ_SNDHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    if (target_delay) {
+        rc = zmq_setsockopt (push, ZMQ_HWM_TARGET_DELAY, &target_delay,
+            sizeof (target_delay));
+        assert (rc == 0);
+    }
+    rc = zmq_connect (push, last_endpoint);
+    assert (rc == 0);
+
+    fill_and_drain (push, pull, hwm ? hwm : 1000);
+
+    close_zero_linger (push);
+    close_zero_linger (pull);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *s = zmq_socket (ctx, ZMQ_PUSH);
+    assert (s);
+
+    int value;
+    size_t size = sizeof (value);
+    int rc = zmq_getsockopt (s, ZMQ_WARMUP, &value, &size);
+    assert (rc == 0);
+    assert (value == 0);
+
+    value = 2;
+    rc = zmq_setsockopt (s, ZMQ_WARMUP, &value, sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+
+    value = 1;
+    rc = zmq_setsockopt (s, ZMQ_WARMUP, &value, sizeof (value));
+    assert (rc == 0);
+    rc = zmq_getsockopt (s, ZMQ_WARMUP, &value, &size);
+    assert (rc == 0);
+    assert (value == 1);
+
+    rc = zmq_close (s);
+    assert (rc == 0);
+
+    test_transport (ctx, "inproc://warmup", 1000, 0);
+    test_transport (ctx, "inproc://warmup-unbounded", 0, 0);
+    test_transport (ctx, "tcp://127.0.0.1:*", 1000, 0);
+    test_transport (ctx, "tcp://127.0.0.1:*", 5000, 10);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,288 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Creates an XPUB socket with a broadcast ring of the given capacity.
+static void *create_pub (void *ctx, const char *endpoint, int capacity,
+    int block)
+{
+    void *pub = zmq_socket (ctx, ZMQ_XPUB);
+    assert (pub);
+    int rc = zmq_setsockopt (pub, ZMQ_XPUB_BROADCAST_RING, &capacity,
+        sizeof (capacity));
+    assert (rc == 0);
+    rc = zmq_setsockopt (pub, ZMQ_XPUB_BROADCAST_BLOCK, &block,
+        sizeof (block));
+    assert (rc == 0);
+    rc = zmq_bind (pub, endpoint);
+    assert (rc == 0);
+    return pub;
+}
+
+//  Connects a socket of the given type subscribed to the topic and waits
+//  till the subscription reaches the publisher.
+static void *create_sub (void *ctx, void *pub, const char *endpoint,
+    int type, const char *topic)
+{
+    void *sub = zmq_socket (ctx, type);
+    assert (sub);
+    int rc = zmq_connect (sub, endpoint);
+    assert (rc == 0);
+    if (type == ZMQ_SUB) {
+        rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, topic, strlen (topic));
+        assert (rc == 0);
+    }
+    else {
+        char buf [8] = {1};
+        memcpy (buf + 1, topic, strlen (topic));
+        rc = zmq_send (sub, buf, strlen (topic) + 1, 0);
+        assert (rc == (int) strlen (topic) + 1);
+    }
+
+    char buf [8];
+    rc = zmq_recv (pub, buf, sizeof (buf), 0);
+    assert (rc == (int) strlen (topic) + 1);
+    assert (buf [0] == 1 && memcmp (buf + 1, topic, rc - 1) == 0);
+    return sub;
+}
+
+static void expect_message (void *sub, const char *topic, const char *body)
+{
+    char buf [8];
+    int rc = zmq_recv (sub, buf, sizeof (buf), 0);
+    assert (rc == (int) strlen (topic));
+    assert (memcmp (buf, topic, rc) == 0);
+    int more;
+    size_t more_size = sizeof (more);
+    rc = zmq_getsockopt (sub, ZMQ_RCVMORE, &more, &more_size);
+    assert (rc == 0);
+    assert (more == 1);
+    rc = zmq_recv (sub, buf, sizeof (buf), 0);
+    assert (rc == (int) strlen (body));
+    assert (memcmp (buf, body, rc) == 0);
+    rc = zmq_getsockopt (sub, ZMQ_RCVMORE, &more, &more_size);
+    assert (rc == 0);
+    assert (more == 0);
+}
+
+static void expect_nothing (void *sub)
+{
+    char buf [8];
+    int rc = zmq_recv (sub, buf, sizeof (buf), ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+}
+
+void test_options (void *ctx)
+{
+    void *pub = zmq_socket (ctx, ZMQ_XPUB);
+    assert (pub);
+
+    int value;
+    size_t size = sizeof (value);
+    int rc = zmq_getsockopt (pub, ZMQ_XPUB_BROADCAST_RING, &value, &size);
+    assert (rc == 0);
+    assert (value == 0);
+    rc = zmq_getsockopt (pub, ZMQ_XPUB_BROADCAST_BLOCK, &value, &size);
+    assert (rc == 0);
+    assert (value == 0);
+
+    value = -1;
+    rc = zmq_setsockopt (pub, ZMQ_XPUB_BROADCAST_RING, &value,
+        sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+    value = 64;
+    rc = zmq_setsockopt (pub, ZMQ_XPUB_BROADCAST_RING, &value,
+        sizeof (value));
+    assert (rc == 0);
+    rc = zmq_getsockopt (pub, ZMQ_XPUB_BROADCAST_RING, &value, &size);
+    assert (rc == 0);
+    assert (value == 64);
+
+    //  The ring can't be changed once a subscriber uses it.
+    rc = zmq_bind (pub, "inproc://options");
+    assert (rc == 0);
+    void *sub = create_sub (ctx, pub, "inproc://options", ZMQ_SUB, "A");
+    value = 128;
+    rc = zmq_setsockopt (pub, ZMQ_XPUB_BROADCAST_RING, &value,
+        sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+    value = 1;
+    rc = zmq_setsockopt (pub, ZMQ_XPUB_BROADCAST_BLOCK, &value,
+        sizeof (value));
+    assert (rc == -1 && errno == EINVAL);
+
+    close_zero_linger (sub);
+    close_zero_linger (pub);
+}
+
+void test_filtering (void *ctx)
+{
+    void *pub = create_pub (ctx, "inproc://filtering", 64, 0);
+    void *sub_a = create_sub (ctx, pub, "inproc://filtering", ZMQ_SUB, "A");
+    void *sub_b = create_sub (ctx, pub, "inproc://filtering", ZMQ_SUB, "B");
+    void *xsub = create_sub (ctx, pub, "inproc://filtering", ZMQ_XSUB, "AB");
+
+    const char *topics [] = {"A", "B", "C", "AB"};
+    for (int i = 0; i < 4; i++) {
+        int rc = zmq_send (pub, topics [i], strlen (topics [i]), ZMQ_SNDMORE);
+        assert (rc == (int) strlen (topics [i]));
+        rc = zmq_send (pub, "body", 4, 0);
+        assert (rc == 4);
+    }
+
+    expect_message (sub_a, "A", "body");
+    expect_message (sub_a, "AB", "body");
+    expect_nothing (sub_a);
+    expect_message (sub_b, "B", "body");
+    expect_nothing (sub_b);
+    expect_message (xsub, "AB", "body");
+    expect_nothing (xsub);
+
+    close_zero_linger (sub_a);
+    close_zero_linger (sub_b);
+    close_zero_linger (xsub);
+    close_zero_linger (pub);
+}
+
+void test_connect_before_bind (void *ctx)
+{
+    void *sub = zmq_socket (ctx, ZMQ_SUB);
+    assert (sub);
+    int rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, "A", 1);
+    assert (rc == 0);
+    rc = zmq_connect (sub, "inproc://early");
+    assert (rc == 0);
+
+    void *pub = create_pub (ctx, "inproc://early", 64, 0);
+    char buf [8];
+    rc = zmq_recv (pub, buf, sizeof (buf), 0);
+    assert (rc == 2 && buf [0] == 1 && buf [1] == 'A');
+
+    rc = zmq_send (pub, "A", 1, ZMQ_SNDMORE);
+    assert (rc == 1);
+    rc = zmq_send (pub, "body", 4, 0);
+    assert (rc == 4);
+    expect_message (sub, "A", "body");
+
+    close_zero_linger (sub);
+    close_zero_linger (pub);
+}
+
+void test_drop (void *ctx)
+{
+    void *pub = create_pub (ctx, "inproc://drop", 16, 0);
+    void *sub = create_sub (ctx, pub, "inproc://drop", ZMQ_SUB, "A");
+
+    //  The subscriber doesn't read, so it gets the first messages only.
+    for (int i = 0; i < 100; i++) {
+        int rc = zmq_send (pub, "A", 1, ZMQ_DONTWAIT);
+        assert (rc == 1);
+    }
+
+    char buf [8];
+    for (int i = 0; i < 16; i++) {
+        int rc = zmq_recv (sub, buf, sizeof (buf), 0);
+        assert (rc == 1);
+    }
+    expect_nothing (sub);
+
+    //  Once drained, the ring takes messages again.
+    int rc = zmq_send (pub, "A", 1, 0);
+    assert (rc == 1);
+    rc = zmq_recv (sub, buf, sizeof (buf), 0);
+    assert (rc == 1);
+
+    close_zero_linger (sub);
+    close_zero_linger (pub);
+}
+
+static void receiver (void *sub)
+{
+    msleep (SETTLE_TIME);
+    char buf [8];
+    for (int i = 0; i < 100; i++) {
+        int rc = zmq_recv (sub, buf, sizeof (buf), 0);
+        assert (rc == 1);
+    }
+}
+
+void test_block (void *ctx)
+{
+    void *pub = create_pub (ctx, "inproc://block", 4, 1);
+    void *sub = create_sub (ctx, pub, "inproc://block", ZMQ_SUB, "A");
+
+    for (int i = 0; i < 4; i++) {
+        int rc = zmq_send (pub, "A", 1, ZMQ_DONTWAIT);
+        assert (rc == 1);
+    }
+    int rc = zmq_send (pub, "A", 1, ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+
+    zmq_pollitem_t items [] = {{pub, 0, ZMQ_POLLOUT, 0}};
+    rc = zmq_poll (items, 1, 0);
+    assert (rc == 0);
+
+    char buf [8];
+    rc = zmq_recv (sub, buf, sizeof (buf), 0);
+    assert (rc == 1);
+    rc = zmq_poll (items, 1, 1000);
+    assert (rc == 1);
+    for (int i = 0; i < 3; i++) {
+        rc = zmq_recv (sub, buf, sizeof (buf), 0);
+        assert (rc == 1);
+    }
+
+    //  Blocking sends wait for the subscriber to catch up.
+    void *thread = zmq_threadstart (&receiver, sub);
+    for (int i = 0; i < 100; i++) {
+        rc = zmq_send (pub, "A", 1, 0);
+        assert (rc == 1);
+    }
+    zmq_threadclose (thread);
+    expect_nothing (sub);
+
+    //  A closed subscriber doesn't hold the publisher back.
+    close_zero_linger (sub);
+    for (int i = 0; i < 100; i++) {
+        rc = zmq_send (pub, "A", 1, 0);
+        assert (rc == 1);
+    }
+
+    close_zero_linger (pub);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_options (ctx);
+    test_filtering (ctx);
+    test_connect_before_bind (ctx);
+    test_drop (ctx);
+    test_block (ctx);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Creates an XPUB socket with a small HWM and a SUB socket subscribed to
+//  "A" that connects to it and never reads. Waits till the subscription
+//  is in place.
+static void setup (void *ctx, const char *endpoint, void **pub, void **sub)
+{
+    *pub = zmq_socket (ctx, ZMQ_XPUB);
+    assert (*pub);
+    int hwm = 10;
+    int rc = zmq_setsockopt (*pub, ZMQ_SNDHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_bind (*pub, endpoint);
+    assert (rc == 0);
+
+    *sub = zmq_socket (ctx, ZMQ_SUB);
+    assert (*sub);
+    rc = zmq_setsockopt (*sub, ZMQ_RCVHWM, &hwm, sizeof (hwm));
+    assert (rc == 0);
+    rc = zmq_setsockopt (*sub, ZMQ_SUBSCRIBE, "A", 1);
+    assert (rc == 0);
+    rc = zmq_connect (*sub, endpoint);
+    assert (rc == 0);
+
+    char buf [8];
+    rc = zmq_recv (*pub, buf, sizeof (buf), 0);
+    assert (rc == 2 && buf [0] == 1 && buf [1] == 'A');
+}
+
+static void publish (void *pub, int count)
+{
+    for (int i = 0; i < count; i++) {
+        int rc = zmq_send (pub, "A", 1, 0);
+        assert (rc == 1);
+    }
+}
+
+//  Waits for the unsubscription XPUB generates once the subscriber is gone.
+//  Over inproc, the subscriber has to process commands for the termination
+//  of the pipe to complete, which querying ZMQ_EVENTS does.
+static void expect_eviction (void *pub, void *sub)
+{
+    char buf [8];
+    int events;
+    size_t events_size = sizeof (events);
+    int rc = -1;
+    for (int i = 0; i < 100 && rc < 0; i++) {
+        rc = zmq_getsockopt (sub, ZMQ_EVENTS, &events, &events_size);
+        assert (rc == 0);
+        rc = zmq_recv (pub, buf, sizeof (buf), ZMQ_DONTWAIT);
+        if (rc < 0) {
+            assert (errno == EAGAIN);
+            msleep (10);
+        }
+    }
+    assert (rc == 2 && buf [0] == 0 && buf [1] == 'A');
+
+    zmq_xpub_peer_stats_t stats [2];
+    size_t size = sizeof (stats);
+    rc = zmq_getsockopt (pub, ZMQ_XPUB_PEER_STATS, stats, &size);
+    assert (rc == 0);
+    assert (size == 0);
+}
+
+void test_stats (void *ctx)
+{
+    void *pub, *sub;
+    setup (ctx, "inproc://stats", &pub, &sub);
+
+    publish (pub, 100);
+
+    zmq_xpub_peer_stats_t stats [2];
+    size_t size = sizeof (stats);
+    int rc = zmq_getsockopt (pub, ZMQ_XPUB_PEER_STATS, stats, &size);
+    assert (rc == 0);
+    assert (size == sizeof (zmq_xpub_peer_stats_t));
+    assert (stats [0].sent > 0);
+    assert (stats [0].dropped > 0);
+    assert (stats [0].sent + stats [0].dropped == 100);
+    assert (stats [0].paced == 0);
+
+    //  A buffer too small for a single record gets nothing.
+    size = sizeof (zmq_xpub_peer_stats_t) - 1;
+    rc = zmq_getsockopt (pub, ZMQ_XPUB_PEER_STATS, stats, &size);
+    assert (rc == 0);
+    assert (size == 0);
+
+    close_zero_linger (sub);
+    close_zero_linger (pub);
+}
+
+void test_pacing (void *ctx)
+{
+    void *pub, *sub;
+    setup (ctx, "inproc://pacing", &pub, &sub);
+
+    //  A burst of up to a tenth of a second's worth of messages passes.
+    int rate = 50;
+    int rc = zmq_setsockopt (pub, ZMQ_XPUB_PACING, &rate, sizeof (rate));
+    assert (rc == 0);
+    publish (pub, 8);
+
+    zmq_xpub_peer_stats_t stats [1];
+    size_t size = sizeof (stats);
+    rc = zmq_getsockopt (pub, ZMQ_XPUB_PEER_STATS, stats, &size);
+    assert (rc == 0);
+    assert (size == sizeof (stats));
+    assert (stats [0].sent + stats [0].paced == 8);
+    assert (stats [0].sent >= 5 && stats [0].sent <= 6);
+    assert (stats [0].dropped == 0);
+
+    char buf [8];
+    for (int i = 0; i < (int) stats [0].sent; i++) {
+        rc = zmq_recv (sub, buf, sizeof (buf), 0);
+        assert (rc == 1);
+    }
+
+    close_zero_linger (sub);
+    close_zero_linger (pub);
+}
+
+void test_evict_drop_ratio (void *ctx)
+{
+    void *pub, *sub;
+    setup (ctx, "inproc://ratio", &pub, &sub);
+
+    int ratio = 50;
+    int rc = zmq_setsockopt (pub, ZMQ_XPUB_EVICT_DROP_RATIO, &ratio,
+        sizeof (ratio));
+    assert (rc == 0);
+    publish (pub, 1000);
+
+    expect_eviction (pub, sub);
+
+    close_zero_linger (sub);
+    close_zero_linger (pub);
+}
+
+void test_evict_queue_age (void *ctx)
+{
+    void *pub, *sub;
+    setup (ctx, "inproc://age", &pub, &sub);
+
+    int age = 50;
+    int rc = zmq_setsockopt (pub, ZMQ_XPUB_EVICT_QUEUE_AGE, &age,
+        sizeof (age));
+    assert (rc == 0);
+    size_t size = sizeof (age);
+    rc = zmq_getsockopt (pub, ZMQ_XPUB_EVICT_QUEUE_AGE, &age, &size);
+    assert (rc == 0);
+    assert (age == 50);
+    publish (pub, 30);
+    msleep (100);
+    publish (pub, 1);
+
+    expect_eviction (pub, sub);
+
+    close_zero_linger (sub);
+    close_zero_linger (pub);
+}
+
+void test_evict_queue_age_on_send (void *ctx)
+{
+    void *pub, *sub;
+    setup (ctx, "inproc://age_on_send", &pub, &sub);
+
+    int age = 50;
+    int rc = zmq_setsockopt (pub, ZMQ_XPUB_EVICT_QUEUE_AGE, &age,
+        sizeof (age));
+    assert (rc == 0);
+    publish (pub, 30);
+    msleep (100);
+
+    //  The subscriber doesn't get this one, so nothing is dropped for it,
+    //  but it's still been full for too long.
+    rc = zmq_send (pub, "B", 1, 0);
+    assert (rc == 1);
+
+    expect_eviction (pub, sub);
+
+    close_zero_linger (sub);
+    close_zero_linger (pub);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    test_stats (ctx);
+    test_pacing (ctx);
+    test_evict_drop_ratio (ctx);
+    test_evict_queue_age (ctx);
+    test_evict_queue_age_on_send (ctx);
+
+    int rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+//  Decodes a file written by zmq_ctx_flight_recorder_dump and prints the
+//  records of all threads merged in chronological order. Times are shown
+//  in microseconds relative to the moment of the dump. The file format is
+//  described in src/flight_recorder.cpp.
+
+struct record_t
+{
+    unsigned long long time;
+    unsigned long long object;
+    unsigned int thread;
+    unsigned int event;
+    unsigned int value;
+};
+
+static bool earlier (const record_t &a_, const record_t &b_)
+{
+    return a_.time < b_.time;
+}
+
+static unsigned int get_uint32 (const unsigned char *buf_)
+{
+    return ((unsigned int) buf_ [0] << 24) | ((unsigned int) buf_ [1] << 16) |
+        ((unsigned int) buf_ [2] << 8) | (unsigned int) buf_ [3];
+}
+
+static unsigned long long get_uint64 (const unsigned char *buf_)
+{
+    return ((unsigned long long) get_uint32 (buf_) << 32) |
+        get_uint32 (buf_ + 4);
+}
+
+//  Keep in sync with flight_recorder_t::event_t.
+static const char *event_name (unsigned int event_)
+{
+    static const char *names [] = {"?", "command", "activate_read",
+        "activate_write", "hwm_reached", "engine_read", "engine_write",
+        "send_blocked", "recv_blocked"};
+    return event_ < sizeof names / sizeof names [0] ? names [event_] : "?";
+}
+
+//  Keep in sync with command_t::type_t.
+static const char *command_name (unsigned int type_)
+{
+    static const char *names [] = {"stop", "plug", "own", "attach", "bind",
+        "activate_read", "activate_write", "hiccup", "pipe_term",
+        "pipe_term_ack", "term_req", "term", "term_ack", "reap", "reaped",
+        "inproc_connected", "done"};
+    return type_ < sizeof names / sizeof names [0] ? names [type_] : "?";
+}
+
+int main (int argc, char *argv [])
+{
+    if (argc != 2) {
+        printf ("usage: flight_decode <dump-file>\n");
+        return 1;
+    }
+
+    FILE *file = fopen (argv [1], "rb");
+    if (!file) {
+        printf ("cannot open %s\n", argv [1]);
+        return 1;
+    }
+
+    unsigned char header [24];
+    if (fread (header, 1, sizeof header, file) != sizeof header
+    ||  memcmp (header, "ZMQFR\0\0\1", 8) != 0) {
+        printf ("%s is not a flight recorder dump\n", argv [1]);
+        return 1;
+    }
+    const unsigned long long ticks_per_us = get_uint64 (header + 8);
+    const unsigned long long dump_time = get_uint64 (header + 16);
+    if (ticks_per_us == 0) {
+        printf ("%s is corrupted\n", argv [1]);
+        return 1;
+    }
+
+    std::vector <record_t> records;
+    unsigned char section [8];
+    while (fread (section, 1, sizeof section, file) == sizeof section) {
+        const unsigned int thread = get_uint32 (section);
+        const unsigned int count = get_uint32 (section + 4);
+        for (unsigned int i = 0; i != count; i++) {
+            unsigned char buf [24];
+            if (fread (buf, 1, sizeof buf, file) != sizeof buf) {
+                printf ("%s is truncated\n", argv [1]);
+                return 1;
+            }
+            record_t record;
+            record.time = get_uint64 (buf);
+            record.object = get_uint64 (buf + 8);
+            record.thread = thread;
+            record.event = get_uint32 (buf + 16);
+            record.value = get_uint32 (buf + 20);
+            records.push_back (record);
+        }
+    }
+    fclose (file);
+
+    std::stable_sort (records.begin (), records.end (), earlier);
+
+    printf ("%14s %6s %18s  %-15s %s\n",
+        "time [us]", "thread", "object", "event", "value");
+    for (size_t i = 0; i != records.size (); i++) {
+        const record_t &r = records [i];
+        const double time = r.time >= dump_time ?
+            (double) (r.time - dump_time) / ticks_per_us :
+            -(double) (dump_time - r.time) / ticks_per_us;
+        printf ("%14.3f %6u 0x%016llx  %-15s ", time, r.thread, r.object,
+            event_name (r.event));
+        if (r.event == 1)
+            printf ("%s\n", command_name (r.value));
+        else
+            printf ("%u\n", r.value);
+    }
+    return 0;
+}